@@ -148,6 +148,7 @@ endif()
 if(UNIX)
 	cmake_push_check_state()
 	list(APPEND CMAKE_REQUIRED_DEFINITIONS -D_GNU_SOURCE)
+	check_symbol_exists("memfd_create"  "sys/mman.h" HAVE_MEMFD_CREATE)
 	check_symbol_exists("memmem"        "string.h"   HAVE_MEMMEM)
 	check_symbol_exists("memrchr"       "string.h"   HAVE_MEMRCHR)
 	check_symbol_exists("strchrnul"     "string.h"   HAVE_STRCHRNUL)
@@ -162,6 +163,8 @@ include(CheckStructHasMember)
 check_struct_has_member("struct stat"     st_blksize     sys/stat.h   HAVE_STRUCT_STAT_ST_BLKSIZE)
 check_struct_has_member("struct stat"     st_birthtime   sys/stat.h   HAVE_STRUCT_STAT_ST_BIRTHTIME)
 check_struct_has_member("struct stat"     __st_birthtime sys/stat.h   HAVE_STRUCT_STAT___ST_BIRTHTIME)
+check_struct_has_member("struct stat"     st_mtim        sys/stat.h   HAVE_STRUCT_STAT_ST_MTIM)
+check_struct_has_member("struct stat"     st_mtimespec   sys/stat.h   HAVE_STRUCT_STAT_ST_MTIMESPEC)
 check_struct_has_member("struct tm"       tm_zone        time.h       HAVE_STRUCT_TM_TM_ZONE)
 check_struct_has_member("struct tm"       tm_gmtoff      time.h       HAVE_STRUCT_TM_TM_GMTOFF)
 
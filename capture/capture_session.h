@@ -21,6 +21,7 @@
 
 #include <epan/fifo_string_cache.h>
 #include <wsutil/processes.h>
+#include <wsutil/shm_ring.h>
 
 #include <epan/cfile.h>
 
@@ -63,6 +64,25 @@ typedef void (*new_packets_fn)(capture_session *cap_session, int to_read);
 typedef void (*drops_fn)(capture_session *cap_session, uint32_t dropped,
                          const char *interface_name);
 
+/**
+ * How full the queue of packets between a capture thread of the capture
+ * child and the thread writing them out is.
+ */
+typedef struct {
+    uint32_t packets;       /**< Packets queued now */
+    uint32_t bytes;         /**< Packet bytes queued now */
+    uint32_t max_packets;   /**< Most packets queued so far */
+    uint32_t max_bytes;     /**< Most packet bytes queued so far */
+    uint32_t size;          /**< Size of the queue's buffer */
+} capture_queue_usage;
+
+/**
+ * Capture child told us how full the packet queue of an interface is.
+ */
+typedef void (*queue_usage_fn)(capture_session *cap_session,
+                               const capture_queue_usage *usage,
+                               const char *interface_name);
+
 /**
  * Capture child told us that a warning or error has occurred while
  * starting or running the capture.
@@ -112,6 +132,7 @@ struct _capture_session {
     wtap_rec rec;                         /**< record we're reading packet information into */
     struct wtap *wtap;                    /**< current wtap file */
     struct _info_data *cap_data_info;     /**< stats for this capture */
+    ws_shm_ring *shm_ring;                /**< shared-memory mirror of the capture file, if any */
 
     // If the user wants to ignore duplicate frames, we need these.
     fifo_string_cache_t frame_dup_cache;
@@ -128,6 +149,7 @@ struct _capture_session {
     new_file_fn new_file;
     new_packets_fn new_packets;
     drops_fn drops;
+    queue_usage_fn queue_usage;
     message_fn error;
     cfilter_error_fn cfilter_error;
     message_fn warning;
@@ -138,8 +160,8 @@ struct _capture_session {
 extern void
 capture_session_init(capture_session *cap_session, capture_file *cf,
                      new_file_fn new_file, new_packets_fn new_packets,
-                     drops_fn drops, message_fn error,
-                     cfilter_error_fn cfilter_error,
+                     drops_fn drops, queue_usage_fn queue_usage,
+                     message_fn error, cfilter_error_fn cfilter_error,
                      message_fn warning, toolbar_control_fn toolbar,
                      closed_fn closed);
 
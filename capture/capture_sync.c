@@ -120,8 +120,8 @@ static void (*fetch_dumpcap_pid)(ws_process_id);
 void
 capture_session_init(capture_session *cap_session, capture_file *cf,
                      new_file_fn new_file, new_packets_fn new_packets,
-                     drops_fn drops, message_fn error,
-                     cfilter_error_fn cfilter_error,
+                     drops_fn drops, queue_usage_fn queue_usage,
+                     message_fn error, cfilter_error_fn cfilter_error,
                      message_fn warning, toolbar_control_fn toolbar,
                      closed_fn closed)
 {
@@ -143,12 +143,14 @@ capture_session_init(capture_session *cap_session, capture_file *cf,
     cap_session->new_file                        = new_file;
     cap_session->new_packets                     = new_packets;
     cap_session->drops                           = drops;
+    cap_session->queue_usage                     = queue_usage;
     cap_session->error                           = error;
     cap_session->cfilter_error                   = cfilter_error;
     cap_session->warning                         = warning;
     cap_session->toolbar                         = toolbar;
     cap_session->closed                          = closed;
     cap_session->frame_cksum                     = NULL;
+    cap_session->shm_ring                        = NULL;
 
     g_queue_init(&cap_session->toolbar_queue);
 }
@@ -201,6 +203,9 @@ void capture_process_finished(capture_session *cap_session)
 
     cap_session->closed(cap_session, message->str);
     g_string_free(message, TRUE);
+    /* Readers that still have the file open hold their own reference. */
+    ws_shm_ring_unref(cap_session->shm_ring);
+    cap_session->shm_ring = NULL;
     g_free(capture_opts->closed_msg);
     capture_opts->closed_msg = NULL;
     capture_opts->stop_after_extcaps = false;
@@ -965,6 +970,30 @@ sync_pipe_start(capture_options *capture_opts, GPtrArray *capture_comments,
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->compress_type);
     }
 
+#if !defined(_WIN32) && !defined(DEBUG_CHILD)
+    /*
+     * If we read the capture file while it's being written, have dumpcap
+     * mirror it into shared memory, so that we usually don't have to read
+     * back what it just wrote. The fd we pass is a non-close-on-exec
+     * duplicate, so only dumpcap inherits it.
+     */
+    int shm_ring_child_fd = -1;
+    ws_shm_ring_unref(cap_session->shm_ring);
+    cap_session->shm_ring = NULL;
+    if (capture_opts->real_time_mode && !capture_opts->compress_type) {
+        cap_session->shm_ring = ws_shm_ring_create(WS_SHM_RING_DEFAULT_SIZE);
+    }
+    if (cap_session->shm_ring != NULL) {
+        shm_ring_child_fd = ws_dup(ws_shm_ring_fd(cap_session->shm_ring));
+    }
+    if (shm_ring_child_fd != -1) {
+        char shm_ring_fd_str[ARGV_NUMBER_LEN];
+        snprintf(shm_ring_fd_str, ARGV_NUMBER_LEN, "%d", shm_ring_child_fd);
+        argv = sync_pipe_add_arg(argv, &argc, "--shm-ring");
+        argv = sync_pipe_add_arg(argv, &argc, shm_ring_fd_str);
+    }
+#endif
+
     int ret;
     char* msg;
 #ifdef _WIN32
@@ -973,11 +1002,18 @@ sync_pipe_start(capture_options *capture_opts, GPtrArray *capture_comments,
 #else
     ret = sync_pipe_open_command(argv, NULL, &sync_pipe_read_io, NULL,
                                  &cap_session->fork_child, NULL, &msg, update_cb);
+#ifndef DEBUG_CHILD
+    if (shm_ring_child_fd != -1) {
+        ws_close(shm_ring_child_fd);
+    }
+#endif
 #endif
 
     if (ret == -1) {
         report_failure("%s", msg);
         g_free(msg);
+        ws_shm_ring_unref(cap_session->shm_ring);
+        cap_session->shm_ring = NULL;
         return false;
     }
 
@@ -2036,6 +2072,28 @@ sync_pipe_input_cb(GIOChannel *pipe_io, capture_session *cap_session)
         cap_session->drops(cap_session, num, name);
         break;
         }
+    case SP_QUEUE_USAGE: {
+        /* "packets:bytes:max_packets:max_bytes:size:name" */
+        capture_queue_usage usage;
+        uint32_t *fields[] = { &usage.packets, &usage.bytes, &usage.max_packets,
+                               &usage.max_bytes, &usage.size };
+        const char *p = buffer;
+        const char *end;
+        size_t i;
+
+        for (i = 0; i < G_N_ELEMENTS(fields); i++) {
+            if (!ws_strtou32(p, &end, fields[i]) || end[0] != ':')
+                break;
+            p = end + 1;
+        }
+        if (i == G_N_ELEMENTS(fields)) {
+            if (cap_session->queue_usage != NULL)
+                cap_session->queue_usage(cap_session, &usage, p);
+        } else {
+            ws_warning("Bad queue usage message \"%s\"", buffer);
+        }
+        break;
+        }
     default:
         if (g_ascii_isprint(indicator))
             ws_warning("Unknown indicator '%c'", indicator);
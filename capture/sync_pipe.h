@@ -52,6 +52,7 @@ extern "C" {
 #define SP_BAD_FILTER   'B'     /* error message for bad capture filter */
 #define SP_PACKET_COUNT 'P'     /* count of packets captured since last message */
 #define SP_DROPS        'D'     /* count of packets dropped in capture */
+#define SP_QUEUE_USAGE  'U'     /* packet queue occupancy and high-water marks of an interface */
 #define SP_SUCCESS      'S'     /* success indication, no extra data */
 #define SP_TOOLBAR_CTRL 'T'     /* interface toolbar control packet */
 #define SP_IFACE_LIST   'I'     /* interface list */
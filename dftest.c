@@ -58,6 +58,7 @@ static int opt_optimize = 1;
 static int opt_show_types;
 static int opt_dump_refs;
 static int opt_dump_macros;
+static int opt_first_match;
 
 static int64_t elapsed_expand;
 static int64_t elapsed_compile;
@@ -119,6 +120,8 @@ print_usage(void)
      * print empty reference vectors. */
     fprintf(fp, "      --refs          dump some runtime data structures\n");
     fprintf(fp, "      --file <path>   read filters line-by-line from a file (use '-' for stdin)\n");
+    fprintf(fp, "      --first-match   combine the filters read with --file into one program\n");
+    fprintf(fp, "                      that finds the first of them to match\n");
     fprintf(fp, "  -h, --help          display this help and exit\n");
     fprintf(fp, "  -v, --version       print version\n");
     fprintf(fp, "\n");
@@ -254,6 +257,18 @@ optarg_to_digit(const char *arg, int* digit)
     return true;
 }
 
+static uint16_t
+dump_flags(void)
+{
+    uint16_t flags = 0;
+
+    if (opt_show_types)
+        flags |= DF_DUMP_SHOW_FTYPE;
+    if (opt_dump_refs)
+        flags |= DF_DUMP_REFERENCES;
+    return flags;
+}
+
 static int
 test_filter(const char *text)
 {
@@ -289,13 +304,7 @@ test_filter(const char *text)
     if (opt_syntax_tree)
         print_syntax_tree(df);
 
-    uint16_t dump_flags = 0;
-    if (opt_show_types)
-        dump_flags |= DF_DUMP_SHOW_FTYPE;
-    if (opt_dump_refs)
-        dump_flags |= DF_DUMP_REFERENCES;
-
-    dfilter_dump(stdout, df, dump_flags);
+    dfilter_dump(stdout, df, dump_flags());
 
     print_warnings(df);
 
@@ -313,6 +322,41 @@ fail:
     return WS_EXIT_INVALID_FILTER;
 }
 
+/* Combine the filters the way the coloring rules are, and dump the
+ * program. */
+static int
+test_first_match(GPtrArray *texts)
+{
+    GPtrArray   *filters = g_ptr_array_new_with_free_func((GDestroyNotify)dfilter_free);
+    char        *expanded_text;
+    dfilter_t   *df;
+    int          exit_status = EXIT_SUCCESS;
+
+    for (unsigned i = 0; i < texts->len; i++) {
+        const char *text = g_ptr_array_index(texts, i);
+
+        printf("Filter %u:\n %s\n\n", i, text);
+        expanded_text = expand_filter(text);
+        df = NULL;
+        if (expanded_text == NULL || !compile_filter(expanded_text, &df)) {
+            g_free(expanded_text);
+            exit_status = WS_EXIT_INVALID_FILTER;
+            goto out;
+        }
+        g_free(expanded_text);
+        /* An empty filter never matches. */
+        g_ptr_array_add(filters, df);
+    }
+
+    df = dfilter_combine_first_match((dfilter_t **)filters->pdata, filters->len);
+    dfilter_dump(stdout, df, dump_flags());
+    dfilter_free(df);
+
+out:
+    g_ptr_array_free(filters, true);
+    return exit_status;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -337,6 +381,7 @@ main(int argc, char **argv)
         { "types",    ws_no_argument,   0, 2000 },
         { "refs",     ws_no_argument,   0, 3000 },
         { "file",     ws_required_argument, 0, 4000 },
+        { "first-match", ws_no_argument, 0, 5000 },
         LONGOPT_WSLOG
         { NULL,       0,                0,  0   }
     };
@@ -458,6 +503,9 @@ main(int argc, char **argv)
             case 4000:
                 path = ws_optarg;
                 break;
+            case 5000:
+                opt_first_match = 1;
+                break;
             case 'v':
                 show_version();
                 return EXIT_SUCCESS;
@@ -562,6 +610,7 @@ main(int argc, char **argv)
             }
         }
         bool first = true;
+        GPtrArray *texts = g_ptr_array_new_with_free_func(g_free);
 #ifdef HAVE_GETLINE
         char *line = NULL;
         size_t len = 0;
@@ -570,6 +619,10 @@ main(int argc, char **argv)
         char line[MAX_LINELEN];
         while (fgetline(line, sizeof(line), filter_p) >= 0) {
 #endif
+            if (opt_first_match) {
+                g_ptr_array_add(texts, g_strchomp(g_strdup(line)));
+                continue;
+            }
             if (first) {
                 first = false;
             } else {
@@ -584,6 +637,9 @@ main(int argc, char **argv)
         g_free(line);
 #endif
         fclose(filter_p);
+        if (opt_first_match)
+            exit_status = test_first_match(texts);
+        g_ptr_array_free(texts, true);
     } else {
 
         /* Check again for filter on command line */
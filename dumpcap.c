@@ -39,6 +39,7 @@
 #include <wsutil/socket.h>
 #include <wsutil/wslog.h>
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 
 #ifdef HAVE_LIBCAP
 # include <sys/prctl.h>
@@ -118,9 +119,6 @@ FILE *debug_log;   /* for logging debug messages to  */
 #include <stdarg.h> /* va_copy */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static int64_t pcap_queue_bytes;
-static int64_t pcap_queue_packets;
 static int64_t pcap_queue_byte_limit;
 static int64_t pcap_queue_packet_limit;
 
@@ -133,6 +131,9 @@ static HANDLE sig_pipe_handle;
 static bool signal_pipe_check_running(void);
 #endif
 static int sync_pipe_fd = 2;
+#ifndef _WIN32
+static ws_shm_ring *shm_ring; /* mirror of the capture file for our parent */
+#endif
 
 #if defined (ENABLE_ASAN) || defined (ENABLE_LSAN)
 /* This has public visibility so that if compiled with shared libasan (the
@@ -332,6 +333,34 @@ typedef struct _pcapng_pipe_info {
 
 struct _loop_data; /* forward declaration so we can use it in the cap_pipe_dispatch function pointer */
 
+/*
+ * A ring of packets captured by a capture thread and waiting to be written
+ * by the main thread, if use_threads is set.
+ *
+ * Each source has its own ring, with its capture thread as the only
+ * producer and the main thread as the only consumer, so neither side
+ * takes a lock. The buffer is allocated once; records are copied into it
+ * back to back, and the producer publishes them by advancing head while
+ * the consumer frees them by advancing tail. Positions and counters are
+ * free-running and only ever compared by difference.
+ */
+typedef struct _pcap_ring {
+    uint8_t *buf;
+    unsigned size;              /**< Size of buf, a power of two. */
+
+    /* Written by the capture thread only. */
+    int      head;              /**< Position after the last published record. */
+    int      packets_in;        /**< Records published. */
+    int      bytes_in;          /**< Packet or block bytes published. */
+    int      max_packets;       /**< High-water mark of queued records. */
+    int      max_bytes;         /**< High-water mark of queued bytes. */
+
+    /* Written by the main thread only. */
+    int      tail;              /**< Position of the oldest unwritten record. */
+    int      packets_out;       /**< Records written. */
+    int      bytes_out;         /**< Packet or block bytes written. */
+} pcap_ring;
+
 /*
  * A source of packets from which we're capturing.
  */
@@ -347,6 +376,7 @@ typedef struct _capture_src {
     unsigned                     interface_id;
     unsigned                     idb_id;                 /**< If from_pcapng is false, the output IDB interface ID. Otherwise the mapping in src_iface_to_global is used. */
     GThread                     *tid;
+    pcap_ring                   *ring;                   /**< Packets queued by tid, if use_threads is set. */
     int                          snaplen;
     int                          linktype;
     bool                         ts_nsec;                /**< true if we're using nanosecond precision. */
@@ -420,14 +450,34 @@ typedef struct _loop_data {
     int      interval_s;
 } loop_data;
 
-typedef struct _pcap_queue_element {
-    capture_src        *pcap_src;
+/*
+ * A record in a pcap_ring, followed by the packet data or pcapng block.
+ * A rec_len of 0 means the rest of the buffer is unused and the next
+ * record is at the start.
+ */
+typedef struct _pcap_ring_record {
+    uint32_t            rec_len;   /**< Length of the record including data and padding. */
     union {
         struct pcap_pkthdr  phdr;
         pcapng_block_header_t  bh;
     } u;
-    uint8_t             *pd;
-} pcap_queue_element;
+} pcap_ring_record;
+
+#define PCAP_RING_ALIGN(len)        (((len) + 7) & ~(size_t)7)
+#define PCAP_RING_RECORD_LEN(len)   (PCAP_RING_ALIGN(sizeof(pcap_ring_record)) + PCAP_RING_ALIGN(len))
+
+/* Ring size if there's no byte limit, and the most we'll allocate per source. */
+#define PCAP_RING_DEFAULT_SIZE      (64 * 1024 * 1024)
+#define PCAP_RING_MAX_SIZE          (1024 * 1024 * 1024)
+
+/* The most records the main thread writes from one ring before moving on
+   to the next one. */
+#define PCAP_RING_BATCH             64
+
+/* Set by the main thread while it waits for packets to be queued. */
+static int     pcap_ring_waiting;
+static GMutex  pcap_ring_mtx;
+static GCond   pcap_ring_cond;
 
 /*
  * This needs to be static, so that the SIGINT handler can clear the "go"
@@ -494,10 +544,14 @@ static const char* get_vcs_version_info(void);
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
 static void report_packet_drops(uint32_t received, uint32_t pcap_drops, uint32_t drops, uint32_t flushed, uint32_t ps_ifdrop, char *name);
+static void report_queue_usage(pcap_ring *ring, const char *name);
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, unsigned i, const char *errmsg);
 static void report_capture_warning(const char *warning_msg, const char *secondary_warning_msg);
 
+static pcap_ring *pcap_ring_new(void);
+static void pcap_ring_free(pcap_ring *ring);
+
 #define MSG_MAX_LENGTH 4096
 
 static void
@@ -1286,6 +1340,11 @@ exit_main(void)
         global_capture_opts.save_file = NULL;
     }
 
+#ifndef _WIN32
+    ws_shm_ring_unref(shm_ring);
+    shm_ring = NULL;
+#endif
+
     capture_opts_cleanup(&global_capture_opts);
 }
 
@@ -3313,6 +3372,10 @@ static void capture_loop_close_input(void)
                 pcap_src->pcap_h = NULL;
             }
         }
+        if (pcap_src->ring != NULL) {
+            pcap_ring_free(pcap_src->ring);
+            pcap_src->ring = NULL;
+        }
     }
 
     global_ld.go = false;
@@ -3488,6 +3551,12 @@ capture_loop_init_output(capture_options *capture_opts, char *errmsg, int errmsg
     } else {
         global_ld.pdh = ws_cwstream_fdopen(global_ld.save_file_fd, ws_name_to_compression_type(capture_opts->compress_type), &err);
     }
+#ifndef _WIN32
+    if (global_ld.pdh != NULL && shm_ring != NULL) {
+        /* Falls back to the parent reading the file if we're compressing. */
+        ws_cwstream_set_shm_ring(global_ld.pdh, shm_ring);
+    }
+#endif
     if (global_ld.pdh == NULL) {
         /* We couldn't set up to write to the capture file. */
         /* XXX - use cf_open_error_message from ui/capture.c instead? */
@@ -3995,6 +4064,11 @@ do_file_switch_or_stop(capture_options *capture_opts)
                                 &global_ld.save_file_fd, &global_ld.err)) {
 
             /* File switch succeeded: reset the conditions */
+#ifndef _WIN32
+            if (shm_ring != NULL) {
+                ws_cwstream_set_shm_ring(global_ld.pdh, shm_ring);
+            }
+#endif
             global_ld.bytes_written = 0;
             global_ld.packets_written = 0;
             if (capture_opts->use_pcapng) {
@@ -4059,45 +4133,221 @@ pcap_read_handler(void* arg)
     return (NULL);
 }
 
-/* Try to pop an item off the head of the packet queue and if it exists,
-   write it */
+static pcap_ring *
+pcap_ring_new(void)
+{
+    pcap_ring *ring = g_new0(pcap_ring, 1);
+    uint64_t   size;
+
+    /* Room for the byte limit and the headers of the packet limit, plus
+       the largest record on either side of the point where the ring
+       wraps around, so that the limits are what decides when to drop. */
+    if (pcap_queue_byte_limit > 0) {
+        size = pcap_queue_byte_limit;
+    } else {
+        size = PCAP_RING_DEFAULT_SIZE;
+    }
+    size += (uint64_t)pcap_queue_packet_limit * PCAP_RING_RECORD_LEN(0);
+    size += 2 * PCAP_RING_RECORD_LEN(WTAP_MAX_PACKET_SIZE_STANDARD);
+    size = MIN(size, PCAP_RING_MAX_SIZE);
+
+    ring->size = 1;
+    while (ring->size < size) {
+        ring->size <<= 1;
+    }
+    ring->buf = (uint8_t *)g_malloc(ring->size);
+    return ring;
+}
+
+static void
+pcap_ring_free(pcap_ring *ring)
+{
+    g_free(ring->buf);
+    g_free(ring);
+}
+
+/* Get the number of records and bytes queued on all sources. Called from
+   any thread. */
+static void
+capture_loop_queue_size(unsigned *packets, unsigned *bytes)
+{
+    unsigned i;
+
+    *packets = 0;
+    *bytes = 0;
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        pcap_ring *ring = pcap_src->ring;
+
+        if (ring != NULL) {
+            *packets += (unsigned)g_atomic_int_get(&ring->packets_in) - (unsigned)g_atomic_int_get(&ring->packets_out);
+            *bytes += (unsigned)g_atomic_int_get(&ring->bytes_in) - (unsigned)g_atomic_int_get(&ring->bytes_out);
+        }
+    }
+}
+
+/* Copy a packet or block into the ring of a source, if the queue limits
+   and the space in the ring allow it. Called from the capture thread of
+   the source. */
 static bool
-capture_loop_dequeue_packet(void) {
-    pcap_queue_element *queue_element;
-
-    g_async_queue_lock(pcap_queue);
-    queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            pcap_queue_bytes -= queue_element->u.bh.block_total_length;
-        } else {
-            pcap_queue_bytes -= queue_element->u.phdr.caplen;
+capture_loop_enqueue(capture_src *pcap_src, const struct pcap_pkthdr *phdr,
+                     const pcapng_block_header_t *bh, const uint8_t *pd,
+                     uint32_t len)
+{
+    pcap_ring        *ring = pcap_src->ring;
+    pcap_ring_record *rec;
+    unsigned          queued_packets, queued_bytes;
+    unsigned          head, tail, offset, to_end, needed;
+    size_t            rec_len = PCAP_RING_RECORD_LEN(len);
+
+    capture_loop_queue_size(&queued_packets, &queued_bytes);
+    if (((pcap_queue_byte_limit > 0) && (queued_bytes >= pcap_queue_byte_limit)) ||
+        ((pcap_queue_packet_limit > 0) && (queued_packets >= pcap_queue_packet_limit))) {
+        return false;
+    }
+
+    head = (unsigned)ring->head;
+    tail = (unsigned)g_atomic_int_get(&ring->tail);
+    offset = head & (ring->size - 1);
+    to_end = ring->size - offset;
+    needed = rec_len > to_end ? to_end + (unsigned)rec_len : (unsigned)rec_len;
+    if (rec_len > ring->size || needed > ring->size - (head - tail)) {
+        return false;
+    }
+
+    if (rec_len > to_end) {
+        /* Skip the rest of the buffer. Everything is a multiple of 8
+           bytes, so there's always room for rec_len here. */
+        rec = (pcap_ring_record *)(void *)(ring->buf + offset);
+        rec->rec_len = 0;
+        head += to_end;
+        offset = 0;
+    }
+
+    rec = (pcap_ring_record *)(void *)(ring->buf + offset);
+    rec->rec_len = (uint32_t)rec_len;
+    if (phdr != NULL) {
+        rec->u.phdr = *phdr;
+    } else {
+        rec->u.bh = *bh;
+    }
+    memcpy(ring->buf + offset + PCAP_RING_ALIGN(sizeof(pcap_ring_record)), pd, len);
+
+    /* Publish the record, then the counters used for the limits. */
+    g_atomic_int_set(&ring->head, (int)(head + (unsigned)rec_len));
+    g_atomic_int_set(&ring->packets_in, ring->packets_in + 1);
+    g_atomic_int_set(&ring->bytes_in, (int)((unsigned)ring->bytes_in + len));
+
+    queued_packets = (unsigned)ring->packets_in - (unsigned)g_atomic_int_get(&ring->packets_out);
+    queued_bytes = (unsigned)ring->bytes_in - (unsigned)g_atomic_int_get(&ring->bytes_out);
+    if (queued_packets > (unsigned)ring->max_packets)
+        g_atomic_int_set(&ring->max_packets, (int)queued_packets);
+    if (queued_bytes > (unsigned)ring->max_bytes)
+        g_atomic_int_set(&ring->max_bytes, (int)queued_bytes);
+
+    /* Wake up the main thread if it's waiting for packets. */
+    if (g_atomic_int_get(&pcap_ring_waiting)) {
+        g_mutex_lock(&pcap_ring_mtx);
+        g_atomic_int_set(&pcap_ring_waiting, 0);
+        g_cond_signal(&pcap_ring_cond);
+        g_mutex_unlock(&pcap_ring_mtx);
+    }
+    return true;
+}
+
+static bool
+capture_loop_rings_empty(void)
+{
+    unsigned i;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+
+        if (g_atomic_int_get(&pcap_src->ring->head) != pcap_src->ring->tail) {
+            return false;
         }
-        pcap_queue_packets -= 1;
     }
-    g_async_queue_unlock(pcap_queue);
-    if (queue_element) {
-        if (queue_element->pcap_src->from_pcapng) {
-            ws_info("Dequeued a block of type 0x%08x of length %d captured on interface %d.",
-                  queue_element->u.bh.block_type, queue_element->u.bh.block_total_length,
-                  queue_element->pcap_src->interface_id);
+    return true;
+}
 
-            capture_loop_write_pcapng_cb(queue_element->pcap_src,
-                                        &queue_element->u.bh,
-                                        queue_element->pd);
-        } else {
-            ws_info("Dequeued a packet of length %d captured on interface %d.",
-                queue_element->u.phdr.caplen, queue_element->pcap_src->interface_id);
+/* Write out up to PCAP_RING_BATCH queued records from each source. */
+static int
+capture_loop_write_queued(void)
+{
+    unsigned i;
+    int      written = 0;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        capture_src *pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+        pcap_ring   *ring = pcap_src->ring;
+        unsigned     head = (unsigned)g_atomic_int_get(&ring->head);
+        unsigned     tail = (unsigned)ring->tail;
+        unsigned     packets = 0, bytes = 0;
+
+        while (tail != head && packets < PCAP_RING_BATCH) {
+            unsigned          offset = tail & (ring->size - 1);
+            pcap_ring_record *rec = (pcap_ring_record *)(void *)(ring->buf + offset);
+            uint8_t          *pd = ring->buf + offset + PCAP_RING_ALIGN(sizeof(pcap_ring_record));
+
+            if (rec->rec_len == 0) {
+                tail += ring->size - offset;
+                continue;
+            }
+            if (pcap_src->from_pcapng) {
+                ws_info("Dequeued a block of type 0x%08x of length %d captured on interface %d.",
+                      rec->u.bh.block_type, rec->u.bh.block_total_length,
+                      pcap_src->interface_id);
+
+                capture_loop_write_pcapng_cb(pcap_src, &rec->u.bh, pd);
+                bytes += rec->u.bh.block_total_length;
+            } else {
+                ws_info("Dequeued a packet of length %d captured on interface %d.",
+                    rec->u.phdr.caplen, pcap_src->interface_id);
 
-            capture_loop_write_packet_cb((uint8_t *) queue_element->pcap_src,
-                                        &queue_element->u.phdr,
-                                        queue_element->pd);
+                capture_loop_write_packet_cb((uint8_t *) pcap_src, &rec->u.phdr, pd);
+                bytes += rec->u.phdr.caplen;
+            }
+            tail += rec->rec_len;
+            packets++;
+        }
+
+        if (packets > 0 || tail != (unsigned)ring->tail) {
+            /* Hand the space back to the capture thread. */
+            g_atomic_int_set(&ring->tail, (int)tail);
+            g_atomic_int_set(&ring->packets_out, (int)((unsigned)ring->packets_out + packets));
+            g_atomic_int_set(&ring->bytes_out, (int)((unsigned)ring->bytes_out + bytes));
+            written += packets;
         }
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        return true;
     }
-    return false;
+    return written;
+}
+
+/* Write out queued packets and blocks. If there aren't any, wait up to
+   WRITER_THREAD_TIMEOUT for some. Returns the number written. */
+static int
+capture_loop_dequeue_packets(void) {
+    int     written;
+    int64_t end_time;
+
+    written = capture_loop_write_queued();
+    if (written > 0) {
+        return written;
+    }
+
+    end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+    g_mutex_lock(&pcap_ring_mtx);
+    g_atomic_int_set(&pcap_ring_waiting, 1);
+    /* Check again after setting the flag, as a capture thread might have
+       queued something before it could see it. */
+    while (g_atomic_int_get(&pcap_ring_waiting) && capture_loop_rings_empty()) {
+        if (!g_cond_wait_until(&pcap_ring_cond, &pcap_ring_mtx, end_time)) {
+            break;
+        }
+    }
+    g_atomic_int_set(&pcap_ring_waiting, 0);
+    g_mutex_unlock(&pcap_ring_mtx);
+
+    return capture_loop_write_queued();
 }
 
 /*
@@ -4282,10 +4532,12 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
         /* Start threads, one per capture device, to queue incoming packets
-           for writing. */
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+           for writing. Every ring has to exist before any thread starts,
+           as the queue limits count the packets in all of them. */
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+            pcap_src->ring = pcap_ring_new();
+        }
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
             /* XXX - Add an interface name here? */
@@ -4294,15 +4546,9 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
     }
     while (global_ld.go) {
         if (use_threads) {
-            /* Write out the packet at the head of the queue of received
-               packets. */
-            bool dequeued = capture_loop_dequeue_packet();
-
-            if (dequeued) {
-                inpkts = 1;
-            } else {
-                inpkts = 0;
-            }
+            /* Write out a batch of the packets queued by each capture
+               thread. */
+            inpkts = capture_loop_dequeue_packets();
         } else {
             /* Dispatch incoming packets and write them out. */
             pcap_src = g_array_index(global_ld.pcaps, capture_src *, 0);
@@ -4381,6 +4627,17 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
                 global_ld.inpkts_to_sync_pipe = 0;
             }
 
+            /* Let the parent know how full the packet queues are. */
+            if (capture_child) {
+                for (i = 0; i < global_ld.pcaps->len; i++) {
+                    pcap_src = g_array_index(global_ld.pcaps, capture_src *, i);
+                    if (pcap_src->ring != NULL) {
+                        interface_opts = &g_array_index(capture_opts->ifaces, interface_options, i);
+                        report_queue_usage(pcap_src->ring, interface_opts->display_name);
+                    }
+                }
+            }
+
             /* check capture duration condition */
             if (autostop_duration_timer != NULL && g_timer_elapsed(autostop_duration_timer, NULL) >= capture_opts->autostop_duration) {
                 /* The maximum capture time has elapsed; stop the capture. */
@@ -4413,11 +4670,7 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             g_thread_join(pcap_src->tid);
             ws_info("Thread of interface %u terminated.", pcap_src->interface_id);
         }
-        while (1) {
-            bool dequeued = capture_loop_dequeue_packet();
-            if (!dequeued) {
-                break;
-            }
+        while (capture_loop_write_queued() > 0) {
             if (capture_opts->output_to_pipe) {
                 ws_cwstream_flush(global_ld.pdh, NULL);
             }
@@ -4619,6 +4872,9 @@ capture_loop_start(capture_options *capture_opts, bool *stats_known, struct pcap
             }
         }
         report_packet_drops(received, pcap_dropped, pcap_src->dropped, pcap_src->flushed, stats->ps_ifdrop, interface_opts->display_name);
+        if (pcap_src->ring != NULL) {
+            report_queue_usage(pcap_src->ring, interface_opts->display_name);
+        }
     }
 
     /* close the input file (pcap or capture pipe) */
@@ -4897,8 +5153,7 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
                              const uint8_t *pd)
 {
     capture_src        *pcap_src = (capture_src *) (void *) pcap_src_p;
-    pcap_queue_element *queue_element;
-    bool                limit_reached;
+    unsigned            queued_packets, queued_bytes;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4908,35 +5163,8 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
-    if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.phdr = *phdr;
-    queue_element->pd = (uint8_t *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
+    if (!capture_loop_enqueue(pcap_src, phdr, NULL, pd, phdr->caplen)) {
         pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = false;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = true;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         ws_info("Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
     } else {
@@ -4944,18 +5172,18 @@ capture_loop_queue_packet_cb(uint8_t *pcap_src_p, const struct pcap_pkthdr *phdr
         ws_info("Queued a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_src->interface_id);
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    ws_info("Queue size is now %" PRId64 " bytes (%" PRId64 " packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    if (ws_log_msg_is_active(WS_LOG_DOMAIN, LOG_LEVEL_INFO)) {
+        capture_loop_queue_size(&queued_packets, &queued_bytes);
+        ws_info("Queue size is now %u bytes (%u packets)",
+              queued_bytes, queued_packets);
+    }
 }
 
 /* one pcapng block was captured, queue it */
 static void
 capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t *bh, uint8_t *pd)
 {
-    pcap_queue_element *queue_element;
-    bool                limit_reached;
+    unsigned            queued_packets, queued_bytes;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4965,35 +5193,8 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         return;
     }
 
-    queue_element = g_new(pcap_queue_element, 1);
-    if (queue_element == NULL) {
-       pcap_src->dropped++;
-       return;
-    }
-    queue_element->pcap_src = pcap_src;
-    queue_element->u.bh = *bh;
-    queue_element->pd = (uint8_t *)g_malloc(bh->block_total_length);
-    if (queue_element->pd == NULL) {
-        pcap_src->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, bh->block_total_length);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = false;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += bh->block_total_length;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = true;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    if (!capture_loop_enqueue(pcap_src, NULL, bh, pd, bh->block_total_length)) {
         pcap_src->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         ws_info("Dropped a packet of length %d captured on interface %u.",
               bh->block_total_length, pcap_src->interface_id);
     } else {
@@ -5001,10 +5202,11 @@ capture_loop_queue_pcapng_cb(capture_src *pcap_src, const pcapng_block_header_t
         ws_info("Queued a block of type 0x%08x of length %d captured on interface %u.",
               bh->block_type, bh->block_total_length, pcap_src->interface_id);
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    ws_info("Queue size is now %" PRId64 " bytes (%" PRId64 " packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+    if (ws_log_msg_is_active(WS_LOG_DOMAIN, LOG_LEVEL_INFO)) {
+        capture_loop_queue_size(&queued_packets, &queued_bytes);
+        ws_info("Queue size is now %u bytes (%u packets)",
+              queued_bytes, queued_packets);
+    }
 }
 
 static int
@@ -5095,6 +5297,8 @@ gather_dumpcap_runtime_info(feature_list l)
 #define LONGOPT_APPLICATION_FLAVOR  LONGOPT_BASE_APPLICATION+4
 #ifdef _WIN32
 #define LONGOPT_SIGNAL_PIPE         LONGOPT_BASE_APPLICATION+5
+#else
+#define LONGOPT_SHM_RING            LONGOPT_BASE_APPLICATION+6
 #endif
 
 /* And now our feature presentation... [ fade to music ] */
@@ -5114,6 +5318,8 @@ main(int argc, char *argv[])
         {"application-flavor", ws_required_argument, NULL, LONGOPT_APPLICATION_FLAVOR},
 #ifdef _WIN32
         {"signal-pipe", ws_required_argument, NULL, LONGOPT_SIGNAL_PIPE},
+#else
+        {"shm-ring", ws_required_argument, NULL, LONGOPT_SHM_RING},
 #endif
         {0, 0, 0, 0 }
     };
@@ -5582,6 +5788,29 @@ main(int argc, char *argv[])
                 }
             }
             break;
+#else
+        case LONGOPT_SHM_RING:
+        {
+            int shm_ring_fd;
+
+            if (!capture_child) {
+                cmdarg_err("--shm-ring may only be specified with -Z");
+                exit_main();
+                return WS_EXIT_INVALID_OPTION;
+            }
+            /*
+             * ws_optarg = an inherited shared-memory ring fd. If it isn't
+             * usable, our parent just reads everything from the file.
+             */
+            if (ws_strtoi(ws_optarg, NULL, &shm_ring_fd) && shm_ring_fd > 2) {
+                shm_ring = ws_shm_ring_open(shm_ring_fd);
+                if (shm_ring == NULL) {
+                    ws_debug("Unable to map shared-memory ring %d", shm_ring_fd);
+                    ws_close(shm_ring_fd);
+                }
+            }
+            break;
+        }
 #endif
         case 'q':        /* Quiet */
             quiet = true;
@@ -6290,6 +6519,34 @@ report_capture_warning(const char *warning_msg, const char *secondary_warning_ms
     }
 }
 
+static void
+report_queue_usage(pcap_ring *ring, const char *name)
+{
+    unsigned packets = (unsigned)g_atomic_int_get(&ring->packets_in) - (unsigned)g_atomic_int_get(&ring->packets_out);
+    unsigned bytes = (unsigned)g_atomic_int_get(&ring->bytes_in) - (unsigned)g_atomic_int_get(&ring->bytes_out);
+    unsigned max_packets = (unsigned)g_atomic_int_get(&ring->max_packets);
+    unsigned max_bytes = (unsigned)g_atomic_int_get(&ring->max_bytes);
+
+    if (capture_child) {
+        char* tmp = ws_strdup_printf("%u:%u:%u:%u:%u:%s", packets, bytes,
+                                     max_packets, max_bytes, ring->size, name);
+
+        ws_debug("Packet queue of interface '%s': %u packets/%u bytes, at most %u packets/%u bytes (buffer %u bytes)",
+            name, packets, bytes, max_packets, max_bytes, ring->size);
+        sync_pipe_write_string_msg(sync_pipe_fd, SP_QUEUE_USAGE, tmp);
+        g_free(tmp);
+    } else {
+        if (!really_quiet) {
+            fprintf(stderr,
+                "Packet queue of interface '%s': at most %u packets/%u bytes (buffer %u bytes, %.1f%% used)\n",
+                name, max_packets, max_bytes, ring->size,
+                100.0 * max_bytes / ring->size);
+            /* stderr could be line buffered */
+            fflush(stderr);
+        }
+    }
+}
+
 static void
 report_packet_drops(uint32_t received, uint32_t pcap_drops, uint32_t drops, uint32_t flushed, uint32_t ps_ifdrop, char *name)
 {
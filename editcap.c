@@ -644,6 +644,7 @@ static void
 remove_vlan_info(wtap_rec *rec) {
     switch (rec->rec_header.packet_header.pkt_encap) {
         case WTAP_ENCAP_SLL:
+            ws_buffer_own(&rec->data);
             sll_remove_vlan_info(ws_buffer_start_ptr(&rec->data), &rec->rec_header.packet_header.caplen);
             break;
         default:
@@ -656,9 +657,11 @@ static void
 set_unused_info(wtap_rec *rec) {
     switch (rec->rec_header.packet_header.pkt_encap) {
         case WTAP_ENCAP_SLL:
+            ws_buffer_own(&rec->data);
             sll_set_unused_info(ws_buffer_start_ptr(&rec->data));
             break;
         case WTAP_ENCAP_SLL2:
+            ws_buffer_own(&rec->data);
             sll2_set_unused_info(ws_buffer_start_ptr(&rec->data));
             break;
         default:
@@ -876,6 +879,10 @@ mutate_packet_data(wtap_rec *rec, uint32_t change_offset, uint64_t count) {
 
     real_data_start += change_offset;
 
+    /* The data may be in a read-only mapping of the file. */
+    ws_buffer_own(&rec->data);
+    buf = ws_buffer_start_ptr(&rec->data);
+
     for (unsigned i = real_data_start; i < caplen; i++) {
         if (rand() <= err_prob * RAND_MAX) {
             int err_type = rand() / (RAND_MAX / ERR_WT_TOTAL + 1);
@@ -3035,7 +3042,10 @@ handle_chopping(chop_t chop, wtap_rec *rec, bool adjlen)
      * was specified, we need to keep that piece */
     if (chop.len_begin > 0) {
         if (chop.off_begin_pos > 0) {
-            uint8_t *buf = ws_buffer_start_ptr(&rec->data);
+            uint8_t *buf;
+
+            ws_buffer_own(&rec->data);
+            buf = ws_buffer_start_ptr(&rec->data);
 
             memmove(buf + chop.off_begin_pos,
                     buf + chop.off_begin_pos + chop.len_begin,
@@ -3057,7 +3067,10 @@ handle_chopping(chop_t chop, wtap_rec *rec, bool adjlen)
      * specified, we need to keep that piece */
     if (chop.len_end < 0) {
         if (chop.off_end_neg < 0) {
-            uint8_t *buf = ws_buffer_start_ptr(&rec->data);
+            uint8_t *buf;
+
+            ws_buffer_own(&rec->data);
+            buf = ws_buffer_start_ptr(&rec->data);
 
             memmove(buf + (int)phdr->caplen + (chop.len_end + chop.off_end_neg),
                     buf + (int)phdr->caplen + chop.off_end_neg,
@@ -89,6 +89,7 @@
 #include <wsutil/file_util.h>
 #include <wsutil/pint.h>
 #include <wsutil/inet_cidr.h>
+#include <wsutil/bits_count_ones.h>
 
 #include <epan/strutil.h>
 #include <epan/to_str.h>
@@ -110,45 +111,65 @@
 #define ENAME_TACS      "tacs"
 
 #define HASHETHSIZE      2048
-#define HASHHOSTSIZE     2048
 #define HASHIPXNETSIZE    256
-#define SUBNETLENGTHSIZE   32  /*1-32 inc.*/
-#define SUBNETLENGTHSIZE_V6 128 /*1-128 inc.*/
-
-/* hash table used for IPv4 lookup */
-
-#define HASH_IPV4_ADDRESS(addr) (g_htonl(addr) & (HASHHOSTSIZE - 1))
 
+/*
+ * Subnets are kept in a compressed multibit trie with a stride of 6 bits,
+ * in the style of a poptrie. Each node has 64 slots, and a slot either
+ * leads to a child node or holds a leaf: the longest prefix covering the
+ * slot (leaf pushing). Only the child nodes and the leaves where the
+ * value changes from the previous slot are stored, contiguously, and are
+ * found by counting the bits set below the slot in the node's bitmaps.
+ * A node therefore takes 24 bytes however many of its slots are used.
+ *
+ * A slot under which only one longer prefix lies holds a "tail" leaf
+ * instead of a chain of nodes: the whole prefix, to be compared with the
+ * address, and the leaf to use if it doesn't match. With sparse prefixes,
+ * as in IPv6, most prefixes end in a tail, so a /48 or /64 costs a tail
+ * and a share of the nodes near the root rather than a node per stride.
+ *
+ * The trie is built in one go from the subnets read from the files.
+ */
+#define SUBNET_TRIE_STRIDE      6
+#define SUBNET_TRIE_FANOUT      (1 << SUBNET_TRIE_STRIDE)
+#define SUBNET_TRIE_TAIL        0x80000000U     /* Leaf is an index in tails */
 
-typedef struct sub_net_hashipv4 {
-    unsigned          addr;
-    /* XXX: No longer needed?*/
-    uint8_t           flags;          /* B0 dummy_entry, B1 resolve, B2 If the address is used in the trace */
-    struct sub_net_hashipv4   *next;
-    char              name[MAXNAMELEN];
-} sub_net_hashipv4_t;
+typedef struct {
+    uint64_t    child_bits;     /* Slots that lead to a child node */
+    uint64_t    leaf_bits;      /* Slots whose leaf differs from the previous slot's */
+    uint32_t    child_base;     /* Index in nodes of the first child */
+    uint32_t    leaf_base;      /* Index in leaves of the first slot's leaf */
+} subnet_trie_node_t;
 
-/* Array of entries of subnets of different lengths */
 typedef struct {
-    size_t       mask_length;      /*1-32*/
-    uint32_t     mask;             /* e.g. 255.255.255.*/
-    sub_net_hashipv4_t** subnet_addresses; /* Hash table of subnet addresses */
-} subnet_length_entry_t;
+    uint8_t     addr[16];       /* Masked to mask_length */
+    uint8_t     mask_length;
+    uint32_t    prefix;         /* Leaf if the address matches */
+    uint32_t    fallback;       /* Leaf if it doesn't */
+} subnet_trie_tail_t;
 
+typedef struct {
+    const char *name;
+    uint8_t     mask_length;
+} subnet_trie_prefix_t;
 
-/* IPv6 subnet lookup structures */
-typedef struct sub_net_hashipv6 {
-    uint8_t                   addr[16];   /* masked network address */
-    uint8_t                   flags;
-    struct sub_net_hashipv6  *next;
-    char                      name[MAXNAMELEN];
-} sub_net_hashipv6_t;
+/* A subnet read from a file, waiting for the trie to be built. */
+typedef struct {
+    uint8_t     addr[16];       /* Masked to mask_length */
+    uint8_t     mask_length;
+    uint32_t    seq;            /* Order in which it was read */
+    const char *name;
+} subnet_trie_entry_t;
 
 typedef struct {
-    size_t               mask_length;       /* 1-128 */
-    uint8_t              mask[16];          /* byte mask */
-    sub_net_hashipv6_t **subnet_addresses;  /* hash table */
-} subnet_length_entry_v6_t;
+    unsigned      addr_len;     /* 4 or 16 */
+    GArray       *nodes;        /* subnet_trie_node_t, nodes[0] is the root */
+    GArray       *leaves;       /* uint32_t: 0, index + 1 in prefixes, or SUBNET_TRIE_TAIL | index in tails */
+    GArray       *tails;        /* subnet_trie_tail_t */
+    GArray       *prefixes;     /* subnet_trie_prefix_t */
+    GArray       *entries;      /* subnet_trie_entry_t, until the trie is built */
+    GStringChunk *names;
+} subnet_trie_t;
 
 typedef struct {
     uint8_t     mask[16];
@@ -270,11 +291,8 @@ static wmem_map_t *serv_port_custom_hashtable;
 // Maps enterprise-id -> enterprise-desc (only used for user additions)
 static GHashTable *enterprises_hashtable;
 
-static subnet_length_entry_t subnet_length_entries[SUBNETLENGTHSIZE]; /* Ordered array of entries */
-static bool have_subnet_entry;
-
-static subnet_length_entry_v6_t subnet_length_entries_v6[SUBNETLENGTHSIZE_V6]; /* IPv6 subnet entries */
-static bool have_subnet_entry_v6;
+static subnet_trie_t subnet_trie;
+static subnet_trie_t subnet6_trie;
 
 static bool new_resolved_objects;
 
@@ -3152,47 +3170,285 @@ read_subnets_file (const char *subnetspath)
     return true;
 } /* read_subnets_file */
 
-static subnet_entry_t
-subnet_lookup(const uint32_t addr)
+static void
+subnet_trie_init(subnet_trie_t *trie, unsigned addr_len)
 {
-    subnet_entry_t subnet_entry;
-    uint32_t i;
+    trie->addr_len = addr_len;
+    trie->nodes = NULL;
+    trie->leaves = NULL;
+    trie->tails = NULL;
+    trie->prefixes = g_array_new(false, false, sizeof(subnet_trie_prefix_t));
+    trie->entries = g_array_new(false, false, sizeof(subnet_trie_entry_t));
+    trie->names = g_string_chunk_new(4096);
+}
 
-    /* Search mask lengths linearly, longest first */
+static void
+subnet_trie_free(subnet_trie_t *trie)
+{
+    if (trie->prefixes == NULL)
+        return;
+    if (trie->nodes != NULL) {
+        g_array_free(trie->nodes, true);
+        g_array_free(trie->leaves, true);
+        g_array_free(trie->tails, true);
+    }
+    if (trie->entries != NULL)
+        g_array_free(trie->entries, true);
+    g_array_free(trie->prefixes, true);
+    g_string_chunk_free(trie->names);
+    memset(trie, 0, sizeof(*trie));
+}
 
-    i = SUBNETLENGTHSIZE;
-    while(have_subnet_entry && i > 0) {
-        uint32_t masked_addr;
-        subnet_length_entry_t* length_entry;
+/* Add a subnet to a trie that hasn't been built yet. addr is in network
+ * byte order; the bits past mask_length are ignored. If the same subnet
+ * is added more than once, the first name is kept.
+ */
+static void
+subnet_trie_insert(subnet_trie_t *trie, const uint8_t *addr, unsigned mask_length,
+                   const char *name)
+{
+    subnet_trie_entry_t entry;
+    unsigned full = mask_length / 8;
+    unsigned rem = mask_length % 8;
 
-        /* Note that we run from 31 (length 32)  to 0 (length 1)  */
-        --i;
-        ws_assert(i < SUBNETLENGTHSIZE);
+    ws_assert(trie->entries != NULL);
 
+    memset(&entry, 0, sizeof(entry));
+    memcpy(entry.addr, addr, full);
+    if (rem != 0)
+        entry.addr[full] = addr[full] & (0xff << (8 - rem));
+    entry.mask_length = (uint8_t)mask_length;
+    entry.seq = trie->entries->len;
+    entry.name = g_string_chunk_insert(trie->names, name);
+    g_array_append_val(trie->entries, entry);
+}
 
-        length_entry = &subnet_length_entries[i];
+/* The slot of an address at a depth, padding the address with zero bits. */
+static inline unsigned
+subnet_trie_slot(const uint8_t *addr, unsigned addr_len, unsigned depth)
+{
+    unsigned byte = depth / 8;
+    unsigned bits = (unsigned)addr[byte] << 8;
 
-        if (NULL != length_entry->subnet_addresses) {
-            sub_net_hashipv4_t * tp;
-            uint32_t hash_idx;
+    if (byte + 1 < addr_len)
+        bits |= addr[byte + 1];
+    return (bits >> (16 - SUBNET_TRIE_STRIDE - depth % 8)) & (SUBNET_TRIE_FANOUT - 1);
+}
 
-            masked_addr = addr & length_entry->mask;
-            hash_idx = HASH_IPV4_ADDRESS(masked_addr);
+static bool
+subnet_trie_tail_match(const subnet_trie_tail_t *tail, const uint8_t *addr)
+{
+    unsigned full = tail->mask_length / 8;
+    unsigned rem = tail->mask_length % 8;
 
-            tp = length_entry->subnet_addresses[hash_idx];
-            while(tp != NULL && tp->addr != masked_addr) {
-                tp = tp->next;
-            }
+    if (memcmp(tail->addr, addr, full) != 0)
+        return false;
+    return rem == 0 || ((tail->addr[full] ^ addr[full]) & (0xff << (8 - rem)) & 0xff) == 0;
+}
 
-            if (NULL != tp) {
-                subnet_entry.mask = length_entry->mask;
-                subnet_entry.mask_length = i + 1; /* Length is offset + 1 */
-                subnet_entry.name = tp->name;
-                return subnet_entry;
+static int
+subnet_trie_entry_compare(const void *a, const void *b)
+{
+    const subnet_trie_entry_t *entry_a = (const subnet_trie_entry_t *)a;
+    const subnet_trie_entry_t *entry_b = (const subnet_trie_entry_t *)b;
+    int ret = memcmp(entry_a->addr, entry_b->addr, sizeof(entry_a->addr));
+
+    if (ret != 0)
+        return ret;
+    if (entry_a->mask_length != entry_b->mask_length)
+        return entry_a->mask_length < entry_b->mask_length ? -1 : 1;
+    return entry_a->seq < entry_b->seq ? -1 : (entry_a->seq > entry_b->seq);
+}
+
+/*
+ * Fill in node node_idx, at bit depth, from the sorted entries [lo, hi),
+ * which are all the entries sharing the node's first depth bits. inherited
+ * is the leaf of the node's slot in its parent. Entry i is prefix i + 1.
+ */
+static void
+subnet_trie_build_node(subnet_trie_t *trie, uint32_t node_idx, unsigned depth,
+                       unsigned lo, unsigned hi, uint32_t inherited)
+{
+    const subnet_trie_entry_t *entries = (const subnet_trie_entry_t *)(void *)trie->entries->data;
+    unsigned next_depth = depth + SUBNET_TRIE_STRIDE;
+    uint32_t value[SUBNET_TRIE_FANOUT];
+    uint8_t value_length[SUBNET_TRIE_FANOUT];
+    unsigned group_lo[SUBNET_TRIE_FANOUT], group_hi[SUBNET_TRIE_FANOUT];
+    unsigned deeper[SUBNET_TRIE_FANOUT], last_deeper[SUBNET_TRIE_FANOUT];
+    subnet_trie_node_t node;
+    uint32_t leaf, child_idx;
+    unsigned i, slot;
+
+    memset(value_length, 0, sizeof(value_length));
+    memset(deeper, 0, sizeof(deeper));
+    memset(group_lo, 0, sizeof(group_lo));
+    memset(group_hi, 0, sizeof(group_hi));
+    for (slot = 0; slot < SUBNET_TRIE_FANOUT; slot++)
+        value[slot] = inherited;
+
+    /*
+     * The entries are sorted by address, so those that go on below a
+     * slot are next to each other. Prefixes that end in this node are
+     * pushed into every slot they cover, the longest one winning.
+     */
+    for (i = lo; i < hi; i++) {
+        const subnet_trie_entry_t *entry = &entries[i];
+
+        if (entry->mask_length <= depth)
+            continue;
+        slot = subnet_trie_slot(entry->addr, trie->addr_len, depth);
+        if (entry->mask_length <= next_depth) {
+            unsigned count = 1U << (next_depth - entry->mask_length);
+
+            for (unsigned j = slot; j < slot + count; j++) {
+                if (value_length[j] < entry->mask_length) {
+                    value[j] = i + 1;
+                    value_length[j] = entry->mask_length;
+                }
             }
+        } else {
+            if (deeper[slot] == 0)
+                group_lo[slot] = i;
+            group_hi[slot] = i + 1;
+            deeper[slot]++;
+            last_deeper[slot] = i;
+        }
+    }
+
+    memset(&node, 0, sizeof(node));
+    node.leaf_base = trie->leaves->len;
+    leaf = 0;
+    for (slot = 0; slot < SUBNET_TRIE_FANOUT; slot++) {
+        uint32_t slot_leaf;
+
+        if (deeper[slot] > 1) {
+            node.child_bits |= UINT64_C(1) << slot;
+            /* Not looked at; don't start a new run for it. */
+            slot_leaf = slot == 0 ? value[slot] : leaf;
+        } else if (deeper[slot] == 1) {
+            const subnet_trie_entry_t *entry = &entries[last_deeper[slot]];
+            subnet_trie_tail_t tail;
+
+            memcpy(tail.addr, entry->addr, sizeof(tail.addr));
+            tail.mask_length = entry->mask_length;
+            tail.prefix = last_deeper[slot] + 1;
+            tail.fallback = value[slot];
+            slot_leaf = SUBNET_TRIE_TAIL | trie->tails->len;
+            g_array_append_val(trie->tails, tail);
+        } else {
+            slot_leaf = value[slot];
+        }
+
+        if (slot == 0 || slot_leaf != leaf) {
+            node.leaf_bits |= UINT64_C(1) << slot;
+            g_array_append_val(trie->leaves, slot_leaf);
+            leaf = slot_leaf;
         }
     }
 
+    /* The children of a node are next to each other. */
+    node.child_base = trie->nodes->len;
+    g_array_set_size(trie->nodes, node.child_base + ws_count_ones(node.child_bits));
+    g_array_index(trie->nodes, subnet_trie_node_t, node_idx) = node;
+
+    child_idx = node.child_base;
+    for (slot = 0; slot < SUBNET_TRIE_FANOUT; slot++) {
+        if (node.child_bits & (UINT64_C(1) << slot)) {
+            subnet_trie_build_node(trie, child_idx++, next_depth,
+                                   group_lo[slot], group_hi[slot], value[slot]);
+        }
+    }
+}
+
+/* Build a trie from the subnets added to it. */
+static void
+subnet_trie_build(subnet_trie_t *trie)
+{
+    subnet_trie_entry_t *entries;
+    unsigned count = 0;
+
+    /* Sort the subnets, and drop all but the first of each repeated one. */
+    g_array_sort(trie->entries, subnet_trie_entry_compare);
+    entries = (subnet_trie_entry_t *)(void *)trie->entries->data;
+    for (unsigned i = 0; i < trie->entries->len; i++) {
+        if (count > 0 &&
+                entries[count - 1].mask_length == entries[i].mask_length &&
+                memcmp(entries[count - 1].addr, entries[i].addr, sizeof(entries[i].addr)) == 0) {
+            continue; /* XXX provide warning that an address was repeated? */
+        }
+        entries[count++] = entries[i];
+    }
+    g_array_set_size(trie->entries, count);
+
+    g_array_set_size(trie->prefixes, count);
+    for (unsigned i = 0; i < count; i++) {
+        subnet_trie_prefix_t *prefix = &g_array_index(trie->prefixes, subnet_trie_prefix_t, i);
+
+        prefix->name = entries[i].name;
+        prefix->mask_length = entries[i].mask_length;
+    }
+
+    trie->nodes = g_array_new(false, false, sizeof(subnet_trie_node_t));
+    trie->leaves = g_array_new(false, false, sizeof(uint32_t));
+    trie->tails = g_array_sized_new(false, false, sizeof(subnet_trie_tail_t), count);
+    g_array_set_size(trie->nodes, 1);
+    subnet_trie_build_node(trie, 0, 0, 0, count, 0);
+
+    g_array_free(trie->entries, true);
+    trie->entries = NULL;
+}
+
+/* Find the longest prefix in a built trie that matches an address in
+ * network byte order. */
+static const subnet_trie_prefix_t *
+subnet_trie_lookup(const subnet_trie_t *trie, const uint8_t *addr)
+{
+    const subnet_trie_node_t *node;
+    uint32_t node_idx = 0;
+    unsigned depth = 0;
+    uint64_t bit;
+    uint32_t leaf;
+
+    if (trie->nodes == NULL || trie->prefixes->len == 0)
+        return NULL;
+
+    for (;;) {
+        node = &g_array_index(trie->nodes, subnet_trie_node_t, node_idx);
+        bit = UINT64_C(1) << subnet_trie_slot(addr, trie->addr_len, depth);
+        if (!(node->child_bits & bit))
+            break;
+        node_idx = node->child_base + ws_count_ones(node->child_bits & (bit - 1));
+        depth += SUBNET_TRIE_STRIDE;
+    }
+
+    leaf = g_array_index(trie->leaves, uint32_t,
+                         node->leaf_base + ws_count_ones(node->leaf_bits & (bit | (bit - 1))) - 1);
+    if (leaf & SUBNET_TRIE_TAIL) {
+        const subnet_trie_tail_t *tail = &g_array_index(trie->tails, subnet_trie_tail_t,
+                                                        leaf & ~SUBNET_TRIE_TAIL);
+
+        leaf = subnet_trie_tail_match(tail, addr) ? tail->prefix : tail->fallback;
+    }
+
+    if (leaf == 0)
+        return NULL;
+    return &g_array_index(trie->prefixes, subnet_trie_prefix_t, leaf - 1);
+}
+
+static subnet_entry_t
+subnet_lookup(const uint32_t addr)
+{
+    subnet_entry_t subnet_entry;
+    const subnet_trie_prefix_t *prefix;
+
+    prefix = subnet_trie_lookup(&subnet_trie, (const uint8_t *)&addr);
+    if (prefix != NULL) {
+        subnet_entry.mask = g_htonl(ws_ipv4_get_subnet_mask(prefix->mask_length));
+        subnet_entry.mask_length = prefix->mask_length;
+        subnet_entry.name = prefix->name;
+        return subnet_entry;
+    }
+
     subnet_entry.mask = 0;
     subnet_entry.mask_length = 0;
     subnet_entry.name = NULL;
@@ -3207,59 +3463,17 @@ subnet_lookup(const uint32_t addr)
 static void
 subnet_entry_set(uint32_t subnet_addr, const uint8_t mask_length, const char* name)
 {
-    subnet_length_entry_t* entry;
-    sub_net_hashipv4_t * tp;
-    size_t hash_idx;
-
     ws_assert(mask_length > 0 && mask_length <= 32);
 
-    entry = &subnet_length_entries[mask_length - 1];
-
-    subnet_addr &= entry->mask;
-
-    hash_idx = HASH_IPV4_ADDRESS(subnet_addr);
-
-    if (NULL == entry->subnet_addresses) {
-        entry->subnet_addresses = (sub_net_hashipv4_t**)wmem_alloc0(addr_resolv_scope, sizeof(sub_net_hashipv4_t*) * HASHHOSTSIZE);
-    }
-
-    if (NULL != (tp = entry->subnet_addresses[hash_idx])) {
-        sub_net_hashipv4_t * new_tp;
-
-        while (tp->next) {
-            if (tp->addr == subnet_addr) {
-                return; /* XXX provide warning that an address was repeated? */
-            } else {
-                tp = tp->next;
-            }
-        }
-
-        new_tp = wmem_new(addr_resolv_scope, sub_net_hashipv4_t);
-        tp->next = new_tp;
-        tp = new_tp;
-    } else {
-        tp = entry->subnet_addresses[hash_idx] = wmem_new(addr_resolv_scope, sub_net_hashipv4_t);
-    }
-
-    tp->next = NULL;
-    tp->addr = subnet_addr;
-    (void) g_strlcpy(tp->name, name, MAXNAMELEN); /* This is longer than subnet names can actually be */
-    have_subnet_entry = true;
+    subnet_trie_insert(&subnet_trie, (const uint8_t *)&subnet_addr, mask_length, name);
 }
 
 static void
 subnet_name_lookup_init(const char* app_env_var_prefix)
 {
     char* subnetspath;
-    uint32_t i;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        uint32_t length = i + 1;
-
-        subnet_length_entries[i].subnet_addresses  = NULL;
-        subnet_length_entries[i].mask_length  = length;
-        subnet_length_entries[i].mask = g_htonl(ws_ipv4_get_subnet_mask(length));
-    }
+    subnet_trie_init(&subnet_trie, 4);
 
     /* Check profile directory before personal configuration */
     subnetspath = get_persconffile_path(ENAME_SUBNETS, true, app_env_var_prefix);
@@ -3284,6 +3498,8 @@ subnet_name_lookup_init(const char* app_env_var_prefix)
         report_open_failure(subnetspath, errno, false);
     }
     g_free(subnetspath);
+
+    subnet_trie_build(&subnet_trie);
 }
 
 /* IPv6 Subnet Name Resolution */
@@ -3305,79 +3521,23 @@ static void
 subnet6_entry_set(const ws_in6_addr *subnet_addr, const uint32_t mask_length,
                   const char *name)
 {
-    subnet_length_entry_v6_t *entry;
-    sub_net_hashipv6_t *tp;
-    uint8_t masked[16];
-    size_t hash_idx;
-
     ws_assert(mask_length > 0 && mask_length <= 128);
-    entry = &subnet_length_entries_v6[mask_length - 1];
-
-    for (int i = 0; i < 16; i++)
-        masked[i] = subnet_addr->bytes[i] & entry->mask[i];
-
-    hash_idx = ipv6_oat_hash(masked) & (HASHHOSTSIZE - 1);
-
-    if (entry->subnet_addresses == NULL)
-        entry->subnet_addresses = (sub_net_hashipv6_t **)wmem_alloc0(
-            addr_resolv_scope, sizeof(sub_net_hashipv6_t *) * HASHHOSTSIZE);
 
-    if ((tp = entry->subnet_addresses[hash_idx]) != NULL) {
-        sub_net_hashipv6_t *new_tp;
-        while (tp->next) {
-            if (memcmp(tp->addr, masked, 16) == 0)
-                return; /* duplicate */
-            tp = tp->next;
-        }
-        if (memcmp(tp->addr, masked, 16) == 0)
-            return; /* duplicate at tail */
-        new_tp = wmem_new(addr_resolv_scope, sub_net_hashipv6_t);
-        tp->next = new_tp;
-        tp = new_tp;
-    } else {
-        tp = entry->subnet_addresses[hash_idx] =
-            wmem_new(addr_resolv_scope, sub_net_hashipv6_t);
-    }
-
-    tp->next = NULL;
-    memcpy(tp->addr, masked, 16);
-    (void)g_strlcpy(tp->name, name, MAXNAMELEN);
-    have_subnet_entry_v6 = true;
+    subnet_trie_insert(&subnet6_trie, subnet_addr->bytes, mask_length, name);
 }
 
 static subnet_entry_v6_t
 subnet6_lookup(const ws_in6_addr *addr)
 {
     subnet_entry_v6_t result;
-    uint32_t i = SUBNETLENGTHSIZE_V6;
-
-    while (have_subnet_entry_v6 && i > 0) {
-        subnet_length_entry_v6_t *length_entry;
-        uint8_t masked[16];
-        size_t hash_idx;
-        sub_net_hashipv6_t *tp;
-
-        --i;
-        length_entry = &subnet_length_entries_v6[i];
-
-        if (length_entry->subnet_addresses == NULL)
-            continue;
+    const subnet_trie_prefix_t *prefix;
 
-        for (int b = 0; b < 16; b++)
-            masked[b] = addr->bytes[b] & length_entry->mask[b];
-
-        hash_idx = ipv6_oat_hash(masked) & (HASHHOSTSIZE - 1);
-        tp = length_entry->subnet_addresses[hash_idx];
-
-        while (tp != NULL && memcmp(tp->addr, masked, 16) != 0)
-            tp = tp->next;
-
-        if (tp != NULL) {
-            memcpy(result.mask, length_entry->mask, 16);
-            result.mask_length = i + 1;
-            result.name = tp->name;
-            return result;
-        }
+    prefix = subnet_trie_lookup(&subnet6_trie, addr->bytes);
+    if (prefix != NULL) {
+        ipv6_get_subnet_mask(prefix->mask_length, result.mask);
+        result.mask_length = prefix->mask_length;
+        result.name = prefix->name;
+        return result;
     }
 
     memset(result.mask, 0, 16);
@@ -3433,11 +3593,7 @@ subnet6_name_lookup_init(const char *app_env_var_prefix)
 {
     char *subnetspath;
 
-    for (uint32_t i = 0; i < SUBNETLENGTHSIZE_V6; ++i) {
-        subnet_length_entries_v6[i].subnet_addresses = NULL;
-        subnet_length_entries_v6[i].mask_length = i + 1;
-        ipv6_get_subnet_mask((uint32_t)(i + 1), subnet_length_entries_v6[i].mask);
-    }
+    subnet_trie_init(&subnet6_trie, 16);
 
     /* Check profile directory before personal configuration */
     subnetspath = get_persconffile_path(ENAME_SUBNETS_V6, true, app_env_var_prefix);
@@ -3458,6 +3614,8 @@ subnet6_name_lookup_init(const char *app_env_var_prefix)
     if (!read_subnets_ipv6_file(subnetspath) && errno != ENOENT)
         report_open_failure(subnetspath, errno, false);
     g_free(subnetspath);
+
+    subnet_trie_build(&subnet6_trie);
 }
 
 /* SS7 PC Name Resolution Portion */
@@ -4093,9 +4251,6 @@ host_name_lookup_init(const char* app_env_var_prefix)
 static void
 host_name_lookup_cleanup(void)
 {
-    uint32_t i, j;
-    sub_net_hashipv4_t *entry, *next_entry;
-
     _host_name_lookup_cleanup();
 
     ipxnet_hash_table = NULL;
@@ -4103,37 +4258,8 @@ host_name_lookup_cleanup(void)
     ipv6_hash_table = NULL;
     ss7pc_hash_table = NULL;
 
-    for(i = 0; i < SUBNETLENGTHSIZE; ++i) {
-        if (subnet_length_entries[i].subnet_addresses != NULL) {
-            for (j = 0; j < HASHHOSTSIZE; j++) {
-                for (entry = subnet_length_entries[i].subnet_addresses[j];
-                     entry != NULL; entry = next_entry) {
-                    next_entry = entry->next;
-                    wmem_free(addr_resolv_scope, entry);
-                }
-            }
-            wmem_free(addr_resolv_scope, subnet_length_entries[i].subnet_addresses);
-            subnet_length_entries[i].subnet_addresses = NULL;
-        }
-    }
-
-    have_subnet_entry = false;
-
-    for(i = 0; i < SUBNETLENGTHSIZE_V6; ++i) {
-        sub_net_hashipv6_t *entry6, *next_entry6;
-        if (subnet_length_entries_v6[i].subnet_addresses != NULL) {
-            for (j = 0; j < HASHHOSTSIZE; j++) {
-                for (entry6 = subnet_length_entries_v6[i].subnet_addresses[j];
-                     entry6 != NULL; entry6 = next_entry6) {
-                    next_entry6 = entry6->next;
-                    wmem_free(addr_resolv_scope, entry6);
-                }
-            }
-            wmem_free(addr_resolv_scope, subnet_length_entries_v6[i].subnet_addresses);
-            subnet_length_entries_v6[i].subnet_addresses = NULL;
-        }
-    }
-    have_subnet_entry_v6 = false;
+    subnet_trie_free(&subnet_trie);
+    subnet_trie_free(&subnet6_trie);
 
     new_resolved_objects = false;
 }
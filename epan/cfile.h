@@ -12,6 +12,7 @@
 #include <epan/epan.h>
 #include <epan/column-info.h>
 #include <epan/dfilter/dfilter.h>
+#include <epan/dfilter_verdicts.h>
 #include <epan/frame_data.h>
 #include <epan/frame_data_sequence.h>
 
@@ -113,6 +114,9 @@ typedef struct _capture_file {
     bool                        redissecting;         /* true if currently redissecting (cf_redissect_packets) */
     bool                        read_lock;            /* true if currently processing a file (cf_read) */
     rescan_type                 redissection_queued;  /* Queued redissection type. */
+    dfilter_verdict_cache      *dfilter_verdicts;     /* Per-frame verdicts of recent display filters */
+    uint32_t                    first_pass_pending;   /* First frame not yet dissected in order, if the first pass was deferred; 0 if none */
+    bool                        first_pass_running;   /* true while the deferred first pass is running */
     /* search */
     char                       *sfilter;              /* Filter, hex value, or string being searched */
     /* XXX: Some of these booleans should be enums; they're exclusive cases */
@@ -66,6 +66,77 @@ static GHashTable *session_disabled_filters;
  */
 static bool tmp_colors_set;
 
+/* The enabled filters of color_filter_list, combined into one program
+ * that finds the first of them to match a packet, so that the fields
+ * they have in common are only read once. */
+typedef struct {
+    color_filter_t *colorf;
+    dfilter_t      *c_colorfilter;  /* colorf->c_colorfilter when combined */
+} combined_rule_t;
+
+static dfilter_t *combined_filter;
+static GArray *combined_rules;
+
+static void
+color_filters_combined_free(void)
+{
+    dfilter_free(combined_filter);
+    combined_filter = NULL;
+    if (combined_rules) {
+        g_array_free(combined_rules, true);
+        combined_rules = NULL;
+    }
+}
+
+/* Does the combined program still match color_filter_list? */
+static bool
+color_filters_combined_is_current(void)
+{
+    unsigned i = 0;
+
+    if (combined_filter == NULL)
+        return false;
+
+    for (GSList *curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        color_filter_t *colorf = (color_filter_t *)curr->data;
+        combined_rule_t *rule;
+
+        if (colorf->disabled || colorf->c_colorfilter == NULL)
+            continue;
+        if (i >= combined_rules->len)
+            return false;
+        rule = &g_array_index(combined_rules, combined_rule_t, i);
+        if (rule->colorf != colorf || rule->c_colorfilter != colorf->c_colorfilter)
+            return false;
+        i++;
+    }
+    return i == combined_rules->len;
+}
+
+static void
+color_filters_combine(void)
+{
+    GPtrArray *filters;
+
+    color_filters_combined_free();
+
+    combined_rules = g_array_new(false, false, sizeof(combined_rule_t));
+    filters = g_ptr_array_new();
+    for (GSList *curr = color_filter_list; curr != NULL; curr = g_slist_next(curr)) {
+        color_filter_t *colorf = (color_filter_t *)curr->data;
+        combined_rule_t rule;
+
+        if (colorf->disabled || colorf->c_colorfilter == NULL)
+            continue;
+        rule.colorf = colorf;
+        rule.c_colorfilter = colorf->c_colorfilter;
+        g_array_append_val(combined_rules, rule);
+        g_ptr_array_add(filters, colorf->c_colorfilter);
+    }
+    combined_filter = dfilter_combine_first_match((dfilter_t **)filters->pdata, filters->len);
+    g_ptr_array_free(filters, true);
+}
+
 /* Create a new filter */
 color_filter_t *
 color_filter_new(const char *name,          /* The name of the filter to create */
@@ -198,6 +269,7 @@ color_filters_set_tmp(uint8_t filt_nr, const char *filter, bool disabled, char *
                 return false;
             } else {
                 g_free(colorf->filter_text);
+                color_filters_combined_free();
                 dfilter_free(colorf->c_colorfilter);
                 colorf->filter_text = g_strdup(tmpfilter);
                 colorf->c_colorfilter = compiled_filter;
@@ -361,6 +433,7 @@ bool
 color_filters_init(char** err_msg, color_filter_add_cb_func add_cb, const char* app_env_var_prefix)
 {
     /* delete all currently existing filters */
+    color_filters_combined_free();
     color_filter_list_delete(&color_filter_list);
 
     /* now try to construct the filters list */
@@ -379,6 +452,7 @@ color_filters_reload(char** err_msg, color_filter_add_cb_func add_cb, const char
 {
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
+    color_filters_combined_free();
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
 
@@ -390,6 +464,7 @@ void
 color_filters_cleanup(void)
 {
     /* delete the previously deleted filters */
+    color_filters_combined_free();
     color_filter_list_delete(&color_filter_deleted_list);
 
     if (session_disabled_filters) {
@@ -482,6 +557,7 @@ color_filters_apply(GSList *tmp_cfl, GSList *edit_cfl, char** err_msg)
 
     /* "move" old entries to the deleted list
      * we must keep them until the dissection no longer needs them */
+    color_filters_combined_free();
     color_filter_deleted_list = g_slist_concat(color_filter_deleted_list, color_filter_list);
     color_filter_list = NULL;
 
@@ -591,22 +667,29 @@ color_filters_use_proto(int proto_id)
 const color_filter_t *
 color_filters_colorize_packet(epan_dissect_t *edt)
 {
-    GSList         *curr;
-    color_filter_t *colorf;
+    combined_rule_t *rule;
+    int              match;
 
     /* If we have color filters, "search" for the matching one. */
     if ((edt->tree != NULL) && (color_filters_used())) {
-        curr = color_filter_list;
-
-        while(curr != NULL) {
-            colorf = (color_filter_t *)curr->data;
-            if ( (!colorf->disabled) &&
-                 (colorf->c_colorfilter != NULL) &&
-                 dfilter_apply_edt(colorf->c_colorfilter, edt) &&
-                 !color_filter_is_session_disabled(colorf->filter_name)) {
-                return colorf;
+        if (!color_filters_combined_is_current())
+            color_filters_combine();
+
+        match = dfilter_apply_first_match_edt(combined_filter, edt);
+        if (match < 0)
+            return NULL;
+
+        rule = &g_array_index(combined_rules, combined_rule_t, match);
+        if (!color_filter_is_session_disabled(rule->colorf->filter_name))
+            return rule->colorf;
+
+        /* That one is paused; try the ones after it. */
+        for (unsigned i = (unsigned)match + 1; i < combined_rules->len; i++) {
+            rule = &g_array_index(combined_rules, combined_rule_t, i);
+            if (dfilter_apply_edt(rule->c_colorfilter, edt) &&
+                !color_filter_is_session_disabled(rule->colorf->filter_name)) {
+                return rule->colorf;
             }
-            curr = g_slist_next(curr);
         }
     }
 
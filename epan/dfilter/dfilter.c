@@ -707,6 +707,177 @@ dfilter_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 	return dfvm_apply_full(df, tree, fvals);
 }
 
+/*
+ * Copy an instruction argument of one of the filters being combined.
+ * Registers and jump targets are given their numbers in the combined
+ * program, once per value, as the filter's instructions share them;
+ * everything else is shared with the filter.
+ */
+static dfvm_value_t *
+combine_value(dfvm_value_t *v, GHashTable *values, GHashTable *regs,
+		unsigned *next_register, unsigned insn_base)
+{
+	dfvm_value_t *new_v;
+	void *reg;
+
+	if (v == NULL)
+		return NULL;
+	if (v->type != REGISTER && v->type != INSN_NUMBER)
+		return dfvm_value_ref(v);
+
+	new_v = g_hash_table_lookup(values, v);
+	if (new_v == NULL) {
+		if (v->type == INSN_NUMBER) {
+			new_v = dfvm_value_new(INSN_NUMBER);
+			new_v->value.numeric = v->value.numeric + insn_base;
+		}
+		else {
+			/* Registers are stored as reg+1, as in gencode. */
+			reg = g_hash_table_lookup(regs, GUINT_TO_POINTER(v->value.numeric));
+			if (reg == NULL) {
+				reg = GUINT_TO_POINTER(++*next_register);
+				g_hash_table_insert(regs, GUINT_TO_POINTER(v->value.numeric), reg);
+			}
+			new_v = dfvm_value_new_register(GPOINTER_TO_INT(reg) - 1);
+		}
+		g_hash_table_insert(values, v, dfvm_value_ref(new_v));
+	}
+	return dfvm_value_ref(new_v);
+}
+
+/* Merge the references of a filter into those of the combined program. */
+static void
+combine_references(GHashTable *to, GHashTable *from)
+{
+	GHashTableIter iter;
+	void *key;
+
+	g_hash_table_iter_init(&iter, from);
+	while (g_hash_table_iter_next(&iter, &key, NULL)) {
+		if (!g_hash_table_contains(to, key))
+			g_hash_table_insert(to, key, g_ptr_array_new_with_free_func((GDestroyNotify)reference_free));
+	}
+}
+
+dfilter_t *
+dfilter_combine_first_match(dfilter_t **filters, unsigned count)
+{
+	dfilter_t	*df;
+	GHashTable	*loaded_fields;	/* hfinfo -> register+1 in df */
+	GHashTable	*loaded_raw_fields;
+	GHashTable	*loaded_vs_fields;
+	GHashTable	*loaded;
+	GHashTable	*interesting;
+	GHashTable	*regs;		/* register in a filter -> register+1 in df */
+	GHashTable	*values;	/* value in a filter -> value in df */
+	unsigned	next_register = 0;
+	dfvm_insn_t	*insn, *new_insn;
+	void		*key, *reg;
+	GHashTableIter	iter;
+	int		i;
+
+	df = dfilter_new(NULL);
+	df->insns = g_ptr_array_new();
+	df->references = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+				NULL, free_refs_array);
+	df->raw_references = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+				NULL, free_refs_array);
+	df->ret_type = FT_BOOLEAN;
+
+	loaded_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	loaded_raw_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	loaded_vs_fields = g_hash_table_new(g_direct_hash, g_direct_equal);
+	interesting = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	for (unsigned n = 0; n < count; n++) {
+		dfilter_t *f = filters[n];
+		unsigned insn_base = df->insns->len;
+
+		if (f == NULL)
+			continue;
+
+		regs = g_hash_table_new(g_direct_hash, g_direct_equal);
+		values = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+				NULL, (GDestroyNotify)dfvm_value_unref);
+
+		/*
+		 * Give the fields this filter reads whole the registers
+		 * earlier filters read them into, so that they're only read
+		 * once per packet. Reads of layers of a field keep their own
+		 * registers.
+		 */
+		for (unsigned j = 0; j < f->insns->len; j++) {
+			insn = g_ptr_array_index(f->insns, j);
+			if (insn->op != DFVM_READ_TREE)
+				continue;
+			if (insn->arg1->type == HFINFO_VS)
+				loaded = loaded_vs_fields;
+			else if (insn->arg1->type == RAW_HFINFO)
+				loaded = loaded_raw_fields;
+			else
+				loaded = loaded_fields;
+			reg = g_hash_table_lookup(loaded, insn->arg1->value.hfinfo);
+			if (reg == NULL) {
+				reg = GUINT_TO_POINTER(++next_register);
+				g_hash_table_insert(loaded, insn->arg1->value.hfinfo, reg);
+			}
+			g_hash_table_insert(regs, GUINT_TO_POINTER(insn->arg2->value.numeric), reg);
+		}
+
+		for (unsigned j = 0; j < f->insns->len; j++) {
+			insn = g_ptr_array_index(f->insns, j);
+			if (insn->op == DFVM_RETURN) {
+				/* The filter's verdict is in the accumulator. */
+				new_insn = dfvm_insn_new(DFVM_MATCH);
+				new_insn->arg1 = dfvm_value_ref(dfvm_value_new_uint(n));
+			}
+			else {
+				new_insn = dfvm_insn_new(insn->op);
+				new_insn->arg1 = combine_value(insn->arg1, values, regs, &next_register, insn_base);
+				new_insn->arg2 = combine_value(insn->arg2, values, regs, &next_register, insn_base);
+				new_insn->arg3 = combine_value(insn->arg3, values, regs, &next_register, insn_base);
+			}
+			new_insn->id = (int)df->insns->len;
+			g_ptr_array_add(df->insns, new_insn);
+		}
+
+		for (i = 0; i < f->num_interesting_fields; i++)
+			g_hash_table_add(interesting, GINT_TO_POINTER(f->interesting_fields[i]));
+		combine_references(df->references, f->references);
+		combine_references(df->raw_references, f->raw_references);
+
+		g_hash_table_destroy(values);
+		g_hash_table_destroy(regs);
+	}
+
+	/* None of them matched. */
+	insn = dfvm_insn_new(DFVM_RETURN);
+	insn->id = (int)df->insns->len;
+	g_ptr_array_add(df->insns, insn);
+
+	df->num_interesting_fields = (int)g_hash_table_size(interesting);
+	df->interesting_fields = g_new(int, MAX(df->num_interesting_fields, 1));
+	i = 0;
+	g_hash_table_iter_init(&iter, interesting);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+		df->interesting_fields[i++] = GPOINTER_TO_INT(key);
+
+	df->num_registers = next_register;
+	df->registers = g_new0(df_cell_t, MAX(df->num_registers, 1));
+
+	g_hash_table_destroy(interesting);
+	g_hash_table_destroy(loaded_fields);
+	g_hash_table_destroy(loaded_raw_fields);
+	g_hash_table_destroy(loaded_vs_fields);
+	return df;
+}
+
+int
+dfilter_apply_first_match_edt(dfilter_t *df, epan_dissect_t *edt)
+{
+	return dfvm_apply_first_match(df, edt->tree);
+}
+
 void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
 {
@@ -785,6 +956,87 @@ dfilter_requires_columns(const dfilter_t *df)
 	return dfilter_interested_in_proto(df, proto_cols);
 }
 
+bool
+dfilter_verdict_is_reusable(const dfilter_t *df)
+{
+	if (df == NULL) {
+		return true;
+	}
+
+	if (g_hash_table_size(df->references) > 0 ||
+			g_hash_table_size(df->raw_references) > 0) {
+		return false;
+	}
+
+	if (dfilter_requires_columns(df)) {
+		return false;
+	}
+
+	static int proto_frame;
+	if (proto_frame <= 0) {
+		proto_frame = proto_get_id_by_filter_name("frame");
+	}
+	ws_assert(proto_frame > 0);
+
+	return !dfilter_interested_in_proto(df, proto_frame);
+}
+
+bool
+dfilter_is_narrowing_of(const char *text, const char *broader)
+{
+	size_t broader_len = strlen(broader);
+	const char *conjunct;
+	char *combined;
+	dfilter_t *text_df = NULL, *combined_df = NULL;
+	bool narrows;
+
+	if (broader_len == 0) {
+		/* Dissectors can hide frames even without a filter, and hidden
+		 * frames never pass any filter. */
+		return true;
+	}
+
+	if (strncmp(text, broader, broader_len) == 0) {
+		conjunct = text + broader_len;
+	} else if (text[0] == '(' && strncmp(text + 1, broader, broader_len) == 0 &&
+			text[broader_len + 1] == ')') {
+		conjunct = text + broader_len + 2;
+	} else {
+		return false;
+	}
+
+	while (g_ascii_isspace(*conjunct))
+		conjunct++;
+	if (strncmp(conjunct, "&&", 2) == 0) {
+		conjunct += 2;
+	} else if (g_ascii_strncasecmp(conjunct, "and", 3) == 0 &&
+			!g_ascii_isalnum(conjunct[3]) && conjunct[3] != '_' && conjunct[3] != '.') {
+		conjunct += 3;
+	} else {
+		return false;
+	}
+	while (g_ascii_isspace(*conjunct))
+		conjunct++;
+	if (*conjunct == '\0')
+		return false;
+
+	/*
+	 * Operator precedence might make that something else entirely, e.g.
+	 * "a || b" to "a || b && c", so check that the syntax tree is the
+	 * same as explicitly grouping the two filters.
+	 */
+	combined = ws_strdup_printf("(%s) && (%s)", broader, conjunct);
+	narrows = dfilter_compile_full(text, &text_df, NULL, DF_SAVE_TREE, __func__) &&
+		  dfilter_compile_full(combined, &combined_df, NULL, DF_SAVE_TREE, __func__) &&
+		  text_df != NULL && combined_df != NULL &&
+		  g_strcmp0(dfilter_syntax_tree(text_df), dfilter_syntax_tree(combined_df)) == 0;
+	dfilter_free(text_df);
+	dfilter_free(combined_df);
+	g_free(combined);
+
+	return narrows;
+}
+
 GPtrArray *
 dfilter_deprecated_tokens(dfilter_t *df) {
 	if (df->deprecated && df->deprecated->len > 0) {
@@ -205,6 +205,34 @@ dfilter_apply_edt(dfilter_t *df, struct epan_dissect *edt);
 bool
 dfilter_apply(dfilter_t *df, proto_tree *tree);
 
+/**
+ * @brief Combine an ordered list of compiled filters into one program.
+ *
+ * The program tries the filters in order and stops at the first one that
+ * matches. A field that several of the filters test is read from the tree
+ * once per packet rather than once per filter.
+ *
+ * @param filters The filters, in the order they are tried. NULL entries
+ * never match.
+ * @param count The number of entries in filters.
+ * @return The combined program. It doesn't refer to the filters, which
+ * may be freed before it.
+ */
+WS_DLL_PUBLIC
+dfilter_t *
+dfilter_combine_first_match(dfilter_t **filters, unsigned count);
+
+/**
+ * @brief Apply a program made by dfilter_combine_first_match().
+ *
+ * @param df The combined program.
+ * @param edt The epan_dissect structure to apply the program to.
+ * @return The index of the first filter that matches, or -1 if none does.
+ */
+WS_DLL_PUBLIC
+int
+dfilter_apply_first_match_edt(dfilter_t *df, struct epan_dissect *edt);
+
 /**
  * @brief Apply a dfilter to a proto_tree and populate fvals.
  *
@@ -296,6 +324,39 @@ WS_DLL_PUBLIC
 bool
 dfilter_requires_columns(const dfilter_t *df);
 
+/**
+ * @brief Check if the verdict of a display filter on a frame can be reused.
+ *
+ * A verdict can be reused when a frame is filtered again without being
+ * redissected if it only depends on the dissection of that frame. It can't
+ * be if the filter uses field references to the selected frame, columns,
+ * or frame fields such as marks, time references and comments, which can
+ * change without a redissection.
+ *
+ * @param df The display filter to check.
+ * @return true if verdicts of the filter can be reused, false otherwise.
+ */
+WS_DLL_PUBLIC
+bool
+dfilter_verdict_is_reusable(const dfilter_t *df);
+
+/**
+ * @brief Check if every frame that passes a filter passes another one too,
+ * because it is the other filter with a conjunct appended.
+ *
+ * That is "broader && c", "broader and c" or "(broader) && c", as long as
+ * operator precedence doesn't make it something else, as in "a || b" and
+ * "a || b && c". Any filter narrows the empty filter, as hidden frames
+ * pass no filter. Both filters are the text after macro expansion.
+ *
+ * @param text The text of the filter that might be narrower.
+ * @param broader The text of the filter that might be broader.
+ * @return true if "text" is known to narrow "broader", false otherwise.
+ */
+WS_DLL_PUBLIC
+bool
+dfilter_is_narrowing_of(const char *text, const char *broader);
+
 /**
  * @brief Get deprecated tokens from a dfilter.
  *
@@ -0,0 +1,385 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include "dfvm-set.h"
+
+#include <wsutil/inet_cidr.h>
+#include <wsutil/ws_assert.h>
+
+/* A set member: (low, high) for a range or (value, NULL). */
+typedef struct {
+	const fvalue_t *low;
+	const fvalue_t *high;
+} set_member_t;
+
+typedef struct trie_node {
+	struct trie_node *child[2];
+	bool terminal;
+} trie_node_t;
+
+struct dfvm_set {
+	ftenum_t ftype;		/* Type of the first member. */
+	GPtrArray *fvalues;	/* Owns every member value. */
+	GArray *all;		/* Every member, for values of another type. */
+	GHashTable *values;	/* Hashable single values. */
+	GArray *intervals;	/* Sorted and disjoint once sealed. */
+	trie_node_t *trie;	/* IPv4 and IPv6 subnets. */
+	GArray *others;		/* Members that can't be indexed. */
+	bool sealed;
+};
+
+static bool
+is_hashable(ftenum_t ftype)
+{
+	if (FT_IS_INTEGER(ftype))
+		return true;
+
+	switch (ftype) {
+		case FT_ETHER:
+		case FT_BYTES:
+		case FT_STRING:
+		case FT_STRINGZ:
+		case FT_UINT_STRING:
+		case FT_STRINGZPAD:
+		case FT_STRINGZTRUNC:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static bool
+is_ordered(ftenum_t ftype)
+{
+	if (FT_IS_INTEGER(ftype))
+		return true;
+
+	switch (ftype) {
+		case FT_FLOAT:
+		case FT_DOUBLE:
+		case FT_ABSOLUTE_TIME:
+		case FT_RELATIVE_TIME:
+		case FT_IPv4:
+		case FT_IPv6:
+			return true;
+		default:
+			return false;
+	}
+}
+
+/* Returns the prefix length of an address, 32 or 128 if it is a host
+ * address, or -1 if the IPv4 mask isn't contiguous. */
+static int
+address_prefix_len(const fvalue_t *fv)
+{
+	if (fvalue_type_ftenum(fv) == FT_IPv4) {
+		const ipv4_addr_and_mask *ipv4 = fvalue_get_ipv4((fvalue_t *)fv);
+		uint32_t mask = ipv4->nmask;
+		int len = 0;
+
+		while (mask & 0x80000000) {
+			len++;
+			mask <<= 1;
+		}
+		return mask == 0 ? len : -1;
+	}
+	else {
+		const ipv6_addr_and_prefix *ipv6 = fvalue_get_ipv6((fvalue_t *)fv);
+
+		return MIN(ipv6->prefix, 128);
+	}
+}
+
+static bool
+is_host_address(const fvalue_t *fv)
+{
+	switch (fvalue_type_ftenum(fv)) {
+		case FT_IPv4:
+			return address_prefix_len(fv) == 32;
+		case FT_IPv6:
+			return address_prefix_len(fv) == 128;
+		default:
+			return true;
+	}
+}
+
+static unsigned
+address_bit(const fvalue_t *fv, int pos)
+{
+	if (fvalue_type_ftenum(fv) == FT_IPv4) {
+		const ipv4_addr_and_mask *ipv4 = fvalue_get_ipv4((fvalue_t *)fv);
+
+		return (ipv4->addr >> (31 - pos)) & 1;
+	}
+	else {
+		const ipv6_addr_and_prefix *ipv6 = fvalue_get_ipv6((fvalue_t *)fv);
+
+		return (ipv6->addr.bytes[pos / 8] >> (7 - pos % 8)) & 1;
+	}
+}
+
+static void
+trie_insert(dfvm_set_t *set, const fvalue_t *fv, int prefix_len)
+{
+	trie_node_t *node;
+
+	if (set->trie == NULL)
+		set->trie = g_new0(trie_node_t, 1);
+
+	node = set->trie;
+	for (int pos = 0; pos < prefix_len; pos++) {
+		unsigned bit;
+
+		if (node->terminal) {
+			/* Already covered by a shorter prefix. */
+			return;
+		}
+		bit = address_bit(fv, pos);
+		if (node->child[bit] == NULL)
+			node->child[bit] = g_new0(trie_node_t, 1);
+		node = node->child[bit];
+	}
+	node->terminal = true;
+}
+
+static bool
+trie_lookup(const trie_node_t *node, const fvalue_t *fv)
+{
+	int bits = fvalue_type_ftenum(fv) == FT_IPv4 ? 32 : 128;
+
+	for (int pos = 0; node != NULL; pos++) {
+		if (node->terminal)
+			return true;
+		if (pos == bits)
+			break;
+		node = node->child[address_bit(fv, pos)];
+	}
+	return false;
+}
+
+static void
+trie_free(trie_node_t *node)
+{
+	if (node == NULL)
+		return;
+	trie_free(node->child[0]);
+	trie_free(node->child[1]);
+	g_free(node);
+}
+
+static bool
+member_contains(const set_member_t *m, const fvalue_t *fv)
+{
+	if (m->high == NULL)
+		return fvalue_eq(fv, m->low) == FT_TRUE;
+	return fvalue_ge(fv, m->low) == FT_TRUE &&
+			fvalue_le(fv, m->high) == FT_TRUE;
+}
+
+dfvm_set_t *
+dfvm_set_new(void)
+{
+	dfvm_set_t *set = g_new0(dfvm_set_t, 1);
+
+	set->ftype = FT_NONE;
+	set->fvalues = g_ptr_array_new_with_free_func((GDestroyNotify)fvalue_free);
+	set->all = g_array_new(false, false, sizeof(set_member_t));
+	set->values = g_hash_table_new((GHashFunc)fvalue_hash, (GEqualFunc)fvalue_equal);
+	set->intervals = g_array_new(false, false, sizeof(set_member_t));
+	set->others = g_array_new(false, false, sizeof(set_member_t));
+	return set;
+}
+
+static void
+add_interval(dfvm_set_t *set, const fvalue_t *low, const fvalue_t *high)
+{
+	set_member_t m = { low, high };
+
+	/* An empty range (or one with a NaN bound) can never match. */
+	if (fvalue_le(low, high) != FT_TRUE)
+		return;
+	g_array_append_val(set->intervals, m);
+}
+
+void
+dfvm_set_add(dfvm_set_t *set, fvalue_t *fv)
+{
+	set_member_t m = { fv, NULL };
+	ftenum_t ftype = fvalue_type_ftenum(fv);
+	int prefix_len;
+
+	ws_assert(!set->sealed);
+	g_ptr_array_add(set->fvalues, fv);
+	g_array_append_val(set->all, m);
+	if (set->ftype == FT_NONE)
+		set->ftype = ftype;
+
+	if (ftype != set->ftype) {
+		g_array_append_val(set->others, m);
+	}
+	else if (is_hashable(ftype)) {
+		g_hash_table_add(set->values, fv);
+	}
+	else if (ftype == FT_IPv4 || ftype == FT_IPv6) {
+		prefix_len = address_prefix_len(fv);
+		if (is_host_address(fv))
+			g_hash_table_add(set->values, fv);
+		else if (prefix_len >= 0)
+			trie_insert(set, fv, prefix_len);
+		else
+			g_array_append_val(set->others, m);
+	}
+	else if (is_ordered(ftype)) {
+		/* x == v exactly when v <= x <= v. */
+		add_interval(set, fv, fv);
+	}
+	else {
+		g_array_append_val(set->others, m);
+	}
+}
+
+void
+dfvm_set_add_range(dfvm_set_t *set, fvalue_t *low, fvalue_t *high)
+{
+	set_member_t m = { low, high };
+	ftenum_t ftype = fvalue_type_ftenum(low);
+
+	ws_assert(!set->sealed);
+	g_ptr_array_add(set->fvalues, low);
+	g_ptr_array_add(set->fvalues, high);
+	g_array_append_val(set->all, m);
+	if (set->ftype == FT_NONE)
+		set->ftype = ftype;
+
+	if (ftype == set->ftype && fvalue_type_ftenum(high) == ftype &&
+			is_ordered(ftype) && is_host_address(low) && is_host_address(high))
+		add_interval(set, low, high);
+	else
+		g_array_append_val(set->others, m);
+}
+
+static int
+compare_interval(const void *a, const void *b)
+{
+	const set_member_t *ma = a;
+	const set_member_t *mb = b;
+
+	if (fvalue_lt(ma->low, mb->low) == FT_TRUE)
+		return -1;
+	if (fvalue_lt(mb->low, ma->low) == FT_TRUE)
+		return 1;
+	return 0;
+}
+
+void
+dfvm_set_seal(dfvm_set_t *set)
+{
+	GArray *intervals = set->intervals;
+	unsigned n = 0;
+
+	ws_assert(!set->sealed);
+	set->sealed = true;
+	if (intervals->len == 0)
+		return;
+
+	/* Sort by lower bound and merge overlapping intervals. */
+	g_array_sort(intervals, compare_interval);
+	for (unsigned i = 1; i < intervals->len; i++) {
+		set_member_t *cur = &g_array_index(intervals, set_member_t, n);
+		set_member_t *next = &g_array_index(intervals, set_member_t, i);
+
+		if (fvalue_le(next->low, cur->high) == FT_TRUE) {
+			if (fvalue_gt(next->high, cur->high) == FT_TRUE)
+				cur->high = next->high;
+		}
+		else {
+			g_array_index(intervals, set_member_t, ++n) = *next;
+		}
+	}
+	g_array_set_size(intervals, n + 1);
+}
+
+static bool
+intervals_contain(GArray *intervals, const fvalue_t *fv)
+{
+	unsigned lo = 0, hi = intervals->len;
+
+	/* Find the last interval whose lower bound is <= fv. */
+	while (lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+
+		if (fvalue_le(g_array_index(intervals, set_member_t, mid).low, fv) == FT_TRUE)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return false;
+	return fvalue_le(fv, g_array_index(intervals, set_member_t, lo - 1).high) == FT_TRUE;
+}
+
+bool
+dfvm_set_contains(const dfvm_set_t *set, const fvalue_t *fv)
+{
+	ws_assert(set->sealed);
+
+	if (fvalue_type_ftenum(fv) != set->ftype || !is_host_address(fv)) {
+		/* The indexes don't apply; compare with every member. */
+		for (unsigned i = 0; i < set->all->len; i++) {
+			if (member_contains(&g_array_index(set->all, set_member_t, i), fv))
+				return true;
+		}
+		return false;
+	}
+
+	if (g_hash_table_size(set->values) > 0 &&
+			g_hash_table_contains(set->values, fv))
+		return true;
+	if (set->trie && trie_lookup(set->trie, fv))
+		return true;
+	if (set->intervals->len > 0 && intervals_contain(set->intervals, fv))
+		return true;
+	for (unsigned i = 0; i < set->others->len; i++) {
+		if (member_contains(&g_array_index(set->others, set_member_t, i), fv))
+			return true;
+	}
+	return false;
+}
+
+unsigned
+dfvm_set_size(const dfvm_set_t *set)
+{
+	return set->all->len;
+}
+
+void
+dfvm_set_free(dfvm_set_t *set)
+{
+	g_hash_table_destroy(set->values);
+	g_array_free(set->intervals, true);
+	g_array_free(set->others, true);
+	g_array_free(set->all, true);
+	trie_free(set->trie);
+	g_ptr_array_free(set->fvalues, true);
+	g_free(set);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
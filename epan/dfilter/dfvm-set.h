@@ -0,0 +1,99 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 2001 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef DFVM_SET_H
+#define DFVM_SET_H
+
+#include <wireshark.h>
+
+#include <epan/ftypes/ftypes.h>
+
+/**
+ * @brief Sets of constants with at least this many members are indexed
+ * at compile time instead of being built on the set stack for each packet.
+ */
+#define DFVM_SET_INDEX_MIN 8
+
+/**
+ * @brief An indexed set of constant values and ranges, for the membership
+ * operator.
+ *
+ * Values are kept in a hash table, ranges in a sorted array of disjoint
+ * intervals, and IPv4 and IPv6 subnets in a prefix trie, so testing a
+ * value doesn't depend on the size of the set. Members that can't be
+ * indexed are tested one by one.
+ */
+typedef struct dfvm_set dfvm_set_t;
+
+/**
+ * @brief Create an empty set.
+ *
+ * @return A new set. Free it with dfvm_set_free().
+ */
+dfvm_set_t *
+dfvm_set_new(void);
+
+/**
+ * @brief Add a value to a set.
+ *
+ * @param set The set.
+ * @param fv The value. The set takes ownership of it.
+ */
+void
+dfvm_set_add(dfvm_set_t *set, fvalue_t *fv);
+
+/**
+ * @brief Add an inclusive range of values to a set.
+ *
+ * @param set The set.
+ * @param low The lower bound. The set takes ownership of it.
+ * @param high The upper bound. The set takes ownership of it.
+ */
+void
+dfvm_set_add_range(dfvm_set_t *set, fvalue_t *low, fvalue_t *high);
+
+/**
+ * @brief Finish building the index of a set.
+ *
+ * Must be called after the last member is added and before the set is
+ * tested.
+ *
+ * @param set The set.
+ */
+void
+dfvm_set_seal(dfvm_set_t *set);
+
+/**
+ * @brief Test if a value is a member of a set.
+ *
+ * @param set The set.
+ * @param fv The value.
+ * @return True if the value equals a member or is within a member range.
+ */
+bool
+dfvm_set_contains(const dfvm_set_t *set, const fvalue_t *fv);
+
+/**
+ * @brief Get the number of members (values and ranges) of a set.
+ *
+ * @param set The set.
+ * @return The number of members.
+ */
+unsigned
+dfvm_set_size(const dfvm_set_t *set);
+
+/**
+ * @brief Free a set and all its members.
+ *
+ * @param set The set.
+ */
+void
+dfvm_set_free(dfvm_set_t *set);
+
+#endif /* DFVM_SET_H */
@@ -72,6 +72,7 @@ dfvm_opcode_tostr(dfvm_opcode_t code)
 		case DFVM_STACK_POP:		return "STACK_POP";
 		case DFVM_NOT_ALL_ZERO:		return "NOT_ALL_ZERO";
 		case DFVM_NO_OP:		return "NO_OP";
+		case DFVM_MATCH:		return "MATCH";
 	}
 	return "(fix-opcode-string)";
 }
@@ -89,6 +90,9 @@ dfvm_value_free(dfvm_value_t *v)
 		case PCRE:
 			ws_regex_free(v->value.pcre);
 			break;
+		case FVALUE_SET:
+			dfvm_set_free(v->value.set);
+			break;
 		case EMPTY:
 		case HFINFO:
 		case RAW_HFINFO:
@@ -243,6 +247,14 @@ dfvm_value_new_uint(unsigned num)
 	return v;
 }
 
+dfvm_value_t*
+dfvm_value_new_set(dfvm_set_t *set)
+{
+	dfvm_value_t *v = dfvm_value_new(FVALUE_SET);
+	v->value.set = set;
+	return v;
+}
+
 static char *
 dfvm_value_tostr(dfvm_value_t *v)
 {
@@ -270,6 +282,9 @@ dfvm_value_tostr(dfvm_value_t *v)
 		case PCRE:
 			s = ws_strdup(ws_regex_pattern(v->value.pcre));
 			break;
+		case FVALUE_SET:
+			s = ws_strdup_printf("{%u members}", dfvm_set_size(v->value.set));
+			break;
 		case REGISTER:
 			s = ws_strdup_printf("R%"PRIu32, v->value.numeric);
 			break;
@@ -552,7 +567,11 @@ append_op_args(wmem_strbuf_t *buf, dfvm_insn_t *insn, GSList **stack_print,
 		case DFVM_SET_ANY_IN:
 		case DFVM_SET_ALL_NOT_IN:
 		case DFVM_SET_ANY_NOT_IN:
-			wmem_strbuf_append_printf(buf, "%s%s",
+			if (arg2)
+				wmem_strbuf_append_printf(buf, "%s%s in %s",
+						arg1_str, arg1_str_type, arg2_str);
+			else
+				wmem_strbuf_append_printf(buf, "%s%s",
 						arg1_str, arg1_str_type);
 			break;
 
@@ -616,6 +635,7 @@ append_op_args(wmem_strbuf_t *buf, dfvm_insn_t *insn, GSList **stack_print,
 
 		case DFVM_IF_TRUE_GOTO:
 		case DFVM_IF_FALSE_GOTO:
+		case DFVM_MATCH:
 			wmem_strbuf_append_printf(buf, "%u", arg1->value.numeric);
 			break;
 
@@ -1200,7 +1220,7 @@ test_in_internal(fvalue_t *fv, GPtrArray *range[2])
 }
 
 static bool
-any_in(dfilter_t *df, dfvm_value_t *arg1)
+any_in(dfilter_t *df, dfvm_value_t *arg1, dfvm_value_t *arg2)
 {
 	df_cell_t *rp = &df->registers[arg1->value.numeric];
 	GPtrArray *value;
@@ -1212,6 +1232,14 @@ any_in(dfilter_t *df, dfvm_value_t *arg1)
 	value = df_cell_ptr(rp);
 
 	for (size_t i = 0; i < value->len; i++) {
+		if (arg2) {
+			/* Constant set indexed at compile time. */
+			ok = dfvm_set_contains(arg2->value.set, value->pdata[i]);
+			if (ok) {
+				return true;
+			}
+			continue;
+		}
 		stack = df->set_stack;
 		ok = false;
 		while (stack) {
@@ -1229,7 +1257,7 @@ any_in(dfilter_t *df, dfvm_value_t *arg1)
 }
 
 static bool
-all_in(dfilter_t *df, dfvm_value_t *arg1)
+all_in(dfilter_t *df, dfvm_value_t *arg1, dfvm_value_t *arg2)
 {
 	df_cell_t *rp = &df->registers[arg1->value.numeric];
 	GPtrArray *value;
@@ -1241,6 +1269,14 @@ all_in(dfilter_t *df, dfvm_value_t *arg1)
 	value = df_cell_ptr(rp);
 
 	for (size_t i = 0; i < value->len; i++) {
+		if (arg2) {
+			/* Constant set indexed at compile time. */
+			ok = dfvm_set_contains(arg2->value.set, value->pdata[i]);
+			if (!ok) {
+				return false;
+			}
+			continue;
+		}
 		stack = df->set_stack;
 		ok = false;
 		while (stack) {
@@ -1587,8 +1623,12 @@ check_exists(proto_tree *tree, dfvm_value_t *arg1, dfvm_value_t *arg2)
 	return false;
 }
 
-bool
-dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
+/*
+ * Run the program; if it ends at a MATCH instruction, *match is set to the
+ * index it gives, otherwise to -1.
+ */
+static bool
+dfvm_run(dfilter_t *df, proto_tree *tree, GPtrArray **fvals, int *match)
 {
 	int		id, length;
 	bool	accum = true;
@@ -1759,19 +1799,19 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 				break;
 
 			case DFVM_SET_ALL_IN:
-				accum = all_in(df, arg1);
+				accum = all_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_ANY_IN:
-				accum = any_in(df, arg1);
+				accum = any_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_ALL_NOT_IN:
-				accum = !all_in(df, arg1);
+				accum = !all_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_ANY_NOT_IN:
-				accum = !any_in(df, arg1);
+				accum = !any_in(df, arg1, arg2);
 				break;
 
 			case DFVM_SET_CLEAR:
@@ -1794,8 +1834,17 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 					}
 				}
 				free_register_overhead(df);
+				*match = -1;
 				return accum;
 
+			case DFVM_MATCH:
+				if (accum) {
+					free_register_overhead(df);
+					*match = (int)arg1->value.numeric;
+					return true;
+				}
+				break;
+
 			case DFVM_NO_OP:
 				break;
 
@@ -1821,12 +1870,29 @@ dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
 	ws_assert_not_reached();
 }
 
+bool
+dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals)
+{
+	int match;
+
+	return dfvm_run(df, tree, fvals, &match);
+}
+
 bool
 dfvm_apply(dfilter_t *df, proto_tree *tree)
 {
 	return dfvm_apply_full(df, tree, NULL);
 }
 
+int
+dfvm_apply_first_match(dfilter_t *df, proto_tree *tree)
+{
+	int match;
+
+	dfvm_run(df, tree, NULL, &match);
+	return match;
+}
+
 /*
  * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
  *
@@ -15,6 +15,7 @@
 #include "syntax-tree.h"
 #include "drange.h"
 #include "dfunctions.h"
+#include "dfvm-set.h"
 
 /**
  * @brief Aborts with a fatal error when an unhandled DFVM opcode is encountered.
@@ -39,6 +40,7 @@ typedef enum {
     DRANGE,       /**< Payload is a display filter range (drange_t) */
     FUNCTION_DEF, /**< Payload is a display filter function definition (df_func_def_t) */
     PCRE,         /**< Payload is a compiled Perl-Compatible Regular Expression (pcre2) */
+    FVALUE_SET,   /**< Payload is an indexed set of constants (dfvm_set_t) */
 } dfvm_value_type_t;
 
 /**
@@ -58,6 +60,7 @@ typedef struct {
 		header_field_info *hfinfo;     /**< Pointer to header field metadata. */
 		df_func_def_t *funcdef;        /**< Pointer to a display filter function definition. */
 		ws_regex_t *pcre;              /**< Pointer to a compiled regular expression. */
+		dfvm_set_t *set;               /**< Pointer to an indexed set of constants. */
 	} value;
 
 	int ref_count; /**< Reference count for memory management. */
@@ -124,6 +127,7 @@ typedef enum {
     DFVM_STACK_POP,         /**< Pop N entries from the function argument stack */
     DFVM_NOT_ALL_ZERO,      /**< True if not all bytes in the register's values are zero */
     DFVM_NO_OP,             /**< No operation; placeholder or padding instruction */
+    DFVM_MATCH,             /**< Halt execution if the accumulator is true; the filter with the given index matched */
 } dfvm_opcode_t;
 
 /**
@@ -267,6 +271,15 @@ dfvm_value_new_pcre(ws_regex_t *re);
 dfvm_value_t*
 dfvm_value_new_uint(unsigned num);
 
+/**
+ * @brief Creates a new value for an indexed set of constants.
+ *
+ * @param set The sealed set. The value takes ownership of it.
+ * @return A pointer to the newly created set value.
+ */
+dfvm_value_t*
+dfvm_value_new_set(dfvm_set_t *set);
+
 /**
  * @brief Dumps the bytecode of a dfilter_t to a file.
  *
@@ -311,6 +324,16 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 bool
 dfvm_apply_full(dfilter_t *df, proto_tree *tree, GPtrArray **fvals);
 
+/**
+ * @brief Apply a program made of several filters to a protocol tree.
+ *
+ * @param df The program, from dfilter_combine_first_match().
+ * @param tree The protocol tree to process.
+ * @return The index of the first filter that matched, or -1 if none did.
+ */
+int
+dfvm_apply_first_match(dfilter_t *df, proto_tree *tree);
+
 /**
  * @brief Retrieves the raw value of a field as a GByteArray.
  *
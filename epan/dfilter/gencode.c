@@ -444,8 +444,58 @@ fixup_jumps(void *data, void *user_data)
 	}
 }
 
+/* Returns true if every element of the set is a constant and there are
+ * enough of them to be worth indexing. */
+static bool
+is_indexable_set(GSList *nodelist)
+{
+	stnode_t	*node1, *node2;
+	unsigned	count = 0;
+
+	while (nodelist) {
+		node1 = nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node2 = nodelist->data;
+		nodelist = g_slist_next(nodelist);
+
+		if (stnode_type_id(node1) != STTYPE_FVALUE)
+			return false;
+		if (node2 && stnode_type_id(node2) != STTYPE_FVALUE)
+			return false;
+		count++;
+	}
+	return count >= DFVM_SET_INDEX_MIN;
+}
+
+/* Builds the set of constants once, instead of pushing each element on
+ * the set stack for every packet. */
+static dfvm_value_t *
+gen_indexed_set(GSList *nodelist)
+{
+	dfvm_set_t	*set;
+	stnode_t	*node1, *node2;
+
+	set = dfvm_set_new();
+	while (nodelist) {
+		node1 = nodelist->data;
+		nodelist = g_slist_next(nodelist);
+		node2 = nodelist->data;
+		nodelist = g_slist_next(nodelist);
+
+		if (node2) {
+			dfvm_set_add_range(set, stnode_steal_data(node1),
+						stnode_steal_data(node2));
+		} else {
+			dfvm_set_add(set, stnode_steal_data(node1));
+		}
+	}
+	dfvm_set_seal(set);
+	return dfvm_value_new_set(set);
+}
+
 /* Generate the code for the in operator. Pushes set values into a stack
- * and then evaluates membership in a single instruction. */
+ * and then evaluates membership in a single instruction. Large sets of
+ * constants are indexed at compile time instead. */
 static void
 gen_relation_in(dfwork_t *dfw, dfvm_opcode_t op, stmatch_t how,
 				stnode_t *st_arg1, stnode_t *st_arg2)
@@ -460,8 +510,22 @@ gen_relation_in(dfwork_t *dfw, dfvm_opcode_t op, stmatch_t how,
 	/* Create code for the LHS of the relation */
 	val1 = gen_entity(dfw, st_arg1, &jumps);
 
-	/* Create code to populate the set stack */
 	nodelist_head = nodelist = stnode_steal_data(st_arg2);
+
+	if (is_indexable_set(nodelist_head)) {
+		insn = dfvm_insn_new(select_opcode(op, how));
+		insn->arg1 = dfvm_value_ref(val1);
+		insn->arg2 = dfvm_value_ref(gen_indexed_set(nodelist_head));
+		dfw_append_insn(dfw, insn);
+		set_nodelist_free(nodelist_head);
+
+		/* Jump here if the LHS entity was not present */
+		g_slist_foreach(jumps, fixup_jumps, dfw);
+		g_slist_free(jumps);
+		return;
+	}
+
+	/* Create code to populate the set stack */
 	while (nodelist) {
 		node1 = nodelist->data;
 		nodelist = g_slist_next(nodelist);
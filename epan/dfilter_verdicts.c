@@ -0,0 +1,182 @@
+/* dfilter_verdicts.c
+ * Per-frame display filter verdicts of recently applied filters
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/dfilter/dfilter.h>
+
+#include "dfilter_verdicts.h"
+
+#define DFILTER_VERDICTS_MAX 8
+
+struct _dfilter_verdicts {
+    char     *text;     /* Filter text after macro expansion, "" for no filter */
+    uint8_t  *passed;   /* One bit per frame, set if the frame passed */
+    uint32_t  frames;   /* Number of frames there's room for */
+    uint32_t  count;    /* Number of frames whose verdict is known */
+};
+
+struct _dfilter_verdict_cache {
+    GQueue    verdicts; /* Most recently stored first */
+};
+
+static inline bool
+verdict_passed(const dfilter_verdicts *verdicts, uint32_t framenum)
+{
+    return (verdicts->passed[(framenum - 1) / 8] >> ((framenum - 1) % 8)) & 1;
+}
+
+dfilter_verdicts *
+dfilter_verdicts_new(const char *text, uint32_t frames)
+{
+    dfilter_verdicts *verdicts = g_new0(dfilter_verdicts, 1);
+
+    verdicts->text = g_strdup(text);
+    verdicts->passed = (uint8_t *)g_malloc0((frames + 7) / 8);
+    verdicts->frames = frames;
+    return verdicts;
+}
+
+void
+dfilter_verdicts_free(dfilter_verdicts *verdicts)
+{
+    g_free(verdicts->text);
+    g_free(verdicts->passed);
+    g_free(verdicts);
+}
+
+void
+dfilter_verdicts_add(dfilter_verdicts *verdicts, uint32_t framenum, bool passed)
+{
+    if (framenum > verdicts->frames)
+        return;
+    if (passed)
+        verdicts->passed[(framenum - 1) / 8] |= 1 << ((framenum - 1) % 8);
+    verdicts->count = framenum;
+}
+
+uint32_t
+dfilter_verdicts_count(const dfilter_verdicts *verdicts)
+{
+    return verdicts->count;
+}
+
+bool
+dfilter_verdicts_lookup(const dfilter_verdicts *verdicts, bool exact,
+        uint32_t framenum, bool *passed)
+{
+    if (framenum == 0 || framenum > verdicts->count)
+        return false;
+
+    *passed = verdict_passed(verdicts, framenum);
+    /* A frame that didn't pass a broader filter can't pass this one. */
+    return exact || !*passed;
+}
+
+dfilter_verdict_cache *
+dfilter_verdict_cache_new(void)
+{
+    dfilter_verdict_cache *cache = g_new(dfilter_verdict_cache, 1);
+
+    g_queue_init(&cache->verdicts);
+    return cache;
+}
+
+void
+dfilter_verdict_cache_free(dfilter_verdict_cache *cache)
+{
+    if (cache == NULL)
+        return;
+
+    dfilter_verdict_cache_clear(cache);
+    g_free(cache);
+}
+
+void
+dfilter_verdict_cache_clear(dfilter_verdict_cache *cache)
+{
+    dfilter_verdicts *verdicts;
+
+    if (cache == NULL)
+        return;
+
+    while ((verdicts = (dfilter_verdicts *)g_queue_pop_head(&cache->verdicts)) != NULL)
+        dfilter_verdicts_free(verdicts);
+}
+
+const dfilter_verdicts *
+dfilter_verdict_cache_find(dfilter_verdict_cache *cache, const char *text, bool *exact)
+{
+    const dfilter_verdicts *broader = NULL;
+
+    if (cache == NULL)
+        return NULL;
+
+    for (GList *item = cache->verdicts.head; item != NULL; item = item->next) {
+        const dfilter_verdicts *verdicts = (const dfilter_verdicts *)item->data;
+
+        if (strcmp(verdicts->text, text) == 0) {
+            *exact = true;
+            return verdicts;
+        }
+        if (broader == NULL && dfilter_is_narrowing_of(text, verdicts->text)) {
+            broader = verdicts;
+        }
+    }
+
+    *exact = false;
+    return broader;
+}
+
+void
+dfilter_verdict_cache_store(dfilter_verdict_cache *cache, dfilter_verdicts *verdicts)
+{
+    if (verdicts->count == 0) {
+        dfilter_verdicts_free(verdicts);
+        return;
+    }
+
+    for (GList *item = cache->verdicts.head; item != NULL; item = item->next) {
+        dfilter_verdicts *old = (dfilter_verdicts *)item->data;
+
+        if (strcmp(old->text, verdicts->text) == 0) {
+            g_queue_delete_link(&cache->verdicts, item);
+            if (old->count > verdicts->count) {
+                dfilter_verdicts_free(verdicts);
+                verdicts = old;
+            } else {
+                dfilter_verdicts_free(old);
+            }
+            break;
+        }
+    }
+
+    g_queue_push_head(&cache->verdicts, verdicts);
+    while (g_queue_get_length(&cache->verdicts) > DFILTER_VERDICTS_MAX) {
+        dfilter_verdicts_free((dfilter_verdicts *)g_queue_pop_tail(&cache->verdicts));
+    }
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
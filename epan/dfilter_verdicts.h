@@ -0,0 +1,161 @@
+/** @file
+ * Per-frame display filter verdicts of recently applied filters
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#pragma once
+#include <ws_symbol_export.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * The verdicts of one display filter on the frames of a capture file, in
+ * frame number order. Filtering stopped early leaves the verdicts of the
+ * frames it did get to.
+ */
+typedef struct _dfilter_verdicts dfilter_verdicts;
+
+/**
+ * The verdicts of the last few display filters applied to a capture file.
+ *
+ * Refiltering with a filter whose verdicts are known doesn't need to
+ * dissect any frame, and narrowing a filter by adding a conjunct ("tcp" to
+ * "tcp && tcp.port == 443") only needs to dissect the frames that passed
+ * the broader filter.
+ *
+ * The verdicts are only valid as long as the frames would be dissected
+ * the same way: the cache must be cleared whenever the frames are
+ * redissected, or anything a filter might look at without redissection
+ * changes, such as a frame being ignored or its comments being edited.
+ */
+typedef struct _dfilter_verdict_cache dfilter_verdict_cache;
+
+/**
+ * @brief Create verdicts for a filter, none of them known yet.
+ *
+ * @param text The filter text after macro expansion, "" for no filter.
+ * @param frames The number of frames that may get a verdict.
+ * @return The new verdicts.
+ */
+WS_DLL_PUBLIC
+dfilter_verdicts *dfilter_verdicts_new(const char *text, uint32_t frames);
+
+/**
+ * @brief Free verdicts that haven't been stored in a cache.
+ *
+ * @param verdicts The verdicts.
+ */
+WS_DLL_PUBLIC
+void dfilter_verdicts_free(dfilter_verdicts *verdicts);
+
+/**
+ * @brief Record the verdict of the next frame.
+ *
+ * Frames must be recorded in order, starting with frame 1; frames past
+ * the number given to dfilter_verdicts_new() are ignored.
+ *
+ * @param verdicts The verdicts.
+ * @param framenum The number of the frame.
+ * @param passed true if the frame passed the filter.
+ */
+WS_DLL_PUBLIC
+void dfilter_verdicts_add(dfilter_verdicts *verdicts, uint32_t framenum, bool passed);
+
+/**
+ * @brief Get the number of frames whose verdict is known.
+ *
+ * @param verdicts The verdicts.
+ * @return The number of frames, from frame 1 on.
+ */
+WS_DLL_PUBLIC
+uint32_t dfilter_verdicts_count(const dfilter_verdicts *verdicts);
+
+/**
+ * @brief Find out whether a frame passes a filter without filtering it.
+ *
+ * @param verdicts Verdicts returned by dfilter_verdict_cache_find().
+ * @param exact The value dfilter_verdict_cache_find() returned in *exact.
+ * @param framenum The number of the frame.
+ * @param passed Set to true if the frame passes the filter being applied.
+ * @return true if that is known, false if the frame must be filtered.
+ */
+WS_DLL_PUBLIC
+bool dfilter_verdicts_lookup(const dfilter_verdicts *verdicts, bool exact,
+        uint32_t framenum, bool *passed);
+
+/**
+ * @brief Create an empty verdict cache.
+ *
+ * @return The new cache.
+ */
+WS_DLL_PUBLIC
+dfilter_verdict_cache *dfilter_verdict_cache_new(void);
+
+/**
+ * @brief Free a verdict cache and the verdicts in it.
+ *
+ * @param cache The cache, or NULL.
+ */
+WS_DLL_PUBLIC
+void dfilter_verdict_cache_free(dfilter_verdict_cache *cache);
+
+/**
+ * @brief Forget all the verdicts in a cache.
+ *
+ * @param cache The cache, or NULL.
+ */
+WS_DLL_PUBLIC
+void dfilter_verdict_cache_clear(dfilter_verdict_cache *cache);
+
+/**
+ * @brief Find verdicts that can be used to apply a filter.
+ *
+ * @param cache The cache, or NULL.
+ * @param text The filter text after macro expansion, "" for no filter.
+ * @param exact Set to true if the verdicts are for the filter itself, or
+ * to false if they are for a broader filter, i.e. only frames that passed
+ * it need to be filtered again.
+ * @return The verdicts, or NULL if there are none that can be used.
+ */
+WS_DLL_PUBLIC
+const dfilter_verdicts *dfilter_verdict_cache_find(dfilter_verdict_cache *cache,
+        const char *text, bool *exact);
+
+/**
+ * @brief Remember the verdicts of a filter.
+ *
+ * The cache takes ownership of the verdicts. They replace older verdicts
+ * for the same filter unless those are for more frames, and the least
+ * recently stored filter is forgotten if there are too many.
+ *
+ * @param cache The cache.
+ * @param verdicts The verdicts.
+ */
+WS_DLL_PUBLIC
+void dfilter_verdict_cache_store(dfilter_verdict_cache *cache, dfilter_verdicts *verdicts);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -912,7 +912,7 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 		}
 		if (do_frame_dissection) {
 			item = proto_tree_add_time(fh_tree, hf_frame_shift_offset, tvb,
-					    0, 0, &(pinfo->fd->shift_offset));
+					    0, 0, frame_data_shift_offset(pinfo->fd));
 			proto_item_set_generated(item);
 
 			if (proto_field_is_referenced(tree, hf_frame_time_delta)) {
@@ -1294,8 +1294,13 @@ dissect_frame(tvbuff_t *tvb, packet_info *pinfo, proto_tree *parent_tree, void*
 		/* Get ALL matching color filters (not just first).
 		 * Store matches in proto_data so the display code below can show
 		 * multiple matching rules in the frame tree. This enables multi-color
-		 * support in TShark when --color flag is used. */
-		color_filter = color_filters_colorize_packet_all(fr_data->color_edt, wmem_file_scope(), &matches);
+		 * support in TShark when --color flag is used.
+		 * If only the first one is shown, the rules are run as one program
+		 * that stops at it. */
+		if (prefs.gui_packet_list_multi_color_details)
+			color_filter = color_filters_colorize_packet_all(fr_data->color_edt, wmem_file_scope(), &matches);
+		else
+			color_filter = color_filters_colorize_packet(fr_data->color_edt);
 		pinfo->fd->color_filter = color_filter;
 		pinfo->fd->need_colorize = 0;
 
@@ -2831,12 +2831,121 @@ tcp_detect_duplicate_packet(tvbuff_t *tvb,
     }
 }
 
-/* fwd contains a list of all segments processed but not yet ACKed in the
+/* Returns the index of the first unacked segment that doesn't start before seq. */
+static uint32_t
+tcp_unacked_lower_bound(const tcp_analyze_seq_flow_info_t *info, uint32_t seq)
+{
+    uint32_t lo = 0, hi = info->segment_count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (LT_SEQ(info->segments[mid].seq, seq)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Returns the index of the first unacked segment that starts after seq. */
+static uint32_t
+tcp_unacked_upper_bound(const tcp_analyze_seq_flow_info_t *info, uint32_t seq)
+{
+    uint32_t lo = 0, hi = info->segment_count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (LE_SEQ(info->segments[mid].seq, seq)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Recomputes min_frame for the first count unacked segments. */
+static void
+tcp_unacked_update_min_frame(tcp_analyze_seq_flow_info_t *info, uint32_t count)
+{
+    uint32_t min_frame = count < info->segment_count ? info->segments[count].min_frame : UINT32_MAX;
+
+    while (count > 0) {
+        tcp_unacked_t *ual = &info->segments[--count];
+
+        min_frame = MIN(min_frame, ual->frame);
+        ual->min_frame = min_frame;
+    }
+}
+
+/* Adds an unacked segment, after any others that start at the same seq. */
+static tcp_unacked_t *
+tcp_unacked_insert(tcp_analyze_seq_flow_info_t *info, uint32_t frame, uint32_t seq, uint32_t nextseq)
+{
+    tcp_unacked_t *ual;
+    uint32_t pos;
+
+    if (info->segment_count == info->segment_alloc) {
+        info->segment_alloc = info->segment_alloc ? info->segment_alloc * 2 : 16;
+        info->segments = (tcp_unacked_t *)wmem_realloc(wmem_file_scope(), info->segments,
+                                                       info->segment_alloc * sizeof(tcp_unacked_t));
+    }
+
+    pos = tcp_unacked_upper_bound(info, seq);
+    memmove(&info->segments[pos + 1], &info->segments[pos],
+            (info->segment_count - pos) * sizeof(tcp_unacked_t));
+    info->segment_count++;
+
+    ual = &info->segments[pos];
+    ual->frame = frame;
+    ual->seq = seq;
+    ual->nextseq = nextseq;
+    ual->min_frame = frame;
+    if (pos + 1 < info->segment_count) {
+        ual->min_frame = MIN(frame, info->segments[pos + 1].min_frame);
+    }
+    /* Frames are normally added in increasing order, so this rarely loops. */
+    while (pos > 0 && info->segments[pos - 1].min_frame > frame) {
+        info->segments[--pos].min_frame = frame;
+    }
+
+    if (nextseq - seq > info->max_seglen) {
+        info->max_seglen = nextseq - seq;
+    }
+    return ual;
+}
+
+/* Returns the highest nextseq of the unacked segments, which must not be empty. */
+static uint32_t
+tcp_unacked_max_nextseq(const tcp_analyze_seq_flow_info_t *info)
+{
+    uint32_t i = info->segment_count;
+    uint32_t max_nextseq = info->segments[i - 1].nextseq;
+
+    /* No segment ends more than max_seglen bytes after its start. */
+    while (i > 0) {
+        const tcp_unacked_t *ual = &info->segments[--i];
+
+        if (LE_SEQ(ual->seq + info->max_seglen, max_nextseq)) {
+            break;
+        }
+        if (GT_SEQ(ual->nextseq, max_nextseq)) {
+            max_nextseq = ual->nextseq;
+        }
+    }
+    return max_nextseq;
+}
+
+/* fwd contains all segments processed but not yet ACKed in the
  *     same direction as the current segment.
- * rev contains a list of all segments received but not yet ACKed in the
+ * rev contains all segments received but not yet ACKed in the
  *     opposite direction to the current segment.
  *
- * New segments are always added to the head of the fwd/rev lists.
+ * Both are arrays ordered by sequence number, so that ACKs only have to
+ * look at the segments below the ACK value.
  *
  * Changes below should be synced with ChAdvTCPAnalysis in the User's
  * Guide: doc/wsug_src/WSUG_chapter_advanced.adoc
@@ -2845,17 +2954,17 @@ static void
 tcp_analyze_sequence_number(packet_info *pinfo, uint32_t seq, uint32_t ack, uint32_t seglen, uint16_t flags, uint32_t window, struct tcp_analysis *tcpd, struct tcp_per_packet_data_t *tcppd)
 {
     tcp_unacked_t *ual=NULL;
-    tcp_unacked_t *prevual=NULL;
     uint32_t nextseq;
+    uint32_t i;
 
 #if 0
     printf("\nanalyze_sequence numbers   frame:%u\n",pinfo->num);
     printf("FWD list lastflags:0x%04x base_seq:%u: nextseq:%u lastack:%u\n",tcpd->fwd->lastsegmentflags,tcpd->fwd->base_seq,tcpd->fwd->tcp_analyze_seq_info->nextseq,tcpd->rev->tcp_analyze_seq_info->lastack);
-    for(ual=tcpd->fwd->tcp_analyze_seq_info->segments; ual; ual=ual->next)
-            printf("Frame:%d Seq:%u Nextseq:%u\n",ual->frame,ual->seq,ual->nextseq);
+    for(i=0; i<tcpd->fwd->tcp_analyze_seq_info->segment_count; i++)
+            printf("Frame:%d Seq:%u Nextseq:%u\n",tcpd->fwd->tcp_analyze_seq_info->segments[i].frame,tcpd->fwd->tcp_analyze_seq_info->segments[i].seq,tcpd->fwd->tcp_analyze_seq_info->segments[i].nextseq);
     printf("REV list lastflags:0x%04x base_seq:%u nextseq:%u lastack:%u\n",tcpd->rev->lastsegmentflags,tcpd->rev->base_seq,tcpd->rev->tcp_analyze_seq_info->nextseq,tcpd->fwd->tcp_analyze_seq_info->lastack);
-    for(ual=tcpd->rev->tcp_analyze_seq_info->segments; ual; ual=ual->next)
-            printf("Frame:%d Seq:%u Nextseq:%u\n",ual->frame,ual->seq,ual->nextseq);
+    for(i=0; i<tcpd->rev->tcp_analyze_seq_info->segment_count; i++)
+            printf("Frame:%d Seq:%u Nextseq:%u\n",tcpd->rev->tcp_analyze_seq_info->segments[i].frame,tcpd->rev->tcp_analyze_seq_info->segments[i].seq,tcpd->rev->tcp_analyze_seq_info->segments[i].nextseq);
 #endif
 
     if (!tcpd) {
@@ -3097,29 +3206,22 @@ finished_fwd:
              * and take this opportunity to push the tail further than this single packet
              */
 
+            tcp_analyze_seq_flow_info_t *rev_info = tcpd->rev->tcp_analyze_seq_info;
             uint32_t tail_le = 0, tail_re = 0;
-            for(ual=tcpd->rev->tcp_analyze_seq_info->segments; ual; ual=ual->next) {
-
-                if(tail_le == tail_re) { /* init edge values */
-                    tail_le = ual->seq;
-                    tail_re = ual->nextseq;
-                }
-
-                /* Only look at what happens above the current ACK value,
-                 * as what happened before is definitely ACKed here and can be
-                 * safely ignored. */
-                if(GE_SEQ(ual->seq,ack)) {
 
-                    /* if the left edge is contiguous, move the tail leftward */
-                    if(EQ_SEQ(ual->nextseq,tail_le)) {
-                        tail_le = ual->seq;
-                    }
-
-                    /* otherwise, we have isolated segments above what is being ACKed here,
-                     * and we reinit the tails with the current values */
-                    else {
-                        tail_le = ual->seq;
-                        tail_re = ual->nextseq; // move the end tail
+            /* Only look at what happens above the current ACK value,
+             * as what happened before is definitely ACKed here and can be
+             * safely ignored. Find the lowest run of contiguous segments
+             * there. */
+            i = tcp_unacked_lower_bound(rev_info, ack);
+            if(i < rev_info->segment_count) {
+                tail_le = rev_info->segments[i].seq;
+                tail_re = rev_info->segments[i].nextseq;
+
+                /* while the next left edge is contiguous, move the tail rightward */
+                for(i++; i < rev_info->segment_count && LE_SEQ(rev_info->segments[i].seq, tail_re); i++) {
+                    if(GT_SEQ(rev_info->segments[i].nextseq, tail_re)) {
+                        tail_re = rev_info->segments[i].nextseq;
                     }
                 }
             }
@@ -3305,20 +3407,31 @@ finished_fwd:
                      * XXX: if compared packets have different sizes, it's not handled yet
                      */
                     bool pk_already_seen = false;
-                    ual = tcpd->fwd->tcp_analyze_seq_info->segments;
-                    while(ual) {
-                        if(GE_SEQ(seq,ual->seq) && LE_SEQ(seq+seglen,ual->nextseq)) {
-                            pk_already_seen = true;
-                            /* As we know this packet has retransmissions, we are marking it
-                             * as eligible to Karn's algo.
-                             */
-                            ual->karn_flag = true;
-                            if(!tcpd->ta) {
-                                tcp_analyze_get_acked_struct(pinfo->num, seq, ack, true, tcpd);
-                            }
+                    tcp_analyze_seq_flow_info_t *fwd_info = tcpd->fwd->tcp_analyze_seq_info;
+                    tcp_unacked_t *seen_ual = NULL;
+
+                    /* Look for the most recent segment covering this one. It can't
+                     * start more than max_seglen bytes before the end of this one.
+                     */
+                    i = tcp_unacked_upper_bound(fwd_info, seq);
+                    while(i > 0) {
+                        ual = &fwd_info->segments[--i];
+                        if(LT_SEQ(ual->seq + fwd_info->max_seglen, seq + seglen)) {
                             break;
                         }
-                        ual=ual->next;
+                        if(LE_SEQ(seq+seglen,ual->nextseq) && (!seen_ual || ual->frame > seen_ual->frame)) {
+                            seen_ual = ual;
+                        }
+                    }
+                    if(seen_ual) {
+                        pk_already_seen = true;
+                        /* As we know this packet has retransmissions, we are marking it
+                         * as eligible to Karn's algo.
+                         */
+                        seen_ual->karn_flag = true;
+                        if(!tcpd->ta) {
+                            tcp_analyze_get_acked_struct(pinfo->num, seq, ack, true, tcpd);
+                        }
                     }
 
                     if(t < ooo_thres && !pk_already_seen) {
@@ -3370,13 +3483,17 @@ finished_fwd:
          * See : issue #12259
          * See : issue #17714
          */
-        ual = tcpd->fwd->tcp_analyze_seq_info->segments;
-        while(ual) {
-            if(GE_SEQ(ual->seq, seq)) {
-                nstime_delta(&tcpd->ta->rto_ts, &pinfo->abs_ts, &ual->ts );
-                tcpd->ta->rto_frame=ual->frame;
+        i = tcp_unacked_lower_bound(tcpd->fwd->tcp_analyze_seq_info, seq);
+        if(i < tcpd->fwd->tcp_analyze_seq_info->segment_count) {
+            /* The eldest segment at or above seq is the one with the min_frame of the first one */
+            uint32_t min_frame = tcpd->fwd->tcp_analyze_seq_info->segments[i].min_frame;
+
+            ual = &tcpd->fwd->tcp_analyze_seq_info->segments[i];
+            while(ual->frame != min_frame) {
+                ual++;
             }
-            ual=ual->next;
+            nstime_delta(&tcpd->ta->rto_ts, &pinfo->abs_ts, &ual->ts );
+            tcpd->ta->rto_frame=ual->frame;
         }
     }
 
@@ -3434,19 +3551,15 @@ finished_checking_retransmission_type:
         /* Add this new sequence number to the fwd list.  But only if there
          * aren't "too many" unacked segments (e.g., we're not seeing the ACKs).
          */
-        ual = wmem_new(wmem_file_scope(), tcp_unacked_t);
-        ual->next=tcpd->fwd->tcp_analyze_seq_info->segments;
-        tcpd->fwd->tcp_analyze_seq_info->segments=ual;
-        tcpd->fwd->tcp_analyze_seq_info->segment_count++;
-        ual->frame=pinfo->num;
-        ual->seq=seq;
-        ual->ts=pinfo->abs_ts;
 
         /* next sequence number is seglen bytes away, plus SYN/FIN which counts as one byte */
         if( (flags&(TH_SYN|TH_FIN)) ) {
             nextseq+=1;
         }
 
+        ual = tcp_unacked_insert(tcpd->fwd->tcp_analyze_seq_info, pinfo->num, seq, nextseq);
+        ual->ts=pinfo->abs_ts;
+
         /* All Retransmissions are marked for later Karn discovery.
          * It's very unlikely that we will ever meet a TCP client
          * that just acknowledges a Fast Retransmission segment without
@@ -3462,8 +3575,6 @@ finished_checking_retransmission_type:
         else {
             ual->karn_flag=false;
         }
-
-        ual->nextseq=nextseq;
     }
 
     /* Every time we are moving the highest number seen,
@@ -3565,43 +3676,65 @@ finished_checking_retransmission_type:
 
     /* remove all segments this ACKs and we don't need to keep around any more
      */
-    prevual = NULL;
-    ual = tcpd->rev->tcp_analyze_seq_info->segments;
-    while(ual) {
-        tcp_unacked_t *tmpual;
+    {
+        tcp_analyze_seq_flow_info_t *rev_info = tcpd->rev->tcp_analyze_seq_info;
+        uint32_t end, kept = 0;
+        bool acked = false, acked_partial = false, acked_karn = false;
+        uint32_t acked_frame = 0;
+        nstime_t acked_ts = NSTIME_INIT_ZERO;
+
+        /* Only segments starting below the ACK can be (partially) acknowledged by it. */
+        end = tcp_unacked_lower_bound(rev_info, ack);
+        for(i = 0; i < end; i++) {
+            ual = &rev_info->segments[i];
+
+            /* If this ack matches the segment, or acknowledges part of it, report
+             * the eldest such segment.
+             */
+            if(GE_SEQ(ual->nextseq, ack)) {
+                if(!acked || ual->frame < acked_frame) {
+                    acked = true;
+                    acked_frame = ual->frame;
+                    acked_ts = ual->ts;
+                    acked_karn = ual->karn_flag;
+                    acked_partial = ack!=ual->nextseq;
+                }
+            }
 
-        /* If this ack matches the segment, process accordingly */
-        if(ack==ual->nextseq) {
-            tcp_analyze_get_acked_struct(pinfo->num, seq, ack, true, tcpd);
-            tcpd->ta->frame_acked=ual->frame;
-            nstime_delta(&tcpd->ta->ts, &pinfo->abs_ts, &ual->ts);
-            /* mark it as a full segment ACK */
-            tcpd->ta->partial_ack=0;
+            /* If this acknowledges part of the segment, adjust the segment info for the acked part.
+             * This typically happens in the context of GSO/GRO or Retransmissions with
+             * segment repackaging (elsewhere called repacketization). For the user, looking at the
+             * previous packets for any Retransmission or at the SYN MSS Option presence would
+             * answer what case is precisely encountered.
+             */
+            if(GT_SEQ(ual->nextseq, ack)) {
+                ual->seq = ack;
+                rev_info->segments[kept++] = *ual;
+                continue;
+            }
 
-            if (tcppd) {
-                if (ual->karn_flag) {
-                    tcpd->ta->iskarn=true;
-                    tcppd->karn_flag=true;
-                }
-                else {
-                    tcpd->ta->iskarn=false;
-                    tcppd->karn_flag=false;
-                }
+            /* This segment is old, or an exact match.  Delete the segment from the list */
+            if (tcpd->rev->scps_capable) {
+              /* Track largest segment successfully sent for SNACK analysis*/
+              if ((ual->nextseq - ual->seq) > tcpd->fwd->maxsizeacked) {
+                tcpd->fwd->maxsizeacked = (ual->nextseq - ual->seq);
+              }
             }
         }
-        /* If this acknowledges part of the segment, adjust the segment info for the acked part.
-         * This typically happens in the context of GSO/GRO or Retransmissions with
-         * segment repackaging (elsewhere called repacketization). For the user, looking at the
-         * previous packets for any Retransmission or at the SYN MSS Option presence would
-         * answer what case is precisely encountered.
-         */
-        else if (GT_SEQ(ack, ual->seq) && LE_SEQ(ack, ual->nextseq)) {
-            ual->seq = ack;
+
+        if(kept < end) {
+            memmove(&rev_info->segments[kept], &rev_info->segments[end],
+                    (rev_info->segment_count - end) * sizeof(tcp_unacked_t));
+            rev_info->segment_count -= end - kept;
+        }
+        tcp_unacked_update_min_frame(rev_info, kept);
+
+        if(acked) {
             tcp_analyze_get_acked_struct(pinfo->num, seq, ack, true, tcpd);
-            tcpd->ta->frame_acked=ual->frame;
-            nstime_delta(&tcpd->ta->ts, &pinfo->abs_ts, &ual->ts);
+            tcpd->ta->frame_acked=acked_frame;
+            nstime_delta(&tcpd->ta->ts, &pinfo->abs_ts, &acked_ts);
 
-            /* mark it as a partial segment ACK
+            /* mark it as a full or partial segment ACK
              *
              * XXX - This mark is used later to create an Expert Note,
              * but other ways of tracking these packets are possible:
@@ -3611,49 +3744,15 @@ finished_checking_retransmission_type:
              * essential yet, as matching packets can be selected with
              * 'tcp.analysis.partial_ack'.
              */
-            tcpd->ta->partial_ack=1;
+            tcpd->ta->partial_ack=acked_partial;
 
             /* identify ambiguous ACKs following Karn's definition
              */
             if (tcppd) {
-                if (ual->karn_flag) {
-                    tcpd->ta->iskarn=true;
-                    tcppd->karn_flag=true;
-                }
-                else {
-                    tcpd->ta->iskarn=false;
-                    tcppd->karn_flag=false;
-                }
+                tcpd->ta->iskarn=acked_karn;
+                tcppd->karn_flag=acked_karn;
             }
-
-            continue;
-        }
-        /* If this acknowledges a segment prior to this one, leave this segment alone and move on */
-        else if (GT_SEQ(ual->nextseq,ack)) {
-            prevual = ual;
-            ual = ual->next;
-            continue;
-        }
-
-        /* This segment is old, or an exact match.  Delete the segment from the list */
-        tmpual=ual->next;
-
-        if (tcpd->rev->scps_capable) {
-          /* Track largest segment successfully sent for SNACK analysis*/
-          if ((ual->nextseq - ual->seq) > tcpd->fwd->maxsizeacked) {
-            tcpd->fwd->maxsizeacked = (ual->nextseq - ual->seq);
-          }
         }
-
-        if (!prevual) {
-            tcpd->rev->tcp_analyze_seq_info->segments = tmpual;
-        }
-        else{
-            prevual->next = tmpual;
-        }
-        wmem_free(wmem_file_scope(), ual);
-        ual = tmpual;
-        tcpd->rev->tcp_analyze_seq_info->segment_count--;
     }
 
     /* how many bytes of data are there in flight after this frame
@@ -3676,24 +3775,15 @@ finished_checking_retransmission_type:
          * by now still the default.
          */
         if(!tcp_bif_seq_based) {
-            ual=tcpd->fwd->tcp_analyze_seq_info->segments;
+            tcp_analyze_seq_flow_info_t *fwd_info = tcpd->fwd->tcp_analyze_seq_info;
 
-            if (seglen!=0 && ual && tcpd->fwd->tcp_analyze_seq_info->valid_bif) {
+            if (seglen!=0 && fwd_info->segment_count > 0 && fwd_info->valid_bif) {
                 uint32_t first_seq, last_seq;
 
                 dry_bif_handling = true;
 
-                first_seq = ual->seq - tcpd->fwd->base_seq;
-                last_seq = ual->nextseq - tcpd->fwd->base_seq;
-                while (ual) {
-                    if ((ual->nextseq-tcpd->fwd->base_seq)>last_seq) {
-                        last_seq = ual->nextseq-tcpd->fwd->base_seq;
-                    }
-                    if ((ual->seq-tcpd->fwd->base_seq)<first_seq) {
-                        first_seq = ual->seq-tcpd->fwd->base_seq;
-                    }
-                    ual = ual->next;
-                }
+                first_seq = fwd_info->segments[0].seq - tcpd->fwd->base_seq;
+                last_seq = tcp_unacked_max_nextseq(fwd_info) - tcpd->fwd->base_seq;
                 in_flight = last_seq-first_seq;
             }
         } else { /* calculation based on SEQ numbers (see issue 7703) */
@@ -160,8 +160,8 @@ extern struct tcp_multisegment_pdu *
 pdu_store_sequencenumber_of_next_pdu(packet_info *pinfo, uint32_t seq, uint32_t nxtpdu, wmem_tree_t *multisegment_pdus);
 
 typedef struct _tcp_unacked_t {
-	struct _tcp_unacked_t *next;
 	uint32_t frame;
+	uint32_t min_frame; /* lowest frame of this segment and the ones after it */
 	uint32_t seq;
 	uint32_t nextseq;
 	bool     karn_flag; /* indication for the later Karn discovery */
@@ -313,8 +313,10 @@ typedef enum {
  * is enabled, so save the memory when it isn't
  */
 typedef struct tcp_analyze_seq_flow_info_t {
-	tcp_unacked_t *segments;/* List of segments for which we haven't seen an ACK */
-	uint16_t segment_count;	/* How many unacked segments we're currently storing */
+	tcp_unacked_t *segments;/* Segments for which we haven't seen an ACK, ordered by seq */
+	uint32_t segment_count;	/* How many unacked segments we're currently storing */
+	uint32_t segment_alloc;	/* How many segments there is room for */
+	uint32_t max_seglen;	/* No segment is longer than this */
 	uint8_t lastacklen;     /* length of the last fwd ACK packet - 0 means pure ACK */
 
 	bool valid_bif;     /* if lost pkts, disable BiF until ACK is recvd */
@@ -365,7 +367,7 @@ typedef struct tcp_process_info_t {
 
 typedef struct _tcp_flow_t {
 	uint32_t base_seq;	/* base seq number (used by relative sequence numbers)*/
-#define TCP_MAX_UNACKED_SEGMENTS 10000 /* The most unacked segments we'll store */
+#define TCP_MAX_UNACKED_SEGMENTS 100000 /* The most unacked segments we'll store */
 	uint32_t fin;		/* frame number of the final FIN */
 	uint32_t window;		/* last seen window */
 	int16_t	win_scale;	/* -1 is we don't know, -2 is window scaling is not used */
@@ -307,7 +307,6 @@ frame_data_init(frame_data *fdata, uint32_t num, const wtap_rec *rec,
   fdata->file_off = offset;
   fdata->passed_dfilter = 1;
   fdata->dependent_of_displayed = 0;
-  fdata->dependent_frames = NULL;
   fdata->encoding = PACKET_CHAR_ENC_CHAR_ASCII;
   fdata->visited = 0;
   fdata->marked = 0;
@@ -369,12 +368,35 @@ frame_data_init(frame_data *fdata, uint32_t num, const wtap_rec *rec,
   fdata->has_modified_block = 0;
   fdata->need_colorize = 0;
   fdata->color_filter = NULL;
-  fdata->shift_offset.secs = 0;
-  fdata->shift_offset.nsecs = 0;
+  fdata->cold = NULL;
   fdata->frame_ref_num = 0;
   fdata->prev_dis_num = 0;
-  fdata->aggregation_key = NULL;
-  fdata->aggregated = false;
+  fdata->aggregated = 0;
+}
+
+frame_data_cold *
+frame_data_get_cold(frame_data *fdata)
+{
+  if (fdata->cold == NULL)
+    fdata->cold = g_new0(frame_data_cold, 1);
+  return fdata->cold;
+}
+
+const nstime_t *
+frame_data_shift_offset(const frame_data *fdata)
+{
+  static const nstime_t no_shift = NSTIME_INIT_ZERO;
+
+  return fdata->cold ? &fdata->cold->shift_offset : &no_shift;
+}
+
+void
+frame_data_set_aggregation_key(frame_data *fdata, char *key)
+{
+  frame_data_cold *cold = frame_data_get_cold(fdata);
+
+  g_free(cold->aggregation_key);
+  cold->aggregation_key = key;
 }
 
 void
@@ -458,21 +480,27 @@ frame_data_destroy(frame_data *fdata)
     fdata->pfd = NULL;
   }
 
-  if (fdata->dependent_frames) {
-    g_hash_table_destroy(fdata->dependent_frames);
-    fdata->dependent_frames = NULL;
+  if (fdata->cold && fdata->cold->dependent_frames) {
+    g_hash_table_destroy(fdata->cold->dependent_frames);
+    fdata->cold->dependent_frames = NULL;
   }
 
   frame_data_aggregation_free(fdata);
+
+  /* A time shift outlives redissection; anything else is gone now. */
+  if (fdata->cold && nstime_is_zero(&fdata->cold->shift_offset)) {
+    g_free(fdata->cold);
+    fdata->cold = NULL;
+  }
 }
 
 void frame_data_aggregation_free(frame_data* fdata)
 {
-  if (fdata->aggregation_key) {
-    g_free(fdata->aggregation_key);
-    fdata->aggregation_key = NULL;
+  if (fdata->cold && fdata->cold->aggregation_key) {
+    g_free(fdata->cold->aggregation_key);
+    fdata->cold->aggregation_key = NULL;
   }
-  fdata->aggregated = false;
+  fdata->aggregated = 0;
 }
 
 /*
@@ -53,10 +53,20 @@ typedef enum {
    Try to keep it close to, and less than or equal to, a power of 2.
    "Smaller than a power of 2" is OK for ILP32 platforms.
 
-   XXX - shuffle the fields to try to keep the most commonly-accessed
-   fields within the first 16 or 32 bytes, so they all fit in a cache
-   line? */
+   The fields needed to read, sort and show every frame come first, so
+   they share a cache line. Members that only a few frames ever set are
+   kept in a frame_data_cold structure that is allocated the first time
+   one of them is set; use the accessors below for those. */
 struct _color_filter; /* Forward */
+struct _proto_data_table; /* Forward */
+
+/** @brief Members of a frame_data that most frames never set. */
+typedef struct _frame_data_cold {
+  GHashTable  *dependent_frames;     /**< A hash table of frames which this one depends on */
+  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
+  char        *aggregation_key; /**< Holds the aggregation_key values used for rendering the aggregation view. */
+} frame_data_cold;
+
 DIAG_OFF_PEDANTIC
 
 /** @brief Frame data structure */
@@ -66,12 +76,7 @@ typedef struct _frame_data {
   uint32_t     pkt_len;      /**< Packet length */
   uint32_t     cap_len;      /**< Amount actually captured */
   int64_t      file_off;     /**< File offset */
-  /* These two are pointers, meaning 64-bit on LP64 (64-bit UN*X) and
-     LLP64 (64-bit Windows) platforms.  Put them here, one after the
-     other, so they don't require padding between them. */
-  wmem_list_t *pfd;          /**< Per frame proto data */
-  GHashTable  *dependent_frames;     /**< A hash table of frames which this one depends on */
-  const struct _color_filter *color_filter;  /**< Per-packet matching color_filter_t object */
+  nstime_t     abs_ts;       /**< Absolute timestamp */
   uint32_t     cum_bytes;    /**< Cumulative bytes into the capture */
   /* XXX - cum_bytes presumably ought to be 64-bit as well now */
   uint8_t      tcp_snd_manual_analysis;   /**< TCP SEQ Analysis Overriding, 0 = none, 1 = OOO, 2 = RET , 3 = Fast RET, 4 = Spurious RET  */
@@ -89,19 +94,72 @@ typedef struct _frame_data {
   unsigned int has_modified_block : 1; /** 1 = block for this packet has been modified */
   unsigned int need_colorize    : 1; /**< 1 = need to (re-)calculate packet color */
   unsigned int tsprec           : 4; /**< Time stamp precision -2^tsprec gives up to femtoseconds */
-  nstime_t     abs_ts;       /**< Absolute timestamp */
-  nstime_t     shift_offset; /**< How much the abs_tm of the frame is shifted */
+  unsigned int aggregated       : 1; /**< 1 = not displayed individually because it is represented
+                                          by another frame sharing the same aggregation_key */
   uint32_t     frame_ref_num; /**< Reference frame for relative timestamps (can be this frame) */
   /* frame_ref_num == num if ref_time == true, but also if this is the first
    * record that has_ts (or if somehow a record without a TS is a reference
    * time frame, the first frame after that with has_ts == true.) */
   uint32_t     prev_dis_num; /**< Previous displayed frame (0 if first one) */
-  gchar*       aggregation_key; /**< Holds the aggregation_key values used for rendering the aggregation view. */
-  bool         aggregated; /**<  * True if this frame is not displayed individually because it is represented
-   * by another frame sharing the same aggregation_key. */
+  /* These are pointers, meaning 64-bit on LP64 (64-bit UN*X) and
+     LLP64 (64-bit Windows) platforms.  Put them here, one after the
+     other, so they don't require padding between them. */
+  struct _proto_data_table *pfd; /**< Per frame proto data */
+  const struct _color_filter *color_filter;  /**< Per-packet matching color_filter_t object */
+  frame_data_cold *cold;     /**< Rarely set members, or NULL if none are set */
 } frame_data;
 DIAG_ON_PEDANTIC
 
+/**
+ * @brief Get the cold members of a frame_data struct, allocating them if
+ * this is the first time one is set.
+ *
+ * @param fdata The frame_data.
+ * @return The cold members.
+ */
+WS_DLL_PUBLIC frame_data_cold *frame_data_get_cold(frame_data *fdata);
+
+/**
+ * @brief Get the frames a frame depends on.
+ *
+ * @param fdata The frame_data.
+ * @return A hash table of frame numbers, or NULL if it depends on none.
+ */
+static inline GHashTable *
+frame_data_dependent_frames(const frame_data *fdata)
+{
+  return fdata->cold ? fdata->cold->dependent_frames : NULL;
+}
+
+/**
+ * @brief Get how much the time stamp of a frame has been shifted.
+ *
+ * @param fdata The frame_data.
+ * @return The shift; zero if the frame hasn't been shifted.
+ */
+WS_DLL_PUBLIC const nstime_t *frame_data_shift_offset(const frame_data *fdata);
+
+/**
+ * @brief Get the aggregation key of a frame.
+ *
+ * @param fdata The frame_data.
+ * @return The key, or NULL if the frame has none.
+ */
+static inline const char *
+frame_data_aggregation_key(const frame_data *fdata)
+{
+  return fdata->cold ? fdata->cold->aggregation_key : NULL;
+}
+
+/**
+ * @brief Set the aggregation key of a frame.
+ *
+ * @param fdata The frame_data.
+ * @param key The key, allocated with g_malloc(); the frame takes ownership
+ * of it. Any previous key is freed.
+ */
+WS_DLL_PUBLIC void frame_data_set_aggregation_key(frame_data *fdata, char *key);
+
 /** @brief Compare two frame_data structs by a given field.
  *  @param epan   The epan session context.
  *  @param fdata1 The first frame_data to compare.
@@ -0,0 +1,629 @@
+/* frame_data_index.c
+ * Sidecar index of the frames of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_EPAN
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+#include <wsutil/wslog.h>
+
+#include "epan_dissect.h"
+#include "frame_data_index.h"
+#include "packet.h"
+
+/*
+ * The nanoseconds of the modification time of a file, if the stat
+ * structure has them, or 0 if not.
+ */
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+  #define ST_MTIME_NSEC(statb) ((statb).st_mtim.tv_nsec)
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+  #define ST_MTIME_NSEC(statb) ((statb).st_mtimespec.tv_nsec)
+#else
+  #define ST_MTIME_NSEC(statb) (0)
+#endif
+
+/*
+ * An index file is a header, a summary of the records, the link-layer
+ * types of the packets, and one fixed-size entry per frame. All values
+ * are little-endian.
+ *
+ * Header:
+ *
+ *   0  magic
+ *   8  version
+ *  12  size of an entry
+ *  16  size of the capture file
+ *  24  modification time of the capture file, in seconds
+ *  32  number of frames
+ *  36  wiretap file type/subtype of the capture file
+ *  40  number of section header blocks
+ *  44  number of interface description blocks
+ *  48  number of name resolution blocks
+ *  52  number of decryption secrets blocks
+ *  56  modification time of the capture file, nanoseconds
+ *
+ * Summary:
+ *
+ *  64  flags
+ *  68  number of dropped packets
+ *  72  number of packet comments
+ *  80  number of link-layer types
+ *
+ * Entry:
+ *
+ *   0  offset of the record in the capture file
+ *   8  time stamp, seconds
+ *  16  time stamp, nanoseconds
+ *  20  packet length
+ *  24  captured length
+ *  28  flags
+ *  29  time stamp precision
+ */
+static const uint8_t index_magic[8] = { 'W', 'S', 'I', 'D', 'X', '\r', '\n', 0x1a };
+
+#define INDEX_VERSION       2
+#define INDEX_HEADER_SIZE   64
+#define INDEX_SUMMARY_SIZE  32
+#define INDEX_ENTRY_SIZE    32
+
+#define SUMMARY_FLAG_PRESENT      0x01
+#define SUMMARY_FLAG_DROPS_KNOWN  0x02
+
+#define ENTRY_FLAG_HAS_TS   0x01
+
+/* Number of records frame_data_index_verify() reads, at most. */
+#define VERIFY_SAMPLES      64
+
+struct _frame_data_index {
+  GMappedFile   *mapped;
+  const uint8_t *summary;
+  const uint8_t *linktypes;
+  uint32_t       num_linktypes;
+  const uint8_t *entries;
+  uint32_t       count;
+  uint32_t       next;          /* Index of the next entry to read */
+  char          *index_path;
+  bool           stale;         /* The index turned out not to match the file */
+  uint32_t       skip;          /* Records to skip when falling back to wtap_read() */
+  GArray        *scanned;       /* wtap_scan_entry of the records, for a scanned index */
+  GArray        *scanned_linktypes; /* Link-layer types of the scanned records */
+  int64_t        resume_offset; /* Where sequential reading continues after them */
+  bool           resumed;
+};
+
+static char *
+index_path_for(const char *path)
+{
+  return g_strconcat(path, FRAME_DATA_INDEX_SUFFIX, NULL);
+}
+
+/* Fill in the parts of the header that describe the capture file. */
+static bool
+fill_header(uint8_t *hdr, wtap *wth, const char *path, uint32_t count)
+{
+  ws_statb64 st;
+
+  if (ws_stat64(path, &st) != 0)
+    return false;
+
+  memset(hdr, 0, INDEX_HEADER_SIZE);
+  memcpy(hdr, index_magic, sizeof index_magic);
+  phtoleu32(hdr + 8, INDEX_VERSION);
+  phtoleu32(hdr + 12, INDEX_ENTRY_SIZE);
+  phtoleu64(hdr + 16, (uint64_t)st.st_size);
+  phtoleu64(hdr + 24, (uint64_t)st.st_mtime);
+  phtoleu32(hdr + 32, count);
+  phtoleu32(hdr + 36, (uint32_t)wtap_file_type_subtype(wth));
+  phtoleu32(hdr + 40, wtap_file_get_num_shbs(wth));
+  phtoleu32(hdr + 44, wtap_file_get_num_idbs(wth));
+  phtoleu32(hdr + 48, wtap_file_get_num_nrbs(wth));
+  phtoleu32(hdr + 52, wtap_file_get_num_dsbs(wth));
+  phtoleu32(hdr + 56, (uint32_t)ST_MTIME_NSEC(st));
+  return true;
+}
+
+static void
+fill_summary(uint8_t *summary, const frame_data_index_summary *s)
+{
+  uint32_t flags = 0;
+
+  memset(summary, 0, INDEX_SUMMARY_SIZE);
+  if (s == NULL)
+    return;
+  flags = SUMMARY_FLAG_PRESENT;
+  if (s->drops_known)
+    flags |= SUMMARY_FLAG_DROPS_KNOWN;
+  phtoleu32(summary + 0, flags);
+  phtoleu32(summary + 4, s->drops);
+  phtoleu64(summary + 8, s->packet_comment_count);
+  phtoleu32(summary + 16, s->linktypes != NULL ? s->linktypes->len : 0);
+}
+
+static void
+fill_entry(uint8_t *entry, const frame_data *fdata)
+{
+  memset(entry, 0, INDEX_ENTRY_SIZE);
+  phtoleu64(entry + 0, (uint64_t)fdata->file_off);
+  phtoleu64(entry + 8, (uint64_t)fdata->abs_ts.secs);
+  phtoleu32(entry + 16, (uint32_t)fdata->abs_ts.nsecs);
+  phtoleu32(entry + 20, fdata->pkt_len);
+  phtoleu32(entry + 24, fdata->cap_len);
+  entry[28] = fdata->has_ts ? ENTRY_FLAG_HAS_TS : 0;
+  entry[29] = (uint8_t)fdata->tsprec;
+}
+
+/* Does a record read from the capture file match its entry? */
+static bool
+entry_matches(const uint8_t *entry, uint32_t num, const wtap_rec *rec,
+    int64_t offset)
+{
+  frame_data fdlocal;
+
+  frame_data_init(&fdlocal, num, rec, offset, 0);
+  return fdlocal.pkt_len == pletohu32(entry + 20) &&
+         fdlocal.cap_len == pletohu32(entry + 24) &&
+         fdlocal.has_ts == ((entry[28] & ENTRY_FLAG_HAS_TS) ? 1 : 0) &&
+         (!fdlocal.has_ts ||
+          (fdlocal.abs_ts.secs == (time_t)pletohu64(entry + 8) &&
+           fdlocal.abs_ts.nsecs == (int)pletohu32(entry + 16)));
+}
+
+/*
+ * The index doesn't describe the capture file after all; remove it, and
+ * read the rest of the file sequentially, skipping the records that were
+ * read through it.
+ */
+static void
+discard_index(frame_data_index *idx)
+{
+  ws_debug("frame index %s doesn't match the capture file; reading the file sequentially",
+           idx->index_path);
+  ws_unlink(idx->index_path);
+  idx->stale = true;
+  idx->skip = idx->next;
+}
+
+bool
+frame_data_index_write(wtap *wth, const char *path, frame_data_sequence *fds,
+    uint32_t count, const frame_data_index_summary *summary)
+{
+  uint8_t hdr[INDEX_HEADER_SIZE];
+  uint8_t summary_buf[INDEX_SUMMARY_SIZE];
+  uint8_t entry[INDEX_ENTRY_SIZE];
+  char *index_path, *tmp_path;
+  FILE *fp;
+  bool ok;
+
+  if (wtap_get_compression_type(wth) != WS_FILE_UNCOMPRESSED)
+    return false;
+  if (!fill_header(hdr, wth, path, count))
+    return false;
+  fill_summary(summary_buf, summary);
+
+  /* Write to a temporary file, so that a reader never sees a partial index. */
+  index_path = index_path_for(path);
+  tmp_path = g_strconcat(index_path, ".tmp", NULL);
+  fp = ws_fopen(tmp_path, "wb");
+  if (fp == NULL) {
+    g_free(tmp_path);
+    g_free(index_path);
+    return false;
+  }
+
+  ok = fwrite(hdr, INDEX_HEADER_SIZE, 1, fp) == 1 &&
+       fwrite(summary_buf, INDEX_SUMMARY_SIZE, 1, fp) == 1;
+  if (summary != NULL && summary->linktypes != NULL) {
+    for (unsigned i = 0; ok && i < summary->linktypes->len; i++) {
+      uint8_t linktype[4];
+
+      phtoleu32(linktype, (uint32_t)g_array_index(summary->linktypes, int, i));
+      ok = fwrite(linktype, sizeof linktype, 1, fp) == 1;
+    }
+  }
+  for (uint32_t framenum = 1; ok && framenum <= count; framenum++) {
+    fill_entry(entry, frame_data_sequence_find(fds, framenum));
+    ok = fwrite(entry, INDEX_ENTRY_SIZE, 1, fp) == 1;
+  }
+  if (fclose(fp) != 0)
+    ok = false;
+
+  if (ok) {
+    ws_unlink(index_path);
+    ok = ws_rename(tmp_path, index_path) == 0;
+  }
+  if (!ok)
+    ws_unlink(tmp_path);
+  g_free(tmp_path);
+  g_free(index_path);
+  return ok;
+}
+
+frame_data_index *
+frame_data_index_open(wtap *wth, const char *path)
+{
+  uint8_t expected[INDEX_HEADER_SIZE];
+  frame_data_index *idx;
+  GMappedFile *mapped;
+  const uint8_t *hdr, *summary;
+  char *index_path;
+  size_t length;
+  uint32_t count, num_linktypes;
+
+  if (wtap_get_compression_type(wth) != WS_FILE_UNCOMPRESSED)
+    return NULL;
+
+  index_path = index_path_for(path);
+  mapped = g_mapped_file_new(index_path, false, NULL);
+  if (mapped == NULL) {
+    g_free(index_path);
+    return NULL;
+  }
+
+  hdr = (const uint8_t *)g_mapped_file_get_contents(mapped);
+  length = g_mapped_file_get_length(mapped);
+  if (hdr == NULL || length < INDEX_HEADER_SIZE + INDEX_SUMMARY_SIZE)
+    goto unusable;
+
+  /*
+   * Everything but the frame count has to match what we'd write for the
+   * file as it is now.
+   */
+  count = pletohu32(hdr + 32);
+  if (!fill_header(expected, wth, path, count) ||
+      memcmp(hdr, expected, INDEX_HEADER_SIZE) != 0)
+    goto unusable;
+  summary = hdr + INDEX_HEADER_SIZE;
+  num_linktypes = pletohu32(summary + 16);
+  length -= INDEX_HEADER_SIZE + INDEX_SUMMARY_SIZE;
+  if (num_linktypes > length / 4)
+    goto unusable;
+  length -= (size_t)num_linktypes * 4;
+  if (length / INDEX_ENTRY_SIZE != count || length % INDEX_ENTRY_SIZE != 0)
+    goto unusable;
+
+  idx = g_new0(frame_data_index, 1);
+  idx->mapped = mapped;
+  idx->summary = summary;
+  idx->linktypes = summary + INDEX_SUMMARY_SIZE;
+  idx->num_linktypes = num_linktypes;
+  idx->entries = idx->linktypes + (size_t)num_linktypes * 4;
+  idx->count = count;
+  idx->index_path = index_path;
+  return idx;
+
+unusable:
+  g_mapped_file_unref(mapped);
+  g_free(index_path);
+  return NULL;
+}
+
+frame_data_index *
+frame_data_index_scan(wtap *wth, unsigned num_threads)
+{
+  frame_data_index *idx;
+  GArray *scanned;
+  int64_t resume_offset;
+
+  if (!wtap_scan_records(wth, num_threads, 0, &scanned, &resume_offset))
+    return NULL;
+  if (scanned->len > UINT32_MAX) {
+    g_array_free(scanned, true);
+    return NULL;
+  }
+
+  idx = g_new0(frame_data_index, 1);
+  idx->scanned = scanned;
+  idx->count = scanned->len;
+  idx->resume_offset = resume_offset;
+
+  /* There are few of them, so a linear search will do. */
+  idx->scanned_linktypes = g_array_new(false, false, sizeof(int));
+  for (unsigned i = 0; i < scanned->len; i++) {
+    int linktype = g_array_index(scanned, wtap_scan_entry, i).pkt_encap;
+    unsigned j;
+
+    for (j = 0; j < idx->scanned_linktypes->len; j++) {
+      if (g_array_index(idx->scanned_linktypes, int, j) == linktype)
+        break;
+    }
+    if (j == idx->scanned_linktypes->len)
+      g_array_append_val(idx->scanned_linktypes, linktype);
+  }
+  return idx;
+}
+
+uint32_t
+frame_data_index_count(const frame_data_index *idx)
+{
+  return idx->count;
+}
+
+bool
+frame_data_index_is_current(const frame_data_index *idx)
+{
+  return idx->entries != NULL && !idx->stale;
+}
+
+bool
+frame_data_index_get_summary(const frame_data_index *idx,
+    frame_data_index_summary *summary)
+{
+  uint32_t flags;
+
+  /*
+   * The scan only finds packets without options, so they have no
+   * comments or drop counts.
+   */
+  if (idx->scanned != NULL) {
+    summary->drops_known = false;
+    summary->drops = 0;
+    summary->packet_comment_count = 0;
+    if (summary->linktypes != NULL)
+      g_array_append_vals(summary->linktypes, idx->scanned_linktypes->data,
+                          idx->scanned_linktypes->len);
+    return true;
+  }
+
+  if (idx->summary == NULL)
+    return false;
+  flags = pletohu32(idx->summary + 0);
+  if (!(flags & SUMMARY_FLAG_PRESENT))
+    return false;
+  summary->drops_known = (flags & SUMMARY_FLAG_DROPS_KNOWN) != 0;
+  summary->drops = pletohu32(idx->summary + 4);
+  summary->packet_comment_count = pletohu64(idx->summary + 8);
+  if (summary->linktypes != NULL) {
+    for (uint32_t i = 0; i < idx->num_linktypes; i++) {
+      int linktype = (int)pletohu32(idx->linktypes + (size_t)i * 4);
+
+      g_array_append_val(summary->linktypes, linktype);
+    }
+  }
+  return true;
+}
+
+bool
+frame_data_index_verify(frame_data_index *idx, wtap *wth)
+{
+  const uint8_t *entry;
+  wtap_rec rec;
+  int64_t offset, prev_offset = -1;
+  int err;
+  char *err_info;
+  uint32_t step, i;
+  bool ok = true;
+
+  if (idx->entries == NULL || idx->stale)
+    return false;
+
+  /*
+   * Every entry has to be one that could have been written for this
+   * file; that's cheap to check, as the index is in memory.
+   */
+  for (i = 0; i < idx->count; i++) {
+    entry = idx->entries + (size_t)i * INDEX_ENTRY_SIZE;
+    offset = (int64_t)pletohu64(entry + 0);
+    if (offset <= prev_offset || entry[29] > 0xF) {
+      discard_index(idx);
+      return false;
+    }
+    prev_offset = offset;
+  }
+
+  /*
+   * Reading every record is what the index saves us, so read a sample of
+   * them, including the first and the last, and make sure they're the
+   * ones that were indexed; the file might have been rewritten without
+   * changing its size or time stamp.
+   */
+  wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
+  step = idx->count / VERIFY_SAMPLES + 1;
+  for (i = 0; ok && i < idx->count; i += step) {
+    if (i + step >= idx->count)
+      i = idx->count - 1;
+    entry = idx->entries + (size_t)i * INDEX_ENTRY_SIZE;
+    offset = (int64_t)pletohu64(entry + 0);
+    err_info = NULL;
+    ok = wtap_seek_read(wth, offset, &rec, &err, &err_info) &&
+         entry_matches(entry, i + 1, &rec, offset);
+    if (!ok)
+      g_free(err_info);
+    wtap_rec_reset(&rec);
+  }
+  wtap_rec_cleanup(&rec);
+
+  if (!ok)
+    discard_index(idx);
+  return ok;
+}
+
+bool
+frame_data_index_next_frame(frame_data_index *idx, frame_data *fdata,
+    uint32_t cum_bytes)
+{
+  const uint8_t *entry;
+  const wtap_scan_entry *scanned;
+  wtap_rec rec;
+  int64_t offset;
+
+  if (idx->scanned == NULL && (idx->entries == NULL || idx->stale))
+    return false;
+  if (idx->next >= idx->count)
+    return false;
+
+  /*
+   * frame_data_init() takes what it needs from a record; make one up
+   * from the entry.
+   */
+  memset(&rec, 0, sizeof rec);
+  rec.rec_type = REC_TYPE_PACKET;
+  if (idx->scanned != NULL) {
+    scanned = &g_array_index(idx->scanned, wtap_scan_entry, idx->next);
+    rec.presence_flags = scanned->presence_flags;
+    rec.ts = scanned->ts;
+    rec.tsprec = scanned->tsprec;
+    rec.rec_header.packet_header.len = scanned->len;
+    rec.rec_header.packet_header.caplen = scanned->caplen;
+    offset = scanned->offset;
+  } else {
+    entry = idx->entries + (size_t)idx->next * INDEX_ENTRY_SIZE;
+    rec.presence_flags = (entry[28] & ENTRY_FLAG_HAS_TS) ? WTAP_HAS_TS : 0;
+    rec.ts.secs = (time_t)pletohu64(entry + 8);
+    rec.ts.nsecs = (int)pletohu32(entry + 16);
+    rec.tsprec = entry[29];
+    rec.rec_header.packet_header.len = pletohu32(entry + 20);
+    rec.rec_header.packet_header.caplen = pletohu32(entry + 24);
+    offset = (int64_t)pletohu64(entry + 0);
+  }
+  frame_data_init(fdata, idx->next + 1, &rec, offset, cum_bytes);
+  idx->next++;
+  return true;
+}
+
+bool
+frame_data_index_read(frame_data_index *idx, wtap *wth, wtap_rec *rec,
+    int *err, char **err_info, int64_t *data_offset)
+{
+  const uint8_t *entry;
+
+  *err = 0;
+  *err_info = NULL;
+  if (idx->scanned != NULL) {
+    if (idx->next < idx->count) {
+      *data_offset = g_array_index(idx->scanned, wtap_scan_entry, idx->next).offset;
+      if (!wtap_seek_read(wth, *data_offset, rec, err, err_info))
+        return false;
+      idx->next++;
+      return true;
+    }
+    /* Read whatever the scan couldn't find in order. */
+    if (!idx->resumed) {
+      idx->resumed = true;
+      if (!wtap_set_read_offset(wth, idx->resume_offset, err))
+        return false;
+    }
+    return wtap_read(wth, rec, err, err_info, data_offset);
+  }
+
+  if (!idx->stale) {
+    if (idx->next >= idx->count)
+      return false;
+
+    entry = idx->entries + (size_t)idx->next * INDEX_ENTRY_SIZE;
+    *data_offset = (int64_t)pletohu64(entry + 0);
+    if (wtap_seek_read(wth, *data_offset, rec, err, err_info) &&
+        entry_matches(entry, idx->next + 1, rec, *data_offset)) {
+      idx->next++;
+      return true;
+    }
+
+    /*
+     * Make sure the record is the one that was indexed; the file might
+     * have been rewritten without changing its size or time stamp. If it
+     * isn't, or can't be read, read the file without the index.
+     */
+    g_free(*err_info);
+    *err = 0;
+    *err_info = NULL;
+    wtap_rec_reset(rec);
+    discard_index(idx);
+  }
+
+  /*
+   * The sequential side of wth hasn't been used yet, so it's at the first
+   * record; skip the ones that have already been read through the index,
+   * which matched it.
+   */
+  for (; idx->skip > 0; idx->skip--) {
+    if (!wtap_read(wth, rec, err, err_info, data_offset))
+      return false;
+    wtap_rec_reset(rec);
+  }
+  return wtap_read(wth, rec, err, err_info, data_offset);
+}
+
+bool
+frame_data_index_first_pass(epan_t *session, int file_type_subtype, wtap *wth,
+    frame_data_sequence *frames, uint32_t count, uint32_t *next, uint32_t last,
+    frame_data_index_pass_func pass_func, void *user_data,
+    int *err, char **err_info)
+{
+  epan_dissect_t edt;
+  wtap_rec rec;
+  frame_data *fdata;
+  bool done = true;
+
+  *err = 0;
+  *err_info = NULL;
+  if (*next == 0 || last < *next)
+    return true;
+
+  epan_dissect_init(&edt, session, false, false);
+  wtap_rec_init(&rec, 2048);
+  while (*next <= last) {
+    if (pass_func != NULL && pass_func(*next, user_data)) {
+      done = false;
+      break;
+    }
+    fdata = frame_data_sequence_find(frames, *next);
+    if (!wtap_seek_read(wth, fdata->file_off, &rec, err, err_info)) {
+      done = false;
+      break;
+    }
+    /* The same dissection, taps included, as the sequential read does. */
+    epan_dissect_run_with_taps(&edt, file_type_subtype, &rec, fdata, NULL);
+    epan_dissect_reset(&edt);
+    wtap_rec_reset(&rec);
+    (*next)++;
+  }
+  epan_dissect_cleanup(&edt);
+  wtap_rec_cleanup(&rec);
+
+  if (*next > count) {
+    *next = 0;
+    postseq_cleanup_all_protocols();
+  }
+  return done;
+}
+
+void
+frame_data_index_close(frame_data_index *idx)
+{
+  if (idx == NULL)
+    return;
+  if (idx->scanned != NULL) {
+    g_array_free(idx->scanned, true);
+    g_array_free(idx->scanned_linktypes, true);
+  }
+  if (idx->mapped != NULL)
+    g_mapped_file_unref(idx->mapped);
+  g_free(idx->index_path);
+  g_free(idx);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,229 @@
+/** @file
+ * Sidecar index of the frames of a capture file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+#pragma once
+#include <epan/epan.h>
+#include <epan/frame_data_sequence.h>
+#include <wiretap/wtap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Suffix appended to the name of a capture file to get the name of
+ * its frame index.
+ */
+#define FRAME_DATA_INDEX_SUFFIX ".wsidx"
+
+/**
+ * A frame index records, for every frame of a capture file, where its
+ * record starts in the file, along with its lengths and time stamp. It is
+ * stored next to the capture file, and lets a later reader of the same
+ * file go straight to each record with random access, rather than scanning
+ * the file sequentially to find them.
+ *
+ * An index is only used if the capture file still has the size and
+ * modification time, to the nanosecond where the file system keeps it,
+ * that it had when the index was written, and if opening the file found
+ * the same metadata blocks (section headers, interfaces, name resolution
+ * and decryption secrets) as reading all of it did; otherwise records that
+ * follow those blocks might be read without them.
+ *
+ * If the records turn out not to match the index anyway, the index is
+ * removed and the file is read sequentially, as if it had no index.
+ */
+typedef struct _frame_data_index frame_data_index;
+
+/**
+ * Totals over the records of a capture file that an index can keep, so
+ * that a reader that doesn't read the records still knows them.
+ */
+typedef struct {
+  GArray   *linktypes;            /**< Link-layer types of the packets, as ints */
+  uint64_t  packet_comment_count; /**< Number of comments in the packets */
+  bool      drops_known;          /**< true if the number of dropped packets is known */
+  uint32_t  drops;                /**< Number of dropped packets */
+} frame_data_index_summary;
+
+/**
+ * @brief Write the frame index of a capture file that has been read
+ * completely.
+ *
+ * Nothing is written for compressed files, which can't be read at
+ * arbitrary offsets cheaply.
+ *
+ * @param wth The wiretap session of the file, after reading all of it.
+ * @param path Path of the capture file.
+ * @param fds The frames of the file, one per record.
+ * @param count Number of frames in fds.
+ * @param summary Totals over the records to keep in the index, or NULL.
+ * @return true if the index was written.
+ */
+WS_DLL_PUBLIC bool frame_data_index_write(wtap *wth, const char *path,
+    frame_data_sequence *fds, uint32_t count,
+    const frame_data_index_summary *summary);
+
+/**
+ * @brief Open the frame index of a capture file, if it has an up-to-date
+ * one.
+ *
+ * @param wth The wiretap session of the file, just opened.
+ * @param path Path of the capture file.
+ * @return The index, or NULL if there's no usable index.
+ */
+WS_DLL_PUBLIC frame_data_index *frame_data_index_open(wtap *wth, const char *path);
+
+/**
+ * @brief Build a frame index for a capture file by scanning it with
+ * several threads.
+ *
+ * The index isn't stored; it lists the records wtap_scan_records() finds,
+ * with what frame_data_index_next_frame() needs to set up their frames.
+ * Once those have been set up or read, frame_data_index_read() goes on
+ * reading the rest of the file with wtap_read().
+ *
+ * @param wth The wiretap session of the file, just opened.
+ * @param num_threads The maximum number of threads to use.
+ * @return The index, or NULL if the file can't be scanned.
+ */
+WS_DLL_PUBLIC frame_data_index *frame_data_index_scan(wtap *wth, unsigned num_threads);
+
+/**
+ * @brief Get the number of frames in a frame index.
+ *
+ * @param idx The index.
+ * @return The number of frames.
+ */
+WS_DLL_PUBLIC uint32_t frame_data_index_count(const frame_data_index *idx);
+
+/**
+ * @brief Check whether a frame index was opened from a file and still
+ * matches the capture file, as far as it has been read.
+ *
+ * If it doesn't, a new index should be written once the capture file has
+ * been read completely.
+ *
+ * @param idx The index.
+ * @return true if the index is a stored one that matches the capture file.
+ */
+WS_DLL_PUBLIC bool frame_data_index_is_current(const frame_data_index *idx);
+
+/**
+ * @brief Get the totals over the records that were stored in a frame index,
+ * or that a scanned index lists.
+ *
+ * @param idx The index.
+ * @param summary Set to the totals; the link-layer types are appended to
+ * summary->linktypes, if it's not NULL.
+ * @return true if the index has them, false if it was written without them.
+ */
+WS_DLL_PUBLIC bool frame_data_index_get_summary(const frame_data_index *idx,
+    frame_data_index_summary *summary);
+
+/**
+ * @brief Check that the records of a capture file are the ones listed in
+ * its frame index, without reading all of them.
+ *
+ * This reads a sample of the records; if any of them doesn't match, the
+ * index is removed, and frame_data_index_read() reads the file
+ * sequentially.
+ *
+ * @param idx The index, just opened.
+ * @param wth The wiretap session of the file.
+ * @return true if the index can be used in place of the records.
+ */
+WS_DLL_PUBLIC bool frame_data_index_verify(frame_data_index *idx, wtap *wth);
+
+/**
+ * @brief Set up the frame_data of the next frame in a frame index, without
+ * reading its record.
+ *
+ * Only the members that frame_data_init() would set from the record are
+ * set; the frame hasn't been dissected.
+ *
+ * @param idx The index, checked with frame_data_index_verify(), or a
+ * scanned index.
+ * @param fdata The frame to set up.
+ * @param cum_bytes Cumulative number of bytes in the frames before this one.
+ * @return true on success, false at the end of the index.
+ */
+WS_DLL_PUBLIC bool frame_data_index_next_frame(frame_data_index *idx,
+    frame_data *fdata, uint32_t cum_bytes);
+
+/**
+ * @brief Read the record of the next frame in a frame index.
+ *
+ * A replacement for wtap_read() that reads the records at the offsets the
+ * index gives, using wtap_seek_read().
+ *
+ * If a record doesn't match its entry in the index, the index is removed,
+ * and this reads the remaining records with wtap_read(), skipping the ones
+ * it has already returned. Entries of a scanned index aren't checked.
+ *
+ * @param idx The index.
+ * @param wth The wiretap session of the file.
+ * @param rec The record to read into.
+ * @param err Set to the error code on failure, or 0 at the end of the index.
+ * @param err_info Set to additional error information, if any.
+ * @param data_offset Set to the offset of the record in the file.
+ * @return true on success, false at the end of the index or on error.
+ */
+WS_DLL_PUBLIC bool frame_data_index_read(frame_data_index *idx, wtap *wth,
+    wtap_rec *rec, int *err, char **err_info, int64_t *data_offset);
+
+/**
+ * @brief Called between the frames of a deferred first pass.
+ *
+ * @param framenum The next frame to be dissected.
+ * @param user_data The user_data passed to frame_data_index_first_pass().
+ * @return true to stop the pass before that frame.
+ */
+typedef bool (*frame_data_index_pass_func)(uint32_t framenum, void *user_data);
+
+/**
+ * @brief Dissect, in order, frames that were set up from a frame index
+ * without being dissected, as reading the file would have.
+ *
+ * The frames from *next up to and including last are dissected with the
+ * taps, and *next is advanced past each of them, so a pass that's stopped
+ * can be resumed later by calling this again. Once every frame has been
+ * dissected, the protocols' postseq_cleanup routines are called, and
+ * *next is set to 0.
+ *
+ * @param session The dissection session.
+ * @param file_type_subtype The wiretap file type/subtype of the file.
+ * @param wth The wiretap session of the file.
+ * @param frames The frames of the file.
+ * @param count Number of frames in frames.
+ * @param next The first frame not yet dissected, or 0 if there's none.
+ * @param last The last frame to dissect.
+ * @param pass_func Called before each frame, or NULL.
+ * @param user_data Passed to pass_func.
+ * @param err Set to the error code if a record can't be read, or 0.
+ * @param err_info Set to additional error information, if any.
+ * @return true if every frame up to last has been dissected, false if the
+ * pass was stopped or a record couldn't be read.
+ */
+WS_DLL_PUBLIC bool frame_data_index_first_pass(epan_t *session,
+    int file_type_subtype, wtap *wth, frame_data_sequence *frames,
+    uint32_t count, uint32_t *next, uint32_t last,
+    frame_data_index_pass_func pass_func, void *user_data,
+    int *err, char **err_info);
+
+/**
+ * @brief Close a frame index.
+ *
+ * @param idx The index. May be NULL.
+ */
+WS_DLL_PUBLIC void frame_data_index_close(frame_data_index *idx);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
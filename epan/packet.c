@@ -187,6 +187,7 @@ struct heur_dissector_list {
 	const char	*ui_name;
 	protocol_t	*protocol;
 	GSList		*dissectors;
+	unsigned	num_entries;	/* Number of entries ever added */
 };
 
 static GHashTable *heur_dissector_lists;
@@ -194,6 +195,236 @@ static GHashTable *heur_dissector_lists;
 /* Name hashtables for fast detection of duplicate names */
 static GHashTable* heuristic_short_names;
 
+/*
+ * Per-flow state of a heuristic dissector list: which entry last accepted
+ * a packet of the flow, and which ones keep rejecting them. A flow is
+ * identified by its addresses and ports.
+ */
+typedef struct heur_flow_key {
+	const struct heur_dissector_list *list;
+	port_type	ptype;
+	uint32_t	port_a;
+	uint32_t	port_b;
+	address		addr_a;
+	address		addr_b;
+} heur_flow_key_t;
+
+typedef struct heur_flow {
+	heur_dtbl_entry_t *accepted;	/* Last entry that accepted a packet */
+	unsigned	num_rejects;	/* Number of counters in rejects */
+	uint16_t	*rejects;	/* Rejections in a row, then skipped packets, by list_index */
+} heur_flow_t;
+
+/*
+ * Once a heuristic dissector has rejected this many packets of a flow in a
+ * row, it isn't tried on the next HEUR_FLOW_RETRY_INTERVAL packets of the
+ * flow that it would have been tried on; then it's tried on one again, in
+ * case the flow has changed, e.g. a port has been reused.
+ */
+#define HEUR_FLOW_MAX_REJECTS		8
+#define HEUR_FLOW_RETRY_INTERVAL	256
+
+/*
+ * The outcome of a call to dissector_try_heuristic() on the first pass,
+ * so that dissecting the frame again gives the same outcome even though
+ * the flow caches, and the order of the list, have changed since.
+ */
+typedef struct heur_verdict_key {
+	const struct heur_dissector_list *list;
+	uint32_t	frame;
+	uint8_t		layer;
+} heur_verdict_key_t;
+
+/* Recorded when no entry accepted the packet, but some weren't tried. */
+static heur_dtbl_entry_t heur_verdict_none;
+
+static wmem_map_t *heur_flows;
+static wmem_map_t *heur_verdicts;
+
+static bool heur_timing;
+
+static unsigned
+heur_flow_hash(const void *k)
+{
+	const heur_flow_key_t *key = (const heur_flow_key_t *)k;
+	unsigned hash_val;
+
+	hash_val = g_direct_hash(key->list);
+	hash_val = hash_val * 31 + key->ptype;
+	hash_val = hash_val * 31 + key->port_a;
+	hash_val = hash_val * 31 + key->port_b;
+	hash_val = add_address_to_hash(hash_val, &key->addr_a);
+	hash_val = add_address_to_hash(hash_val, &key->addr_b);
+	return hash_val;
+}
+
+static gboolean
+heur_flow_equal(const void *a, const void *b)
+{
+	const heur_flow_key_t *key_a = (const heur_flow_key_t *)a;
+	const heur_flow_key_t *key_b = (const heur_flow_key_t *)b;
+
+	return key_a->list == key_b->list &&
+		key_a->ptype == key_b->ptype &&
+		key_a->port_a == key_b->port_a &&
+		key_a->port_b == key_b->port_b &&
+		addresses_equal(&key_a->addr_a, &key_b->addr_a) &&
+		addresses_equal(&key_a->addr_b, &key_b->addr_b);
+}
+
+static unsigned
+heur_verdict_hash(const void *k)
+{
+	const heur_verdict_key_t *key = (const heur_verdict_key_t *)k;
+
+	return (g_direct_hash(key->list) * 31 + key->frame) * 31 + key->layer;
+}
+
+static gboolean
+heur_verdict_equal(const void *a, const void *b)
+{
+	const heur_verdict_key_t *key_a = (const heur_verdict_key_t *)a;
+	const heur_verdict_key_t *key_b = (const heur_verdict_key_t *)b;
+
+	return key_a->list == key_b->list && key_a->frame == key_b->frame &&
+		key_a->layer == key_b->layer;
+}
+
+static void
+heur_verdicts_init(void)
+{
+	heur_flows = wmem_map_new(wmem_file_scope(), heur_flow_hash, heur_flow_equal);
+	heur_verdicts = wmem_map_new(wmem_file_scope(), heur_verdict_hash, heur_verdict_equal);
+}
+
+static void
+heur_verdicts_cleanup(void)
+{
+	/* Freed with the file scope. */
+	heur_flows = NULL;
+	heur_verdicts = NULL;
+}
+
+/*
+ * Get what the heuristic dissectors of a list made of the earlier packets
+ * of this packet's flow, if it has one.
+ */
+static heur_flow_t *
+heur_flow_get(const struct heur_dissector_list *list, packet_info *pinfo)
+{
+	heur_flow_key_t key, *new_key;
+	heur_flow_t *flow;
+	const address *src, *dst;
+	uint32_t srcport, destport;
+
+	if (!prefs.heur_flow_cache || heur_flows == NULL || pinfo->ptype == PT_NONE)
+		return NULL;
+
+	/* Both directions are the same flow. */
+	src = &pinfo->src;
+	dst = &pinfo->dst;
+	srcport = pinfo->srcport;
+	destport = pinfo->destport;
+	if (cmp_address(src, dst) > 0 ||
+	    (addresses_equal(src, dst) && srcport > destport)) {
+		src = &pinfo->dst;
+		dst = &pinfo->src;
+		srcport = pinfo->destport;
+		destport = pinfo->srcport;
+	}
+
+	key.list = list;
+	key.ptype = pinfo->ptype;
+	key.port_a = srcport;
+	key.port_b = destport;
+	key.addr_a = *src;
+	key.addr_b = *dst;
+	flow = (heur_flow_t *)wmem_map_lookup(heur_flows, &key);
+	if (flow == NULL) {
+		new_key = wmem_new(wmem_file_scope(), heur_flow_key_t);
+		*new_key = key;
+		copy_address_wmem(wmem_file_scope(), &new_key->addr_a, src);
+		copy_address_wmem(wmem_file_scope(), &new_key->addr_b, dst);
+		flow = wmem_new0(wmem_file_scope(), heur_flow_t);
+		flow->num_rejects = list->num_entries;
+		flow->rejects = wmem_alloc0_array(wmem_file_scope(), uint16_t, flow->num_rejects);
+		wmem_map_insert(heur_flows, new_key, flow);
+	}
+	return flow;
+}
+
+/*
+ * Check whether an entry has given up on a flow, and count the packet it
+ * skips if it has. Once it has skipped enough of them, it gets one more
+ * packet; rejecting that one makes it give up again right away.
+ */
+static bool
+heur_flow_skip(heur_flow_t *flow, const heur_dtbl_entry_t *hdtbl_entry)
+{
+	uint16_t *rejects;
+
+	if (hdtbl_entry->list_index >= flow->num_rejects)
+		return false;
+	rejects = &flow->rejects[hdtbl_entry->list_index];
+	if (*rejects < HEUR_FLOW_MAX_REJECTS)
+		return false;
+	if (*rejects < HEUR_FLOW_MAX_REJECTS + HEUR_FLOW_RETRY_INTERVAL) {
+		(*rejects)++;
+		return true;
+	}
+	*rejects = HEUR_FLOW_MAX_REJECTS - 1;
+	return false;
+}
+
+static void
+heur_flow_reject(heur_flow_t *flow, const heur_dtbl_entry_t *hdtbl_entry)
+{
+	if (hdtbl_entry->list_index < flow->num_rejects &&
+	    flow->rejects[hdtbl_entry->list_index] < HEUR_FLOW_MAX_REJECTS)
+		flow->rejects[hdtbl_entry->list_index]++;
+}
+
+static void
+heur_flow_accept(heur_flow_t *flow, heur_dtbl_entry_t *hdtbl_entry)
+{
+	flow->accepted = hdtbl_entry;
+	if (hdtbl_entry->list_index < flow->num_rejects)
+		flow->rejects[hdtbl_entry->list_index] = 0;
+}
+
+static heur_dtbl_entry_t *
+heur_verdict_lookup(const struct heur_dissector_list *list, packet_info *pinfo,
+		    uint8_t layer_num)
+{
+	heur_verdict_key_t key;
+
+	if (heur_verdicts == NULL)
+		return NULL;
+	key.list = list;
+	key.frame = pinfo->num;
+	key.layer = layer_num;
+	return (heur_dtbl_entry_t *)wmem_map_lookup(heur_verdicts, &key);
+}
+
+static void
+heur_verdict_record(const struct heur_dissector_list *list, packet_info *pinfo,
+		    uint8_t layer_num, heur_dtbl_entry_t *hdtbl_entry)
+{
+	heur_verdict_key_t *key;
+
+	if (heur_verdicts == NULL)
+		return;
+	key = wmem_new(wmem_file_scope(), heur_verdict_key_t);
+	key->list = list;
+	key->frame = pinfo->num;
+	key->layer = layer_num;
+	/* If a list is tried more than once at the same layer, keep the first. */
+	if (!wmem_map_contains(heur_verdicts, key))
+		wmem_map_insert(heur_verdicts, key, hdtbl_entry);
+	else
+		wmem_free(wmem_file_scope(), key);
+}
+
 static void
 destroy_heuristic_dissector_entry(void *data)
 {
@@ -383,6 +614,9 @@ init_dissection(const char* app_env_var_prefix)
 	/* Initialize the table of conversations. */
 	epan_conversation_init();
 
+	/* Initialize the heuristic dissector verdicts. */
+	heur_verdicts_init();
+
 	/* Initialize protocol-specific variables. */
 	g_slist_foreach(init_routines, &call_routine, NULL);
 
@@ -405,6 +639,8 @@ cleanup_dissection(void)
 	/* Cleanup the expert infos */
 	expert_packet_cleanup();
 
+	heur_verdicts_cleanup();
+
 	wmem_leave_file_scope();
 
 	/*
@@ -580,10 +816,12 @@ mark_frame_as_depended_upon(frame_data *fd, uint32_t frame_num)
 		/* ws_assert(frame_num < fd->num) - we assume in several other
 		 * places in the code that frames don't depend on future
 		 * frames. */
-		if (fd->dependent_frames == NULL) {
-			fd->dependent_frames = g_hash_table_new(g_direct_hash, g_direct_equal);
+		frame_data_cold *cold = frame_data_get_cold(fd);
+
+		if (cold->dependent_frames == NULL) {
+			cold->dependent_frames = g_hash_table_new(g_direct_hash, g_direct_equal);
 		}
-		g_hash_table_add(fd->dependent_frames, GUINT_TO_POINTER(frame_num));
+		g_hash_table_add(cold->dependent_frames, GUINT_TO_POINTER(frame_num));
 	}
 }
 
@@ -3020,6 +3258,10 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const char *dis
 	hdtbl_entry->list_name = g_strdup(name);
 	hdtbl_entry->enabled   = (enable == HEURISTIC_ENABLE);
 	hdtbl_entry->enabled_by_default = (enable == HEURISTIC_ENABLE);
+	hdtbl_entry->list_index = sub_dissectors->num_entries++;
+	hdtbl_entry->attempts = 0;
+	hdtbl_entry->accepts = 0;
+	hdtbl_entry->time_us = 0;
 
 	/* do the table insertion */
 	/* Ensure short_name is unique */
@@ -3078,6 +3320,85 @@ heur_dissector_delete(const char *name, heur_dissector_t dissector, const int pr
 	}
 }
 
+/*
+ * Is a heuristic dissector one we can try?
+ */
+static bool
+heur_dtbl_entry_is_enabled(const heur_dtbl_entry_t *hdtbl_entry)
+{
+	return hdtbl_entry->protocol == NULL ||
+		(proto_is_protocol_enabled(hdtbl_entry->protocol) && hdtbl_entry->enabled);
+}
+
+/*
+ * Call one heuristic dissector of a list, from dissector_try_heuristic().
+ * Returns what the dissector returned.
+ */
+static int
+call_heur_dtbl_entry(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+		     packet_info *pinfo, proto_tree *tree, void *data,
+		     uint16_t saved_can_desegment, unsigned saved_layers_len,
+		     unsigned saved_tree_count)
+{
+	int      proto_id;
+	int      len;
+	bool     consumed_none;
+	unsigned saved_desegment_len;
+	int64_t  start_time = 0;
+
+	/* XXX - why set this now and above? */
+	pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+
+	if (hdtbl_entry->protocol != NULL) {
+		proto_id = proto_get_id(hdtbl_entry->protocol);
+		/* do NOT change this behavior - wslua uses the protocol short name set here in order
+		   to determine which Lua-based heuristic dissector to call */
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		add_layer(pinfo, proto_id);
+	}
+
+	pinfo->heur_list_name = hdtbl_entry->list_name;
+
+	saved_desegment_len = pinfo->desegment_len;
+	hdtbl_entry->attempts++;
+	if (heur_timing)
+		start_time = g_get_monotonic_time();
+	len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
+	if (heur_timing)
+		hdtbl_entry->time_us += (uint64_t)(g_get_monotonic_time() - start_time);
+	consumed_none = len == 0 || (pinfo->desegment_len != saved_desegment_len && pinfo->desegment_offset == 0);
+	if (hdtbl_entry->protocol != NULL &&
+		(consumed_none || (tree && saved_tree_count == tree->tree_data->count))) {
+		/*
+		 * We added a protocol layer above. The dissector
+		 * didn't consume any data or it didn't add any
+		 * items to the tree so remove it from the list.
+		 */
+		while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+			/*
+			 * Only reduce the layer number if the dissector
+			 * didn't consume data. Since tree can be NULL on
+			 * the first pass, we cannot check it or it will
+			 * break dissectors that rely on a stable value.
+			 */
+			remove_last_layer(pinfo, consumed_none);
+		}
+	}
+	if (len) {
+		hdtbl_entry->accepts++;
+		if (ws_log_msg_is_active(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG)) {
+			ws_debug("Frame: %d | Layers: %s | Dissector: %s\n", pinfo->num, proto_list_layers(pinfo), hdtbl_entry->short_name);
+		}
+	}
+	return len;
+}
+
 bool
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **heur_dtbl_entry, void *data)
@@ -3087,14 +3408,14 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	int                saved_proto_layer_num;
 	const char        *saved_heur_list_name;
 	GSList            *entry;
-	GSList            *prev_entry = NULL;
 	uint16_t           saved_can_desegment;
 	unsigned           saved_layers_len = 0;
 	heur_dtbl_entry_t *hdtbl_entry;
-	int                proto_id;
-	int                len;
-	bool               consumed_none;
-	unsigned           saved_desegment_len;
+	heur_dtbl_entry_t *first_entry = NULL;
+	heur_dtbl_entry_t *accepted = NULL;
+	heur_flow_t       *flow = NULL;
+	bool               skipped = false;
+	uint8_t            layer_num = pinfo->curr_layer_num;
 	unsigned           saved_tree_count = tree ? tree->tree_data->count : 0;
 
 	/* can_desegment is set to 2 by anyone which offers this api/service.
@@ -3120,74 +3441,81 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 	DISSECTOR_ASSERT(saved_layers_len < prefs.gui_max_tree_depth);
 
-	for (entry = sub_dissectors->dissectors; entry != NULL;
-	    entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+	/*
+	 * If we've seen this packet before, do what we did then; otherwise
+	 * start with whatever last accepted a packet of its flow.
+	 */
+	if (PINFO_FD_VISITED(pinfo)) {
+		first_entry = heur_verdict_lookup(sub_dissectors, pinfo, layer_num);
+		if (first_entry == &heur_verdict_none)
+			goto done;
+	} else {
+		flow = heur_flow_get(sub_dissectors, pinfo);
+		if (flow != NULL)
+			first_entry = flow->accepted;
+	}
+
+	if (first_entry != NULL && heur_dtbl_entry_is_enabled(first_entry)) {
+		if (call_heur_dtbl_entry(first_entry, tvb, pinfo, tree, data,
+		    saved_can_desegment, saved_layers_len, saved_tree_count))
+			accepted = first_entry;
+		else if (flow != NULL)
+			heur_flow_reject(flow, first_entry);
+	}
+
+	for (entry = sub_dissectors->dissectors;
+	    accepted == NULL && entry != NULL; entry = g_slist_next(entry)) {
 		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
 
-		if (hdtbl_entry->protocol != NULL &&
-			(!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==false))) {
+		if (hdtbl_entry == first_entry || !heur_dtbl_entry_is_enabled(hdtbl_entry)) {
 			/*
 			 * No - don't try this dissector.
 			 */
 			continue;
 		}
-
-		if (hdtbl_entry->protocol != NULL) {
-			proto_id = proto_get_id(hdtbl_entry->protocol);
-			/* do NOT change this behavior - wslua uses the protocol short name set here in order
-			   to determine which Lua-based heuristic dissector to call */
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
-
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			add_layer(pinfo, proto_id);
-		}
-
-		pinfo->heur_list_name = hdtbl_entry->list_name;
-
-		saved_desegment_len = pinfo->desegment_len;
-		len = (hdtbl_entry->dissector)(tvb, pinfo, tree, data);
-		consumed_none = len == 0 || (pinfo->desegment_len != saved_desegment_len && pinfo->desegment_offset == 0);
-		if (hdtbl_entry->protocol != NULL &&
-			(consumed_none || (tree && saved_tree_count == tree->tree_data->count))) {
-			/*
-			 * We added a protocol layer above. The dissector
-			 * didn't consume any data or it didn't add any
-			 * items to the tree so remove it from the list.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				/*
-				 * Only reduce the layer number if the dissector
-				 * didn't consume data. Since tree can be NULL on
-				 * the first pass, we cannot check it or it will
-				 * break dissectors that rely on a stable value.
-				 */
-				remove_last_layer(pinfo, consumed_none);
-			}
+		if (flow != NULL && heur_flow_skip(flow, hdtbl_entry)) {
+			/* It has given up on this flow. */
+			skipped = true;
+			continue;
 		}
-		if (len) {
-			if (ws_log_msg_is_active(WS_LOG_DOMAIN, LOG_LEVEL_DEBUG)) {
-				ws_debug("Frame: %d | Layers: %s | Dissector: %s\n", pinfo->num, proto_list_layers(pinfo), hdtbl_entry->short_name);
-			}
 
-			*heur_dtbl_entry = hdtbl_entry;
+		if (call_heur_dtbl_entry(hdtbl_entry, tvb, pinfo, tree, data,
+		    saved_can_desegment, saved_layers_len, saved_tree_count)) {
+			accepted = hdtbl_entry;
 
 			/* Bubble the matched entry to the top for faster search next time. */
-			if (prev_entry != NULL) {
+			if (entry != sub_dissectors->dissectors) {
 				sub_dissectors->dissectors = g_slist_remove_link(sub_dissectors->dissectors, entry);
 				sub_dissectors->dissectors = g_slist_concat(entry, sub_dissectors->dissectors);
 			}
-			status = true;
 			break;
 		}
-		prev_entry = entry;
+		if (flow != NULL)
+			heur_flow_reject(flow, hdtbl_entry);
 	}
 
+	if (accepted != NULL) {
+		*heur_dtbl_entry = accepted;
+		status = true;
+	}
+
+	if (!PINFO_FD_VISITED(pinfo)) {
+		if (flow != NULL && accepted != NULL)
+			heur_flow_accept(flow, accepted);
+
+		/*
+		 * Dissecting the packet again starts with the same
+		 * verdict; the flow caches will have moved on by then.
+		 * If nothing accepted it, that only needs recording if
+		 * something wasn't tried.
+		 */
+		if (accepted != NULL)
+			heur_verdict_record(sub_dissectors, pinfo, layer_num, accepted);
+		else if (skipped)
+			heur_verdict_record(sub_dissectors, pinfo, layer_num, &heur_verdict_none);
+	}
+
+done:
 	pinfo->current_proto = saved_curr_proto;
 	pinfo->curr_proto_layer_num = saved_proto_layer_num;
 	pinfo->heur_list_name = saved_heur_list_name;
@@ -3195,6 +3523,28 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	return status;
 }
 
+void
+heur_dissector_set_timing(bool enable)
+{
+	heur_timing = enable;
+}
+
+static void
+heur_dissector_reset_stats_func(void *key _U_, void *value, void *user_data _U_)
+{
+	heur_dtbl_entry_t *hdtbl_entry = (heur_dtbl_entry_t *)value;
+
+	hdtbl_entry->attempts = 0;
+	hdtbl_entry->accepts = 0;
+	hdtbl_entry->time_us = 0;
+}
+
+void
+heur_dissector_reset_stats(void)
+{
+	g_hash_table_foreach(heuristic_short_names, heur_dissector_reset_stats_func, NULL);
+}
+
 typedef struct heur_dissector_foreach_info {
 	void *        caller_data;
 	DATFunc_heur  caller_func;
@@ -3343,6 +3693,7 @@ register_heur_dissector_list_with_description(const char *name, const char *ui_n
 	sub_dissectors->protocol  = (proto == -1) ? NULL : find_protocol_by_id(proto);
 	sub_dissectors->ui_name = ui_name;
 	sub_dissectors->dissectors = NULL;	/* initially empty */
+	sub_dissectors->num_entries = 0;
 	/* Make sure the registration is unique */
 	if (!g_hash_table_insert(heur_dissector_lists, (void *)name,
 			    (void *) sub_dissectors)) {
@@ -676,6 +676,10 @@ typedef struct heur_dtbl_entry {
     char*            short_name;       /**< Internal unique identifier string used to distinguish this heuristic from others. */
     bool             enabled;          /**< Whether this heuristic dissector is currently enabled. */
     bool             enabled_by_default; /**< Whether this heuristic dissector is enabled by default upon registration. */
+    unsigned         list_index;       /**< Position at which the entry was added to its list; used to cache verdicts per flow. */
+    uint64_t         attempts;         /**< Number of times the heuristic dissector has been called. */
+    uint64_t         accepts;          /**< Number of times it has accepted the packet. */
+    uint64_t         time_us;          /**< Time spent in it, in microseconds, while heur_dissector_set_timing() is enabled. */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
@@ -743,6 +747,12 @@ WS_DLL_PUBLIC bool has_heur_dissector_list(const char *name);
  *  until we find one that recognizes the protocol.
  *  Call this while the parent dissector running.
  *
+ *  For packets with ports, the dissector that last recognized a packet of
+ *  the same flow is tried first, and dissectors that have rejected several
+ *  packets of the flow in a row are no longer tried for it. Which
+ *  dissector recognized the packet, or that none did, is remembered, so
+ *  that dissecting the packet again gives the same result.
+ *
  * @param sub_dissectors the sub-dissector list
  * @param tvb the tvbuff with the (remaining) packet data
  * @param pinfo the packet info of this packet (additional info)
@@ -754,6 +764,19 @@ WS_DLL_PUBLIC bool has_heur_dissector_list(const char *name);
 WS_DLL_PUBLIC bool dissector_try_heuristic(heur_dissector_list_t sub_dissectors,
     tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, heur_dtbl_entry_t **hdtbl_entry, void *data);
 
+/** Measure the time spent in each heuristic dissector.
+ *
+ * The attempts and accepts of each heur_dtbl_entry_t are always counted;
+ * the time spent is only added to time_us while timing is enabled, as
+ * reading the clock costs about as much as a cheap heuristic does.
+ *
+ * @param enable true to start timing, false to stop.
+ */
+WS_DLL_PUBLIC void heur_dissector_set_timing(bool enable);
+
+/** Reset the attempt, accept and time counters of all heuristic dissectors. */
+WS_DLL_PUBLIC void heur_dissector_reset_stats(void);
+
 /** Find a heuristic dissector table by table name.
  *
  * @param name name of the dissector table
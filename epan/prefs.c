@@ -3322,6 +3322,13 @@ prefs_register_modules(void)
                                    10,
                                    &prefs.gui_fileopen_preview);
 
+    prefs_register_bool_preference(gui_module, "frame_index",
+                                   "Keep a frame index next to capture files",
+                                   "Write a \".wsidx\" file next to each capture file that has been "
+                                   "read completely, and use it to find the records of the file without "
+                                   "scanning it when it is opened again.",
+                                   &prefs.gui_frame_index);
+
     register_string_like_preference(gui_module, "tlskeylog_command", "Program to launch with TLS Keylog",
         "Program path or command line to launch with SSLKEYLOGFILE",
         &prefs.gui_tlskeylog_command, PREF_STRING, NULL, true);
@@ -3626,7 +3633,7 @@ prefs_register_modules(void)
 
     prefs_register_uint_preference(gui_module, "packet_list_cached_rows_max",
                                    "Maximum cached rows",
-                                   "Maximum number of rows that can be sorted by columns that require dissection. Increasing this increases memory consumption by caching column text",
+                                   "Maximum number of rows whose column text is kept in memory. Column text for further rows is kept in a temporary file",
                                    10,
                                    &prefs.gui_packet_list_cached_rows_max);
 
@@ -3951,6 +3958,13 @@ prefs_register_modules(void)
                                    "Currently ICMP and ICMPv6 use this preference to add VLAN ID to conversation tracking, and IPv4 uses this preference to take VLAN ID into account during reassembly",
                                    &prefs.strict_conversation_tracking_heuristics);
 
+    prefs_register_bool_preference(protocols_module, "heuristic_flow_cache",
+                                   "Remember heuristic dissector results per flow",
+                                   "Try the heuristic dissector that last accepted a packet of a flow first, "
+                                   "and try heuristic dissectors that keep rejecting the packets of a flow "
+                                   "only now and then.",
+                                   &prefs.heur_flow_cache);
+
     prefs_register_bool_preference(protocols_module, "ignore_dup_frames",
                                    "Ignore duplicate frames",
                                    "Ignore frames that are exact duplicates of any previous frame.",
@@ -4202,6 +4216,7 @@ prefs_set_global_defaults(wmem_allocator_t* pref_scope, const char** col_fmt, in
     wmem_free(pref_scope, prefs.gui_fileopen_dir);
     prefs.gui_fileopen_dir           = wmem_strdup(pref_scope, get_persdatafile_dir());
     prefs.gui_fileopen_preview       = 3;
+    prefs.gui_frame_index            = false;
     wmem_free(pref_scope, prefs.gui_tlskeylog_command);
     prefs.gui_tlskeylog_command      = wmem_strdup(pref_scope, "");
     prefs.gui_ask_unsaved            = true;
@@ -4294,6 +4309,7 @@ prefs_set_global_defaults(wmem_allocator_t* pref_scope, const char** col_fmt, in
     prefs.display_abs_time_ascii = ABS_TIME_ASCII_TREE;
     prefs.ignore_dup_frames = false;
     prefs.ignore_dup_frames_cache_entries = 10000;
+    prefs.heur_flow_cache = true;
 
     /* set the default values for the io graph dialog */
     prefs.gui_io_graph_automatic_update = true;
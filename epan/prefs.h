@@ -235,6 +235,7 @@ typedef struct _e_prefs {
     unsigned      gui_fileopen_style;           /**< File open dialog style (last directory vs. fixed directory) */
     char         *gui_fileopen_dir;             /**< Fixed directory used when gui_fileopen_style is set to fixed */
     unsigned      gui_fileopen_preview;         /**< Number of bytes to preview when browsing capture files */
+    bool          gui_frame_index;              /**< If true, keep a sidecar frame index next to capture files */
 
     char         *gui_tlskeylog_command;         /**< Shell command executed to retrieve a TLS key log file path */
 
@@ -318,6 +319,7 @@ typedef struct _e_prefs {
     bool          enable_incomplete_dissectors_check;  /**< If true, warn when a dissector does not consume all available data */
     bool          incomplete_dissectors_check_debug;   /**< If true, emit debug output for incomplete dissector checks */
     bool          strict_conversation_tracking_heuristics; /**< If true, apply stricter heuristics for conversation tracking */
+    bool          heur_flow_cache;                     /**< If true, remember which heuristic dissectors accept or reject each flow */
     int           conversation_deinterlacing_key;      /**< Key bitmask controlling conversation deinterlacing behavior */
 
     /* Duplicate frame detection */
@@ -10,6 +10,9 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <glib.h>
 
 #include <epan/wmem_scopes.h>
@@ -24,80 +27,176 @@ typedef struct _proto_data {
   int   proto;
   uint32_t key;
   void *proto_data;
+  uint32_t seq;         /* When it was added, counting from 1; 0 in a free slot */
 } proto_data_t;
 
-static int
-p_compare(const void *a, const void *b)
+/*
+ * The protocol data of a packet or a frame.
+ *
+ * Most have only a few entries, which are kept in order in entries[]
+ * and searched from the newest. Past PROTO_DATA_INLINE entries, they
+ * move to an open-addressing hash table with linear probing.
+ *
+ * p_add_proto_data() can add several entries with the same protocol and
+ * key, and the most recently added one is the one that counts, so a
+ * lookup in the hash table follows the whole probe sequence and picks
+ * the match with the highest seq.
+ */
+#define PROTO_DATA_INLINE     4
+#define PROTO_DATA_MIN_SLOTS  16
+#define PROTO_DATA_REMOVED    UINT32_MAX  /* seq of a removed hash table entry */
+
+struct _proto_data_table {
+  uint32_t      count;          /* Number of entries */
+  uint32_t      next_seq;
+  uint32_t      size;           /* Number of hash table slots, or 0 if the entries are inline */
+  uint32_t      used;           /* Hash table slots that aren't free, including removed entries */
+  proto_data_t *slots;
+  proto_data_t  entries[PROTO_DATA_INLINE];
+};
+
+typedef struct _proto_data_table proto_data_table_t;
+
+static proto_data_table_t **
+p_get_table(wmem_allocator_t *scope, struct _packet_info* pinfo)
 {
-  const proto_data_t *ap = (const proto_data_t *)a;
-  const proto_data_t *bp = (const proto_data_t *)b;
-
-  if (ap -> proto > bp -> proto) {
-    return 1;
-  } else if (ap -> proto == bp -> proto) {
-    if (ap->key > bp->key){
-      return 1;
-    } else if (ap -> key == bp -> key) {
-      return 0;
-    }
-    return -1;
+  proto_data_table_t **table;
+
+  if (scope == pinfo->pool) {
+    table = &pinfo->proto_data;
+  } else if (scope == wmem_file_scope()) {
+    table = &pinfo->fd->pfd;
   } else {
-    return -1;
+    DISSECTOR_ASSERT(!"invalid wmem scope");
   }
+  return table;
 }
 
-void
-p_add_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, uint32_t key, void *proto_data)
+static inline uint32_t
+p_hash(int proto, uint32_t key)
 {
-  proto_data_t     *p1;
-  wmem_list_t     **proto_list;
+  uint32_t h = ((uint32_t)proto * 0x9e3779b1U) ^ key;
 
-  if (scope == pinfo->pool) {
-    proto_list = &pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    proto_list = &pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  return h;
+}
+
+/* Find the most recently added entry for proto and key. */
+static proto_data_t *
+p_find(proto_data_table_t *table, int proto, uint32_t key)
+{
+  proto_data_t *found = NULL;
+  uint32_t mask, i;
+
+  if (table->size == 0) {
+    for (i = table->count; i-- > 0; ) {
+      if (table->entries[i].proto == proto && table->entries[i].key == key)
+        return &table->entries[i];
+    }
+    return NULL;
   }
 
-  if (*proto_list == NULL) {
-    *proto_list = wmem_list_new(scope);
+  /* The table is never full, so the probe sequence ends at a free slot. */
+  mask = table->size - 1;
+  for (i = p_hash(proto, key) & mask; table->slots[i].seq != 0; i = (i + 1) & mask) {
+    proto_data_t *slot = &table->slots[i];
+
+    if (slot->seq != PROTO_DATA_REMOVED && slot->proto == proto &&
+        slot->key == key && (found == NULL || slot->seq > found->seq))
+      found = slot;
   }
+  return found;
+}
+
+static void
+p_hash_insert(proto_data_t *slots, uint32_t size, const proto_data_t *pd)
+{
+  uint32_t mask = size - 1;
+  uint32_t i = p_hash(pd->proto, pd->key) & mask;
+
+  while (slots[i].seq != 0)
+    i = (i + 1) & mask;
+  slots[i] = *pd;
+}
+
+/* Move the entries to a new hash table with room for at least one more. */
+static void
+p_rehash(wmem_allocator_t *scope, proto_data_table_t *table)
+{
+  uint32_t size = MAX(table->size, PROTO_DATA_MIN_SLOTS);
+  proto_data_t *slots;
 
-  p1 = wmem_new(scope, proto_data_t);
+  while ((table->count + 1) * 2 > size)
+    size *= 2;
+  slots = wmem_alloc0_array(scope, proto_data_t, size);
 
-  p1->proto = proto;
-  p1->key = key;
-  p1->proto_data = proto_data;
+  if (table->size == 0) {
+    for (uint32_t i = 0; i < table->count; i++)
+      p_hash_insert(slots, size, &table->entries[i]);
+  } else {
+    for (uint32_t i = 0; i < table->size; i++) {
+      if (table->slots[i].seq != 0 && table->slots[i].seq != PROTO_DATA_REMOVED)
+        p_hash_insert(slots, size, &table->slots[i]);
+    }
+    wmem_free(scope, table->slots);
+  }
+  table->slots = slots;
+  table->size = size;
+  table->used = table->count;
+}
+
+static int
+p_compare_newest_first(const void *a, const void *b)
+{
+  const proto_data_t *ap = *(const proto_data_t * const *)a;
+  const proto_data_t *bp = *(const proto_data_t * const *)b;
 
-  /* Add it to the list */
-  wmem_list_prepend(*proto_list, p1);
+  return (ap->seq < bp->seq) - (ap->seq > bp->seq);
 }
 
 void
-p_set_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, uint32_t key, void *proto_data)
+p_add_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, uint32_t key, void *proto_data)
 {
-  /* Probably more dissectors should use this instead of p_add_proto_data. */
-  proto_data_t  temp;
-  wmem_list_t  *proto_list;
-  wmem_list_frame_t *item;
+  proto_data_table_t **table_ptr = p_get_table(scope, pinfo);
+  proto_data_table_t  *table = *table_ptr;
+  proto_data_t         pd;
+
+  if (table == NULL) {
+    table = wmem_new0(scope, proto_data_table_t);
+    table->next_seq = 1;
+    *table_ptr = table;
+  }
 
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
+  pd.proto = proto;
+  pd.key = key;
+  pd.proto_data = proto_data;
+  pd.seq = table->next_seq++;
 
-  if (scope == pinfo->pool) {
-    proto_list = pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    proto_list = pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+  if (table->size == 0 && table->count < PROTO_DATA_INLINE) {
+    table->entries[table->count++] = pd;
+    return;
   }
 
-  if (proto_list) {
-    item = wmem_list_find_custom(proto_list, &temp, p_compare);
-    if (item) {
-      proto_data_t *pd = (proto_data_t*)wmem_list_frame_data(item);
+  /* Keep at least a quarter of the slots free. */
+  if (table->size == 0 || (table->used + 1) * 4 > table->size * 3)
+    p_rehash(scope, table);
+  p_hash_insert(table->slots, table->size, &pd);
+  table->count++;
+  table->used++;
+}
+
+void
+p_set_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, uint32_t key, void *proto_data)
+{
+  /* Probably more dissectors should use this instead of p_add_proto_data. */
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+  proto_data_t       *pd;
+
+  if (table) {
+    pd = p_find(table, proto, key);
+    if (pd) {
       pd->proto_data = proto_data;
       return;
     }
@@ -109,31 +208,15 @@ p_set_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void *
 p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, uint32_t key)
 {
-  proto_data_t  temp, *p1;
-  wmem_list_t  *proto_list;
-  wmem_list_frame_t *item;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
-
-  if (scope == pinfo->pool) {
-    proto_list = pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    proto_list = pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+  proto_data_t       *pd;
 
-  if (!proto_list)
+  if (!table)
     return NULL;
 
-  item = wmem_list_find_custom(proto_list, &temp, p_compare);
-
-  if (item) {
-    p1 = wmem_list_frame_data(item);
-    return p1->proto_data;
-  }
+  pd = p_find(table, proto, key);
+  if (pd)
+    return pd->proto_data;
 
   return NULL;
 }
@@ -141,56 +224,53 @@ p_get_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto,
 void
 p_remove_proto_data(wmem_allocator_t *scope, struct _packet_info* pinfo, int proto, uint32_t key)
 {
-  proto_data_t  temp;
-  wmem_list_t  *proto_list;
-  wmem_list_frame_t *item;
-
-  temp.proto = proto;
-  temp.key = key;
-  temp.proto_data = NULL;
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+  proto_data_t       *pd;
 
-  if (scope == pinfo->pool) {
-    proto_list = pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    proto_list = pinfo->fd->pfd;
-  } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
-  }
+  if (!table)
+    return;
 
-  if (!proto_list)
+  pd = p_find(table, proto, key);
+  if (!pd)
     return;
 
-  item = wmem_list_find_custom(proto_list, &temp, p_compare);
-  if (item) {
-    wmem_list_remove_frame(proto_list, item);
+  if (table->size == 0) {
+    memmove(pd, pd + 1, (size_t)(&table->entries[table->count] - (pd + 1)) * sizeof *pd);
+  } else {
+    /* Leave the slot in place, so that later ones stay reachable. */
+    pd->seq = PROTO_DATA_REMOVED;
   }
+  table->count--;
 }
 
 GPtrArray *
 p_get_proto_names_and_keys(wmem_allocator_t *scope, struct _packet_info* pinfo) {
-  wmem_list_t  *proto_list;
-  proto_data_t *temp;
+  proto_data_table_t *table = *p_get_table(scope, pinfo);
+  proto_data_t **sorted;
+  uint32_t n = 0;
   GPtrArray *ret;
 
-  if (scope == pinfo->pool) {
-    proto_list = pinfo->proto_data;
-  } else if (scope == wmem_file_scope()) {
-    proto_list = pinfo->fd->pfd;
+  if (!table)
+    return NULL;
+
+  /* List them from the newest to the oldest, as they're looked up. */
+  sorted = g_new(proto_data_t *, table->count);
+  if (table->size == 0) {
+    for (uint32_t i = 0; i < table->count; i++)
+      sorted[n++] = &table->entries[i];
   } else {
-    DISSECTOR_ASSERT(!"invalid wmem scope");
+    for (uint32_t i = 0; i < table->size; i++) {
+      if (table->slots[i].seq != 0 && table->slots[i].seq != PROTO_DATA_REMOVED)
+        sorted[n++] = &table->slots[i];
+    }
   }
-
-  if (!proto_list)
-    return NULL;
+  qsort(sorted, n, sizeof *sorted, p_compare_newest_first);
 
   ret = g_ptr_array_new();
-
-  for (wmem_list_frame_t *frame = wmem_list_head(proto_list);
-      frame; frame = wmem_list_frame_next(frame)) {
-
-    temp = wmem_list_frame_data(frame);
-    g_ptr_array_add(ret, wmem_strdup_printf(pinfo->pool, "[%s, key %u]",proto_get_protocol_name(temp->proto), temp->key));
+  for (uint32_t i = 0; i < n; i++) {
+    g_ptr_array_add(ret, wmem_strdup_printf(pinfo->pool, "[%s, key %u]", proto_get_protocol_name(sorted[i]->proto), sorted[i]->key));
   }
+  g_free(sorted);
   return ret;
 }
 
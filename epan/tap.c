@@ -87,6 +87,8 @@ typedef struct _tap_listener_t {
 	unsigned flags;
 	char *fstring;
 	dfilter_t *code;
+	int filter_slot;	/* index into tap_filter_verdicts, or -1 */
+	bool filter_slot_owner;	/* first listener with this filter_slot */
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
@@ -96,6 +98,114 @@ typedef struct _tap_listener_t {
 
 static tap_listener_t *tap_listener_queue;
 
+/*
+ * The listeners in tap_listener_queue, indexed by tap_id, so that
+ * pushing a tapped packet only visits the listeners for its tap.
+ * Each entry is a NULL-terminated array of listeners in the same
+ * order as in tap_listener_queue, or NULL if the tap has no listeners.
+ * Rebuilt whenever a listener is registered or removed.
+ */
+static tap_listener_t ***tap_listeners_by_id;
+static unsigned tap_listeners_by_id_len;
+
+/*
+ * Several listeners often use the same filter string (e.g. the expert,
+ * conversation and I/O graph taps all given the same filter), and a
+ * listener with several tapped packets would otherwise run its filter
+ * once per tapped packet. The result of a filter depends only on the
+ * epan_dissect_t, so listeners with identical filter strings share a
+ * "filter slot", and tap_push_tapped_queue() runs each filter at most
+ * once per packet and remembers the verdict here.
+ */
+#define TAP_FILTER_UNKNOWN	-1
+#define TAP_FILTER_FAILED	0
+#define TAP_FILTER_PASSED	1
+static int8_t *tap_filter_verdicts;
+static unsigned tap_filter_slot_count;
+
+static void
+free_tap_listener_index(void)
+{
+	unsigned i;
+
+	for (i = 0; i < tap_listeners_by_id_len; i++) {
+		g_free(tap_listeners_by_id[i]);
+	}
+	g_free(tap_listeners_by_id);
+	tap_listeners_by_id = NULL;
+	tap_listeners_by_id_len = 0;
+
+	g_free(tap_filter_verdicts);
+	tap_filter_verdicts = NULL;
+	tap_filter_slot_count = 0;
+}
+
+static void
+assign_tap_filter_slots(void)
+{
+	tap_listener_t *tl;
+	GHashTable *slots;
+	void *slot;
+
+	slots = g_hash_table_new(g_str_hash, g_str_equal);
+	for (tl = tap_listener_queue; tl; tl = tl->next) {
+		if (!tl->fstring || !*tl->fstring) {
+			tl->filter_slot = -1;
+			tl->filter_slot_owner = false;
+			continue;
+		}
+		if (g_hash_table_lookup_extended(slots, tl->fstring, NULL, &slot)) {
+			tl->filter_slot = GPOINTER_TO_INT(slot);
+			tl->filter_slot_owner = false;
+		} else {
+			tl->filter_slot = (int)tap_filter_slot_count++;
+			tl->filter_slot_owner = true;
+			g_hash_table_insert(slots, tl->fstring, GINT_TO_POINTER(tl->filter_slot));
+		}
+	}
+	g_hash_table_destroy(slots);
+
+	if (tap_filter_slot_count > 0) {
+		tap_filter_verdicts = g_new(int8_t, tap_filter_slot_count);
+	}
+}
+
+static void
+rebuild_tap_listener_index(void)
+{
+	tap_listener_t *tl;
+	unsigned *counts;
+	unsigned len = 0;
+
+	free_tap_listener_index();
+	assign_tap_filter_slots();
+
+	for (tl = tap_listener_queue; tl; tl = tl->next) {
+		if ((unsigned)tl->tap_id >= len) {
+			len = tl->tap_id + 1;
+		}
+	}
+	if (len == 0) {
+		return;
+	}
+
+	counts = g_new0(unsigned, len);
+	for (tl = tap_listener_queue; tl; tl = tl->next) {
+		counts[tl->tap_id]++;
+	}
+
+	tap_listeners_by_id = g_new0(tap_listener_t **, len);
+	tap_listeners_by_id_len = len;
+	for (tl = tap_listener_queue; tl; tl = tl->next) {
+		if (!tap_listeners_by_id[tl->tap_id]) {
+			tap_listeners_by_id[tl->tap_id] = g_new0(tap_listener_t *, counts[tl->tap_id] + 1);
+			counts[tl->tap_id] = 0;
+		}
+		tap_listeners_by_id[tl->tap_id][counts[tl->tap_id]++] = tl;
+	}
+	g_free(counts);
+}
+
 static GSList *tap_plugins;
 
 #ifdef HAVE_PLUGINS
@@ -279,7 +389,11 @@ void tap_build_interesting (epan_dissect_t *edt)
 	   interesting hf_fields */
 	for(tl=tap_listener_queue;tl;tl=tl->next){
 		if(tl->code){
-			epan_dissect_prime_with_dfilter(edt, tl->code);
+			/* Listeners sharing a filter string share its verdict,
+			 * so only the first one needs to prime the tree. */
+			if(tl->filter_slot < 0 || tl->filter_slot_owner){
+				epan_dissect_prime_with_dfilter(edt, tl->code);
+			}
 		}
 		if(tl->flags & TL_REQUIRES_PROTOCOLS){
 			need_protocols = true;
@@ -315,6 +429,24 @@ tap_queue_init(epan_dissect_t *edt)
 	tap_build_interesting (edt);
 }
 
+/* Run a listener's filter, or look up the verdict if a listener with the
+   same filter string has already run it for this packet. */
+static bool
+tap_listener_filter_passes(tap_listener_t *tl, epan_dissect_t *edt)
+{
+	int8_t *verdict;
+
+	if(tl->filter_slot < 0){
+		return dfilter_apply_edt(tl->code, edt);
+	}
+
+	verdict = &tap_filter_verdicts[tl->filter_slot];
+	if(*verdict == TAP_FILTER_UNKNOWN){
+		*verdict = dfilter_apply_edt(tl->code, edt) ? TAP_FILTER_PASSED : TAP_FILTER_FAILED;
+	}
+	return *verdict == TAP_FILTER_PASSED;
+}
+
 /* this function is called after a packet has been fully dissected to push the tapped
    data to all extensions that has callbacks registered.
 */
@@ -322,8 +454,9 @@ void
 tap_push_tapped_queue(epan_dissect_t *edt)
 {
 	tap_packet_t *tp;
-	tap_listener_t *tl;
+	tap_listener_t *tl, **tlp;
 	unsigned i;
+	int main_filter_verdict = TAP_FILTER_UNKNOWN;
 
 	/* nothing to do, just return */
 	if(!tapping_is_active){
@@ -337,76 +470,87 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
-	/* loop over all tap listeners and call the listener callback
-	   for all packets that match the filter. */
+	/* Filters are run lazily, at most once each, for this packet. */
+	if(tap_filter_slot_count){
+		memset(tap_filter_verdicts, TAP_FILTER_UNKNOWN, tap_filter_slot_count);
+	}
+
+	/* loop over all tap listeners for the tap of each packet and call
+	   the listener callback for all packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
-		for(tl=tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
+		tp=&tap_packet_array[i];
+		if((unsigned)tp->tap_id>=tap_listeners_by_id_len || !tap_listeners_by_id[tp->tap_id]){
+			/* Nobody is listening to this tap. */
+			continue;
+		}
+		for(tlp=tap_listeners_by_id[tp->tap_id];(tl=*tlp)!=NULL;tlp++){
 			/* Don't tap the packet if it's an "error packet"
 			 * unless the listener has requested that we do so.
 			 */
 			if (!(tp->flags & TAP_PACKET_IS_ERROR_PACKET) || (tl->flags & TL_REQUIRES_ERROR_PACKETS))
 			{
-				if(tp->tap_id==tl->tap_id){
-					if(!tl->packet){
-						/* There isn't a per-packet
-						 * routine for this tap.
-						 */
-						continue;
-					}
-					if(tl->failed){
-						/* A previous call failed,
-						 * meaning "stop running this
-						 * tap", so don't call the
-						 * packet routine.
-						 */
-						continue;
-					}
-
-					/* If we have a filter, see if the
-					 * packet passes.
+				if(!tl->packet){
+					/* There isn't a per-packet
+					 * routine for this tap.
 					 */
-					unsigned flags = tl->flags;
-					if((tl->flags & TL_LIMIT_TO_DISPLAY_FILTER) && main_filter) {
-
-						if (!dfilter_apply_edt(main_filter, edt)){
-							/* The packet didn't
-							 * pass the filter. */
-							if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
-								flags |= TL_DISPLAY_FILTER_IGNORED;
-							else
-								continue;
-						}
+					continue;
+				}
+				if(tl->failed){
+					/* A previous call failed,
+					 * meaning "stop running this
+					 * tap", so don't call the
+					 * packet routine.
+					 */
+					continue;
+				}
+
+				/* If we have a filter, see if the
+				 * packet passes.
+				 */
+				unsigned flags = tl->flags;
+				if((tl->flags & TL_LIMIT_TO_DISPLAY_FILTER) && main_filter) {
+
+					if(main_filter_verdict == TAP_FILTER_UNKNOWN){
+						main_filter_verdict = dfilter_apply_edt(main_filter, edt) ?
+						    TAP_FILTER_PASSED : TAP_FILTER_FAILED;
 					}
-					if(tl->code){
-						if (!dfilter_apply_edt(tl->code, edt)){
-							/* The packet didn't
-							 * pass the filter. */
-							if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
-								flags |= TL_DISPLAY_FILTER_IGNORED;
-							else
-								continue;
-						}
+					if (main_filter_verdict == TAP_FILTER_FAILED){
+						/* The packet didn't
+						 * pass the filter. */
+						if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
+							flags |= TL_DISPLAY_FILTER_IGNORED;
+						else
+							continue;
 					}
+				}
+				if(tl->code){
+					if (!tap_listener_filter_passes(tl, edt)){
+						/* The packet didn't
+						 * pass the filter. */
+						if (tl->flags & TL_IGNORE_DISPLAY_FILTER)
+							flags |= TL_DISPLAY_FILTER_IGNORED;
+						else
+							continue;
+					}
+				}
 
-					/* So call the per-packet routine. */
-					tap_packet_status status;
+				/* So call the per-packet routine. */
+				tap_packet_status status;
 
-					status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data, flags);
+				status = tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data, flags);
 
-					switch (status) {
+				switch (status) {
 
-					case TAP_PACKET_DONT_REDRAW:
-						break;
+				case TAP_PACKET_DONT_REDRAW:
+					break;
 
-					case TAP_PACKET_REDRAW:
-						tl->needs_redraw=true;
-						break;
+				case TAP_PACKET_REDRAW:
+					tl->needs_redraw=true;
+					break;
 
-					case TAP_PACKET_FAILED:
-						tl->failed=true;
-						break;
-					}
+				case TAP_PACKET_FAILED:
+					tl->failed=true;
+					break;
 				}
 			}
 		}
@@ -606,6 +750,7 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	tl->next=tap_listener_queue;
 
 	tap_listener_queue=tl;
+	rebuild_tap_listener_index();
 
 	return NULL;
 }
@@ -646,6 +791,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 		if(fstring){
 			if(!dfilter_compile(fstring, &code, &df_err)){
 				tl->fstring=NULL;
+				rebuild_tap_listener_index();
 				error_string = g_string_new("");
 				g_string_printf(error_string,
 						 "Filter \"%s\" is invalid - %s",
@@ -656,6 +802,7 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 		}
 		tl->fstring=g_strdup(fstring);
 		tl->code=code;
+		rebuild_tap_listener_index();
 	}
 
 	return NULL;
@@ -749,6 +896,7 @@ remove_tap_listener(void *tapdata)
 			return;
 		}
 	}
+	rebuild_tap_listener_index();
 	free_tap_listener(tl);
 }
 
@@ -799,16 +947,8 @@ tap_listeners_require_columns(void)
 bool
 have_tap_listener(int tap_id)
 {
-	tap_listener_t *tap_queue = tap_listener_queue;
-
-	while(tap_queue) {
-		if(tap_queue->tap_id == tap_id)
-			return true;
-
-		tap_queue = tap_queue->next;
-	}
-
-	return false;
+	return (unsigned)tap_id < tap_listeners_by_id_len &&
+	    tap_listeners_by_id[tap_id] != NULL;
 }
 
 /*
@@ -869,6 +1009,7 @@ void tap_cleanup(void)
 		free_tap_listener(elem_lq);
 	}
 	tap_listener_queue = NULL;
+	free_tap_listener_index();
 
 	while(head_dl){
 		elem_dl = head_dl;
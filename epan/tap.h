@@ -189,13 +189,13 @@ WS_DLL_PUBLIC void tap_build_interesting(epan_dissect_t *edt);
  *
  * @param edt The epan_dissect_t structure to prime with tap listener filters.
  */
-extern void tap_queue_init(epan_dissect_t *edt);
+WS_DLL_PUBLIC void tap_queue_init(epan_dissect_t *edt);
 
 /** this function is called after a packet has been fully dissected to push the tapped
  *  data to all extensions that has callbacks registered.
  * @param edt The epan_dissect_t structure containing the dissection data for the current packet.
  */
-extern void tap_push_tapped_queue(epan_dissect_t *edt);
+WS_DLL_PUBLIC void tap_push_tapped_queue(epan_dissect_t *edt);
 
 /**
  * @brief Resets all tap listeners.
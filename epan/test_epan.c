@@ -8,9 +8,36 @@
 
 #include "config.h"
 
+#include <stdio.h>
+#include <string.h>
+
+#include "dfilter_verdicts.h"
+#include "epan.h"
+#include "epan_dissect.h"
+#include "frame_data.h"
+#include "frame_data_index.h"
+#include "frame_data_sequence.h"
+#include "packet.h"
+#include "packet_info.h"
+#include "proto_data.h"
+#include "register.h"
 #include "strutil.h"
+#include "tap.h"
+#include "wmem_scopes.h"
+#include "dfilter/dfilter.h"
+#include "dfilter/dfunctions.h"
+#include <wiretap/wtap.h>
+#include <wsutil/file_util.h>
+#include <wsutil/filesystem.h>
+#include <wsutil/pint.h>
+#include <wsutil/time_util.h>
 #include <wsutil/utf8_entities.h>
 
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
 /*
  * FIXME: LABEL_LENGTH includes the nul byte terminator.
  * This is confusing but matches ITEM_LABEL_LENGTH.
@@ -74,8 +101,1128 @@ void test_label_escape_control(void)
     g_assert_cmpuint(pos, ==, strlen(dst));
 }
 
+static GPtrArray *tap_test_calls;
+
+static tap_packet_status
+tap_test_packet(void *tapdata, packet_info *pinfo _U_, epan_dissect_t *edt _U_,
+                const void *data _U_, tap_flags_t flags _U_)
+{
+    if (tap_test_calls)
+        g_ptr_array_add(tap_test_calls, tapdata);
+    return TAP_PACKET_DONT_REDRAW;
+}
+
+void test_tap_dispatch(void)
+{
+    packet_info pinfo;
+    int listeners[3];
+    int tap_a, tap_b, tap_c;
+
+    memset(&pinfo, 0, sizeof(pinfo));
+    tap_test_calls = g_ptr_array_new();
+
+    tap_a = register_tap("test_tap_a");
+    tap_b = register_tap("test_tap_b");
+    tap_c = register_tap("test_tap_c");
+
+    g_assert_null(register_tap_listener("test_tap_a", &listeners[0], NULL, 0, NULL, tap_test_packet, NULL, NULL));
+    g_assert_null(register_tap_listener("test_tap_b", &listeners[1], NULL, 0, NULL, tap_test_packet, NULL, NULL));
+    g_assert_null(register_tap_listener("test_tap_a", &listeners[2], NULL, 0, NULL, tap_test_packet, NULL, NULL));
+
+    g_assert_true(have_tap_listener(tap_a));
+    g_assert_true(have_tap_listener(tap_b));
+    g_assert_false(have_tap_listener(tap_c));
+
+    /* Packets go to the listeners of their tap, most recently registered first. */
+    tap_queue_init(NULL);
+    tap_queue_packet(tap_b, &pinfo, NULL);
+    tap_queue_packet(tap_c, &pinfo, NULL);
+    tap_queue_packet(tap_a, &pinfo, NULL);
+    tap_push_tapped_queue(NULL);
+    g_assert_cmpuint(tap_test_calls->len, ==, 3);
+    g_assert_true(g_ptr_array_index(tap_test_calls, 0) == &listeners[1]);
+    g_assert_true(g_ptr_array_index(tap_test_calls, 1) == &listeners[2]);
+    g_assert_true(g_ptr_array_index(tap_test_calls, 2) == &listeners[0]);
+
+    remove_tap_listener(&listeners[1]);
+    remove_tap_listener(&listeners[2]);
+    g_assert_false(have_tap_listener(tap_b));
+
+    g_ptr_array_set_size(tap_test_calls, 0);
+    tap_queue_init(NULL);
+    tap_queue_packet(tap_a, &pinfo, NULL);
+    tap_queue_packet(tap_b, &pinfo, NULL);
+    tap_push_tapped_queue(NULL);
+    g_assert_cmpuint(tap_test_calls->len, ==, 1);
+    g_assert_true(g_ptr_array_index(tap_test_calls, 0) == &listeners[0]);
+
+    remove_tap_listener(&listeners[0]);
+    g_assert_false(have_tap_listener(tap_a));
+
+    g_ptr_array_free(tap_test_calls, true);
+    tap_test_calls = NULL;
+}
+
+/* The number of times the filters below have been run; each run returns
+ * the new count, so a filter comparing it with 1 only passes the first
+ * time it is run for a packet. */
+static unsigned tap_test_filter_runs;
+
+static bool
+tap_test_filter_func(GSList *stack _U_, uint32_t arg_count _U_, df_cell_t *retval)
+{
+    fvalue_t *fv = fvalue_new(FT_UINT32);
+
+    fvalue_set_uinteger(fv, ++tap_test_filter_runs);
+    df_cell_append(retval, fv);
+    return true;
+}
+
+static ftenum_t
+tap_test_filter_semcheck(dfwork_t *dfw _U_, const char *func_name _U_,
+                         ftenum_t logical_ftype _U_, GSList *param_list _U_,
+                         df_loc_t func_loc _U_)
+{
+    return FT_UINT32;
+}
+
+static df_func_def_t tap_test_filter_def = {
+    "tap_test_filter_runs", tap_test_filter_func, 0, 0, FT_UINT32, tap_test_filter_semcheck
+};
+
+static unsigned
+tap_test_call_count(void *tapdata)
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < tap_test_calls->len; i++) {
+        if (g_ptr_array_index(tap_test_calls, i) == tapdata)
+            count++;
+    }
+    return count;
+}
+
+/* Push two tapped packets through the listeners of a tap, as one
+ * dissected packet. */
+static void
+tap_test_push_packet(epan_dissect_t *edt, int tap_id)
+{
+    tap_test_filter_runs = 0;
+    g_ptr_array_set_size(tap_test_calls, 0);
+    tap_queue_init(edt);
+    tap_queue_packet(tap_id, &edt->pi, NULL);
+    tap_queue_packet(tap_id, &edt->pi, NULL);
+    tap_push_tapped_queue(edt);
+}
+
+void test_tap_shared_filter(void)
+{
+    static const struct packet_provider_funcs funcs = { 0 };
+    epan_t *session;
+    epan_dissect_t *edt;
+    dfilter_t *main_filter;
+    df_error_t *df_err = NULL;
+    int listeners[4];
+    int tap_id;
+
+    g_assert_true(df_func_register(&tap_test_filter_def));
+    session = epan_new(NULL, &funcs);
+    edt = epan_dissect_new(session, true, false);
+    tap_test_calls = g_ptr_array_new();
+    tap_id = register_tap("test_tap_filter");
+
+    /* Listeners with the same filter string share one run of it, once
+     * per packet however many tapped packets there are, and all of them
+     * get its verdict. A different filter string is run on its own,
+     * after it, as its listener is the oldest. */
+    g_assert_null(register_tap_listener("test_tap_filter", &listeners[3], "tap_test_filter_runs() == 2", 0, NULL, tap_test_packet, NULL, NULL));
+    g_assert_null(register_tap_listener("test_tap_filter", &listeners[0], "tap_test_filter_runs() == 1", 0, NULL, tap_test_packet, NULL, NULL));
+    g_assert_null(register_tap_listener("test_tap_filter", &listeners[1], "tap_test_filter_runs() == 1", 0, NULL, tap_test_packet, NULL, NULL));
+    g_assert_null(register_tap_listener("test_tap_filter", &listeners[2], "tap_test_filter_runs() == 1", 0, NULL, tap_test_packet, NULL, NULL));
+    for (int packet = 0; packet < 2; packet++) {
+        tap_test_push_packet(edt, tap_id);
+        g_assert_cmpuint(tap_test_filter_runs, ==, 2);
+        g_assert_cmpuint(tap_test_call_count(&listeners[0]), ==, 2);
+        g_assert_cmpuint(tap_test_call_count(&listeners[1]), ==, 2);
+        g_assert_cmpuint(tap_test_call_count(&listeners[2]), ==, 2);
+        g_assert_cmpuint(tap_test_call_count(&listeners[3]), ==, 2);
+    }
+
+    /* The others keep sharing the filter when the listener that ran it
+     * goes away. */
+    remove_tap_listener(&listeners[2]);
+    remove_tap_listener(&listeners[3]);
+    tap_test_push_packet(edt, tap_id);
+    g_assert_cmpuint(tap_test_filter_runs, ==, 1);
+    g_assert_cmpuint(tap_test_call_count(&listeners[0]), ==, 2);
+    g_assert_cmpuint(tap_test_call_count(&listeners[1]), ==, 2);
+    remove_tap_listener(&listeners[0]);
+    remove_tap_listener(&listeners[1]);
+
+    /* The main display filter is also run once for all the listeners
+     * limited to it. */
+    g_assert_true(dfilter_compile("tap_test_filter_runs() == 1", &main_filter, &df_err));
+    tap_load_main_filter(main_filter);
+    g_assert_null(register_tap_listener("test_tap_filter", &listeners[0], NULL, TL_LIMIT_TO_DISPLAY_FILTER, NULL, tap_test_packet, NULL, NULL));
+    g_assert_null(register_tap_listener("test_tap_filter", &listeners[1], NULL, TL_LIMIT_TO_DISPLAY_FILTER, NULL, tap_test_packet, NULL, NULL));
+    tap_test_push_packet(edt, tap_id);
+    g_assert_cmpuint(tap_test_filter_runs, ==, 1);
+    g_assert_cmpuint(tap_test_call_count(&listeners[0]), ==, 2);
+    g_assert_cmpuint(tap_test_call_count(&listeners[1]), ==, 2);
+    remove_tap_listener(&listeners[0]);
+    remove_tap_listener(&listeners[1]);
+    tap_load_main_filter(NULL);
+    dfilter_free(main_filter);
+
+    g_ptr_array_free(tap_test_calls, true);
+    tap_test_calls = NULL;
+    epan_dissect_free(edt);
+    epan_free(session);
+    df_func_deregister(&tap_test_filter_def);
+}
+
+void test_dfilter_narrowing(void)
+{
+    /* A conjunct appended with either spelling of "and". */
+    g_assert_true(dfilter_is_narrowing_of("tcp && tcp.port == 443", "tcp"));
+    g_assert_true(dfilter_is_narrowing_of("tcp and udp", "tcp"));
+    g_assert_true(dfilter_is_narrowing_of("tcp AND udp", "tcp"));
+    g_assert_true(dfilter_is_narrowing_of("tcp&&udp", "tcp"));
+    g_assert_false(dfilter_is_narrowing_of("tcp andudp", "tcp"));
+    g_assert_false(dfilter_is_narrowing_of("tcp.port == 443", "tcp"));
+    g_assert_false(dfilter_is_narrowing_of("tcp || udp", "tcp"));
+    g_assert_false(dfilter_is_narrowing_of("udp && tcp", "tcp"));
+    g_assert_false(dfilter_is_narrowing_of("tcp", "tcp && udp"));
+
+    /* The broader filter in parentheses. */
+    g_assert_true(dfilter_is_narrowing_of("(tcp || udp) && ip", "tcp || udp"));
+    g_assert_true(dfilter_is_narrowing_of("(tcp || udp) and ip", "tcp || udp"));
+
+    /* "&&" binds tighter than "||", so this is "tcp || (udp && ip)". */
+    g_assert_false(dfilter_is_narrowing_of("tcp || udp && ip", "tcp || udp"));
+    g_assert_true(dfilter_is_narrowing_of("tcp && udp && ip", "tcp && udp"));
+
+    /* Everything narrows no filter, nothing narrows a filter by adding
+     * nothing or something that isn't a filter. */
+    g_assert_true(dfilter_is_narrowing_of("tcp", ""));
+    g_assert_false(dfilter_is_narrowing_of("tcp && ", "tcp"));
+    g_assert_false(dfilter_is_narrowing_of("tcp && (", "tcp"));
+}
+
+/* A capture file of sorts for the verdict tests: the frame the filters
+ * are looking at, and which of the frames are ignored or commented. */
+#define VERDICT_TEST_FRAMES 20
+static uint32_t verdict_test_frame;
+static bool verdict_test_ignored[VERDICT_TEST_FRAMES + 1];
+static bool verdict_test_commented[VERDICT_TEST_FRAMES + 1];
+static unsigned verdict_test_dissected;
+
+static bool
+verdict_test_frame_func(GSList *stack _U_, uint32_t arg_count _U_, df_cell_t *retval)
+{
+    fvalue_t *fv = fvalue_new(FT_UINT32);
+
+    fvalue_set_uinteger(fv, verdict_test_frame);
+    df_cell_append(retval, fv);
+    return true;
+}
+
+static bool
+verdict_test_comment_func(GSList *stack _U_, uint32_t arg_count _U_, df_cell_t *retval)
+{
+    fvalue_t *fv = fvalue_new(FT_UINT32);
+
+    fvalue_set_uinteger(fv, verdict_test_commented[verdict_test_frame]);
+    df_cell_append(retval, fv);
+    return true;
+}
+
+static df_func_def_t verdict_test_frame_def = {
+    "verdict_test_frame", verdict_test_frame_func, 0, 0, FT_UINT32, tap_test_filter_semcheck
+};
+
+static df_func_def_t verdict_test_comment_def = {
+    "verdict_test_comment", verdict_test_comment_func, 0, 0, FT_UINT32, tap_test_filter_semcheck
+};
+
+/*
+ * Filter the frames the way rescan_packets() in file.c does, using the
+ * verdicts in "cache" if there are any that apply and storing the new
+ * ones, and stopping after "stop_after" frames if that isn't 0. Returns
+ * the frames displayed, one bit each.
+ */
+static uint32_t
+verdict_test_rescan(epan_dissect_t *edt, dfilter_verdict_cache *cache,
+                    const char *text, uint32_t stop_after)
+{
+    df_error_t *df_err = NULL;
+    dfilter_t *df = NULL;
+    const dfilter_verdicts *known;
+    dfilter_verdicts *verdicts;
+    bool exact = false;
+    bool passed;
+    uint32_t displayed = 0;
+
+    g_assert_true(dfilter_compile(text, &df, &df_err));
+    known = dfilter_verdict_cache_find(cache, text, &exact);
+    verdicts = dfilter_verdicts_new(text, VERDICT_TEST_FRAMES);
+    for (uint32_t framenum = 1; framenum <= VERDICT_TEST_FRAMES; framenum++) {
+        if (stop_after != 0 && framenum > stop_after)
+            break;
+        if (known == NULL || !dfilter_verdicts_lookup(known, exact, framenum, &passed)) {
+            verdict_test_dissected++;
+            verdict_test_frame = framenum;
+            passed = !verdict_test_ignored[framenum] &&
+                     (df == NULL || dfilter_apply_edt(df, edt));
+        }
+        if (passed)
+            displayed |= 1U << framenum;
+        dfilter_verdicts_add(verdicts, framenum, passed);
+    }
+    dfilter_verdict_cache_store(cache, verdicts);
+    dfilter_free(df);
+    return displayed;
+}
+
+/* The frames a full rescan displays, without any known verdicts. */
+static uint32_t
+verdict_test_full_rescan(epan_dissect_t *edt, const char *text)
+{
+    dfilter_verdict_cache *cache = dfilter_verdict_cache_new();
+    uint32_t displayed = verdict_test_rescan(edt, cache, text, 0);
+
+    dfilter_verdict_cache_free(cache);
+    return displayed;
+}
+
+void test_dfilter_verdict_reuse(void)
+{
+    static const struct packet_provider_funcs funcs = { 0 };
+    static const char broad[] = "verdict_test_frame() % 2 == 0";
+    static const char narrow[] = "verdict_test_frame() % 2 == 0 && verdict_test_frame() > 6";
+    static const char either[] = "verdict_test_frame() % 2 == 0 || verdict_test_frame() == 5";
+    static const char trap[] = "verdict_test_frame() % 2 == 0 || verdict_test_frame() == 5 && verdict_test_frame() > 6";
+    static const char commented[] = "verdict_test_comment() == 1";
+    epan_t *session;
+    epan_dissect_t *edt;
+    dfilter_verdict_cache *cache;
+    uint32_t full_broad, full_narrow;
+
+    g_assert_true(df_func_register(&verdict_test_frame_def));
+    g_assert_true(df_func_register(&verdict_test_comment_def));
+    session = epan_new(NULL, &funcs);
+    edt = epan_dissect_new(session, true, false);
+    memset(verdict_test_ignored, 0, sizeof(verdict_test_ignored));
+    memset(verdict_test_commented, 0, sizeof(verdict_test_commented));
+    verdict_test_commented[3] = true;
+
+    full_broad = verdict_test_full_rescan(edt, broad);
+    full_narrow = verdict_test_full_rescan(edt, narrow);
+    g_assert_cmpuint(full_broad, ==, 0x155554);
+    g_assert_cmpuint(full_narrow, ==, 0x155500);
+    cache = dfilter_verdict_cache_new();
+
+    /* Reapplying a filter doesn't dissect anything. */
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad);
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad);
+    g_assert_cmpuint(verdict_test_dissected, ==, 0);
+
+    /* Narrowing it only dissects the frames that passed it. */
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, narrow, 0), ==, full_narrow);
+    g_assert_cmpuint(verdict_test_dissected, ==, VERDICT_TEST_FRAMES / 2);
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, narrow, 0), ==, full_narrow);
+    g_assert_cmpuint(verdict_test_dissected, ==, 0);
+
+    /* Something that only looks like narrowing a filter dissects
+     * everything, as "&&" binds tighter than "||". */
+    verdict_test_rescan(edt, cache, either, 0);
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, trap, 0), ==, full_broad);
+    g_assert_cmpuint(verdict_test_dissected, ==, VERDICT_TEST_FRAMES);
+
+    /* The verdicts of an aborted rescan are used as far as they go, and
+     * don't replace the complete ones. */
+    dfilter_verdict_cache_clear(cache);
+    verdict_test_rescan(edt, cache, broad, 7);
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, narrow, 0), ==, full_narrow);
+    g_assert_cmpuint(verdict_test_dissected, ==, 3 + VERDICT_TEST_FRAMES - 7);
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad);
+    g_assert_cmpuint(verdict_test_dissected, ==, VERDICT_TEST_FRAMES - 7);
+    verdict_test_rescan(edt, cache, broad, 5);
+    verdict_test_dissected = 0;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad);
+    g_assert_cmpuint(verdict_test_dissected, ==, 0);
+
+    /*
+     * Ignoring a frame, unignoring it and editing comments change what
+     * the filters see without redissecting, so the known verdicts are
+     * wrong until the cache is cleared, as file.c does.
+     */
+    verdict_test_ignored[8] = true;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, narrow, 0), ==, full_narrow);
+    g_assert_cmpuint(verdict_test_full_rescan(edt, narrow), ==, full_narrow & ~(1U << 8));
+    dfilter_verdict_cache_clear(cache);
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, narrow, 0), ==, full_narrow & ~(1U << 8));
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad & ~(1U << 8));
+
+    verdict_test_ignored[8] = false;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad & ~(1U << 8));
+    dfilter_verdict_cache_clear(cache);
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, broad, 0), ==, full_broad);
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, narrow, 0), ==, full_narrow);
+
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, commented, 0), ==, 1U << 3);
+    verdict_test_commented[3] = false;
+    verdict_test_commented[12] = true;
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, commented, 0), ==, 1U << 3);
+    dfilter_verdict_cache_clear(cache);
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, commented, 0), ==, 1U << 12);
+    g_assert_cmpuint(verdict_test_rescan(edt, cache, commented, 0), ==,
+                     verdict_test_full_rescan(edt, commented));
+
+    dfilter_verdict_cache_free(cache);
+    epan_dissect_free(edt);
+    epan_free(session);
+    df_func_deregister(&verdict_test_comment_def);
+    df_func_deregister(&verdict_test_frame_def);
+}
+
+void test_proto_data(void)
+{
+    packet_info pinfo;
+    frame_data fd;
+    int values[64];
+
+    memset(&pinfo, 0, sizeof(pinfo));
+    memset(&fd, 0, sizeof(fd));
+    pinfo.pool = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+    pinfo.fd = &fd;
+
+    g_assert_null(p_get_proto_data(pinfo.pool, &pinfo, 1, 0));
+
+    /* The most recently added entry wins, before and after the entries
+     * outgrow the inline array. */
+    for (int i = 0; i < 64; i++) {
+        p_add_proto_data(pinfo.pool, &pinfo, i % 3, i % 2, &values[i]);
+        g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, i % 3, i % 2) == &values[i]);
+    }
+    g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, 1, 0) == &values[58]);
+    g_assert_null(p_get_proto_data(pinfo.pool, &pinfo, 3, 0));
+
+    /* Removing an entry uncovers the one added before it. */
+    p_remove_proto_data(pinfo.pool, &pinfo, 0, 1);
+    g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, 0, 1) == &values[57]);
+
+    /* Setting replaces the most recent entry, or adds one. */
+    p_set_proto_data(pinfo.pool, &pinfo, 0, 1, &values[0]);
+    g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, 0, 1) == &values[0]);
+    p_remove_proto_data(pinfo.pool, &pinfo, 0, 1);
+    g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, 0, 1) == &values[51]);
+    p_set_proto_data(pinfo.pool, &pinfo, 7, 7, &values[1]);
+    g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, 7, 7) == &values[1]);
+
+    /* Packet and file scope data are kept apart. */
+    wmem_enter_file_scope();
+    g_assert_null(p_get_proto_data(wmem_file_scope(), &pinfo, 7, 7));
+    p_add_proto_data(wmem_file_scope(), &pinfo, 7, 7, &values[2]);
+    g_assert_true(p_get_proto_data(wmem_file_scope(), &pinfo, 7, 7) == &values[2]);
+    g_assert_true(p_get_proto_data(pinfo.pool, &pinfo, 7, 7) == &values[1]);
+    p_remove_proto_data(wmem_file_scope(), &pinfo, 7, 7);
+    g_assert_null(p_get_proto_data(wmem_file_scope(), &pinfo, 7, 7));
+    wmem_leave_file_scope();
+
+    wmem_destroy_allocator(pinfo.pool);
+}
+
+/* NOTE: You have to run "test_epan -m perf" to run the performance tests. */
+void test_tap_dispatch_perf(void)
+{
+#define TAP_PERF_TAPS       64
+#define TAP_PERF_QUEUED     8
+#define TAP_PERF_PACKETS    (1000 * 1000)
+    packet_info pinfo;
+    int listeners[TAP_PERF_TAPS];
+    int tap_ids[TAP_PERF_TAPS];
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    memset(&pinfo, 0, sizeof(pinfo));
+
+    /* One listener on each of many taps, as with many -z options. */
+    for (int i = 0; i < TAP_PERF_TAPS; i++) {
+        char *name = g_strdup_printf("test_tap_perf_%d", i);
+        tap_ids[i] = register_tap(name);
+        g_assert_null(register_tap_listener(name, &listeners[i], NULL, 0, NULL, tap_test_packet, NULL, NULL));
+        g_free(name);
+    }
+
+    get_resource_usage(&start_utime, &start_stime);
+    for (int i = 0; i < TAP_PERF_PACKETS; i++) {
+        tap_queue_init(NULL);
+        for (int j = 0; j < TAP_PERF_QUEUED; j++) {
+            tap_queue_packet(tap_ids[(i + j) % TAP_PERF_TAPS], &pinfo, NULL);
+        }
+        tap_push_tapped_queue(NULL);
+    }
+    get_resource_usage(&end_utime, &end_stime);
+    utime_ms = (end_utime - start_utime) * 1000.0;
+    stime_ms = (end_stime - start_stime) * 1000.0;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "tap dispatch, %d listeners, %d packets: u %.3f ms s %.3f ms",
+        TAP_PERF_TAPS, TAP_PERF_PACKETS, utime_ms, stime_ms);
+
+    for (int i = 0; i < TAP_PERF_TAPS; i++) {
+        remove_tap_listener(&listeners[i]);
+    }
+}
+
+void test_proto_data_perf(void)
+{
+#define PROTO_DATA_PERF_FRAMES  (100 * 1000)
+#define PROTO_DATA_PERF_LAYERS  12
+#define PROTO_DATA_PERF_PASSES  10
+    packet_info pinfo;
+    frame_data *frames;
+    double start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+    uintptr_t sum = 0;
+
+    wmem_enter_file_scope();
+    memset(&pinfo, 0, sizeof(pinfo));
+    pinfo.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    frames = g_new0(frame_data, PROTO_DATA_PERF_FRAMES);
+
+    /*
+     * A deep stack (Ethernet, VLANs, IP, UDP, QUIC, HTTP/3, ...) where
+     * every layer keeps two items of file scope data per frame on the
+     * first pass, and looks them up, along with one it never set, on
+     * every pass.
+     */
+    get_resource_usage(&start_utime, &start_stime);
+    for (int pass = 0; pass < PROTO_DATA_PERF_PASSES; pass++) {
+        for (int i = 0; i < PROTO_DATA_PERF_FRAMES; i++) {
+            pinfo.fd = &frames[i];
+            pinfo.proto_data = NULL;
+            for (int layer = 0; layer < PROTO_DATA_PERF_LAYERS; layer++) {
+                if (pass == 0) {
+                    p_add_proto_data(wmem_file_scope(), &pinfo, layer, 0, GINT_TO_POINTER(i + 1));
+                    p_add_proto_data(wmem_file_scope(), &pinfo, layer, 1, GINT_TO_POINTER(layer + 1));
+                }
+                p_set_proto_depth(&pinfo, layer, layer);
+                sum += (uintptr_t)p_get_proto_data(wmem_file_scope(), &pinfo, layer, 0);
+                sum += (uintptr_t)p_get_proto_data(wmem_file_scope(), &pinfo, layer, 1);
+                sum += (uintptr_t)p_get_proto_data(wmem_file_scope(), &pinfo, layer, 2);
+                sum += p_get_proto_depth(&pinfo, layer);
+            }
+            wmem_free_all(pinfo.pool);
+        }
+    }
+    get_resource_usage(&end_utime, &end_stime);
+    utime_ms = (end_utime - start_utime) * 1000.0;
+    stime_ms = (end_stime - start_stime) * 1000.0;
+    g_assert_cmpuint(sum, >, 0);
+    g_test_minimized_result(utime_ms + stime_ms,
+        "proto data, %d frames, %d layers, %d passes: u %.3f ms s %.3f ms",
+        PROTO_DATA_PERF_FRAMES, PROTO_DATA_PERF_LAYERS, PROTO_DATA_PERF_PASSES,
+        utime_ms, stime_ms);
+
+    g_free(frames);
+    wmem_destroy_allocator(pinfo.pool);
+    wmem_leave_file_scope();
+}
+
+#define INDEX_PACKETS      3
+#define INDEX_PACKET_LEN   64
+
+static uint8_t index_packet_byte(unsigned packet, unsigned i)
+{
+    return (uint8_t)(packet * 31 + i);
+}
+
+/* Write a small pcap file to index. */
+static char *write_index_capture(void)
+{
+    uint32_t magic = 0xa1b2c3d4, snaplen = 65535, network = 1;
+    uint16_t version_major = 2, version_minor = 4;
+    int32_t thiszone = 0;
+    uint32_t sigfigs = 0;
+    uint8_t data[INDEX_PACKET_LEN];
+    char *path;
+    FILE *fh;
+    int fd;
+
+    fd = g_file_open_tmp("test_epan_XXXXXX.pcap", &path, NULL);
+    g_assert_cmpint(fd, !=, -1);
+    fh = ws_fdopen(fd, "wb");
+    g_assert_nonnull(fh);
+    fwrite(&magic, sizeof magic, 1, fh);
+    fwrite(&version_major, sizeof version_major, 1, fh);
+    fwrite(&version_minor, sizeof version_minor, 1, fh);
+    fwrite(&thiszone, sizeof thiszone, 1, fh);
+    fwrite(&sigfigs, sizeof sigfigs, 1, fh);
+    fwrite(&snaplen, sizeof snaplen, 1, fh);
+    fwrite(&network, sizeof network, 1, fh);
+    for (unsigned packet = 0; packet < INDEX_PACKETS; packet++) {
+        uint32_t rec_hdr[4] = { packet, 0, INDEX_PACKET_LEN, INDEX_PACKET_LEN };
+
+        for (unsigned i = 0; i < INDEX_PACKET_LEN; i++)
+            data[i] = index_packet_byte(packet, i);
+        fwrite(rec_hdr, sizeof rec_hdr, 1, fh);
+        fwrite(data, sizeof data, 1, fh);
+    }
+    g_assert_cmpint(fclose(fh), ==, 0);
+    return path;
+}
+
+static void check_index_packet(const wtap_rec *rec, unsigned packet)
+{
+    const uint8_t *data = ws_buffer_start_ptr(&rec->data);
+
+    g_assert_cmpuint(ws_buffer_length(&rec->data), ==, INDEX_PACKET_LEN);
+    for (unsigned i = 0; i < INDEX_PACKET_LEN; i++)
+        g_assert_cmpuint(data[i], ==, index_packet_byte(packet, i));
+}
+
+/* Read a capture file sequentially into frames, and index it. */
+static frame_data_sequence *index_capture(const char *path)
+{
+    frame_data_index_summary summary;
+    frame_data_sequence *fds;
+    frame_data fdlocal;
+    wtap *wth;
+    wtap_rec rec;
+    int64_t offset;
+    uint32_t count = 0;
+    int linktype = 1;
+    int err;
+    char *err_info;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    fds = new_frame_data_sequence();
+    wtap_rec_init(&rec, 0);
+    while (wtap_read(wth, &rec, &err, &err_info, &offset)) {
+        frame_data_init(&fdlocal, count + 1, &rec, offset, 0);
+        frame_data_sequence_add(fds, &fdlocal);
+        count++;
+        wtap_rec_reset(&rec);
+    }
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(count, ==, INDEX_PACKETS);
+
+    summary.linktypes = g_array_new(false, false, sizeof(int));
+    g_array_append_val(summary.linktypes, linktype);
+    summary.packet_comment_count = 2;
+    summary.drops_known = true;
+    summary.drops = 7;
+    g_assert_true(frame_data_index_write(wth, path, fds, count, &summary));
+    g_array_free(summary.linktypes, true);
+
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    return fds;
+}
+
+static bool index_exists(const char *path)
+{
+    char *index_path = g_strconcat(path, FRAME_DATA_INDEX_SUFFIX, NULL);
+    bool exists = g_file_test(index_path, G_FILE_TEST_EXISTS);
+
+    g_free(index_path);
+    return exists;
+}
+
+static void remove_indexed_capture(const char *path)
+{
+    char *index_path = g_strconcat(path, FRAME_DATA_INDEX_SUFFIX, NULL);
+
+    ws_unlink(index_path);
+    ws_unlink(path);
+    g_free(index_path);
+}
+
+/* Read a capture file through its index, as cf_read() does, and check
+   that the records come back in order with the given time stamps. */
+static void check_index_read(const char *path, const frame_data_sequence *fds,
+                             uint32_t first_changed, bool current)
+{
+    frame_data_index *idx;
+    wtap *wth;
+    wtap_rec rec;
+    int64_t offset;
+    int err;
+    char *err_info;
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    idx = frame_data_index_open(wth, path);
+    g_assert_nonnull(idx);
+    wtap_rec_init(&rec, 0);
+    for (uint32_t packet = 0; packet < INDEX_PACKETS; packet++) {
+        g_assert_true(frame_data_index_read(idx, wth, &rec, &err, &err_info, &offset));
+        g_assert_cmpint(offset, ==, frame_data_sequence_find((frame_data_sequence *)fds, packet + 1)->file_off);
+        g_assert_cmpint(rec.ts.secs, ==, packet < first_changed ? packet : 1000 + packet);
+        check_index_packet(&rec, packet);
+        wtap_rec_reset(&rec);
+    }
+    g_assert_false(frame_data_index_read(idx, wth, &rec, &err, &err_info, &offset));
+    g_assert_cmpint(err, ==, 0);
+    g_assert_true(frame_data_index_is_current(idx) == current);
+    g_assert_true(index_exists(path) == current);
+    frame_data_index_close(idx);
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+}
+
+void test_frame_data_index(void)
+{
+    frame_data_index_summary summary;
+    frame_data_sequence *fds;
+    frame_data_index *idx;
+    frame_data fdlocal, *fdata;
+    wtap *wth;
+    int err;
+    char *err_info;
+    char *path;
+
+    path = write_index_capture();
+    fds = index_capture(path);
+
+    /* The frames can be set up from the index alone... */
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    idx = frame_data_index_open(wth, path);
+    g_assert_nonnull(idx);
+    g_assert_cmpuint(frame_data_index_count(idx), ==, INDEX_PACKETS);
+    g_assert_true(frame_data_index_verify(idx, wth));
+    summary.linktypes = g_array_new(false, false, sizeof(int));
+    g_assert_true(frame_data_index_get_summary(idx, &summary));
+    g_assert_cmpuint(summary.linktypes->len, ==, 1);
+    g_assert_cmpint(g_array_index(summary.linktypes, int, 0), ==, 1);
+    g_assert_cmpuint(summary.packet_comment_count, ==, 2);
+    g_assert_true(summary.drops_known);
+    g_assert_cmpuint(summary.drops, ==, 7);
+    g_array_free(summary.linktypes, true);
+    for (uint32_t framenum = 1; framenum <= INDEX_PACKETS; framenum++) {
+        g_assert_true(frame_data_index_next_frame(idx, &fdlocal, 0));
+        fdata = frame_data_sequence_find(fds, framenum);
+        g_assert_cmpuint(fdlocal.num, ==, framenum);
+        g_assert_cmpint(fdlocal.file_off, ==, fdata->file_off);
+        g_assert_cmpuint(fdlocal.pkt_len, ==, fdata->pkt_len);
+        g_assert_cmpuint(fdlocal.cap_len, ==, fdata->cap_len);
+        g_assert_cmpuint(fdlocal.has_ts, ==, fdata->has_ts);
+        g_assert_cmpuint(fdlocal.tsprec, ==, fdata->tsprec);
+        g_assert_true(nstime_cmp(&fdlocal.abs_ts, &fdata->abs_ts) == 0);
+    }
+    g_assert_false(frame_data_index_next_frame(idx, &fdlocal, 0));
+    frame_data_index_close(idx);
+    wtap_close(wth);
+
+    /* ...or used to read the records. */
+    check_index_read(path, fds, INDEX_PACKETS, true);
+
+    free_frame_data_sequence(fds);
+    remove_indexed_capture(path);
+    g_free(path);
+}
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+static void set_mtime(const char *path, const struct timespec *mtime)
+{
+    struct timespec times[2] = { { 0, UTIME_OMIT }, *mtime };
+
+    g_assert_cmpint(utimensat(AT_FDCWD, path, times, 0), ==, 0);
+}
+
+/* Change the time stamps of the packets from first on without changing
+   the size or the modification time of the file. */
+static void rewrite_capture_times(const char *path, uint32_t first)
+{
+    ws_statb64 st;
+    FILE *fh;
+
+    g_assert_cmpint(ws_stat64(path, &st), ==, 0);
+    fh = ws_fopen(path, "r+b");
+    g_assert_nonnull(fh);
+    for (uint32_t packet = first; packet < INDEX_PACKETS; packet++) {
+        uint32_t ts_sec = 1000 + packet;
+
+        g_assert_cmpint(fseek(fh, 24 + packet * (16 + INDEX_PACKET_LEN), SEEK_SET), ==, 0);
+        fwrite(&ts_sec, sizeof ts_sec, 1, fh);
+    }
+    g_assert_cmpint(fclose(fh), ==, 0);
+    set_mtime(path, &st.st_mtim);
+}
+
+void test_frame_data_index_mtime(void)
+{
+    frame_data_sequence *fds;
+    struct timespec mtime;
+    ws_statb64 st;
+    wtap *wth;
+    int err;
+    char *err_info;
+    char *path;
+
+    path = write_index_capture();
+    fds = index_capture(path);
+
+    /* A change of the modification time by a nanosecond makes the index
+       out of date, if the file system keeps nanoseconds. */
+    g_assert_cmpint(ws_stat64(path, &st), ==, 0);
+    mtime = st.st_mtim;
+    mtime.tv_nsec = mtime.tv_nsec < 999999999 ? mtime.tv_nsec + 1 : mtime.tv_nsec - 1;
+    set_mtime(path, &mtime);
+    g_assert_cmpint(ws_stat64(path, &st), ==, 0);
+    if (st.st_mtim.tv_nsec == mtime.tv_nsec) {
+        wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+        g_assert_nonnull(wth);
+        g_assert_null(frame_data_index_open(wth, path));
+        wtap_close(wth);
+    }
+
+    free_frame_data_sequence(fds);
+    remove_indexed_capture(path);
+    g_free(path);
+}
+
+void test_frame_data_index_mismatch(void)
+{
+    frame_data_sequence *fds;
+    frame_data_index *idx;
+    frame_data fdlocal;
+    wtap *wth;
+    int err;
+    char *err_info;
+    char *path;
+
+    path = write_index_capture();
+
+    /* A file rewritten behind the index's back fails the check of a
+       sample of its records, and is then read sequentially. */
+    fds = index_capture(path);
+    rewrite_capture_times(path, 1);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    idx = frame_data_index_open(wth, path);
+    g_assert_nonnull(idx);
+    g_assert_false(frame_data_index_verify(idx, wth));
+    g_assert_false(frame_data_index_is_current(idx));
+    g_assert_false(index_exists(path));
+    g_assert_false(frame_data_index_next_frame(idx, &fdlocal, 0));
+    frame_data_index_close(idx);
+    wtap_close(wth);
+    free_frame_data_sequence(fds);
+    remove_indexed_capture(path);
+    g_free(path);
+
+    /* A record that doesn't match while reading through the index makes
+       the reader go on sequentially from the record after the last one
+       it returned. */
+    path = write_index_capture();
+    fds = index_capture(path);
+    rewrite_capture_times(path, INDEX_PACKETS - 1);
+    check_index_read(path, fds, INDEX_PACKETS - 1, false);
+    free_frame_data_sequence(fds);
+
+    remove_indexed_capture(path);
+    g_free(path);
+}
+#endif /* HAVE_STRUCT_STAT_ST_MTIM */
+
+#define FIRST_PASS_PACKETS  40
+#define FIRST_PASS_PAYLOAD  100
+#define FIRST_PASS_FRAME    (14 + 20 + 20 + FIRST_PASS_PAYLOAD)
+
+/* Write a pcap file of one TCP stream in which every seventh segment is
+ * a retransmission, which only the first pass of the TCP dissector can
+ * tell. */
+static char *write_first_pass_capture(void)
+{
+    static const uint8_t eth_ip_hdr[14 + 12] = {
+        0x00, 0x00, 0x5e, 0x00, 0x53, 0x02, 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01, 0x08, 0x00,
+        0x45, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00,
+    };
+    uint32_t magic = 0xa1b2c3d4, snaplen = 65535, network = 1;
+    uint16_t version_major = 2, version_minor = 4;
+    int32_t thiszone = 0;
+    uint32_t sigfigs = 0;
+    uint8_t frame[FIRST_PASS_FRAME];
+    uint8_t *ip = frame + 14, *tcp = ip + 20;
+    uint32_t seq = 1000;
+    char *path;
+    FILE *fh;
+    int fd;
+
+    fd = g_file_open_tmp("test_epan_XXXXXX.pcap", &path, NULL);
+    g_assert_cmpint(fd, !=, -1);
+    fh = ws_fdopen(fd, "wb");
+    g_assert_nonnull(fh);
+    fwrite(&magic, sizeof magic, 1, fh);
+    fwrite(&version_major, sizeof version_major, 1, fh);
+    fwrite(&version_minor, sizeof version_minor, 1, fh);
+    fwrite(&thiszone, sizeof thiszone, 1, fh);
+    fwrite(&sigfigs, sizeof sigfigs, 1, fh);
+    fwrite(&snaplen, sizeof snaplen, 1, fh);
+    fwrite(&network, sizeof network, 1, fh);
+    memset(frame, 'x', sizeof frame);
+    memcpy(frame, eth_ip_hdr, sizeof eth_ip_hdr);
+    phtonu16(ip + 2, 20 + 20 + FIRST_PASS_PAYLOAD);
+    phtonu32(ip + 12, 0xc0000201);  /* 192.0.2.1 */
+    phtonu32(ip + 16, 0xc0000202);  /* 192.0.2.2 */
+    phtonu16(tcp, 40000);
+    phtonu16(tcp + 2, 40001);
+    phtonu32(tcp + 8, 1);
+    phtonu16(tcp + 12, 0x5018);     /* 20 byte header, PSH and ACK */
+    phtonu16(tcp + 14, 65535);
+    phtonu16(tcp + 16, 0);
+    phtonu16(tcp + 18, 0);
+    for (unsigned packet = 0; packet < FIRST_PASS_PACKETS; packet++) {
+        uint32_t rec_hdr[4] = { packet, 0, FIRST_PASS_FRAME, FIRST_PASS_FRAME };
+
+        if (packet % 7 == 6)
+            seq -= FIRST_PASS_PAYLOAD;
+        phtonu16(ip + 4, (uint16_t)packet);
+        phtonu32(tcp + 4, seq);
+        seq += FIRST_PASS_PAYLOAD;
+        fwrite(rec_hdr, sizeof rec_hdr, 1, fh);
+        fwrite(frame, sizeof frame, 1, fh);
+    }
+    g_assert_cmpint(fclose(fh), ==, 0);
+    return path;
+}
+
+static GArray *first_pass_tapped;
+static unsigned first_pass_postseq_calls;
+
+static tap_packet_status
+first_pass_tap_packet(void *tapdata _U_, packet_info *pinfo, epan_dissect_t *edt _U_,
+                      const void *data _U_, tap_flags_t flags _U_)
+{
+    g_array_append_val(first_pass_tapped, pinfo->num);
+    return TAP_PACKET_DONT_REDRAW;
+}
+
+static void
+first_pass_postseq_cleanup(void)
+{
+    first_pass_postseq_calls++;
+}
+
+/* Append the abbreviations and labels of a protocol tree, depth first. */
+static void
+first_pass_tree_text(proto_node *node, void *data)
+{
+    GString *text = (GString *)data;
+    field_info *fi = PNODE_FINFO(node);
+    char label[ITEM_LABEL_LENGTH];
+
+    if (fi != NULL) {
+        if (fi->rep != NULL)
+            (void) g_strlcpy(label, fi->rep->representation, sizeof label);
+        else
+            proto_item_fill_label(fi, label, NULL);
+        g_string_append_printf(text, "%s: %s\n", fi->hfinfo->abbrev, label);
+    }
+    proto_tree_children_foreach(node, first_pass_tree_text, data);
+}
+
+/* Load a capture file into frames, as cf_read() does, either dissecting
+ * each record as it's read or setting the frames up from a scan of the
+ * file and running the first pass afterwards, the latter in pieces as
+ * the GUI may; then check that the taps saw every frame once, in order,
+ * that the postseq_cleanup routines were called once the first pass was
+ * done, and return the protocol trees of the frames. */
+static GPtrArray *first_pass_load(const char *path, bool deferred)
+{
+    static const struct packet_provider_funcs funcs = { 0 };
+    epan_t *session;
+    epan_dissect_t edt;
+    frame_data_sequence *fds;
+    frame_data_index *idx;
+    frame_data fdlocal, *fdata;
+    const frame_data *ref = NULL, *prev_dis = NULL;
+    nstime_t elapsed_time = NSTIME_INIT_ZERO;
+    uint32_t cum_bytes = 0, count = 0, next;
+    GPtrArray *trees;
+    GString *text;
+    wtap *wth;
+    wtap_rec rec;
+    int64_t offset;
+    int file_type_subtype;
+    int err;
+    char *err_info;
+
+    session = epan_new(NULL, &funcs);
+    first_pass_tapped = g_array_new(false, false, sizeof(uint32_t));
+    first_pass_postseq_calls = 0;
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    file_type_subtype = wtap_file_type_subtype(wth);
+    fds = new_frame_data_sequence();
+    wtap_rec_init(&rec, 0);
+
+    if (deferred) {
+        idx = frame_data_index_scan(wth, 2);
+        g_assert_nonnull(idx);
+        while (frame_data_index_next_frame(idx, &fdlocal, cum_bytes)) {
+            fdata = frame_data_sequence_add(fds, &fdlocal);
+            count++;
+            frame_data_set_before_dissect(fdata, &elapsed_time, &ref, prev_dis);
+            frame_data_set_after_dissect(fdata, &cum_bytes);
+            prev_dis = fdata;
+        }
+        g_assert_false(frame_data_index_read(idx, wth, &rec, &err, &err_info, &offset));
+        g_assert_cmpint(err, ==, 0);
+        frame_data_index_close(idx);
+        g_assert_cmpuint(count, ==, FIRST_PASS_PACKETS);
+        g_assert_cmpuint(first_pass_tapped->len, ==, 0);
+
+        /* Up to a frame in the middle... */
+        next = 1;
+        g_assert_true(frame_data_index_first_pass(session, file_type_subtype, wth, fds,
+                count, &next, count / 2, NULL, NULL, &err, &err_info));
+        g_assert_cmpuint(next, ==, count / 2 + 1);
+        g_assert_cmpuint(first_pass_tapped->len, ==, count / 2);
+        g_assert_cmpuint(first_pass_postseq_calls, ==, 0);
+
+        /* ...then up to frames before that, which have been dissected... */
+        g_assert_true(frame_data_index_first_pass(session, file_type_subtype, wth, fds,
+                count, &next, count / 4, NULL, NULL, &err, &err_info));
+        g_assert_cmpuint(next, ==, count / 2 + 1);
+
+        /* ...then on from there to the end. */
+        g_assert_true(frame_data_index_first_pass(session, file_type_subtype, wth, fds,
+                count, &next, count, NULL, NULL, &err, &err_info));
+        g_assert_cmpuint(next, ==, 0);
+    } else {
+        epan_dissect_init(&edt, session, false, false);
+        while (wtap_read(wth, &rec, &err, &err_info, &offset)) {
+            frame_data_init(&fdlocal, count + 1, &rec, offset, cum_bytes);
+            fdata = frame_data_sequence_add(fds, &fdlocal);
+            count++;
+            frame_data_set_before_dissect(fdata, &elapsed_time, &ref, prev_dis);
+            epan_dissect_run_with_taps(&edt, file_type_subtype, &rec, fdata, NULL);
+            epan_dissect_reset(&edt);
+            frame_data_set_after_dissect(fdata, &cum_bytes);
+            prev_dis = fdata;
+            wtap_rec_reset(&rec);
+        }
+        g_assert_cmpint(err, ==, 0);
+        epan_dissect_cleanup(&edt);
+        postseq_cleanup_all_protocols();
+    }
+    g_assert_cmpuint(first_pass_postseq_calls, ==, 1);
+    g_assert_cmpuint(first_pass_tapped->len, ==, count);
+    for (uint32_t i = 0; i < count; i++)
+        g_assert_cmpuint(g_array_index(first_pass_tapped, uint32_t, i), ==, i + 1);
+
+    trees = g_ptr_array_new_with_free_func(g_free);
+    epan_dissect_init(&edt, session, true, true);
+    for (uint32_t framenum = 1; framenum <= count; framenum++) {
+        fdata = frame_data_sequence_find(fds, framenum);
+        g_assert_true(wtap_seek_read(wth, fdata->file_off, &rec, &err, &err_info));
+        epan_dissect_run(&edt, file_type_subtype, &rec, fdata, NULL);
+        text = g_string_new(NULL);
+        proto_tree_children_foreach(edt.tree, first_pass_tree_text, text);
+        g_ptr_array_add(trees, g_string_free(text, false));
+        epan_dissect_reset(&edt);
+        wtap_rec_reset(&rec);
+    }
+    epan_dissect_cleanup(&edt);
+
+    wtap_rec_cleanup(&rec);
+    wtap_close(wth);
+    free_frame_data_sequence(fds);
+    g_array_free(first_pass_tapped, true);
+    first_pass_tapped = NULL;
+    epan_free(session);
+    return trees;
+}
+
+static bool
+first_pass_stop_at(uint32_t framenum, void *user_data)
+{
+    return framenum == *(uint32_t *)user_data;
+}
+
+void test_frame_data_index_first_pass(void)
+{
+    static const struct packet_provider_funcs funcs = { 0 };
+    GPtrArray *sequential, *deferred;
+    epan_t *session;
+    frame_data_sequence *fds;
+    frame_data_index *idx;
+    frame_data fdlocal;
+    wtap *wth;
+    uint32_t stop_at = 5, next = 1;
+    unsigned retransmissions = 0;
+    int listener;
+    int err;
+    char *err_info;
+    char *path;
+
+    path = write_first_pass_capture();
+    register_postseq_cleanup_routine(first_pass_postseq_cleanup);
+    g_assert_null(register_tap_listener("tcp", &listener, NULL, TL_IS_DISSECTOR_HELPER,
+                                        NULL, first_pass_tap_packet, NULL, NULL));
+
+    /* A deferred first pass leaves the dissectors in the same state as
+     * reading the file does. */
+    sequential = first_pass_load(path, false);
+    deferred = first_pass_load(path, true);
+    g_assert_cmpuint(deferred->len, ==, sequential->len);
+    for (unsigned i = 0; i < sequential->len; i++) {
+        g_assert_cmpstr(g_ptr_array_index(deferred, i), ==, g_ptr_array_index(sequential, i));
+        if (strstr(g_ptr_array_index(sequential, i), "tcp.analysis.retransmission:") != NULL)
+            retransmissions++;
+    }
+    g_assert_cmpuint(retransmissions, ==, FIRST_PASS_PACKETS / 7);
+    g_ptr_array_free(sequential, true);
+    g_ptr_array_free(deferred, true);
+
+    /* A pass that's stopped can be resumed where it stopped. */
+    session = epan_new(NULL, &funcs);
+    first_pass_tapped = g_array_new(false, false, sizeof(uint32_t));
+    first_pass_postseq_calls = 0;
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    fds = new_frame_data_sequence();
+    idx = frame_data_index_scan(wth, 1);
+    g_assert_nonnull(idx);
+    while (frame_data_index_next_frame(idx, &fdlocal, 0))
+        frame_data_sequence_add(fds, &fdlocal);
+    frame_data_index_close(idx);
+    g_assert_false(frame_data_index_first_pass(session, wtap_file_type_subtype(wth), wth, fds,
+            FIRST_PASS_PACKETS, &next, FIRST_PASS_PACKETS, first_pass_stop_at, &stop_at,
+            &err, &err_info));
+    g_assert_cmpint(err, ==, 0);
+    g_assert_cmpuint(next, ==, stop_at);
+    g_assert_cmpuint(first_pass_tapped->len, ==, stop_at - 1);
+    g_assert_cmpuint(first_pass_postseq_calls, ==, 0);
+    g_assert_true(frame_data_index_first_pass(session, wtap_file_type_subtype(wth), wth, fds,
+            FIRST_PASS_PACKETS, &next, FIRST_PASS_PACKETS, NULL, NULL, &err, &err_info));
+    g_assert_cmpuint(next, ==, 0);
+    g_assert_cmpuint(first_pass_tapped->len, ==, FIRST_PASS_PACKETS);
+    g_assert_cmpuint(first_pass_postseq_calls, ==, 1);
+    wtap_close(wth);
+    free_frame_data_sequence(fds);
+    g_array_free(first_pass_tapped, true);
+    first_pass_tapped = NULL;
+    epan_free(session);
+
+    remove_tap_listener(&listener);
+    ws_unlink(path);
+    g_free(path);
+}
+
 int main(int argc, char **argv)
 {
+    static epan_app_data_t app_data;
+    char *configuration_init_error;
     int ret;
 
     /* Set the program name. */
@@ -85,12 +1232,49 @@ int main(int argc, char **argv)
 
     g_test_init(&argc, &argv, NULL);
 
+    /* Initializing epan reads the configuration. */
+    configuration_init_error = configuration_init(argv[0], "wireshark");
+    if (configuration_init_error != NULL) {
+        fprintf(stderr, "test_epan: Can't get pathname of directory containing the test_epan program: %s.\n",
+            configuration_init_error);
+        g_free(configuration_init_error);
+    }
+
+    wtap_init(false, NULL, NULL, 0);
+
+    /* The tap and display filter tests need the dissectors. */
+    app_data.env_var_prefix = "WIRESHARK";
+    app_data.register_func = register_all_protocols;
+    app_data.handoff_func = register_all_protocol_handoffs;
+    if (!epan_init(NULL, NULL, false, &app_data)) {
+        fprintf(stderr, "test_epan: Can't initialize the dissection engine.\n");
+        return 2;
+    }
+
     g_test_add_func("/label/strcat", test_label_strcat);
     g_test_add_func("/label/escape_whitespace", test_label_strcat_escape_whitespace);
     g_test_add_func("/label/escape_control", test_label_escape_control);
 
+    g_test_add_func("/tap/dispatch", test_tap_dispatch);
+    g_test_add_func("/tap/shared_filter", test_tap_shared_filter);
+    g_test_add_func("/dfilter/narrowing", test_dfilter_narrowing);
+    g_test_add_func("/dfilter/verdict_reuse", test_dfilter_verdict_reuse);
+    g_test_add_func("/proto_data/lookup", test_proto_data);
+    g_test_add_func("/frame_data_index/read", test_frame_data_index);
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    g_test_add_func("/frame_data_index/mtime", test_frame_data_index_mtime);
+    g_test_add_func("/frame_data_index/mismatch", test_frame_data_index_mismatch);
+#endif
+    g_test_add_func("/frame_data_index/first_pass", test_frame_data_index_first_pass);
+    if (g_test_perf()) {
+        g_test_add_func("/tap/dispatch_perf", test_tap_dispatch_perf);
+        g_test_add_func("/proto_data/redissect_perf", test_proto_data_perf);
+    }
+
     ret = g_test_run();
 
+    epan_cleanup();
+
     return ret;
 }
 
@@ -45,6 +45,7 @@
 #include <epan/addr_resolv.h>
 #include <epan/color_filters.h>
 #include <epan/secrets.h>
+#include <epan/frame_data_index.h>
 
 #include <epan/cfile.h>
 #include "file.h"
@@ -79,6 +80,8 @@ static void add_new_record_to_record_list(capture_file *cf, wtap_rec *rec,
                                           column_info *cinfo, int64_t offset,
                                           fifo_string_cache_t *frame_dup_cache,
                                           GChecksum *frame_cksum);
+static void add_indexed_frame(capture_file *cf, frame_data *fdlocal);
+static void add_undissected_record(capture_file *cf, wtap_rec *rec, int64_t offset);
 
 static void rescan_packets(capture_file *cf, const char *action, const char *action_item, bool redissect);
 
@@ -140,6 +143,10 @@ static bool find_packet(capture_file *cf, ws_match_function match_function,
 
 #define STATUS_LEN 100
 
+/* Smallest file for which cf_read() scans for the records, rather than
+ * reading them, when it can defer dissecting them. */
+#define CF_SCAN_MIN_SIZE (64 * 1024 * 1024)
+
 /*
  * Maximum number of records we support in a file.
  *
@@ -275,6 +282,7 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, bool is_tempfile
      * old file's read lock was held, but it doesn't hurt to clear it. */
     cf->read_lock = false;
     cf->redissection_queued = RESCAN_NONE;
+    cf->first_pass_pending = 0;
 
     cf->provider.wth = wth;
     cf->f_datalen = 0;
@@ -398,6 +406,9 @@ cf_close(capture_file *cf)
 
     dfilter_free(cf->rfcode);
     cf->rfcode = NULL;
+    dfilter_verdict_cache_free(cf->dfilter_verdicts);
+    cf->dfilter_verdicts = NULL;
+    cf->first_pass_pending = 0;
     if (cf->provider.frames != NULL) {
         free_frame_data_sequence(cf->provider.frames);
         cf->provider.frames = NULL;
@@ -495,6 +506,21 @@ calc_progbar_val(capture_file *cf, int64_t size, int64_t file_pos, char *status_
     return progbar_val;
 }
 
+/*
+ * Read the next record of a file being read from start to end; if we
+ * have a frame index for the file, read the next record it lists rather
+ * than scanning the file for it.
+ */
+static bool
+cf_read_next_record(capture_file *cf, frame_data_index *fd_index, wtap_rec *rec,
+        int *err, char **err_info, int64_t *data_offset)
+{
+    if (fd_index != NULL)
+        return frame_data_index_read(fd_index, cf->provider.wth, rec, err,
+                err_info, data_offset);
+    return wtap_read(cf->provider.wth, rec, err, err_info, data_offset);
+}
+
 cf_read_status_t
 cf_read(capture_file *cf, bool reloading)
 {
@@ -514,6 +540,9 @@ cf_read(capture_file *cf, bool reloading)
     unsigned             tap_flags;
     bool                 compiled _U_;
     volatile bool        is_read_aborted = false;
+    frame_data_index    *fd_index = NULL;
+    frame_data_index_summary fd_index_summary;
+    bool                 fill_from_index = false;
 
     /* The update_progress_dlg call below might end up accepting a user request to
      * trigger redissection/rescans which can modify/destroy the dissection
@@ -616,6 +645,36 @@ cf_read(capture_file *cf, bool reloading)
      * first packet. */
     unsigned num_dsbs = wtap_file_get_num_dsbs(cf->provider.wth);
 
+    /* A read filter drops records, so an index of the frames we'd get
+     * wouldn't list every record. */
+    if (prefs.gui_frame_index && cf->rfcode == NULL && !cf->is_tempfile)
+        fd_index = frame_data_index_open(cf->provider.wth, cf->filename);
+
+    /* If nothing needs the frames to be dissected as they're read, set
+     * them up from the index without reading their records, and leave
+     * the dissection to a first pass that runs when a frame is needed.
+     * Without a usable index, a big enough file is scanned for its
+     * records with a thread per processor instead; whatever records the
+     * scan can't find are read afterwards, but not dissected either. */
+    if (cf->rfcode == NULL && cf->dfcode == NULL && !create_proto_tree &&
+        cinfo == NULL && cksum == NULL && !tap_listeners_require_dissection()) {
+        if (fd_index != NULL && !frame_data_index_verify(fd_index, cf->provider.wth)) {
+            frame_data_index_close(fd_index);
+            fd_index = NULL;
+        }
+        if (fd_index == NULL && size >= CF_SCAN_MIN_SIZE)
+            fd_index = frame_data_index_scan(cf->provider.wth, g_get_num_processors());
+        if (fd_index != NULL) {
+            fd_index_summary.linktypes = cf->linktypes;
+            fill_from_index = frame_data_index_get_summary(fd_index, &fd_index_summary);
+        }
+        if (fill_from_index) {
+            cf->packet_comment_count = fd_index_summary.packet_comment_count;
+            cf->drops_known = fd_index_summary.drops_known;
+            cf->drops = fd_index_summary.drops;
+        }
+    }
+
     g_timer_start(prog_timer);
 
     wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
@@ -626,9 +685,21 @@ cf_read(capture_file *cf, bool reloading)
 
         float   progbar_val;
         char    status_str[STATUS_LEN];
+        frame_data fdlocal;
 
-        while ((wtap_read(cf->provider.wth, &rec, &err, &err_info,
-                        &data_offset))) {
+        if (fill_from_index) {
+            while (frame_data_index_next_frame(fd_index, &fdlocal, cf->cum_bytes)) {
+                if (cf->count == max_records) {
+                    too_many_records = true;
+                    break;
+                }
+                add_indexed_frame(cf, &fdlocal);
+            }
+        }
+
+        while (!too_many_records &&
+               cf_read_next_record(cf, fd_index, &rec, &err, &err_info,
+                        &data_offset)) {
             if (size >= 0) {
                 if (cf->count == max_records) {
                     /*
@@ -638,7 +709,10 @@ cf_read(capture_file *cf, bool reloading)
                     too_many_records = true;
                     break;
                 }
-                file_pos = wtap_read_so_far(cf->provider.wth);
+                if (fd_index != NULL)
+                    file_pos = data_offset;
+                else
+                    file_pos = wtap_read_so_far(cf->provider.wth);
 
                 /* Create the progress bar if necessary. */
                 if (progress_is_slow(progbar, prog_timer, size, file_pos)) {
@@ -687,10 +761,15 @@ cf_read(capture_file *cf, bool reloading)
                    hours even on fast machines) just to see that it was the wrong file. */
                 break;
             }
-            add_new_record_to_record_list(cf, &rec, cf->dfcode, &edt, cinfo,
-                                          data_offset, &frame_dup_cache, cksum);
+            if (fill_from_index)
+                add_undissected_record(cf, &rec, data_offset);
+            else
+                add_new_record_to_record_list(cf, &rec, cf->dfcode, &edt, cinfo,
+                                              data_offset, &frame_dup_cache, cksum);
             wtap_rec_reset(&rec);
         }
+        if (fill_from_index && cf->count > 0)
+            cf->first_pass_pending = 1;
     }
     CATCH(OutOfMemoryError) {
         simple_message_box(ESD_TYPE_ERROR, NULL,
@@ -717,6 +796,24 @@ cf_read(capture_file *cf, bool reloading)
         cf->redissection_queued = RESCAN_REDISSECT;
     }
 
+    /* If we read the whole file by scanning it, or with an index that
+     * turned out not to match it or to lack the totals we keep, save where
+     * its records are for the next time it's opened. */
+    fd_index_summary.linktypes = NULL;
+    if ((fd_index == NULL || !frame_data_index_is_current(fd_index) ||
+         !frame_data_index_get_summary(fd_index, &fd_index_summary)) &&
+        prefs.gui_frame_index && err == 0 && !too_many_records &&
+        !is_read_aborted && !cf->stop_flag && cf->rfcode == NULL &&
+        !cf->is_tempfile) {
+        fd_index_summary.linktypes = cf->linktypes;
+        fd_index_summary.packet_comment_count = cf->packet_comment_count;
+        fd_index_summary.drops_known = cf->drops_known;
+        fd_index_summary.drops = cf->drops;
+        frame_data_index_write(cf->provider.wth, cf->filename,
+                cf->provider.frames, cf->count, &fd_index_summary);
+    }
+    frame_data_index_close(fd_index);
+
     // If we're ignoring duplicate frames, clear the data structures.
     // We really could look at prefs.ignore_dup_frames here, but it's even
     // safer to check if we had allocated 'cksum'.
@@ -743,8 +840,10 @@ cf_read(capture_file *cf, bool reloading)
     wtap_sequential_close(cf->provider.wth);
 
     /* Allow the protocol dissectors to free up memory that they
-     * don't need after the sequential run-through of the packets. */
-    postseq_cleanup_all_protocols();
+     * don't need after the sequential run-through of the packets,
+     * unless that run-through has been deferred. */
+    if (cf->first_pass_pending == 0)
+        postseq_cleanup_all_protocols();
 
     /* compute the time it took to load the file */
     compute_elapsed(cf, start_time);
@@ -1251,6 +1350,120 @@ cf_set_rfcode(capture_file *cf, dfilter_t *rfcode)
     cf->rfcode = rfcode;
 }
 
+static void
+add_packet_to_displayed_frames(frame_data *fdata, capture_file *cf,
+        column_info *cinfo, bool add_to_packet_list)
+{
+    if (fdata->passed_dfilter || fdata->ref_time) {
+        cf->displayed_count++;
+        fdata->dis_num = cf->displayed_count;
+    }
+
+    if (add_to_packet_list) {
+        /* We fill the needed columns from new_packet_list */
+        packet_list_append(cinfo, fdata);
+    }
+
+    if (fdata->passed_dfilter || fdata->ref_time)
+    {
+        frame_data_set_after_dissect(fdata, &cf->cum_bytes);
+        /* The only way we use prev_dis is to get the time stamp of
+         * the previous displayed frame, so ignore it if it doesn't
+         * have a time stamp, because we're presumably interested in
+         * the timestamp of the previously displayed frame with a
+         * time. XXX: What if in the future we want to use the previously
+         * displayed frame for something else, too?
+         */
+        if (fdata->has_ts) {
+            cf->provider.prev_dis = fdata;
+        }
+
+        /* If we haven't yet seen the first frame, this is it. */
+        if (cf->first_displayed == 0)
+            cf->first_displayed = fdata->num;
+
+        /* This is the last frame we've seen so far. */
+        cf->last_displayed = fdata->num;
+    }
+}
+
+/*
+ * Like add_packet_to_packet_list(), for a frame whose display filter
+ * verdict is already known, so that it doesn't need to be dissected.
+ */
+static void
+add_packet_with_known_verdict(frame_data *fdata, capture_file *cf,
+        dfilter_t *dfcode, bool passed)
+{
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+            &cf->provider.ref, cf->provider.prev_dis);
+    cf->provider.prev_cap = fdata;
+
+    fdata->passed_dfilter = passed ? 1 : 0;
+
+    if (fdata->passed_dfilter && dfcode != NULL && frame_data_dependent_frames(fdata)) {
+        g_hash_table_foreach(frame_data_dependent_frames(fdata), find_and_mark_frame_depended_upon, cf->provider.frames);
+    }
+
+    add_packet_to_displayed_frames(fdata, cf, NULL, false);
+}
+
+/*
+ * Add a frame set up from a frame index to the packet list without
+ * dissecting it; run_deferred_first_pass() dissects it later.
+ */
+static void
+add_indexed_frame(capture_file *cf, frame_data *fdlocal)
+{
+    frame_data *fdata;
+
+    /* This does a shallow copy of fdlocal, which is good enough. */
+    fdata = frame_data_sequence_add(cf->provider.frames, fdlocal);
+    cf->count++;
+    cf->f_datalen = fdata->file_off + fdata->cap_len;
+
+    frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+            &cf->provider.ref, cf->provider.prev_dis);
+    cf->provider.prev_cap = fdata;
+
+    add_packet_to_displayed_frames(fdata, cf, NULL, true);
+}
+
+/*
+ * Count the comments and dropped packets a record's options give.
+ */
+static void
+add_record_options_to_totals(capture_file *cf, const wtap_rec *rec)
+{
+    uint64_t dropcount = 0;
+
+    if (rec->block == NULL)
+        return;
+
+    cf->packet_comment_count += wtap_block_count_option(rec->block, OPT_COMMENT);
+    if (wtap_block_get_uint64_option_value(rec->block, OPT_PKT_DROPCOUNT, &dropcount) == WTAP_OPTTYPE_SUCCESS) {
+        cf->drops_known = true;
+        cf->drops += (uint32_t)dropcount;
+    }
+}
+
+/*
+ * Add a record that was read while the frames are being set up from a
+ * frame index, i.e. one the index doesn't list, without dissecting it.
+ */
+static void
+add_undissected_record(capture_file *cf, wtap_rec *rec, int64_t offset)
+{
+    frame_data fdlocal;
+
+    if (rec->rec_type == REC_TYPE_PACKET) {
+        cf_add_encapsulation_type(cf, rec->rec_header.packet_header.pkt_encap);
+    }
+    add_record_options_to_totals(cf, rec);
+    frame_data_init(&fdlocal, cf->count + 1, rec, offset, cf->cum_bytes);
+    add_indexed_frame(cf, &fdlocal);
+}
+
 static void
 add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
         epan_dissect_t *edt, dfilter_t *dfcode, column_info *cinfo,
@@ -1283,46 +1496,16 @@ add_packet_to_packet_list(frame_data *fdata, capture_file *cf,
     if (fdata->passed_dfilter && dfcode != NULL) {
         fdata->passed_dfilter = dfilter_apply_edt(dfcode, edt) ? 1 : 0;
 
-        if (fdata->passed_dfilter && edt->pi.fd->dependent_frames) {
+        if (fdata->passed_dfilter && frame_data_dependent_frames(edt->pi.fd)) {
             /* This frame passed the display filter but it may depend on other
              * (potentially not displayed) frames.  Find those frames and mark them
              * as depended upon.
              */
-            g_hash_table_foreach(edt->pi.fd->dependent_frames, find_and_mark_frame_depended_upon, cf->provider.frames);
+            g_hash_table_foreach(frame_data_dependent_frames(edt->pi.fd), find_and_mark_frame_depended_upon, cf->provider.frames);
         }
     }
 
-    if (fdata->passed_dfilter || fdata->ref_time) {
-        cf->displayed_count++;
-        fdata->dis_num = cf->displayed_count;
-    }
-
-    if (add_to_packet_list) {
-        /* We fill the needed columns from new_packet_list */
-        packet_list_append(cinfo, fdata);
-    }
-
-    if (fdata->passed_dfilter || fdata->ref_time)
-    {
-        frame_data_set_after_dissect(fdata, &cf->cum_bytes);
-        /* The only way we use prev_dis is to get the time stamp of
-         * the previous displayed frame, so ignore it if it doesn't
-         * have a time stamp, because we're presumably interested in
-         * the timestamp of the previously displayed frame with a
-         * time. XXX: What if in the future we want to use the previously
-         * displayed frame for something else, too?
-         */
-        if (fdata->has_ts) {
-            cf->provider.prev_dis = fdata;
-        }
-
-        /* If we haven't yet seen the first frame, this is it. */
-        if (cf->first_displayed == 0)
-            cf->first_displayed = fdata->num;
-
-        /* This is the last frame we've seen so far. */
-        cf->last_displayed = fdata->num;
-    }
+    add_packet_to_displayed_frames(fdata, cf, cinfo, add_to_packet_list);
 
     epan_dissect_reset(edt);
 }
@@ -1377,15 +1560,7 @@ add_new_record_to_record_list(capture_file *cf, wtap_rec *rec,
         fdata = frame_data_sequence_add(cf->provider.frames, &fdlocal);
 
         cf->count++;
-        if (rec->block != NULL) {
-            uint64_t dropcount = 0;
-
-            cf->packet_comment_count += wtap_block_count_option(rec->block, OPT_COMMENT);
-            if (wtap_block_get_uint64_option_value(rec->block, OPT_PKT_DROPCOUNT, &dropcount) == WTAP_OPTTYPE_SUCCESS) {
-                cf->drops_known = true;
-                cf->drops += (uint32_t)dropcount;
-            }
-        }
+        add_record_options_to_totals(cf, rec);
         cf->f_datalen = offset + fdlocal.cap_len;
 
         // Should we check if the frame data is a duplicate, and thus, ignore
@@ -1638,12 +1813,122 @@ cf_redissect_packets(capture_file *cf)
     }
 }
 
+typedef struct {
+    capture_file *cf;
+    progdlg_t    *progbar;
+    GTimer       *prog_timer;
+    uint32_t      first;
+    uint32_t      last;
+    bool          stop_flag;
+} first_pass_progress_t;
+
+/*
+ * Show the progress of a deferred first pass, and stop it if the user
+ * asked to.
+ */
+static bool
+first_pass_progress(uint32_t framenum, void *user_data)
+{
+    first_pass_progress_t *progress = (first_pass_progress_t *)user_data;
+    float  progbar_val;
+    char   status_str[STATUS_LEN];
+
+    progbar_val = (float) (framenum - progress->first) /
+            (progress->last - progress->first + 1);
+
+    /* Create the progress bar if necessary. */
+    if (progress->progbar == NULL)
+        progress->progbar = delayed_create_progress_dlg(progress->cf->window,
+                "Dissecting", "earlier packets", true,
+                &progress->stop_flag, progbar_val);
+
+    if (progress->progbar != NULL &&
+            g_timer_elapsed(progress->prog_timer, NULL) > PROGBAR_UPDATE_INTERVAL) {
+        snprintf(status_str, sizeof(status_str),
+                "%4u of %u frames", framenum - 1, progress->last);
+        update_progress_dlg(progress->progbar, progbar_val, status_str);
+        g_timer_start(progress->prog_timer);
+    }
+
+    return progress->stop_flag || progress->cf->state == FILE_READ_ABORTED;
+}
+
+/*
+ * If the frames were set up from a frame index without being dissected,
+ * dissect the ones up to and including framenum that haven't been yet, in
+ * order, so that the dissectors see every frame in a first pass in the
+ * order of the file before any of them is dissected on its own.
+ *
+ * This can take a while for a frame far into a big file, so it shows a
+ * progress bar and can be stopped; it picks up where it stopped the next
+ * time a frame past that point is needed. Returns false if framenum
+ * can't be dissected yet, because the pass was stopped or is already
+ * running further up the stack.
+ */
+static bool
+run_deferred_first_pass(capture_file *cf, uint32_t framenum)
+{
+    first_pass_progress_t progress;
+    bool    was_locked;
+    bool    done;
+    int     err;
+    char   *err_info;
+
+    if (cf->first_pass_pending == 0 || framenum < cf->first_pass_pending)
+        return true;
+
+    /* The progress bar lets the GUI ask for frames while we're running. */
+    if (cf->first_pass_running)
+        return false;
+    cf->first_pass_running = true;
+
+    /* Keep the GUI from redissecting or closing the file under us, as
+     * for any other pass over the frames; a redissection requested in
+     * the meantime is queued. */
+    was_locked = cf->read_lock;
+    cf->read_lock = true;
+
+    progress.cf = cf;
+    progress.progbar = NULL;
+    progress.prog_timer = g_timer_new();
+    progress.first = cf->first_pass_pending;
+    progress.last = framenum;
+    progress.stop_flag = false;
+    g_timer_start(progress.prog_timer);
+
+    done = frame_data_index_first_pass(cf->epan, cf->cd_t, cf->provider.wth,
+            cf->provider.frames, cf->count, &cf->first_pass_pending, framenum,
+            first_pass_progress, &progress, &err, &err_info);
+    if (!done && err != 0) {
+        /* Reading the frame that's needed will report this. */
+        g_free(err_info);
+        done = true;
+    }
+
+    if (progress.progbar != NULL)
+        destroy_progress_dlg(progress.progbar);
+    g_timer_destroy(progress.prog_timer);
+
+    cf->read_lock = was_locked;
+    cf->first_pass_running = false;
+
+    if (!was_locked && cf->redissection_queued != RESCAN_NONE) {
+        /* Redissection was queued up. Clear the request and perform it now. */
+        bool redissect = cf->redissection_queued == RESCAN_REDISSECT;
+        rescan_packets(cf, NULL, NULL, redissect);
+    }
+
+    return done;
+}
+
 bool
 cf_read_record(capture_file *cf, const frame_data *fdata, wtap_rec *rec)
 {
     int    err;
     char *err_info;
 
+    if (!run_deferred_first_pass(cf, fdata->num))
+        return false;
     if (!wtap_seek_read(cf->provider.wth, fdata->file_off, rec, &err, &err_info)) {
         report_cfile_read_failure(cf->filename, err, err_info);
         return false;
@@ -1658,6 +1943,8 @@ cf_read_record_no_alert(capture_file *cf, const frame_data *fdata,
     int    err;
     char *err_info;
 
+    if (!run_deferred_first_pass(cf, fdata->num))
+        return false;
     if (!wtap_seek_read(cf->provider.wth, fdata->file_off, rec, &err, &err_info)) {
         g_free(err_info);
         return false;
@@ -1710,6 +1997,10 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, bo
     bool        compiled _U_;
     uint32_t    frames_count;
     rescan_type queued_rescan_type = RESCAN_NONE;
+    dfilter_verdicts *verdicts = NULL;
+    const dfilter_verdicts *known_verdicts = NULL;
+    bool        known_verdicts_exact = false;
+    bool        passed;
 
     if (cf->state == FILE_CLOSED || cf->state == FILE_READ_PENDING) {
         return;
@@ -1838,6 +2129,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, bo
          * packet list store. */
         packet_list_clear();
         add_to_packet_list = true;
+
+        /* The dissection state the known verdicts came from is gone. */
+        dfilter_verdict_cache_clear(cf->dfilter_verdicts);
+
+        /* This pass dissects the frames in order, so it does whatever is
+         * left of a deferred first pass. */
+        cf->first_pass_pending = 0;
     }
 
     /* We don't yet know which will be the first and last frames displayed. */
@@ -1879,6 +2177,21 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, bo
 
     frames_count = cf->count;
 
+    /*
+     * If nothing but the display filter needs the frames to be dissected,
+     * record the verdicts of this filter, and use the known verdicts of
+     * this filter or a broader one to skip frames if we have any.
+     */
+    if (!tap_listeners_require_dissection() && dfilter_verdict_is_reusable(cf->dfcode)) {
+        const char *verdicts_text = cf->dfcode ? dfilter_text(cf->dfcode) : "";
+
+        if (!redissect) {
+            known_verdicts = dfilter_verdict_cache_find(cf->dfilter_verdicts, verdicts_text,
+                    &known_verdicts_exact);
+        }
+        verdicts = dfilter_verdicts_new(verdicts_text, frames_count);
+    }
+
     epan_dissect_init(&edt, cf->epan, create_proto_tree, false);
 
     if (redissect) {
@@ -1970,9 +2283,6 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, bo
         /* Frame dependencies from the previous dissection/filtering are no longer valid. */
         fdata->dependent_of_displayed = 0;
 
-        if (!cf_read_record(cf, fdata, &rec))
-            break; /* error reading the frame */
-
         /* If the previous frame is displayed, and we haven't yet seen the
            selected frame, remember that frame - it's the closest one we've
            yet seen before the selected frame. */
@@ -1981,8 +2291,20 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, bo
             preceding_frame = prev_frame;
         }
 
-        add_packet_to_packet_list(fdata, cf, &edt, cf->dfcode, cinfo, &rec,
-                add_to_packet_list);
+        if (known_verdicts != NULL &&
+                dfilter_verdicts_lookup(known_verdicts, known_verdicts_exact, framenum, &passed)) {
+            /* We know whether this frame passes without dissecting it. */
+            add_packet_with_known_verdict(fdata, cf, cf->dfcode, passed);
+        } else {
+            if (!cf_read_record(cf, fdata, &rec))
+                break; /* error reading the frame */
+
+            add_packet_to_packet_list(fdata, cf, &edt, cf->dfcode, cinfo, &rec,
+                    add_to_packet_list);
+        }
+
+        if (verdicts != NULL)
+            dfilter_verdicts_add(verdicts, framenum, fdata->passed_dfilter);
 
         /* If this frame is displayed, and this is the first frame we've
            seen displayed after the selected frame, remember this frame -
@@ -2008,6 +2330,13 @@ rescan_packets(capture_file *cf, const char *action, const char *action_item, bo
     epan_dissect_cleanup(&edt);
     wtap_rec_cleanup(&rec);
 
+    if (verdicts != NULL) {
+        /* Even if we stopped early, the verdicts we got are good. */
+        if (cf->dfilter_verdicts == NULL)
+            cf->dfilter_verdicts = dfilter_verdict_cache_new();
+        dfilter_verdict_cache_store(cf->dfilter_verdicts, verdicts);
+    }
+
     /* We are done redissecting the packet list. */
     cf->redissecting = false;
 
@@ -5011,6 +5340,8 @@ cf_ignore_frame(capture_file *cf, frame_data *frame)
         frame->ignored = true;
         if (cf->count > cf->ignored_count)
             cf->ignored_count++;
+        /* Ignored frames aren't dissected, so they don't pass filters. */
+        dfilter_verdict_cache_clear(cf->dfilter_verdicts);
     }
 }
 
@@ -5024,6 +5355,7 @@ cf_unignore_frame(capture_file *cf, frame_data *frame)
         frame->ignored = false;
         if (cf->ignored_count > 0)
             cf->ignored_count--;
+        dfilter_verdict_cache_clear(cf->dfilter_verdicts);
     }
 }
 
@@ -5147,6 +5479,9 @@ cf_set_modified_block(capture_file *cf, frame_data *fd, const wtap_block_t new_b
 {
     wtap_block_t pkt_block = cf_get_packet_block(cf, fd);
 
+    /* Packet comments are dissected, e.g. as expert info. */
+    dfilter_verdict_cache_clear(cf->dfilter_verdicts);
+
     /* It's possible to further modify the modified block "in place" by doing
      * a call to cf_get_packet_block() that returns an already created modified
      * block, modifying that, and calling this function.
@@ -5275,9 +5610,9 @@ save_record(capture_file *cf, frame_data *fdata, wtap_rec *rec, void *argsp)
      * and set the presence flag, so that time stamps aren't lost.
      */
 
-    if (!nstime_is_zero(&fdata->shift_offset)) {
+    if (!nstime_is_zero(frame_data_shift_offset(fdata))) {
         if (new_rec.presence_flags & WTAP_HAS_TS) {
-            nstime_add(&new_rec.ts, &fdata->shift_offset);
+            nstime_add(&new_rec.ts, frame_data_shift_offset(fdata));
         }
     }
 
@@ -5299,8 +5634,8 @@ save_record(capture_file *cf, frame_data *fdata, wtap_rec *rec, void *argsp)
      *
      * If we're exporting to a different file, then don't do that.
      */
-    if (!args->export && new_rec.presence_flags & WTAP_HAS_TS) {
-        nstime_set_zero(&fdata->shift_offset);
+    if (!args->export && new_rec.presence_flags & WTAP_HAS_TS && fdata->cold) {
+        nstime_set_zero(&fdata->cold->shift_offset);
     }
 
     return true;
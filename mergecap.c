@@ -47,6 +47,7 @@
 
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+1
 #define LONGOPT_NO_MERGING_COMMENT      LONGOPT_BASE_APPLICATION+2
+#define LONGOPT_BENCHMARK               LONGOPT_BASE_APPLICATION+3
 
 /*
  * Show the usage
@@ -74,6 +75,7 @@ print_usage(FILE *output)
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h, --help        display this help and exit.\n");
     fprintf(output, "  -V                verbose output.\n");
+    fprintf(output, "  --benchmark       report the merge rate in records per second.\n");
     fprintf(output, "  -v, --version     print version information and exit.\n");
 }
 
@@ -181,6 +183,61 @@ merge_callback(merge_event event, int num,
     return false;
 }
 
+typedef struct {
+    bool     verbose;
+    unsigned max_in_file_count; /* largest number of files merged at once */
+    uint64_t record_count;      /* records written, including batch passes */
+    int64_t  start_time;        /* monotonic time, in microseconds */
+} benchmark_info_t;
+
+static bool
+benchmark_callback(merge_event event, int num,
+        const merge_in_file_t in_files[], const unsigned in_file_count,
+        void *data)
+{
+    benchmark_info_t *info = (benchmark_info_t *)data;
+
+    switch (event) {
+
+        case MERGE_EVENT_INPUT_FILES_OPENED:
+            if (info->start_time == 0)
+                info->start_time = g_get_monotonic_time();
+            if (in_file_count > info->max_in_file_count)
+                info->max_in_file_count = in_file_count;
+            break;
+
+        case MERGE_EVENT_DONE:
+            /* for this event, num = count */
+            info->record_count += num;
+            break;
+
+        case MERGE_EVENT_RECORD_WAS_READ:
+            /* Don't let the per-record message skew the measurement. */
+            return false;
+
+        default:
+            break;
+    }
+
+    if (info->verbose)
+        return merge_callback(event, num, in_files, in_file_count, NULL);
+
+    /* false = do not stop merging */
+    return false;
+}
+
+static void
+print_benchmark(const benchmark_info_t *info, int in_file_count)
+{
+    double elapsed = (g_get_monotonic_time() - info->start_time) / 1000000.0;
+
+    fprintf(stderr, "mergecap: merged %" PRIu64 " records from %d files (%u open at once) in %.3f s",
+            info->record_count, in_file_count, info->max_in_file_count, elapsed);
+    if (elapsed > 0.0)
+        fprintf(stderr, ", %.0f records/s", info->record_count / elapsed);
+    fprintf(stderr, "\n");
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -191,6 +248,7 @@ main(int argc, char *argv[])
         {"version", ws_no_argument, NULL, 'v'},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
         {"no-merging-comment", ws_no_argument, NULL, LONGOPT_NO_MERGING_COMMENT},
+        {"benchmark", ws_no_argument, NULL, LONGOPT_BENCHMARK},
         LONGOPT_WSLOG
         {0, 0, 0, 0 }
     };
@@ -199,6 +257,7 @@ main(int argc, char *argv[])
     bool                  add_merging_comment = true;
     bool                  do_append        = false;
     bool                  verbose          = false;
+    bool                  benchmark        = false;
     int                   in_file_count    = 0;
     uint32_t              snaplen          = 0;
     int                   file_type        = WTAP_FILE_TYPE_SUBTYPE_UNKNOWN;
@@ -207,6 +266,7 @@ main(int argc, char *argv[])
     idb_merge_mode        mode             = IDB_MERGE_MODE_MAX;
     ws_compression_type   compression_type = WS_FILE_UNKNOWN_COMPRESSION;
     merge_progress_callback_t cb;
+    benchmark_info_t      benchmark_info   = { 0 };
     const struct file_extension_info* file_extensions;
     unsigned num_extensions;
 
@@ -322,6 +382,10 @@ main(int argc, char *argv[])
                 add_merging_comment = false;
                 break;
 
+            case LONGOPT_BENCHMARK:
+                benchmark = true;
+                break;
+
             case '?':              /* Bad options if GNU getopt */
             default:
                 /* wslog arguments are okay */
@@ -351,8 +415,14 @@ main(int argc, char *argv[])
     if (file_type == WTAP_FILE_TYPE_SUBTYPE_UNKNOWN)
         file_type = wtap_pcapng_file_type_subtype();
 
-    cb.callback_func = merge_callback;
-    cb.data = NULL;
+    if (benchmark) {
+        benchmark_info.verbose = verbose;
+        cb.callback_func = benchmark_callback;
+        cb.data = &benchmark_info;
+    } else {
+        cb.callback_func = merge_callback;
+        cb.data = NULL;
+    }
 
     /* check for proper args; at a minimum, must have an output
      * filename and one input file
@@ -420,15 +490,18 @@ main(int argc, char *argv[])
                 (const char *const *) &argv[ws_optind],
                 in_file_count, add_merging_comment, do_append, mode, snaplen,
                 get_appname_and_version(), application_configuration_environment_prefix(),
-                verbose ? &cb : NULL, compression_type);
+                (verbose || benchmark) ? &cb : NULL, compression_type);
     } else {
         /* merge the files to the outfile */
         status = merge_files(out_filename, file_type,
                 (const char *const *) &argv[ws_optind], in_file_count,
                 add_merging_comment, do_append, mode, snaplen, get_appname_and_version(), application_configuration_environment_prefix(),
-                verbose ? &cb : NULL, compression_type);
+                (verbose || benchmark) ? &cb : NULL, compression_type);
     }
 
+    if (status && benchmark)
+        print_benchmark(&benchmark_info, in_file_count);
+
 clean_exit:
     wtap_cleanup();
     free_progdirs();
@@ -53,6 +53,7 @@
 #include <epan/tap.h>
 #include <epan/uat-int.h>
 #include <epan/secrets.h>
+#include <epan/frame_data_index.h>
 
 #include <wsutil/codecs.h>
 
@@ -96,6 +97,8 @@ static frame_data ref_frame;
 static const struct ws_option long_options[] = {
     {"api", ws_required_argument, NULL, 'a'},
     {"foreground", ws_no_argument, NULL, LONGOPT_FOREGROUND},
+    {"workers", ws_required_argument, NULL, LONGOPT_WORKERS},
+    {"max-sessions", ws_required_argument, NULL, LONGOPT_MAX_SESSIONS},
     {"help", ws_no_argument, NULL, 'h'},
     {"version", ws_no_argument, NULL, 'v'},
     {"config-profile", ws_required_argument, NULL, 'C'},
@@ -332,8 +335,8 @@ process_packet(capture_file *cf, epan_dissect_t *edt, int64_t offset,
          * if a display filter was given and it matches this packet.
          */
         if (edt && cf->dfcode) {
-            if (dfilter_apply_edt(cf->dfcode, edt) && edt->pi.fd->dependent_frames) {
-                g_hash_table_foreach(edt->pi.fd->dependent_frames, find_and_mark_frame_depended_upon, cf->provider.frames);
+            if (dfilter_apply_edt(cf->dfcode, edt) && frame_data_dependent_frames(edt->pi.fd)) {
+                g_hash_table_foreach(frame_data_dependent_frames(edt->pi.fd), find_and_mark_frame_depended_upon, cf->provider.frames);
             }
         }
 
@@ -359,6 +362,8 @@ load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
     int64_t      data_offset;
     wtap_rec     rec;
     epan_dissect_t *edt = NULL;
+    frame_data_index *fd_index = NULL;
+    bool         read_all = true;
 
     {
         /* Allocate a frame_data_sequence for all the frames. */
@@ -388,7 +393,14 @@ load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
 
         wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
 
-        while (wtap_read(cf->provider.wth, &rec, &err, &err_info, &data_offset)) {
+        /* If the file has an up-to-date frame index, read the records it
+         * lists rather than scanning the file for them. */
+        if (prefs.gui_frame_index && cf->rfcode == NULL && !cf->is_tempfile)
+            fd_index = frame_data_index_open(cf->provider.wth, cf->filename);
+
+        while (fd_index != NULL ?
+                   frame_data_index_read(fd_index, cf->provider.wth, &rec, &err, &err_info, &data_offset) :
+                   wtap_read(cf->provider.wth, &rec, &err, &err_info, &data_offset)) {
             if (process_packet(cf, edt, data_offset, &rec)) {
                 wtap_rec_reset(&rec);
                 /* Stop reading if we have the maximum number of packets;
@@ -398,11 +410,22 @@ load_cap_file(capture_file *cf, int max_packet_count, int64_t max_byte_count)
                  */
                 if ( (--max_packet_count == 0) || (max_byte_count != 0 && data_offset >= max_byte_count)) {
                     err = 0; /* This is not an error */
+                    read_all = false;
                     break;
                 }
             }
         }
 
+        /* sharkd doesn't keep the totals a frame index can hold, so
+         * leave them out. */
+        if ((fd_index == NULL || !frame_data_index_is_current(fd_index)) &&
+            prefs.gui_frame_index && err == 0 && read_all &&
+            cf->rfcode == NULL && !cf->is_tempfile) {
+            frame_data_index_write(cf->provider.wth, cf->filename,
+                                   cf->provider.frames, cf->count, NULL);
+        }
+        frame_data_index_close(fd_index);
+
         if (edt) {
             epan_dissect_free(edt);
             edt = NULL;
@@ -29,6 +29,8 @@
 typedef void (*sharkd_dissect_func_t)(epan_dissect_t *edt, proto_tree *tree, struct epan_column_info *cinfo, const GSList *data_src, void *data);
 
 #define LONGOPT_FOREGROUND 4000
+#define LONGOPT_WORKERS    4001
+#define LONGOPT_MAX_SESSIONS 4002
 
 /* sharkd.c */
 
@@ -194,6 +196,37 @@ int sharkd_init(int argc, char **argv);
  */
 int sharkd_loop(int argc _U_, char* argv[] _U_);
 
+/**
+ * @brief The load of a session process of the daemon.
+ */
+typedef struct {
+    int      pid;       /**< Process ID of the session process */
+    bool     self;      /**< True if this is the calling session process */
+    bool     busy;      /**< True if serving a client, false if waiting for one */
+    int64_t  started;   /**< When the client connected, in seconds since the epoch */
+    uint64_t requests;  /**< Number of requests handled */
+    uint32_t frames;    /**< Number of frames in the loaded capture file */
+} sharkd_worker_info_t;
+
+/**
+ * @brief Record that the calling session process handled a request.
+ *
+ * Does nothing unless the session process belongs to the daemon's pool.
+ *
+ * @param frames The number of frames in the loaded capture file.
+ */
+void sharkd_worker_note_request(uint32_t frames);
+
+/**
+ * @brief Get the load of all session processes of the daemon.
+ *
+ * @param info Set to an array with an entry for each session process,
+ * or NULL if there are none. The caller must g_free() it.
+ * @return The number of entries in the array; 0 if the calling process
+ * doesn't belong to the daemon's pool.
+ */
+unsigned sharkd_worker_get_info(sharkd_worker_info_t **info);
+
 /* sharkd_session.c */
 
 /**
@@ -206,6 +239,16 @@ int sharkd_loop(int argc _U_, char* argv[] _U_);
  */
 int sharkd_session_main(int mode_setting);
 
+/**
+ * @brief Set up a session before its client is known.
+ *
+ * Called by sharkd_session_main() if it hasn't been called yet, so that
+ * the daemon can do this ahead of time in its spare session processes.
+ *
+ * @param mode_setting The mode in which the session should operate.
+ */
+void sharkd_session_init(int mode_setting);
+
 #endif /* __SHARKD_H */
 
 /*
@@ -34,9 +34,14 @@
 #include <app/application_flavor.h>
 
 #ifndef _WIN32
+#include <sys/mman.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 #include <netinet/tcp.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
 #endif
 
 #include <wsutil/strtoi.h>
@@ -67,6 +72,40 @@ static int mode;
 static socket_handle_t _server_fd = INVALID_SOCKET;
 static bool abstract_socket;
 
+#ifndef _WIN32
+/*
+ * With --workers, the daemon keeps a pool of spare session processes
+ * that have been forked and set up ahead of time, each waiting in accept()
+ * for a client, so that a connecting client doesn't wait for that.  A
+ * session process serves a single client and exits; whenever one of them
+ * gets a client, the daemon forks another to take its place.
+ *
+ * The table of session processes is shared with all of them, so that any
+ * session can report the load of all the others.
+ *
+ * If every slot of the table that may be used (--max-sessions) is taken
+ * by a busy session process, there's nobody left to accept a client, so
+ * the daemon accepts new clients itself, tells them the server is full,
+ * and closes the connection.
+ */
+#define SHARKD_WORKERS_MAX 1024
+
+struct sharkd_worker
+{
+    volatile pid_t pid;         /* 0 if the slot is unused, -1 while being forked */
+    volatile int busy;          /* serving a client */
+    volatile int64_t started;   /* when the client connected */
+    volatile uint64_t requests; /* requests handled */
+    volatile uint32_t frames;   /* frames in the loaded capture file */
+};
+
+static unsigned spare_workers;
+static unsigned max_workers = SHARKD_WORKERS_MAX;
+static struct sharkd_worker *workers;
+static int worker_slot = -1;     /* our slot, in a session process */
+static int worker_notify_fd = -1; /* write end of the daemon's wakeup pipe */
+#endif
+
 static socket_handle_t
 socket_init(char *path)
 {
@@ -227,6 +266,12 @@ print_usage(FILE* output)
     fprintf(output, "  -a <socket>, --api <socket>\n");
     fprintf(output, "                           listen on this socket instead of the console\n");
     fprintf(output, "  --foreground             do not detach from console\n");
+#ifndef _WIN32
+    fprintf(output, "  --workers <count>        keep this many session processes ready for clients\n");
+    fprintf(output, "                           (0 = fork on connection; def: 0)\n");
+    fprintf(output, "  --max-sessions <count>   with --workers, serve at most this many clients at once\n");
+    fprintf(output, "                           (def: %d)\n", SHARKD_WORKERS_MAX);
+#endif
     fprintf(output, "  -h, --help               show this help information\n");
     fprintf(output, "  -v, --version            show version information\n");
     fprintf(output, "  -C <config profile>, --config-profile <config profile>\n");
@@ -384,6 +429,42 @@ sharkd_init(int argc, char **argv)
                     foreground = true;
                     break;
 
+                case LONGOPT_WORKERS:
+                {
+#ifndef _WIN32
+                    uint32_t count;
+
+                    if (!ws_strtou32(ws_optarg, NULL, &count) || count > 64)
+                    {
+                        fprintf(stderr, "Invalid number of spare session processes: %s\n", ws_optarg);
+                        return -1;
+                    }
+                    spare_workers = count;
+                    break;
+#else
+                    fprintf(stderr, "--workers isn't supported on Windows\n");
+                    return -1;
+#endif
+                }
+
+                case LONGOPT_MAX_SESSIONS:
+                {
+#ifndef _WIN32
+                    uint32_t count;
+
+                    if (!ws_strtou32(ws_optarg, NULL, &count) || count == 0 || count > SHARKD_WORKERS_MAX)
+                    {
+                        fprintf(stderr, "Invalid maximum number of sessions: %s\n", ws_optarg);
+                        return -1;
+                    }
+                    max_workers = count;
+                    break;
+#else
+                    fprintf(stderr, "--max-sessions isn't supported on Windows\n");
+                    return -1;
+#endif
+                }
+
                 default:
                     /* wslog arguments are okay */
                     if (ws_log_is_wslog_arg(opt))
@@ -417,6 +498,291 @@ sharkd_init(int argc, char **argv)
     return 0;
 }
 
+#ifndef _WIN32
+static void
+sharkd_worker_sigchld(int signum _U_)
+{
+    int saved_errno = errno;
+
+    /* Wake up the daemon so it can reap the session process. */
+    if (write(worker_notify_fd, "", 1) == -1)
+    {
+        /* The pipe is full, the daemon is going to wake up anyway. */
+    }
+    errno = saved_errno;
+}
+
+/*
+ * Runs in a spare session process: wait for a client and serve it.
+ */
+WS_NORETURN static void
+sharkd_worker_main(int slot, const struct sigaction *old_sigchld)
+{
+    socket_handle_t fd;
+
+    sigaction(SIGCHLD, old_sigchld, NULL);
+    worker_slot = slot;
+
+    /* Everything that doesn't depend on the client. */
+    sharkd_session_init(mode);
+
+    while (1)
+    {
+        fd = accept(_server_fd, NULL, NULL);
+        if (fd == INVALID_SOCKET)
+        {
+            if (errno != EINTR)
+                fprintf(stderr, "cannot accept(): %s\n", g_strerror(errno));
+            continue;
+        }
+
+        if (abstract_socket)
+        {
+            if (!ws_verify_peercred(fd)) {
+                fprintf(stderr, "Unauthorized access. Terminating connection.\n");
+                closesocket(fd);
+                continue;
+            }
+        }
+        break;
+    }
+
+    closesocket(_server_fd);
+
+    workers[slot].started = (int64_t) time(NULL);
+    workers[slot].busy = 1;
+
+    /* Tell the daemon to fork our replacement. */
+    if (write(worker_notify_fd, "", 1) == -1)
+    {
+        /* The pipe is full, the daemon is going to wake up anyway. */
+    }
+    close(worker_notify_fd);
+
+    /* redirect stdin, stdout to socket */
+    dup2(fd, 0);
+    dup2(fd, 1);
+    close(fd);
+
+    exit(sharkd_session_main(mode));
+}
+
+static void
+sharkd_workers_reap(void)
+{
+    pid_t pid;
+
+    while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+    {
+        for (unsigned i = 0; i < SHARKD_WORKERS_MAX; i++)
+        {
+            if (workers[i].pid == pid)
+            {
+                workers[i].pid = 0;
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * Fork session processes until spare_workers of them are waiting for
+ * clients, or max_workers of them are running.
+ *
+ * Returns the number of session processes waiting for clients.
+ */
+static unsigned
+sharkd_workers_spawn(const struct sigaction *old_sigchld)
+{
+    unsigned idle = 0;
+
+    for (unsigned i = 0; i < max_workers; i++)
+    {
+        if (workers[i].pid != 0 && !workers[i].busy)
+            idle++;
+    }
+
+    for (unsigned i = 0; i < max_workers && idle < spare_workers; i++)
+    {
+        pid_t pid;
+
+        if (workers[i].pid != 0)
+            continue;
+
+        workers[i].pid = -1;
+        workers[i].busy = 0;
+        workers[i].started = 0;
+        workers[i].requests = 0;
+        workers[i].frames = 0;
+
+        pid = fork();
+        if (pid == 0)
+            sharkd_worker_main(i, old_sigchld);
+
+        if (pid == -1)
+        {
+            fprintf(stderr, "cannot fork(): %s\n", g_strerror(errno));
+            workers[i].pid = 0;
+            return idle;
+        }
+        workers[i].pid = pid;
+        idle++;
+    }
+    return idle;
+}
+
+/*
+ * Accept a client while no session process can, tell it why it isn't
+ * going to be served, and hang up.
+ */
+static void
+sharkd_workers_refuse(void)
+{
+    static const char refusal[] =
+        "{\"jsonrpc\":\"2.0\",\"id\":null,\"error\":{\"code\":-32000,"
+        "\"message\":\"Too many sessions; try again later\"}}\n";
+    socket_handle_t fd;
+
+    fd = accept(_server_fd, NULL, NULL);
+    if (fd == INVALID_SOCKET)
+        return;
+
+    if (write(fd, refusal, sizeof(refusal) - 1) == -1)
+    {
+        /* The client will see the connection closed instead. */
+    }
+    closesocket(fd);
+}
+
+/*
+ * Keep spare_workers session processes waiting for clients, until we're
+ * killed.
+ */
+static int
+sharkd_workers_loop(void)
+{
+    struct sigaction action, old_sigchld;
+    int notify_pipe[2];
+    bool refusing = false;
+
+    workers = (struct sharkd_worker *) mmap(NULL, SHARKD_WORKERS_MAX * sizeof(struct sharkd_worker),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (workers == MAP_FAILED)
+    {
+        fprintf(stderr, "cannot allocate the session process table: %s\n", g_strerror(errno));
+        workers = NULL;
+        return -1;
+    }
+
+    if (pipe(notify_pipe) == -1)
+    {
+        fprintf(stderr, "cannot create pipe: %s\n", g_strerror(errno));
+        return -1;
+    }
+    fcntl(notify_pipe[1], F_SETFL, fcntl(notify_pipe[1], F_GETFL) | O_NONBLOCK);
+    worker_notify_fd = notify_pipe[1];
+
+    /* We have to know which session processes exited. */
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sharkd_worker_sigchld;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGCHLD, &action, &old_sigchld);
+
+    while (1)
+    {
+        struct pollfd fds[2];
+        unsigned idle;
+        char buf[64];
+
+        sharkd_workers_reap();
+        idle = sharkd_workers_spawn(&old_sigchld);
+
+        /* Without a session process waiting, clients would hang in accept(). */
+        if (idle == 0 && !refusing)
+            ws_warning("No session process is available (at most %u); refusing new clients",
+                    max_workers);
+        else if (idle > 0 && refusing)
+            ws_message("Session processes are available again; accepting new clients");
+        refusing = (idle == 0);
+
+        fds[0].fd = notify_pipe[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = _server_fd;
+        fds[1].events = POLLIN;
+        if (poll(fds, refusing ? 2 : 1, -1) == -1)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "cannot poll(): %s\n", g_strerror(errno));
+            return -1;
+        }
+
+        if (refusing && (fds[1].revents & POLLIN))
+            sharkd_workers_refuse();
+
+        if ((fds[0].revents & POLLIN) &&
+            read(notify_pipe[0], buf, sizeof(buf)) == -1 && errno != EINTR)
+        {
+            fprintf(stderr, "cannot read from pipe: %s\n", g_strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void
+sharkd_worker_note_request(uint32_t frames)
+{
+    if (workers == NULL || worker_slot < 0)
+        return;
+
+    workers[worker_slot].requests++;
+    workers[worker_slot].frames = frames;
+}
+
+unsigned
+sharkd_worker_get_info(sharkd_worker_info_t **info)
+{
+    unsigned count = 0;
+
+    *info = NULL;
+    if (workers == NULL)
+        return 0;
+
+    *info = g_new(sharkd_worker_info_t, SHARKD_WORKERS_MAX);
+    for (unsigned i = 0; i < SHARKD_WORKERS_MAX; i++)
+    {
+        sharkd_worker_info_t *worker = &(*info)[count];
+        pid_t pid = workers[i].pid;
+
+        if (pid <= 0)
+            continue;
+
+        worker->pid = (int) pid;
+        worker->self = ((int) i == worker_slot);
+        worker->busy = workers[i].busy != 0;
+        worker->started = workers[i].started;
+        worker->requests = workers[i].requests;
+        worker->frames = workers[i].frames;
+        count++;
+    }
+    return count;
+}
+#else
+void
+sharkd_worker_note_request(uint32_t frames _U_)
+{
+}
+
+unsigned
+sharkd_worker_get_info(sharkd_worker_info_t **info)
+{
+    *info = NULL;
+    return 0;
+}
+#endif
+
 int
 #ifndef _WIN32
 sharkd_loop(int argc _U_, char* argv[] _U_)
@@ -429,6 +795,11 @@ sharkd_loop(int argc _U_, char* argv[])
         return sharkd_session_main(mode);
     }
 
+#ifndef _WIN32
+    if (spare_workers > 0)
+        return sharkd_workers_loop();
+#endif
+
     while (1)
     {
 #ifndef _WIN32
@@ -77,12 +77,60 @@
 
 #include "sharkd.h"
 
+/*
+ * The frames matching a filter are kept as a roaring-style compressed
+ * bitset: frame numbers are split into chunks by their upper 16 bits,
+ * and each chunk is stored as a sorted array of the lower 16 bits of
+ * the matching frames, as a bitmap, or not at all if none or all of
+ * its frames match, whichever is smallest.
+ */
+#define SHARKD_BITSET_CHUNK_SHIFT   16
+#define SHARKD_BITSET_CHUNK_FRAMES  (1U << SHARKD_BITSET_CHUNK_SHIFT)
+#define SHARKD_BITSET_BITMAP_WORDS  (SHARKD_BITSET_CHUNK_FRAMES / 64)
+/* An array of this many uint16_t is as big as a bitmap. */
+#define SHARKD_BITSET_ARRAY_MAX     (SHARKD_BITSET_CHUNK_FRAMES / 16)
+
+/* The filter cache evicts the least recently used filters beyond this. */
+#define SHARKD_FILTER_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
+enum sharkd_bitset_chunk_type
+{
+    SHARKD_BITSET_CHUNK_NONE,
+    SHARKD_BITSET_CHUNK_ALL,
+    SHARKD_BITSET_CHUNK_ARRAY,
+    SHARKD_BITSET_CHUNK_BITMAP
+};
+
+struct sharkd_bitset_chunk
+{
+    enum sharkd_bitset_chunk_type type;
+    uint32_t count;     /* number of entries in array */
+    union {
+        uint16_t *array;
+        uint64_t *bitmap;
+    } u;
+};
+
 struct sharkd_filter_item
 {
-    uint8_t *filtered; /* can be NULL if all frames are matching for given filter. */
+    char *filter;
+    bool all_match;     /* the filter is empty, every frame matches */
+    unsigned num_chunks;
+    struct sharkd_bitset_chunk *chunks;
+    size_t size;        /* bytes accounted to the filter cache */
+    GList lru_link;     /* link in filter_lru */
 };
 
 static GHashTable *filter_table;
+static GQueue filter_lru = G_QUEUE_INIT; /* most recently used first */
+
+static struct
+{
+    size_t bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} filter_cache;
 
 static int mode;
 static uint32_t rpcid;
@@ -739,29 +787,171 @@ sharkd_session_filter_free(void *data)
 {
     struct sharkd_filter_item *l = (struct sharkd_filter_item *) data;
 
-    g_free(l->filtered);
+    g_queue_unlink(&filter_lru, &l->lru_link);
+    filter_cache.bytes -= l->size;
+
+    for (unsigned i = 0; i < l->num_chunks; i++)
+    {
+        if (l->chunks[i].type == SHARKD_BITSET_CHUNK_ARRAY)
+            g_free(l->chunks[i].u.array);
+        else if (l->chunks[i].type == SHARKD_BITSET_CHUNK_BITMAP)
+            g_free(l->chunks[i].u.bitmap);
+    }
+    g_free(l->chunks);
+    g_free(l->filter);
     g_free(l);
 }
 
+static inline bool
+sharkd_filter_bit_is_set(const uint8_t *filtered, uint32_t framenum)
+{
+    return (filtered[framenum / 8] & (1 << (framenum % 8))) != 0;
+}
+
+/*
+ * Compresses the bitmap returned by sharkd_filter().
+ */
+static void
+sharkd_session_filter_compress(struct sharkd_filter_item *l, const uint8_t *filtered, uint32_t frames_count)
+{
+    l->num_chunks = (frames_count >> SHARKD_BITSET_CHUNK_SHIFT) + 1;
+    l->chunks = g_new0(struct sharkd_bitset_chunk, l->num_chunks);
+    l->size += l->num_chunks * sizeof(struct sharkd_bitset_chunk);
+
+    for (unsigned i = 0; i < l->num_chunks; i++)
+    {
+        struct sharkd_bitset_chunk *chunk = &l->chunks[i];
+        uint32_t first = i << SHARKD_BITSET_CHUNK_SHIFT;
+        uint32_t last = first + (SHARKD_BITSET_CHUNK_FRAMES - 1);
+        uint32_t matched = 0;
+
+        /* There's no frame 0. */
+        if (first == 0)
+            first = 1;
+        if (last > frames_count)
+            last = frames_count;
+
+        for (uint32_t framenum = first; framenum <= last; framenum++)
+            if (sharkd_filter_bit_is_set(filtered, framenum))
+                matched++;
+
+        if (matched == 0)
+        {
+            chunk->type = SHARKD_BITSET_CHUNK_NONE;
+        }
+        else if (matched == last - first + 1)
+        {
+            chunk->type = SHARKD_BITSET_CHUNK_ALL;
+        }
+        else if (matched <= SHARKD_BITSET_ARRAY_MAX)
+        {
+            chunk->type = SHARKD_BITSET_CHUNK_ARRAY;
+            chunk->u.array = g_new(uint16_t, matched);
+            for (uint32_t framenum = first; framenum <= last; framenum++)
+                if (sharkd_filter_bit_is_set(filtered, framenum))
+                    chunk->u.array[chunk->count++] = (uint16_t) framenum;
+            l->size += matched * sizeof(uint16_t);
+        }
+        else
+        {
+            chunk->type = SHARKD_BITSET_CHUNK_BITMAP;
+            chunk->u.bitmap = g_new0(uint64_t, SHARKD_BITSET_BITMAP_WORDS);
+            for (uint32_t framenum = first; framenum <= last; framenum++)
+                if (sharkd_filter_bit_is_set(filtered, framenum))
+                    chunk->u.bitmap[(framenum & 0xffff) / 64] |= UINT64_C(1) << (framenum % 64);
+            l->size += SHARKD_BITSET_BITMAP_WORDS * sizeof(uint64_t);
+        }
+    }
+}
+
+static bool
+sharkd_session_filter_matches(const struct sharkd_filter_item *l, uint32_t framenum)
+{
+    const struct sharkd_bitset_chunk *chunk;
+    uint16_t low = (uint16_t) framenum;
+
+    if (l->all_match)
+        return true;
+
+    if ((framenum >> SHARKD_BITSET_CHUNK_SHIFT) >= l->num_chunks)
+        return false;
+
+    chunk = &l->chunks[framenum >> SHARKD_BITSET_CHUNK_SHIFT];
+    switch (chunk->type)
+    {
+        case SHARKD_BITSET_CHUNK_NONE:
+            return false;
+
+        case SHARKD_BITSET_CHUNK_ALL:
+            return true;
+
+        case SHARKD_BITSET_CHUNK_ARRAY:
+        {
+            uint32_t lo = 0, hi = chunk->count;
+
+            while (lo < hi)
+            {
+                uint32_t mid = lo + (hi - lo) / 2;
+
+                if (chunk->u.array[mid] < low)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo < chunk->count && chunk->u.array[lo] == low;
+        }
+
+        case SHARKD_BITSET_CHUNK_BITMAP:
+            return (chunk->u.bitmap[low / 64] & (UINT64_C(1) << (low % 64))) != 0;
+    }
+
+    return false;
+}
+
 static const struct sharkd_filter_item *
 sharkd_session_filter_data(const char *filter)
 {
     struct sharkd_filter_item *l;
 
     l = (struct sharkd_filter_item *) g_hash_table_lookup(filter_table, filter);
-    if (!l)
+    if (l)
     {
-        uint8_t *filtered = NULL;
+        filter_cache.hits++;
+        g_queue_unlink(&filter_lru, &l->lru_link);
+        g_queue_push_head_link(&filter_lru, &l->lru_link);
+        return l;
+    }
+
+    uint8_t *filtered = NULL;
 
-        int ret = sharkd_filter(filter, &filtered);
+    int ret = sharkd_filter(filter, &filtered);
 
-        if (ret == -1)
-            return NULL;
+    if (ret == -1)
+        return NULL;
 
-        l = g_new(struct sharkd_filter_item, 1);
-        l->filtered = filtered;
+    filter_cache.misses++;
 
-        g_hash_table_insert(filter_table, g_strdup(filter), l);
+    l = g_new0(struct sharkd_filter_item, 1);
+    l->filter = g_strdup(filter);
+    l->lru_link.data = l;
+    l->size = sizeof(*l) + strlen(filter) + 1;
+    if (filtered)
+        sharkd_session_filter_compress(l, filtered, cfile.count);
+    else
+        l->all_match = true;
+    g_free(filtered);
+
+    g_hash_table_insert(filter_table, l->filter, l);
+    g_queue_push_head_link(&filter_lru, &l->lru_link);
+    filter_cache.bytes += l->size;
+
+    /* Never evict the filter we're about to return. */
+    while (filter_cache.bytes > SHARKD_FILTER_CACHE_MAX_BYTES && filter_lru.length > 1)
+    {
+        struct sharkd_filter_item *lru = (struct sharkd_filter_item *) filter_lru.tail->data;
+
+        g_hash_table_remove(filter_table, lru->filter);
+        filter_cache.evictions++;
     }
 
     return l;
@@ -1451,6 +1641,38 @@ sharkd_session_process_status(void)
         sharkd_json_array_close();
     }
 
+    sharkd_json_object_open("filter_cache");
+    sharkd_json_value_anyf("entries", "%u", g_hash_table_size(filter_table));
+    sharkd_json_value_anyf("bytes", "%zu", filter_cache.bytes);
+    sharkd_json_value_anyf("max_bytes", "%d", SHARKD_FILTER_CACHE_MAX_BYTES);
+    sharkd_json_value_anyf("hits", "%" PRIu64, filter_cache.hits);
+    sharkd_json_value_anyf("misses", "%" PRIu64, filter_cache.misses);
+    sharkd_json_value_anyf("evictions", "%" PRIu64, filter_cache.evictions);
+    sharkd_json_object_close();
+
+    sharkd_worker_info_t *workers;
+    unsigned num_workers = sharkd_worker_get_info(&workers);
+
+    if (num_workers > 0)
+    {
+        sharkd_json_array_open("workers");
+        for (unsigned i = 0; i < num_workers; i++)
+        {
+            sharkd_json_object_open(NULL);
+            sharkd_json_value_anyf("pid", "%d", workers[i].pid);
+            if (workers[i].self)
+                sharkd_json_value_anyf("self", "true");
+            sharkd_json_value_anyf("busy", workers[i].busy ? "true" : "false");
+            if (workers[i].busy)
+                sharkd_json_value_anyf("connected", "%" PRId64, workers[i].started);
+            sharkd_json_value_anyf("requests", "%" PRIu64, workers[i].requests);
+            sharkd_json_value_anyf("frames", "%u", workers[i].frames);
+            sharkd_json_object_close();
+        }
+        sharkd_json_array_close();
+    }
+    g_free(workers);
+
     sharkd_json_result_epilogue();
 }
 
@@ -1728,7 +1950,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
     const char *tok_limit  = json_find_attr(buf, tokens, count, "limit");
     const char *tok_refs   = json_find_attr(buf, tokens, count, "refs");
 
-    const uint8_t *filter_data = NULL;
+    const struct sharkd_filter_item *filter_item = NULL;
 
     uint32_t prev_dis_num = 0;
     uint32_t current_ref_frame = 0, next_ref_frame = UINT32_MAX;
@@ -1755,8 +1977,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
 
     if (tok_filter)
     {
-        const struct sharkd_filter_item *filter_item;
-
         filter_item = sharkd_session_filter_data(tok_filter);
         if (!filter_item)
         {
@@ -1766,8 +1986,6 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
                     );
             return;
         }
-
-        filter_data = filter_item->filtered;
     }
 
     skip = 0;
@@ -1802,7 +2020,7 @@ sharkd_session_process_frames(const char *buf, const jsmntok_t *tokens, int coun
         int err;
         char *err_info;
 
-        if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
+        if (filter_item && !sharkd_session_filter_matches(filter_item, framenum))
             continue;
 
         if (skip)
@@ -4891,7 +5109,7 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
     const char *tok_interval = json_find_attr(buf, tokens, count, "interval");
     const char *tok_filter = json_find_attr(buf, tokens, count, "filter");
 
-    const uint8_t *filter_data = NULL;
+    const struct sharkd_filter_item *filter_item = NULL;
 
     struct
     {
@@ -4911,8 +5129,6 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
 
     if (tok_filter)
     {
-        const struct sharkd_filter_item *filter_item;
-
         filter_item = sharkd_session_filter_data(tok_filter);
         if (!filter_item)
         {
@@ -4922,7 +5138,6 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
                     );
             return;
         }
-        filter_data = filter_item->filtered;
     }
 
     st_total.frames = 0;
@@ -4944,7 +5159,7 @@ sharkd_session_process_intervals(char *buf, const jsmntok_t *tokens, int count)
         int64_t msec_rel;
         int64_t new_idx;
 
-        if (filter_data && !(filter_data[framenum / 8] & (1 << (framenum % 8))))
+        if (filter_item && !sharkd_session_filter_matches(filter_item, framenum))
             continue;
 
         fdata = sharkd_get_frame(framenum);
@@ -6193,26 +6408,36 @@ sharkd_session_process(char *buf, const jsmntok_t *tokens, int count)
     }
 }
 
-int
-sharkd_session_main(int mode_setting)
+void
+sharkd_session_init(int mode_setting)
 {
-    char buf[8 * 1024];
-    jsmntok_t *tokens = NULL;
-    int tokens_max = -1;
+    if (filter_table)
+        return;
 
     mode = mode_setting;
 
-    fprintf(stderr, "Hello in child.\n");
-
     dumper.output_file = stdout;
 
     /* XXX - This could be a wmem_map_new_autoreset(wmem_epan_scope(), wmem_file_scope(),...) */
-    filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sharkd_session_filter_free);
+    /* The key is owned by the item. */
+    filter_table = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, sharkd_session_filter_free);
 
 #ifdef HAVE_MAXMINDDB
     /* mmdbresolve was stopped before fork(), force starting it */
     uat_get_table_by_name("MaxMind Database Paths")->post_update_cb();
 #endif
+}
+
+int
+sharkd_session_main(int mode_setting)
+{
+    char buf[8 * 1024];
+    jsmntok_t *tokens = NULL;
+    int tokens_max = -1;
+
+    sharkd_session_init(mode_setting);
+
+    fprintf(stderr, "Hello in child.\n");
 
     while (fgets(buf, sizeof(buf), stdin))
     {
@@ -6253,6 +6478,7 @@ sharkd_session_main(int mode_setting)
         host_name_lookup_process();
 
         sharkd_session_process(buf, tokens, ret);
+        sharkd_worker_note_request(cfile.count);
     }
 
     g_hash_table_destroy(filter_table);
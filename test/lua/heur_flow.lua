@@ -0,0 +1,24 @@
+-- Define two heuristic UDP dissectors that both accept some packets
+--
+-- "heura" accepts payloads that start with "A" or "X", and "heurb" those that
+-- start with "B" or "X", so which one gets an "X" packet depends on which one
+-- is tried first.
+local heura = Proto("heura", "Heuristic Flow Test A")
+local heurb = Proto("heurb", "Heuristic Flow Test B")
+
+local function heur_dissector(proto, first)
+    return function (buf, pinfo, root)
+        if buf:len() < 1 then
+            return false
+        end
+        local c = string.char(buf(0, 1):uint())
+        if c ~= first and c ~= "X" then
+            return false
+        end
+        root:add(proto, buf())
+        return true
+    end
+end
+
+heura:register_heuristic("udp", heur_dissector(heura, "A"))
+heurb:register_heuristic("udp", heur_dissector(heurb, "B"))
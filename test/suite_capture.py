@@ -11,7 +11,9 @@
 import glob
 import hashlib
 import os
+import re
 import socket
+import struct
 import subprocess
 import sys
 import sysconfig
@@ -35,6 +37,7 @@ capture_duration = 5
 testout_pcap = 'testout.pcap'
 testout_pcapng = 'testout.pcapng'
 snapshot_len = 96
+queue_packet_len = 1400
 
 class UdpTrafficGenerator(threading.Thread):
     def __init__(self):
@@ -270,6 +273,115 @@ def check_dumpcap_autostop_stdin(cmd_dumpcap, cmd_capinfos, result_file):
     return check_dumpcap_autostop_stdin_real
 
 
+@pytest.fixture
+def check_dumpcap_packet_queue(cmd_dumpcap):
+    if sys.platform == 'win32':
+        pytest.skip('Test requires OS pipe support.')
+
+    def make_packet(seq):
+        # A sequence number followed by a pattern derived from it, so
+        # that a packet overwritten or cut at the point where the queue
+        # wraps around shows up as a mismatch.
+        return struct.pack('<I', seq) + bytes((seq + i) & 0xff for i in range(queue_packet_len - 4))
+
+    def read_pcap(data):
+        magic = data[:4]
+        if magic in (b'\xd4\xc3\xb2\xa1', b'\x4d\x3c\xb2\xa1'):
+            endian = '<'
+        elif magic in (b'\xa1\xb2\xc3\xd4', b'\xa1\xb2\x3c\x4d'):
+            endian = '>'
+        else:
+            raise AssertionError(f'Not a pcap file: {magic!r}')
+        offset = 24
+        packets = []
+        while offset < len(data):
+            _, _, caplen, _ = struct.unpack_from(endian + 'IIII', data, offset)
+            offset += 16
+            packets.append(data[offset:offset + caplen])
+            offset += caplen
+        return packets
+
+    def read_sync_pipe(data):
+        # Messages from a capture child: a one byte indicator, a three
+        # byte length and the message.
+        offset = 0
+        messages = []
+        while offset < len(data):
+            indicator = chr(data[offset])
+            msg_len = int.from_bytes(data[offset + 1:offset + 4], 'big')
+            messages.append((indicator, data[offset + 4:offset + 4 + msg_len].decode('UTF-8', 'replace')))
+            offset += 4 + msg_len
+        return messages
+
+    def check_dumpcap_packet_queue_real(self, byte_limit, packet_count, block_output=False, child=False, env=None):
+        capture_cmd = capture_command(cmd_dumpcap,
+            '-i', '-',
+            '-P',
+            '-C', str(byte_limit),
+            '-w', '-',
+        )
+        if child:
+            # Send the sync pipe messages to stderr, with frequent updates.
+            capture_cmd += ['-Z', 'none', '--update-interval', '10']
+        proc = subprocess.Popen(capture_cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.PIPE, env=env)
+
+        def write_input():
+            # Ethernet link-layer type; dumpcap doesn't look at the data.
+            proc.stdin.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            for seq in range(packet_count):
+                pkt = make_packet(seq)
+                proc.stdin.write(struct.pack('<IIII', seq, 0, len(pkt), len(pkt)) + pkt)
+            proc.stdin.close()
+
+        writer = threading.Thread(target=write_input)
+        writer.start()
+        if block_output:
+            # Don't read anything until all of the input has been queued
+            # or dropped. The main thread blocks writing to the full
+            # stdout pipe, so the capture thread has to drop packets
+            # once the queue is full.
+            writer.join(timeout=60)
+            assert not writer.is_alive()
+        stdout = proc.stdout.read()
+        stderr = proc.stderr.read()
+        writer.join()
+        assert proc.wait(timeout=60) == 0
+        packets = read_pcap(stdout)
+
+        if child:
+            # The queue usage is reported while capturing and at the end,
+            # as "packets:bytes:max_packets:max_bytes:size:name".
+            messages = read_sync_pipe(stderr)
+            usages = [tuple(int(n) for n in msg.split(':')[:5]) for ind, msg in messages if ind == 'U']
+            drops = [int(msg.split(':')[0]) for ind, msg in messages if ind == 'D']
+            assert len(usages) > 0 and len(drops) == 1
+            for prev, cur in zip(usages, usages[1:]):
+                assert cur[2] >= prev[2] and cur[3] >= prev[3]
+            _, _, _, max_bytes, buffer_size = usages[-1]
+            received, dropped = len(packets), drops[0]
+        else:
+            stderr = stderr.decode('UTF-8', 'replace')
+            drops = re.search(r"Packets received/dropped on interface '.*': (\d+)/(\d+)", stderr)
+            usage = re.search(r"Packet queue of interface '.*': at most (\d+) packets/(\d+) bytes \(buffer (\d+) bytes", stderr)
+            assert drops is not None and usage is not None
+            received, dropped = int(drops.group(1)), int(drops.group(2))
+            max_bytes, buffer_size = int(usage.group(2)), int(usage.group(3))
+
+        # Every packet is either written or dropped, the ones written are
+        # intact and in order, and the queue stays within its limit.
+        assert received + dropped == packet_count
+        assert len(packets) == received
+        last_seq = -1
+        for pkt in packets:
+            seq = struct.unpack_from('<I', pkt)[0]
+            assert seq > last_seq
+            assert pkt == make_packet(seq)
+            last_seq = seq
+        assert max_bytes < byte_limit + queue_packet_len
+        return received, dropped, buffer_size
+    return check_dumpcap_packet_queue_real
+
+
 @pytest.fixture
 def check_dumpcap_ringbuffer_stdin(cmd_dumpcap, cmd_capinfos, result_file):
     def check_dumpcap_ringbuffer_stdin_real(self, packets=None, filesize=None, env=None):
@@ -582,6 +694,26 @@ class TestDumpcapRingbuffer:
         check_dumpcap_ringbuffer_stdin(self, packets=47, env=base_env) # Last prime before 50. Arbitrary.
 
 
+class TestDumpcapPacketQueue:
+    def test_dumpcap_packet_queue_wraparound(self, check_dumpcap_packet_queue, base_env):
+        '''Queue several times the ring buffer size through a capture thread'''
+        packet_count = 5000
+        received, dropped, buffer_size = check_dumpcap_packet_queue(self, 64 * 1024, packet_count, env=base_env)
+        assert received * queue_packet_len > 2 * buffer_size
+
+    def test_dumpcap_packet_queue_overflow(self, check_dumpcap_packet_queue, base_env):
+        '''Drop packets once the queue is full and the output is blocked'''
+        received, dropped, buffer_size = check_dumpcap_packet_queue(self, 64 * 1024, 5000, block_output=True, env=base_env)
+        assert received > 0
+        assert dropped > 0
+
+    def test_dumpcap_packet_queue_child(self, check_dumpcap_packet_queue, base_env):
+        '''Report the queue usage to the parent of a capture child'''
+        received, dropped, buffer_size = check_dumpcap_packet_queue(self, 64 * 1024, 5000, block_output=True, child=True, env=base_env)
+        assert received > 0
+        assert dropped > 0
+
+
 class TestDumpcapPcapngSections:
     def test_dumpcap_pcapng_single_in_single_out(self, check_dumpcap_pcapng_sections, base_env):
         '''Capture from a single pcapng source using Dumpcap and write a single file'''
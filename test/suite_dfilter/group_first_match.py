@@ -0,0 +1,139 @@
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+'''Filters combined into one program that finds the first one to match,
+as the coloring rules are.'''
+
+import os.path
+import re
+import subprocess
+
+import pytest
+
+
+@pytest.fixture
+def first_match_program(cmd_dftest, dfilter_env):
+    def first_match_program_real(filters):
+        '''Returns the instructions of the combined program, as (opcode, args) tuples.'''
+        proc = subprocess.run((cmd_dftest, '--first-match', '--file', '-'),
+            input='\n'.join(filters) + '\n', capture_output=True, check=True,
+            encoding='utf-8', env=dfilter_env)
+        insns = []
+        for line in proc.stdout.split('Instructions:', 1)[1].splitlines():
+            m = re.match(r' (\d{4}) (\S+)\s*(.*)$', line)
+            if m:
+                assert int(m.group(1)) == len(insns)
+                insns.append((m.group(2), m.group(3).strip()))
+        return insns
+    return first_match_program_real
+
+
+@pytest.fixture
+def coloring_rule_names(cmd_tshark, capture_file, conf_path, dfilter_env):
+    def coloring_rule_names_real(trace_file, rules, paused=()):
+        '''Returns the name of the coloring rule each frame gets.'''
+        with open(os.path.join(conf_path, 'colorfilters'), 'w') as f:
+            for name, dfilter in rules:
+                f.write(f'@{name}@{dfilter}@[0,0,0][65535,65535,65535]\n')
+        with open(os.path.join(conf_path, 'paused_filters'), 'w') as f:
+            for name in paused:
+                f.write(name + '\n')
+        proc = subprocess.run((cmd_tshark, '-n', '--color',
+            '-r', capture_file(trace_file),
+            '-o', 'gui.packet_list_multi_color_details:FALSE',
+            '-T', 'fields', '-e', 'frame.coloring_rule.name'),
+            capture_output=True, check=True, encoding='utf-8', env=dfilter_env)
+        return proc.stdout.splitlines()
+    return coloring_rule_names_real
+
+
+def register_of(args):
+    return args.rsplit('-> ', 1)[1]
+
+
+class TestDfilterFirstMatchProgram:
+    def test_match_index(self, first_match_program):
+        '''Each filter ends with a MATCH of its index, and the program with RETURN'''
+        insns = first_match_program(('ip.src == 192.168.0.1', 'udp', 'tcp'))
+        assert [args for op, args in insns if op == 'MATCH'] == ['0', '1', '2']
+        assert insns[-1][0] == 'RETURN'
+        assert 'RETURN' not in [op for op, args in insns[:-1]]
+
+    def test_shared_field(self, first_match_program):
+        '''A field read whole by several filters goes into one register'''
+        insns = first_match_program(('ip.src == 192.168.0.1 && udp',
+            'tcp', 'ip.src == 0.0.0.0 || ip.dst == 0.0.0.0'))
+        reads = [args for op, args in insns if op == 'READ_TREE' and args.startswith('ip.src')]
+        assert len(reads) == 2
+        assert register_of(reads[0]) == register_of(reads[1])
+        dst_reads = [args for op, args in insns if op == 'READ_TREE' and args.startswith('ip.dst')]
+        assert register_of(dst_reads[0]) != register_of(reads[0])
+
+    def test_layer_reads(self, first_match_program):
+        '''Reads of layers of a field keep registers of their own'''
+        insns = first_match_program(('ip.src#2 == 192.168.0.1',
+            'ip.src == 192.168.0.1', 'ip.src#1 == 0.0.0.0'))
+        whole = [register_of(args) for op, args in insns if op == 'READ_TREE']
+        layers = [register_of(args) for op, args in insns if op == 'READ_TREE_R']
+        assert len(whole) == 1
+        assert len(layers) == 2
+        assert len(set(whole + layers)) == 3
+
+    def test_jumps(self, first_match_program):
+        '''Jumps of each filter stay within it, ending at most at its MATCH'''
+        insns = first_match_program(('udp || tcp', 'ip && (udp || tcp)',
+            'ip.src == 192.168.0.1 && !udp'))
+        start = 0
+        jumps = 0
+        for i, (op, args) in enumerate(insns):
+            if op in ('IF_TRUE_GOTO', 'IF_FALSE_GOTO'):
+                end = next(j for j in range(i, len(insns)) if insns[j][0] == 'MATCH')
+                assert start < int(args) <= end
+                jumps += 1
+            elif op == 'MATCH':
+                start = i + 1
+        assert jumps >= 4
+
+
+class TestDfilterFirstMatchColoring:
+    trace_file = 'dhcp.pcap'
+
+    def test_first_match(self, coloring_rule_names):
+        '''Each frame gets the first rule that matches it'''
+        assert coloring_rule_names(self.trace_file, (
+            ('offer', 'dhcp.option.dhcp == 2'),
+            ('server', 'ip.src == 192.168.0.1'),
+            ('any', 'udp'),
+        )) == ['any', 'offer', 'any', 'server']
+
+    def test_shared_field(self, coloring_rule_names):
+        '''A field read once is right for every rule that tests it'''
+        assert coloring_rule_names(self.trace_file, (
+            ('offer', 'ip.src == 192.168.0.1 && dhcp.option.dhcp == 2'),
+            ('request', 'ip.src == 0.0.0.0 && dhcp.option.dhcp == 3'),
+            ('server', 'ip.src == 192.168.0.1'),
+            ('client', 'ip.src == 0.0.0.0'),
+        )) == ['client', 'offer', 'request', 'server']
+
+    def test_layer_reads(self, coloring_rule_names):
+        '''Reading a layer of a field doesn't change what other rules read'''
+        assert coloring_rule_names(self.trace_file, (
+            ('second', 'ip.src#2 == 192.168.0.1'),
+            ('first', 'ip.src#1 == 0.0.0.0'),
+            ('server', 'ip.src == 192.168.0.1'),
+        )) == ['first', 'server', 'first', 'server']
+
+    def test_jumps(self, coloring_rule_names):
+        '''Rules with || and && after other rules jump within themselves'''
+        assert coloring_rule_names(self.trace_file, (
+            ('none', 'dhcp.option.dhcp == 9 || dhcp.option.dhcp == 8'),
+            ('discover_ack', 'dhcp.option.dhcp == 1 || dhcp.option.dhcp == 5'),
+            ('offer_request', 'udp && (dhcp.option.dhcp == 2 || dhcp.option.dhcp == 3)'),
+        )) == ['discover_ack', 'offer_request', 'offer_request', 'discover_ack']
+
+    def test_paused(self, coloring_rule_names):
+        '''A rule paused for the session lets the frames it matches fall through'''
+        assert coloring_rule_names(self.trace_file, (
+            ('offer', 'dhcp.option.dhcp == 2'),
+            ('server', 'ip.src == 192.168.0.1'),
+        ), paused=('offer',)) == ['', 'server', '', 'server']
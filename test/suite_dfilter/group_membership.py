@@ -133,3 +133,49 @@ class TestDfilterMembership:
     def test_membership_rhs_field(self, checkDFilterCount):
         dfilter = 'eth.src in { eth.addr }'
         checkDFilterCount(dfilter, 1)
+
+    # Sets of 8 or more constants are indexed when the filter is compiled.
+
+    def test_membership_indexed_match(self, checkDFilterCount):
+        dfilter = 'tcp.port in {21, 22, 23, 25, 53, 80, 110, 143, 443}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_indexed_no_match(self, checkDFilterCount):
+        dfilter = 'tcp.port in {21, 22, 23, 25, 53, 110, 143, 443, 993}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_indexed_not_in(self, checkDFilterCount):
+        dfilter = 'tcp.dstport not in {21, 22, 23, 25, 53, 110, 143, 443, 993}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_indexed_range(self, checkDFilterCount):
+        dfilter = 'tcp.srcport in {1..10, 20..30, 40..50, 60..70, 100..200, 150..300, 3000..3266, 3267..3267}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_indexed_range_no_match(self, checkDFilterCount):
+        dfilter = 'tcp.dstport in {1..10, 20..30, 40..50, 60..70, 81..100, 100..200, 150..300, 3000..3266}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_indexed_all(self, checkDFilterCount):
+        dfilter = 'all tcp.port in {1..10, 20, 30, 40, 50, 60, 70, 80, 3267}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_indexed_all_no_match(self, checkDFilterCount):
+        dfilter = 'all tcp.port in {1..10, 20, 30, 40, 50, 60, 70, 80, 90}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_indexed_subnet(self, checkDFilterCount):
+        dfilter = 'ip.src in {192.168.0.0/16, 172.16.0.0/12, 10.0.0.0/8, 1.1.1.1, 8.8.8.8, 9.9.9.9, 127.0.0.1, 169.254.0.0/16}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_indexed_subnet_no_match(self, checkDFilterCount):
+        dfilter = 'ip.dst in {192.168.0.0/16, 172.16.0.0/12, 10.0.0.0/8, 1.1.1.1, 8.8.8.8, 9.9.9.9, 127.0.0.1, 207.46.134.128/25}'
+        checkDFilterCount(dfilter, 0)
+
+    def test_membership_indexed_subnet_host(self, checkDFilterCount):
+        dfilter = 'ip.dst in {192.168.0.0/16, 172.16.0.0/12, 1.1.1.1, 8.8.8.8, 9.9.9.9, 127.0.0.1, 207.46.134.94, 169.254.0.0/16}'
+        checkDFilterCount(dfilter, 1)
+
+    def test_membership_indexed_string(self, checkDFilterCount):
+        dfilter = 'http.request.method in {"GET", "POST", "PUT", "DELETE", "OPTIONS", "TRACE", "CONNECT", "PATCH", "HEAD"}'
+        checkDFilterCount(dfilter, 1)
@@ -964,6 +964,30 @@ class TestDissectTcp:
             encoding='utf-8', env=test_env)
         assert stdout == '2\t16\n'
 
+    def test_tcp_analysis_high_bdp(self, cmd_tshark, capture_file, test_env):
+        '''
+        Sequence analysis of a flow with 20000 segments in flight, one of
+        them lost and fast retransmitted. See
+        tools/gen-tcp-high-bdp-test-capture.py for the layout.
+        '''
+        stdout = subprocess.check_output((cmd_tshark,
+            '-r', capture_file('tcp-high-bdp.pcap.gz'),
+            '-Tfields', '-eframe.number', '-etcp.analysis.acks_frame',
+            '-etcp.analysis.bytes_in_flight',
+            '-Y', 'tcp.analysis.lost_segment || tcp.analysis.duplicate_ack || '
+                  'tcp.analysis.fast_retransmission || frame.number in {20002, 20003, 25007}',
+            ), encoding='utf-8', env=test_env)
+        assert stdout.splitlines() == [
+            '10004\t\t14482896',   # previous segment not captured
+            '20002\t\t28960000',   # last segment of the window
+            '20003\t5\t',          # first ACK
+            '25003\t\t',           # duplicate ACKs
+            '25004\t\t',
+            '25005\t\t',
+            '25006\t\t14480000',   # fast retransmission
+            '25007\t20002\t',      # ACK of the whole window
+        ]
+
     def test_tcp_rst_diagnostic_compact_iana(self, cmd_tshark, capture_file, test_env):
         '''RST diagnostic payload with IANA reason code (PEN=0).'''
         stdout = subprocess.check_output((cmd_tshark,
@@ -9,6 +9,7 @@
 '''File format conversion tests'''
 
 import os.path
+import struct
 import subprocess
 from pathlib import PurePath
 
@@ -253,6 +254,166 @@ class TestFileFormatsPcapngDsb:
         assert dsb1_contents == dsb1_out
         assert dsb2_contents == dsb2_out
 
+@pytest.fixture
+def compressed_seek_capture(result_file):
+    '''Writes a pcap file big enough to fill several compressed frames.'''
+    def write_capture():
+        path = result_file('compressed-seek.pcap')
+        with open(path, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            for packet in range(3000):
+                data = bytes((packet * 7 + i // 3) & 0xff for i in range(1500))
+                f.write(struct.pack('<IIII', packet, 0, len(data), len(data)))
+                f.write(data)
+        return path
+    return write_capture
+
+
+class TestFileFormatCompressedSeek:
+    # Where the table of frame sizes starts, and how many entries it has,
+    # in a file written by editcap --compress.
+    @staticmethod
+    def seek_table(contents, compression):
+        if compression == 'zstd':
+            count, = struct.unpack_from('<I', contents, len(contents) - 9)
+            return len(contents) - 9 - count * 8, count
+        count, = struct.unpack_from('<I', contents, len(contents) - 10 - 8)
+        return len(contents) - 10 - 8 - count * 8, count
+
+    @staticmethod
+    def check_round_trip(cmd_editcap, cmd_tshark, compressed, contents, result_file, env):
+        # Sequential read.
+        outfile = result_file('compressed-seek-out.pcap')
+        subprocess.run((cmd_editcap, compressed, outfile), check=True, env=env)
+        with open(outfile, 'rb') as f:
+            assert f.read()[24:] == contents[24:]
+        # Two passes; the second one reads every packet with a seek.
+        subprocess.run((cmd_tshark, '-2', '-r', compressed, '-F', 'pcap', '-w', outfile),
+            check=True, env=env)
+        with open(outfile, 'rb') as f:
+            assert f.read()[24:] == contents[24:]
+
+    def check_compressed_seek(self, compression, cmd_editcap, cmd_tshark, compressed_seek_capture, result_file, test_env):
+        infile = compressed_seek_capture()
+        with open(infile, 'rb') as f:
+            contents = f.read()
+        compressed = result_file('compressed-seek.pcap.' + compression)
+        subprocess.run((cmd_editcap, '--compress', compression, infile, compressed),
+            check=True, env=test_env)
+        self.check_round_trip(cmd_editcap, cmd_tshark, compressed, contents, result_file, test_env)
+
+        with open(compressed, 'rb') as f:
+            compressed_contents = bytearray(f.read())
+        table, count = self.seek_table(compressed_contents, compression)
+        assert count > 2
+
+        # A table whose sizes add up, but which puts the second frame in
+        # the wrong place, must be ignored.
+        first, = struct.unpack_from('<I', compressed_contents, table)
+        second, = struct.unpack_from('<I', compressed_contents, table + 8)
+        corrupt = bytearray(compressed_contents)
+        struct.pack_into('<I', corrupt, table, first - 16)
+        struct.pack_into('<I', corrupt, table + 8, second + 16)
+        with open(compressed, 'wb') as f:
+            f.write(corrupt)
+        self.check_round_trip(cmd_editcap, cmd_tshark, compressed, contents, result_file, test_env)
+
+        # So must a truncated one; the packets before it are all there.
+        with open(compressed, 'wb') as f:
+            f.write(compressed_contents[:table + 8])
+        outfile = result_file('compressed-seek-out.pcap')
+        subprocess.run((cmd_tshark, '-2', '-r', compressed, '-F', 'pcap', '-w', outfile),
+            env=test_env)
+        with open(outfile, 'rb') as f:
+            assert f.read()[24:] == contents[24:]
+
+    def test_compressed_seek_gzip(self, cmd_editcap, cmd_tshark, compressed_seek_capture, result_file, test_env):
+        '''Write a gzip file with a member index, and read it back with and without seeking.'''
+        self.check_compressed_seek('gzip', cmd_editcap, cmd_tshark, compressed_seek_capture, result_file, test_env)
+
+    def test_compressed_seek_zstd(self, cmd_editcap, cmd_tshark, features, compressed_seek_capture, result_file, test_env):
+        '''Write a seekable zstd file, and read it back with and without seeking.'''
+        if not features.have_zstd:
+            pytest.skip('Requires Zstandard.')
+        self.check_compressed_seek('zstd', cmd_editcap, cmd_tshark, compressed_seek_capture, result_file, test_env)
+
+
+def write_pcap_packets(path, linktype, packets):
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, linktype))
+        for number, data in enumerate(packets):
+            f.write(struct.pack('<IIII', number, 0, len(data), len(data)) + data)
+
+
+def read_pcap_packets(path):
+    with open(path, 'rb') as f:
+        contents = f.read()
+    packets = []
+    offset = 24
+    while offset < len(contents):
+        caplen = struct.unpack_from('<I', contents, offset + 8)[0]
+        packets.append(contents[offset + 16:offset + 16 + caplen])
+        offset += 16 + caplen
+    return packets
+
+
+class TestFileFormatEditInPlace:
+    '''Edits made by editcap to the data of uncompressed files, which are
+    read through a read-only memory mapping.'''
+
+    @staticmethod
+    def sll_packet(number, halen, protocol, payload):
+        addr = bytes(range(1, halen + 1)) + b'\xee' * (8 - halen)
+        return struct.pack('>HHH', 0, 1, halen) + addr + struct.pack('>H', protocol) + payload
+
+    def run_editcap(self, cmd_editcap, infile, outfile, options, env):
+        with open(infile, 'rb') as f:
+            original = f.read()
+        subprocess.run((cmd_editcap, *options, infile, outfile), check=True, env=env)
+        # The input file is never written to.
+        with open(infile, 'rb') as f:
+            assert f.read() == original
+        return read_pcap_packets(outfile)
+
+    def test_edit_set_unused(self, cmd_editcap, result_file, base_env):
+        '''Zero the unused link-layer address bytes of SLL packets.'''
+        infile = result_file('sll.pcap')
+        packets = [self.sll_packet(number, 6, 0x0800, bytes(40)) for number in range(20)]
+        # LINKTYPE_LINUX_SLL
+        write_pcap_packets(infile, 113, packets)
+        edited = self.run_editcap(cmd_editcap, infile, result_file('sll-unused.pcap'), ('--set-unused',), base_env)
+        assert edited == [packet[:12] + b'\x00\x00' + packet[14:] for packet in packets]
+
+    def test_edit_novlan(self, cmd_editcap, result_file, base_env):
+        '''Remove the VLAN tags of SLL packets.'''
+        infile = result_file('sll-vlan.pcap')
+        payload = bytes(range(40))
+        tag = struct.pack('>HH', 100, 0x0800)
+        packets = [self.sll_packet(number, 6, 0x8100, tag + payload) for number in range(20)]
+        write_pcap_packets(infile, 113, packets)
+        edited = self.run_editcap(cmd_editcap, infile, result_file('sll-novlan.pcap'), ('--novlan',), base_env)
+        assert edited == [self.sll_packet(number, 6, 0x0800, payload) for number in range(20)]
+
+    def test_edit_chop(self, cmd_editcap, result_file, base_env):
+        '''Chop bytes after an offset from the start and before one from the end.'''
+        infile = result_file('chop.pcap')
+        packets = [bytes((number + i) & 0xff for i in range(60)) for number in range(20)]
+        write_pcap_packets(infile, 1, packets)
+        edited = self.run_editcap(cmd_editcap, infile, result_file('chop-begin.pcap'), ('-C', '4:2'), base_env)
+        assert edited == [packet[:4] + packet[6:] for packet in packets]
+        edited = self.run_editcap(cmd_editcap, infile, result_file('chop-end.pcap'), ('-C', '-2:-3'), base_env)
+        assert edited == [packet[:-5] + packet[-2:] for packet in packets]
+
+    def test_edit_mutate(self, cmd_editcap, result_file, base_env):
+        '''Mutate packet data.'''
+        infile = result_file('mutate.pcap')
+        packets = [bytes(60) for number in range(20)]
+        write_pcap_packets(infile, 1, packets)
+        edited = self.run_editcap(cmd_editcap, infile, result_file('mutated.pcap'), ('-E', '0.5', '--seed', '1'), base_env)
+        assert len(edited) == len(packets)
+        assert edited != packets
+
+
 class TestFileFormatMime:
     def test_mime_pcapng_gz(self, cmd_tshark, capture_file, test_env):
         '''Test that the full uncompressed contents is shown.'''
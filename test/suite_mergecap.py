@@ -270,3 +270,16 @@ class TestMergecapPcapng:
         ), capture_output=True, encoding='utf-8', env=test_env, check=False)
         # check for 11 IDBs, 88*3=264 total pkts, 86*3=258 in first IDB
         check_mergecap(mergecap_proc, 'pcapng', 'Per packet', 264, 11, 258, cmd_capinfos, testout_file, test_env)
+
+    def test_mergecap_benchmark_pcapng(self, cmd_mergecap, capture_file, result_file, cmd_capinfos, test_env):
+        '''Merge many pcapng files to pcapng and report the merge rate.'''
+        testout_file = result_file(testout_pcapng)
+        mergecap_proc = subprocess.run((cmd_mergecap,
+            '-V',
+            '--benchmark',
+            '-w', testout_file,
+            *([capture_file('dhcp.pcapng')] * 50),
+        ), capture_output=True, encoding='utf-8', env=test_env, check=False)
+        # 50 copies of a 4 packet file, merged into a single IDB
+        check_mergecap(mergecap_proc, 'pcapng', 'Ethernet', 200, 1, 200, cmd_capinfos, testout_file, test_env)
+        assert grep_output(mergecap_proc.stderr, r'merged 200 records from 50 files')
@@ -8,8 +8,11 @@
 #
 '''Name resolution tests'''
 
+import ipaddress
 import os.path
+import random
 import shutil
+import struct
 import subprocess
 
 import pytest
@@ -106,3 +109,195 @@ class TestNameResolution:
                 ), encoding='utf-8', env=base_env)
         assert '174.137.42.65\twww.wireshark.org' not in stdout
         assert 'fe80::6233:4bff:fe13:c558\tCrunch.local' in stdout
+
+
+class TestSubnetNameResolution:
+    '''Resolve addresses through the subnets files and compare the names
+    against a brute-force longest prefix match.'''
+
+    @staticmethod
+    def longest_prefix(subnets, addr):
+        best = None
+        for network, name in subnets:
+            if addr in network and (best is None or network.prefixlen > best[0].prefixlen):
+                best = (network, name)
+        return best
+
+    @staticmethod
+    def ipv4_name(subnets, addr):
+        best = TestSubnetNameResolution.longest_prefix(subnets, addr)
+        if best is None:
+            return str(addr)
+        network, name = best
+        # The subnet name, then the host part from the first octet that
+        # isn't totally masked.
+        host = str(ipaddress.IPv4Address(int(addr) & int(network.hostmask)))
+        pos = 0
+        octets = network.prefixlen // 8
+        while pos < len(host) and octets > 0:
+            pos += 1
+            if pos < len(host) and host[pos] == '.':
+                octets -= 1
+        return name + host[pos:]
+
+    @staticmethod
+    def ipv6_name(subnets, addr):
+        best = TestSubnetNameResolution.longest_prefix(subnets, addr)
+        if best is None:
+            return str(addr)
+        network, name = best
+        host = int(addr) & int(network.hostmask)
+        groups = [(host >> (16 * (7 - g))) & 0xffff for g in range(network.prefixlen // 16, 8)]
+        if not groups:
+            return name
+        return name + ':' + ':'.join('%x' % group for group in groups)
+
+    @staticmethod
+    def random_subnets(rng, fixed, bits, count):
+        '''The fixed subnets, and random ones nested in them and each other.'''
+        lines = [line for line, _ in fixed]
+        subnets = [entry for _, entry in fixed if entry is not None]
+        seen = set(network for network, _ in subnets)
+        while len(subnets) < len(fixed) + count:
+            parent = rng.choice(subnets)[0]
+            prefixlen = rng.randint(parent.prefixlen, bits)
+            host = rng.getrandbits(bits - parent.prefixlen)
+            network = ipaddress.ip_network((int(parent.network_address) | host, prefixlen), strict=False)
+            if network in seen:
+                continue
+            seen.add(network)
+            name = 'net%d' % len(subnets)
+            # Host bits past the prefix length are ignored.
+            lines.append('%s/%d %s' % (ipaddress.ip_address(int(network.network_address) | (host & int(network.hostmask))), prefixlen, name))
+            subnets.append((network, name))
+        return lines, subnets
+
+    @staticmethod
+    def random_addresses(rng, subnets, bits, count):
+        '''Addresses at the edges of and inside the subnets, and anywhere.'''
+        addrs = []
+        for network, _ in subnets:
+            addrs.append(network.network_address)
+            addrs.append(network.broadcast_address)
+            for neighbor in (int(network.network_address) - 1, int(network.broadcast_address) + 1):
+                if 0 <= neighbor < 1 << bits:
+                    addrs.append(ipaddress.ip_address(neighbor))
+        while len(addrs) < count:
+            network = rng.choice(subnets)[0]
+            addrs.append(network.network_address + rng.getrandbits(bits - network.prefixlen))
+            addrs.append(ipaddress.ip_address(rng.getrandbits(bits)))
+        return addrs
+
+    @staticmethod
+    def write_pcap(path, headers):
+        with open(path, 'wb') as f:
+            # LINKTYPE_RAW
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 101))
+            for number, header in enumerate(headers):
+                f.write(struct.pack('<IIII', number, 0, len(header), len(header)) + header)
+
+    @staticmethod
+    def resolve(cmd_tshark, capture, fields, env):
+        stdout = subprocess.check_output((cmd_tshark,
+                '-r', capture,
+                '-o', 'nameres.network_name: TRUE',
+                '-o', 'nameres.use_external_name_resolver: FALSE',
+                '-T', 'fields',
+                '-e', fields[0], '-e', fields[1],
+                ), encoding='utf-8', env=env)
+        names = []
+        for line in stdout.splitlines():
+            names.extend(line.split('\t'))
+        return names
+
+    def test_subnets_ipv4(self, cmd_tshark, conf_path, result_file, test_env):
+        '''IPv4 subnet names match a brute-force longest prefix match.'''
+        net = ipaddress.ip_network
+        fixed = (
+            # A /0 is rejected, so it doesn't name every address.
+            ('0.0.0.0/0 everything', None),
+            ('10.0.0.0/8 ten', (net('10.0.0.0/8'), 'ten')),
+            ('10.1.0.0/16 ten-one', (net('10.1.0.0/16'), 'ten-one')),
+            ('10.1.2.0/24 ten-one-two', (net('10.1.2.0/24'), 'ten-one-two')),
+            ('10.1.2.3/32 host', (net('10.1.2.3/32'), 'host')),
+            # Ending off the 6 bit stride, so they're pushed into the
+            # slots below them, and overlapped by longer prefixes.
+            ('10.1.2.64/26 upper', (net('10.1.2.64/26'), 'upper')),
+            ('10.1.2.96/27 upper-half', (net('10.1.2.96/27'), 'upper-half')),
+            ('10.1.2.100/31 pair', (net('10.1.2.100/31'), 'pair')),
+            ('172.16.0.0/12 private', (net('172.16.0.0/12'), 'private')),
+            ('172.20.0.0/14 private-nested', (net('172.20.0.0/14'), 'private-nested')),
+            ('128.0.0.0/1 top', (net('128.0.0.0/1'), 'top')),
+            ('255.255.255.255/32 broadcast', (net('255.255.255.255/32'), 'broadcast')),
+            ('192.168.0.0/17 low', (net('192.168.0.0/17'), 'low')),
+            ('192.168.0.0/23 low-nested', (net('192.168.0.0/23'), 'low-nested')),
+        )
+        rng = random.Random(12)
+        lines, subnets = self.random_subnets(rng, fixed, 32, 200)
+        with open(os.path.join(conf_path, 'subnets'), 'w') as f:
+            f.write('\n'.join(lines) + '\n')
+
+        addrs = self.random_addresses(rng, subnets, 32, 2000)
+        if len(addrs) % 2:
+            addrs.append(ipaddress.IPv4Address('10.1.2.3'))
+        headers = []
+        for src, dst in zip(addrs[0::2], addrs[1::2]):
+            # Protocol 253, for experimentation, with no payload.
+            headers.append(struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20, 0, 0, 64, 253, 0, src.packed, dst.packed))
+        capture = result_file('subnets.pcap')
+        self.write_pcap(capture, headers)
+
+        names = self.resolve(cmd_tshark, capture, ('ip.src_host', 'ip.dst_host'), test_env)
+        assert names == [self.ipv4_name(subnets, addr) for addr in addrs]
+
+        # Check the reference itself.
+        fixed_subnets = [entry for _, entry in fixed if entry is not None]
+        assert self.ipv4_name(fixed_subnets, ipaddress.IPv4Address('10.1.2.3')) == 'host'
+        assert self.ipv4_name(fixed_subnets, ipaddress.IPv4Address('10.1.2.101')) == 'pair.1'
+        assert self.ipv4_name(fixed_subnets, ipaddress.IPv4Address('10.1.3.1')) == 'ten-one.3.1'
+        assert self.ipv4_name(fixed_subnets, ipaddress.IPv4Address('172.21.0.1')) == 'private-nested.1.0.1'
+        assert self.ipv4_name(fixed_subnets, ipaddress.IPv4Address('129.0.0.1')) == 'top1.0.0.1'
+        assert self.ipv4_name(fixed_subnets, ipaddress.IPv4Address('11.0.0.1')) == '11.0.0.1'
+
+    def test_subnets_ipv6(self, cmd_tshark, conf_path, result_file, test_env):
+        '''IPv6 subnet names match a brute-force longest prefix match.'''
+        net = ipaddress.ip_network
+        fixed = (
+            ('::/0 everything', None),
+            ('2001:db8::/32 doc', (net('2001:db8::/32'), 'doc')),
+            ('2001:db8:1::/48 doc-one', (net('2001:db8:1::/48'), 'doc-one')),
+            ('2001:db8:1:2::/64 lan', (net('2001:db8:1:2::/64'), 'lan')),
+            ('2001:db8:1:2::1/128 host', (net('2001:db8:1:2::1/128'), 'host')),
+            ('2001:db8:1:2::100/125 few', (net('2001:db8:1:2::100/125'), 'few')),
+            ('2001:db8:1:2::104/127 pair', (net('2001:db8:1:2::104/127'), 'pair')),
+            ('2001:db8:8000::/33 half', (net('2001:db8:8000::/33'), 'half')),
+            ('2000::/3 global', (net('2000::/3'), 'global')),
+        )
+        rng = random.Random(13)
+        lines, subnets = self.random_subnets(rng, fixed, 128, 200)
+        with open(os.path.join(conf_path, 'subnetsipv6'), 'w') as f:
+            f.write('\n'.join(lines) + '\n')
+
+        # Stay in 2000::/3, so that no address is written in a special form
+        # such as an IPv4-mapped one when it isn't in a subnet.
+        addrs = [addr for addr in self.random_addresses(rng, subnets, 128, 2000)
+                 if addr in net('2000::/3')]
+        if len(addrs) % 2:
+            addrs.append(ipaddress.IPv6Address('2001:db8:1:2::1'))
+        headers = []
+        for src, dst in zip(addrs[0::2], addrs[1::2]):
+            # No next header.
+            headers.append(struct.pack('>IHBB16s16s', 6 << 28, 0, 59, 64, src.packed, dst.packed))
+        capture = result_file('subnets.pcap')
+        self.write_pcap(capture, headers)
+
+        names = self.resolve(cmd_tshark, capture, ('ipv6.src_host', 'ipv6.dst_host'), test_env)
+        assert names == [self.ipv6_name(subnets, addr) for addr in addrs]
+
+        # Check the reference itself.
+        fixed_subnets = [entry for _, entry in fixed if entry is not None]
+        assert self.ipv6_name(fixed_subnets, ipaddress.IPv6Address('2001:db8:1:2::1')) == 'host'
+        assert self.ipv6_name(fixed_subnets, ipaddress.IPv6Address('2001:db8:1:2::105')) == 'pair:1'
+        assert self.ipv6_name(fixed_subnets, ipaddress.IPv6Address('2001:db8:1:3::1')) == 'doc-one:3:0:0:0:1'
+        assert self.ipv6_name(fixed_subnets, ipaddress.IPv6Address('2001:db9::1')) == 'global:1:db9:0:0:0:0:0:1'
+        assert self.ipv6_name(fixed_subnets, ipaddress.IPv6Address('4000::1')) == '4000::1'
@@ -90,3 +90,28 @@ class TestOutputFormats:
         ''' Check that the option -j works with -Tek.'''
         check_outputformat("ek", extra_args=['-j', 'dhcp'], expected="dhcp-filter.ek",
             multiline=True, env=base_env)
+
+
+class TestSecondPassJobs:
+    # A split second pass prints exactly what a single process prints.
+    # The job count is capped at the number of CPUs, so on a machine with
+    # fewer than four this splits into fewer jobs, or none.
+    @pytest.mark.parametrize('pcap_file', ['http2-data-reassembly.pcap', 'many_interfaces.pcapng.1', 'dns+icmp.pcapng.gz'])
+    @pytest.mark.parametrize('output_args', [
+        [],
+        ['-V'],
+        ['-T', 'json'],
+        ['-T', 'fields', '-e', 'frame.number', '-e', 'frame.time_relative',
+         '-e', 'frame.cap_len', '-e', '_ws.col.info', '-E', 'header=y'],
+    ], ids=['text', 'verbose', 'json', 'fields'])
+    def test_second_pass_jobs(self, cmd_tshark, capture_file, pcap_file, output_args, test_env):
+        '''Compare the output of a split second pass with a single one'''
+        def run_tshark(jobs):
+            return subprocess.run([cmd_tshark, '-r', capture_file(pcap_file), '-2',
+                                   '--second-pass-jobs', str(jobs)] + output_args,
+                                  check=True, capture_output=True, env=test_env).stdout
+
+        single = run_tshark(1)
+        assert len(single) > 0
+        assert run_tshark(4) == single
+        assert run_tshark(0) == single
@@ -9,7 +9,13 @@
 '''sharkd tests'''
 
 import json
+import os
+import signal
+import socket
 import subprocess
+import sys
+import tempfile
+import time
 
 import pytest
 
@@ -45,6 +51,73 @@ def run_sharkd_session(cmd_sharkd, base_env):
     return run_sharkd_session_real
 
 
+@pytest.fixture
+def run_sharkd_daemon(cmd_sharkd, base_env):
+    '''Start sharkd in daemon mode on a UNIX socket and return the socket path.'''
+    if sys.platform == 'win32':
+        pytest.skip('Session process pools are not supported on Windows.')
+    # A short path, as UNIX socket paths are limited to about 100 bytes.
+    socket_dir = tempfile.TemporaryDirectory(prefix='sharkd')
+    daemons = []
+
+    def run_sharkd_daemon_real(*args):
+        socket_path = os.path.join(socket_dir.name, f'sharkd{len(daemons)}.sock')
+        # In a session of its own, so that the session processes can be
+        # killed along with the daemon.
+        sharkd_proc = subprocess.Popen(
+            (cmd_sharkd, '-a', 'unix:' + socket_path, '--foreground') + args,
+            stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+            start_new_session=True, env=base_env)
+        daemons.append(sharkd_proc)
+        deadline = time.monotonic() + 30
+        while not os.path.exists(socket_path):
+            assert sharkd_proc.poll() is None
+            assert time.monotonic() < deadline
+            time.sleep(0.05)
+        return socket_path
+
+    yield run_sharkd_daemon_real
+    for sharkd_proc in daemons:
+        os.killpg(sharkd_proc.pid, signal.SIGTERM)
+        sharkd_proc.wait(timeout=30)
+    socket_dir.cleanup()
+
+
+class SharkdClient:
+    '''A client of a sharkd daemon.'''
+    def __init__(self, socket_path):
+        deadline = time.monotonic() + 30
+        while True:
+            self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            self.sock.settimeout(30)
+            try:
+                self.sock.connect(socket_path)
+                break
+            except ConnectionRefusedError:
+                # Bound, but not listening yet.
+                self.sock.close()
+                assert time.monotonic() < deadline
+                time.sleep(0.05)
+        self.reader = self.sock.makefile('r', encoding='utf-8')
+        self.next_id = 1
+
+    def read_response(self):
+        line = self.reader.readline()
+        return json.loads(line) if line else None
+
+    def request(self, method, params=None):
+        req = {"jsonrpc":"2.0", "id":self.next_id, "method":method}
+        if params is not None:
+            req["params"] = params
+        self.next_id += 1
+        self.sock.sendall((json.dumps(req) + '\n').encode('utf-8'))
+        return self.read_response()
+
+    def close(self):
+        self.reader.close()
+        self.sock.close()
+
+
 @pytest.fixture
 def check_sharkd_session(run_sharkd_session):
     def check_sharkd_session_real(sharkd_commands, expected_outputs):
@@ -199,7 +272,8 @@ class TestSharkd:
                     "title": "Length", "format": "%L", "visible":True, "display": "R"
                 },{
                     "title": "Info", "format": "%i", "visible":True, "display": "R"
-                }]
+                }],
+                "filter_cache":{"entries":0,"bytes":0,"max_bytes":67108864,"hits":0,"misses":0,"evictions":0}
             }},
         ))
 
@@ -230,7 +304,52 @@ class TestSharkd:
                     "title": "Length", "format": "%L", "visible":True, "display": "R"
                 },{
                     "title": "Info", "format": "%i", "visible":True, "display": "R"
-                }]
+                }],
+                "filter_cache":{"entries":0,"bytes":0,"max_bytes":67108864,"hits":0,"misses":0,"evictions":0}
+            }},
+        ))
+
+    def test_sharkd_req_status_filter_cache(self, check_sharkd_session, capture_file):
+        check_sharkd_session((
+            {"jsonrpc":"2.0", "id":1, "method":"load",
+            "params":{"file": capture_file('dhcp.pcap')}
+            },
+            {"jsonrpc":"2.0", "id":2, "method":"intervals",
+            "params":{"filter": "frame.number <= 2"}
+            },
+            {"jsonrpc":"2.0", "id":3, "method":"intervals",
+            "params":{"filter": "frame.number <= 2"}
+            },
+            {"jsonrpc":"2.0", "id":4, "method":"intervals",
+            "params":{"filter": "frame.number == 4"}
+            },
+            {"jsonrpc":"2.0", "id":5, "method":"status"},
+        ), (
+            {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
+            {"jsonrpc":"2.0","id":2,"result":{"intervals":[[0,2,656]],"last":0,"frames":2,"bytes":656}},
+            {"jsonrpc":"2.0","id":3,"result":{"intervals":[[0,2,656]],"last":0,"frames":2,"bytes":656}},
+            {"jsonrpc":"2.0","id":4,"result":{"intervals":[[0,1,342]],"last":0,"frames":1,"bytes":342}},
+            {"jsonrpc":"2.0","id":5,"result":{"frames": 4, "duration": 0.070345000,
+                "filename": "dhcp.pcap", "filesize": 1400,
+                "columns":["No.","Time","Delta","Source","Destination","Protocol","Length","Info"],
+                "column_info":[{
+                    "title":"No.","format": "%m","visible":True, "display": "R"
+                },{
+                    "title": "Time", "format": "%t", "visible":True, "display": "R"
+                },{
+                    "title": "Delta", "format": "%Gt", "visible":True, "display": "R"
+                },{
+                    "title": "Source", "format": "%s", "visible":True, "display": "R"
+                },{
+                    "title": "Destination", "format": "%d", "visible":True, "display": "R"
+                },{
+                    "title": "Protocol", "format": "%p", "visible":True, "display": "R"
+                },{
+                    "title": "Length", "format": "%L", "visible":True, "display": "R"
+                },{
+                    "title": "Info", "format": "%i", "visible":True, "display": "R"
+                }],
+                "filter_cache":{"entries":2,"bytes":MatchAny(int),"max_bytes":67108864,"hits":1,"misses":2,"evictions":0}
             }},
         ))
 
@@ -1784,3 +1903,82 @@ class TestSharkd:
             {"jsonrpc":"2.0","id":1,"result":{"status":"OK"}},
             MatchAny(),
         ))
+
+
+class TestSharkdDaemon:
+    def wait_for_workers(self, client, count):
+        '''Return the session processes, once there are count of them.'''
+        deadline = time.monotonic() + 30
+        while True:
+            workers = client.request("status")["result"].get("workers", [])
+            if len(workers) == count:
+                return workers
+            assert time.monotonic() < deadline
+            time.sleep(0.05)
+
+    def test_sharkd_daemon_no_workers(self, run_sharkd_daemon):
+        '''Without --workers, there's no pool to report.'''
+        client = SharkdClient(run_sharkd_daemon())
+        status = client.request("status")
+        assert "frames" in status["result"]
+        assert "workers" not in status["result"]
+        client.close()
+
+    def test_sharkd_daemon_workers(self, run_sharkd_daemon, capture_file):
+        '''Clients are served by spare session processes, which are replaced.'''
+        socket_path = run_sharkd_daemon('--workers', '2')
+        client = SharkdClient(socket_path)
+        assert client.request("load", {"file": capture_file('dhcp.pcap')})["result"] == {"status":"OK"}
+
+        # Our session process, busy, and two spare ones.
+        workers = self.wait_for_workers(client, 3)
+        ours = [w for w in workers if w.get("self")]
+        assert len(ours) == 1
+        assert ours[0]["busy"] is True
+        assert ours[0]["connected"] > 0
+        assert ours[0]["requests"] > 0
+        assert ours[0]["frames"] == 4
+        spare = [w for w in workers if not w["busy"]]
+        assert len(spare) == 2
+        for worker in spare:
+            assert "connected" not in worker
+            assert worker["requests"] == 0
+
+        # Another client gets one of the spare ones.
+        other = SharkdClient(socket_path)
+        other_workers = self.wait_for_workers(other, 4)
+        other_ours = [w for w in other_workers if w.get("self")]
+        assert len(other_ours) == 1
+        assert other_ours[0]["pid"] in [w["pid"] for w in spare]
+        assert sum(w["busy"] for w in other_workers) == 2
+        other.close()
+        client.close()
+
+    def test_sharkd_daemon_sessions_full(self, run_sharkd_daemon):
+        '''Clients are refused while every session is busy.'''
+        socket_path = run_sharkd_daemon('--workers', '1', '--max-sessions', '1')
+        first = SharkdClient(socket_path)
+        assert "frames" in first.request("status")["result"]
+
+        refused = SharkdClient(socket_path)
+        assert refused.read_response() == {"jsonrpc":"2.0", "id":None,
+            "error":{"code":-32000, "message":"Too many sessions; try again later"}}
+        assert refused.read_response() is None
+        refused.close()
+
+        # Once the session ends, another takes its place.
+        first.close()
+        deadline = time.monotonic() + 30
+        while True:
+            client = SharkdClient(socket_path)
+            try:
+                status = client.request("status")
+            except (BrokenPipeError, ConnectionResetError):
+                # Refused before the request was sent.
+                status = {"error": {"code": -32000}}
+            client.close()
+            if "result" in status:
+                break
+            assert status["error"]["code"] == -32000
+            assert time.monotonic() < deadline
+            time.sleep(0.05)
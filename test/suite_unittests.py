@@ -50,12 +50,30 @@ class TestUnitTests:
             '--verbose'
         ), env=base_env)
 
+    def test_unit_wiretap(self, program, base_env):
+        '''wiretap unit tests'''
+        subprocess.check_call((program('test_wiretap'),
+            '--verbose'
+        ), env=base_env)
+
     def test_unit_wsutil(self, program, base_env):
         '''wsutil unit tests'''
         subprocess.check_call((program('test_wsutil'),
             '--verbose'
         ), env=base_env)
 
+    def test_unit_io_graph_item(self, program, base_env):
+        '''I/O graph item unit tests'''
+        subprocess.check_call((program('io_graph_item_test'),
+            '--verbose'
+        ), env=base_env)
+
+    def test_unit_column_text_store(self, program, base_env):
+        '''packet list column text store unit tests'''
+        subprocess.check_call((program('column_text_store_test'),
+            '--verbose'
+        ), env=base_env)
+
     def test_unit_fieldcount(self, cmd_tshark, test_env):
         '''fieldcount'''
         subprocess.check_call((cmd_tshark, '-G', 'fieldcount'), env=test_env)
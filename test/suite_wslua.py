@@ -12,6 +12,7 @@ import filecmp
 import logging
 import os.path
 import shutil
+import struct
 import subprocess
 
 import pytest
@@ -334,6 +335,45 @@ class TestWslua:
         '''wslua try_heuristics'''
         check_lua_script('try_heuristics.lua', dns_port_pcap, True)
 
+    def test_wslua_heur_flow(self, check_lua_script, result_file):
+        '''Heuristic dissectors tried per flow, on the first pass and when dissecting again'''
+        # Flows 1 and 2 leave heurb and heura, respectively, first in
+        # their flows, and heura first in the list; flow 3 is rejected
+        # by both until they give up on it.
+        flows = ((40001, 40002), (40003, 40004), (40005, 40006))
+        payloads = [(0, b'B'), (1, b'A'), (0, b'X'), (1, b'X')]
+        payloads += [(2, b'Z')] * 8
+        payloads += [(2, b'A')] * 300
+        cap_file = result_file('heur_flow.pcap')
+        with open(cap_file, 'wb') as f:
+            f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, 1))
+            for number, (flow, first) in enumerate(payloads):
+                payload = first + b'heur flow test'
+                udp = struct.pack('>HHHH', *flows[flow], 8 + len(payload), 0) + payload
+                ip = struct.pack('>BBHHHBBH4s4s', 0x45, 0, 20 + len(udp), number, 0, 64, 17, 0,
+                    bytes((10, 0, 0, 1)), bytes((10, 0, 0, 2))) + udp
+                frame = bytes((2, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 1, 8, 0)) + ip
+                f.write(struct.pack('<IIII', number, 0, len(frame), len(frame)) + frame)
+
+        def dissect(*args):
+            proc = check_lua_script('heur_flow.lua', cap_file, False,
+                '-Tfields', '-e', 'frame.protocols', *args)
+            return [protocols.rsplit(':', 1)[1] for protocols in proc.stdout.splitlines()]
+
+        one_pass = dissect()
+        assert one_pass[2] == 'heurb'
+        assert one_pass[3] == 'heura'
+        assert one_pass[12] == 'data'
+        assert one_pass[-1] == 'heura'
+        # Dissecting the frames again gives what the first pass gave,
+        # although the caches have moved on since.
+        assert dissect('-2') == one_pass
+
+        no_cache = dissect('-o', 'protocols.heuristic_flow_cache:FALSE')
+        assert no_cache[2] == 'heura'
+        assert no_cache[12] == 'heura'
+        assert dissect('-2', '-o', 'protocols.heuristic_flow_cache:FALSE') == no_cache
+
     def test_wslua_add_packet_field(self, check_lua_script):
         '''wslua add_packet_field'''
         check_lua_script('add_packet_field.lua', dns_port_pcap, True)
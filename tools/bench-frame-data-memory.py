@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+'''
+Benchmark the memory used per frame of a capture file.
+
+Writes a capture of raw IP packets that capture no data, so that the file
+is as small as it can be, and has TShark read it in two passes, which
+keeps a frame_data for every frame the way Wireshark does. The peak
+resident size of a run over a handful of frames is subtracted from that
+of a run over the whole file, and divided by the number of frames.
+
+By default the capture has 100M frames, which needs 1.6 GB of disk space
+in the temporary directory and several GB of memory.
+'''
+
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+LINKTYPE_RAW = 101
+BATCH_PACKETS = 1000000
+BASELINE_FRAMES = 1000
+
+
+def write_capture(path, frames):
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, LINKTYPE_RAW))
+        ts = 1700000000
+        while frames > 0:
+            batch = min(frames, BATCH_PACKETS)
+            # One packet per microsecond, each claiming 64 bytes on the wire.
+            f.write(b''.join(struct.pack('<IIII', ts, i, 0, 64) for i in range(batch)))
+            ts += 1
+            frames -= batch
+
+
+def max_rss_bytes(cmd):
+    '''Run cmd and return its peak resident size in bytes, and its run time.'''
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode != 0:
+        raise subprocess.CalledProcessError(proc.returncode, cmd)
+    # ru_maxrss is in kilobytes on Linux and in bytes on macOS.
+    scale = 1 if sys.platform == 'darwin' else 1024
+    return usage.ru_maxrss * scale, elapsed
+
+
+def run_tshark(tshark, capture):
+    # A filter that matches nothing, so that the second pass prints nothing.
+    return max_rss_bytes([tshark, '-n', '-2', '-r', capture, '-Y', 'frame.number == 0'])
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark the memory used per frame.')
+    parser.add_argument('--tshark', default='tshark', help='Path to the TShark binary')
+    parser.add_argument('--frames', type=int, default=100000000, help='Number of frames (default: %(default)s)')
+    parser.add_argument('--keep', action='store_true', help='Keep the generated files')
+    args = parser.parse_args()
+
+    tshark = shutil.which(args.tshark) or args.tshark
+    work_dir = tempfile.mkdtemp(prefix='bench-frame-data-memory-')
+    baseline_capture = os.path.join(work_dir, 'baseline.pcap')
+    capture = os.path.join(work_dir, 'frames.pcap')
+
+    try:
+        print('Writing %d frames to %s' % (args.frames, work_dir))
+        write_capture(baseline_capture, BASELINE_FRAMES)
+        write_capture(capture, args.frames)
+
+        baseline_rss, _ = run_tshark(tshark, baseline_capture)
+        rss, elapsed = run_tshark(tshark, capture)
+        print('Peak RSS, %d frames: %.1f MB' % (BASELINE_FRAMES, baseline_rss / 1e6))
+        print('Peak RSS, %d frames: %.1f MB (%.1f s)' % (args.frames, rss / 1e6, elapsed))
+        print('Per frame:           %.1f bytes' % ((rss - baseline_rss) / (args.frames - BASELINE_FRAMES)))
+    finally:
+        if args.keep:
+            print('Files kept in %s' % work_dir)
+        else:
+            shutil.rmtree(work_dir)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
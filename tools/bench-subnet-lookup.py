@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+# Wireshark - Network traffic analyzer
+# By Gerald Combs <gerald@wireshark.org>
+# Copyright 1998 Gerald Combs
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+'''
+Benchmark subnet name resolution.
+
+Writes a "subnets" (or "subnetsipv6") file with random prefixes to a
+temporary configuration directory, and a capture of raw IP packets with
+random source and destination addresses. TShark then prints the resolved
+address names of every packet, once with name resolution disabled and once
+with network name resolution enabled; the difference between the two is
+the cost of the subnet lookups.
+
+The peak resident size of a run with the subnets file is also compared
+with that of a run with an empty one, and the benchmark fails if the
+subnets cost more than --max-bytes-per-subnet each.
+
+By default this resolves 100M addresses against 500k subnets, which needs
+a few GB of disk space in the temporary directory.
+'''
+
+import argparse
+import os
+import random
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+LINKTYPE_RAW = 101
+BATCH_PACKETS = 100000
+
+
+def random_prefix_length(rng, ipv6):
+    # Weighted roughly like a routing table: mostly /24 (or /48), some
+    # shorter and longer prefixes.
+    if ipv6:
+        return rng.choice((16, 24, 29, 32, 32, 40, 44, 48, 48, 48, 56, 64, 64, 96, 128))
+    return rng.choice((8, 12, 16, 16, 19, 20, 22, 23, 24, 24, 24, 24, 24, 28, 32))
+
+
+def write_subnets(path, count, ipv6, rng):
+    with open(path, 'w') as f:
+        for i in range(count):
+            length = random_prefix_length(rng, ipv6)
+            if ipv6:
+                addr = rng.getrandbits(128).to_bytes(16, 'big')
+                addr_str = ':'.join('%x' % int.from_bytes(addr[j:j + 2], 'big') for j in range(0, 16, 2))
+            else:
+                addr_str = '.'.join(str(b) for b in rng.getrandbits(32).to_bytes(4, 'big'))
+            f.write('%s/%d net%d\n' % (addr_str, length, i))
+
+
+def write_capture(path, addresses, ipv6):
+    packets = (addresses + 1) // 2
+    if ipv6:
+        header = struct.pack('!IHBB', 6 << 28, 0, 59, 64)
+        addr_len = 16
+    else:
+        header = struct.pack('!BBHHHBBH', 0x45, 0, 20, 0, 0, 64, 253, 0)
+        addr_len = 4
+    caplen = len(header) + 2 * addr_len
+    record = struct.pack('<IIII', 0, 0, caplen, caplen)
+
+    with open(path, 'wb') as f:
+        f.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, LINKTYPE_RAW))
+        while packets > 0:
+            batch = min(packets, BATCH_PACKETS)
+            addrs = os.urandom(batch * 2 * addr_len)
+            step = 2 * addr_len
+            f.write(b''.join(record + header + addrs[i:i + step] for i in range(0, len(addrs), step)))
+            packets -= batch
+
+
+def run_tshark(tshark, capture, conf_dir, resolve, ipv6):
+    '''Run TShark and return its run time and peak resident size in bytes.'''
+    fields = ('ipv6.src_host', 'ipv6.dst_host') if ipv6 else ('ip.src_host', 'ip.dst_host')
+    cmd = [tshark, '-r', capture, '-T', 'fields']
+    for field in fields:
+        cmd += ['-e', field]
+    cmd += ['-N', 'n'] if resolve else ['-n']
+
+    env = dict(os.environ)
+    env['WIRESHARK_CONFIG_DIR'] = conf_dir
+    start = time.perf_counter()
+    proc = subprocess.Popen(cmd, env=env, stdout=subprocess.DEVNULL)
+    _, status, usage = os.wait4(proc.pid, 0)
+    elapsed = time.perf_counter() - start
+    returncode = os.waitstatus_to_exitcode(status)
+    if returncode != 0:
+        raise subprocess.CalledProcessError(returncode, cmd)
+    # ru_maxrss is in kilobytes on Linux and in bytes on macOS.
+    scale = 1 if sys.platform == 'darwin' else 1024
+    return elapsed, usage.ru_maxrss * scale
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Benchmark subnet name resolution.')
+    parser.add_argument('--tshark', default='tshark', help='Path to the TShark binary')
+    parser.add_argument('--subnets', type=int, default=500000, help='Number of subnets (default: %(default)s)')
+    parser.add_argument('--addresses', type=int, default=100000000, help='Number of addresses to resolve (default: %(default)s)')
+    parser.add_argument('--ipv6', action='store_true', help='Benchmark IPv6 subnets instead of IPv4')
+    parser.add_argument('--seed', type=int, default=1, help='Random seed for the subnets file')
+    parser.add_argument('--max-bytes-per-subnet', type=float, default=256,
+                        help='Fail if a subnet costs more memory than this (default: %(default)s)')
+    parser.add_argument('--keep', action='store_true', help='Keep the generated files')
+    args = parser.parse_args()
+
+    tshark = shutil.which(args.tshark) or args.tshark
+    work_dir = tempfile.mkdtemp(prefix='bench-subnet-lookup-')
+    conf_dir = os.path.join(work_dir, 'conf')
+    os.mkdir(conf_dir)
+    empty_conf_dir = os.path.join(work_dir, 'empty-conf')
+    os.mkdir(empty_conf_dir)
+    capture = os.path.join(work_dir, 'addresses.pcap')
+    rng = random.Random(args.seed)
+    subnets_name = 'subnetsipv6' if args.ipv6 else 'subnets'
+    status = 0
+
+    try:
+        print('Writing %d subnets and %d addresses to %s' % (args.subnets, args.addresses, work_dir))
+        write_subnets(os.path.join(conf_dir, subnets_name), args.subnets, args.ipv6, rng)
+        open(os.path.join(empty_conf_dir, subnets_name), 'w').close()
+        write_capture(capture, args.addresses, args.ipv6)
+
+        baseline, _ = run_tshark(tshark, capture, conf_dir, False, args.ipv6)
+        print('No name resolution: %.2f s' % baseline)
+        resolved, rss = run_tshark(tshark, capture, conf_dir, True, args.ipv6)
+        print('Subnet resolution:  %.2f s' % resolved)
+        print('Lookup cost:        %.1f ns/address' % ((resolved - baseline) * 1e9 / args.addresses))
+
+        _, empty_rss = run_tshark(tshark, capture, empty_conf_dir, True, args.ipv6)
+        per_subnet = (rss - empty_rss) / args.subnets
+        print('Subnet memory:      %.1f MB (%.1f bytes/subnet)' % ((rss - empty_rss) / 1e6, per_subnet))
+        if per_subnet > args.max_bytes_per_subnet:
+            print('Subnets use more than %g bytes each' % args.max_bytes_per_subnet)
+            status = 1
+    finally:
+        if args.keep:
+            print('Files kept in %s' % work_dir)
+        else:
+            shutil.rmtree(work_dir)
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+"""
+Generate a synthetic capture of a TCP flow with a large bandwidth-delay
+product, for the TCP sequence analysis tests and for timing it.
+
+tcp-high-bdp.pcap.gz
+  A single connection (client 10.1.0.1:40000 -> server 10.2.0.1:5001) on
+  a 10 Gb/s path with a 50 ms round-trip time:
+
+    Frames 1-3          Three-way handshake, window scale 14 both ways.
+    Frames 4-20002      20000 full-sized (1448 byte) data segments sent
+                        back to back, all in flight at once. Segment 10000
+                        (0-based) is not captured.
+    Frames 20003-25002  One ACK for every other segment, up to the hole.
+    Frames 25003-25005  Three duplicate ACKs for the hole.
+    Frame  25006        Fast retransmission of the missing segment.
+    Frame  25007        Cumulative ACK of the whole window.
+
+  Only the headers are captured, so the file stays small while TCP still
+  sees the full segment lengths. Every ACK has to be matched against up to
+  20000 unacked segments, which is what made the analysis quadratic with a
+  linked list.
+
+Wire format layers (outer to inner):
+  Ethernet II            (14 bytes, DLT_EN10MB = 1)
+  IPv4                   (20 bytes)
+  TCP                    (20 bytes, 24 with the window scale option)
+"""
+
+import gzip
+import os
+import struct
+import sys
+
+CLIENT_MAC = bytes.fromhex('020000000001')
+SERVER_MAC = bytes.fromhex('020000000002')
+CLIENT_IP = bytes((10, 1, 0, 1))
+SERVER_IP = bytes((10, 2, 0, 1))
+CLIENT_PORT = 40000
+SERVER_PORT = 5001
+
+MSS = 1448
+SEGMENTS = 20000
+LOST_SEGMENT = 10000
+CLIENT_ISN = 1000
+SERVER_ISN = 5000
+WINDOW = 65535
+WSCALE = 14
+RTT_NS = 50000000
+SEGMENT_NS = 1200        # 1448 bytes at 10 Gb/s
+
+TH_FIN, TH_SYN, TH_RST, TH_PUSH, TH_ACK = 0x01, 0x02, 0x04, 0x08, 0x10
+
+
+def checksum(data):
+    if len(data) % 2:
+        data += b'\0'
+    total = sum(struct.unpack('!%dH' % (len(data) // 2), data))
+    total = (total >> 16) + (total & 0xffff)
+    total += total >> 16
+    return ~total & 0xffff
+
+
+def frame(from_client, seq, ack, flags, payload_len=0, options=b''):
+    src_mac, dst_mac = (CLIENT_MAC, SERVER_MAC) if from_client else (SERVER_MAC, CLIENT_MAC)
+    src_ip, dst_ip = (CLIENT_IP, SERVER_IP) if from_client else (SERVER_IP, CLIENT_IP)
+    sport, dport = (CLIENT_PORT, SERVER_PORT) if from_client else (SERVER_PORT, CLIENT_PORT)
+
+    tcp_len = 20 + len(options)
+    tcp = struct.pack('!HHIIBBHHH', sport, dport, seq & 0xffffffff, ack & 0xffffffff,
+                      (tcp_len // 4) << 4, flags, WINDOW, 0, 0) + options
+    ip_len = 20 + tcp_len + payload_len
+    ip = struct.pack('!BBHHHBBH4s4s', 0x45, 0, ip_len, 0, 0x4000, 64, 6, 0, src_ip, dst_ip)
+    ip = ip[:10] + struct.pack('!H', checksum(ip)) + ip[12:]
+    eth = dst_mac + src_mac + b'\x08\x00'
+    # The payload isn't captured, so the TCP checksum is left at 0; TShark
+    # doesn't validate it by default.
+    return eth + ip + tcp, 14 + ip_len
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.join(os.path.dirname(__file__), '..', 'test', 'captures')
+    path = os.path.join(out_dir, 'tcp-high-bdp.pcap.gz')
+
+    packets = []
+    t = 1700000000 * 10**9
+
+    def add(delta_ns, pkt):
+        nonlocal t
+        t += delta_ns
+        packets.append((t, pkt))
+
+    ws_option = b'\x01\x03\x03' + bytes((WSCALE,))
+    add(0, frame(True, CLIENT_ISN, 0, TH_SYN, options=ws_option))
+    add(RTT_NS // 2, frame(False, SERVER_ISN, CLIENT_ISN + 1, TH_SYN | TH_ACK, options=ws_option))
+    add(RTT_NS // 2, frame(True, CLIENT_ISN + 1, SERVER_ISN + 1, TH_ACK))
+
+    data_seq = CLIENT_ISN + 1
+    for i in range(SEGMENTS):
+        pkt = frame(True, data_seq + i * MSS, SERVER_ISN + 1, TH_ACK, MSS)
+        if i == LOST_SEGMENT:
+            t += SEGMENT_NS
+        else:
+            add(SEGMENT_NS, pkt)
+
+    # The first ACK arrives one RTT after the first segment.
+    t += RTT_NS - SEGMENTS * SEGMENT_NS
+    for i in range(2, LOST_SEGMENT + 1, 2):
+        add(2 * SEGMENT_NS, frame(False, SERVER_ISN + 1, data_seq + i * MSS, TH_ACK))
+    hole = data_seq + LOST_SEGMENT * MSS
+    for i in range(3):
+        add(SEGMENT_NS, frame(False, SERVER_ISN + 1, hole, TH_ACK))
+    add(1000, frame(True, hole, SERVER_ISN + 1, TH_ACK, MSS))
+    add(RTT_NS, frame(False, SERVER_ISN + 1, data_seq + SEGMENTS * MSS, TH_ACK))
+
+    with gzip.GzipFile(path, 'wb', mtime=0) as f:
+        # pcap with nanosecond timestamps
+        f.write(struct.pack('<IHHiIII', 0xa1b23c4d, 2, 4, 0, 0, 65535, 1))
+        for ts, (data, orig_len) in packets:
+            f.write(struct.pack('<IIII', ts // 10**9, ts % 10**9, len(data), orig_len))
+            f.write(data)
+
+    print('Wrote %d frames to %s' % (len(packets), path))
+
+
+if __name__ == '__main__':
+    main()
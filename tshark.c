@@ -29,6 +29,8 @@
 
 #ifndef _WIN32
 #include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 #include <glib.h>
@@ -49,6 +51,7 @@
 #include <wsutil/wslog.h>
 #include <wsutil/ws_assert.h>
 #include <wsutil/strtoi.h>
+#include <wsutil/tempfile.h>
 #include <wsutil/report_message.h>
 #include <app/application_flavor.h>
 #include <wsutil/path_config.h>
@@ -144,6 +147,7 @@
 #define LONGOPT_GLOBAL_PROFILE          LONGOPT_BASE_APPLICATION+10
 #define LONGOPT_COMPRESS                LONGOPT_BASE_APPLICATION+11
 #define LONGOPT_JSON_COMPACT            LONGOPT_BASE_APPLICATION+12
+#define LONGOPT_SECOND_PASS_JOBS        LONGOPT_BASE_APPLICATION+13
 
 capture_file cfile;
 
@@ -153,6 +157,7 @@ static frame_data prev_dis_frame;
 static frame_data prev_cap_frame;
 
 static bool perform_two_pass_analysis;
+static uint32_t second_pass_jobs = 1;
 static uint32_t epan_auto_reset_count;
 static bool epan_auto_reset;
 
@@ -230,6 +235,8 @@ static void capture_input_new_packets(capture_session *cap_session,
         int to_read);
 static void capture_input_drops(capture_session *cap_session, uint32_t dropped,
         const char* interface_name);
+static void capture_input_queue_usage(capture_session *cap_session,
+        const capture_queue_usage *usage, const char *interface_name);
 static void capture_input_error(capture_session *cap_session,
         char *error_msg, char *secondary_error_msg);
 static void capture_input_cfilter_error(capture_session *cap_session,
@@ -495,6 +502,9 @@ print_usage(FILE *output)
     fprintf(output, "\n");
     fprintf(output, "Processing:\n");
     fprintf(output, "  -2                       perform a two-pass analysis\n");
+    fprintf(output, "  --second-pass-jobs <count>\n");
+    fprintf(output, "                           split the second pass of -2 across <count> processes\n");
+    fprintf(output, "                           (at most one per CPU; 0 = one per CPU; def: 1)\n");
     fprintf(output, "  -M <packet count>        perform session auto reset\n");
     fprintf(output, "  -R <read filter>, --read-filter <read filter>\n");
     fprintf(output, "                           packet Read filter in Wireshark display filter syntax\n");
@@ -1087,6 +1097,7 @@ main(int argc, char *argv[])
         {"global-profile", ws_no_argument, NULL, LONGOPT_GLOBAL_PROFILE},
         {"compress", ws_required_argument, NULL, LONGOPT_COMPRESS},
         {"json-compact", ws_no_argument, NULL, LONGOPT_JSON_COMPACT},
+        {"second-pass-jobs", ws_required_argument, NULL, LONGOPT_SECOND_PASS_JOBS},
         {0, 0, 0, 0}
     };
     bool                 arg_error = false;
@@ -1349,8 +1360,8 @@ main(int argc, char *argv[])
     capture_opts_init(&global_capture_opts, capture_opts_get_interface_list);
     capture_session_init(&global_capture_session, &cfile,
             capture_input_new_file, capture_input_new_packets,
-            capture_input_drops, capture_input_error,
-            capture_input_cfilter_error,
+            capture_input_drops, capture_input_queue_usage,
+            capture_input_error, capture_input_cfilter_error,
             capture_input_warning, NULL,
             capture_input_closed);
 #endif
@@ -1955,6 +1966,15 @@ main(int argc, char *argv[])
             case LONGOPT_JSON_COMPACT:
                 json_compact = true;
                 break;
+            case LONGOPT_SECOND_PASS_JOBS:
+                if (!get_uint32(ws_optarg, "second pass job count", &second_pass_jobs)) {
+                    exit_status = WS_EXIT_INVALID_OPTION;
+                    goto clean_exit;
+                }
+                /* More processes than CPUs wouldn't get done any sooner. */
+                if (second_pass_jobs == 0 || second_pass_jobs > g_get_num_processors())
+                    second_pass_jobs = g_get_num_processors();
+                break;
             case '?':        /* Bad flag - print usage message */
             default:
                 /* wslog arguments are okay */
@@ -2010,6 +2030,12 @@ main(int argc, char *argv[])
         goto clean_exit;
     }
 
+    if (second_pass_jobs != 1 && !perform_two_pass_analysis) {
+        cmdarg_err("--second-pass-jobs can only be used with \"-2\"");
+        exit_status = WS_EXIT_INVALID_OPTION;
+        goto clean_exit;
+    }
+
     /* If we specified output fields, but not the output field type... */
     /* XXX: If we specified both output fields with -e *and* protocol filters
      * with -j/-J, only the former are used. Should we warn or abort?
@@ -3213,6 +3239,8 @@ capture_input_new_file(capture_session *cap_session, char *new_file)
         /* Attempt to open the capture file and set up to read from it. */
         switch(cf_open(cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
             case CF_OK:
+                /* Read what dumpcap just wrote from shared memory, if we can. */
+                wtap_set_shm_ring(cap_session->cf->provider.wth, cap_session->shm_ring);
                 break;
             case CF_ERROR:
                 /* Don't unlink (delete) the save file - leave it around,
@@ -3409,6 +3437,17 @@ report_counts_siginfo(int signum _U_)
 #endif /* SIGINFO */
 
 
+/* capture child told us how full a packet queue is */
+static void
+capture_input_queue_usage(capture_session *cap_session _U_,
+        const capture_queue_usage *usage, const char *interface_name)
+{
+    ws_info("Packet queue of %s: %u packets/%u bytes, at most %u packets/%u bytes (buffer %u bytes)",
+            interface_name, usage->packets, usage->bytes,
+            usage->max_packets, usage->max_bytes, usage->size);
+}
+
+
 /* capture child detected any packet drops? */
 static void
 capture_input_drops(capture_session *cap_session _U_, uint32_t dropped, const char* interface_name)
@@ -3584,8 +3623,8 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
          */
         if (edt && cf->dfcode) {
             elapsed_start = g_get_monotonic_time();
-            if (dfilter_apply_edt(cf->dfcode, edt) && edt->pi.fd->dependent_frames) {
-                g_hash_table_foreach(edt->pi.fd->dependent_frames, find_and_mark_frame_depended_upon, cf->provider.frames);
+            if (dfilter_apply_edt(cf->dfcode, edt) && frame_data_dependent_frames(edt->pi.fd)) {
+                g_hash_table_foreach(frame_data_dependent_frames(edt->pi.fd), find_and_mark_frame_depended_upon, cf->provider.frames);
             }
 
             if (selected_frame_number != 0 && selected_frame_number == cf->count + 1) {
@@ -3880,40 +3919,15 @@ process_new_idbs(wtap *wth, wtap_dumper *pdh, int *err, char **err_info)
     return true;
 }
 
-static pass_status_t
-process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
-        int *err, char **err_info,
-        volatile uint32_t *err_framenum,
-        int max_write_packet_count)
+static epan_dissect_t *
+second_pass_edt_new(capture_file *cf, unsigned tap_flags)
 {
-    wtap_rec        rec;
-    int             framenum;
-    bool            got_printing_error;
-    int             write_framenum = 0;
-    frame_data     *fdata;
     bool            filtering_tap_listeners;
-    unsigned        tap_flags;
     epan_dissect_t *edt = NULL;
-    pass_status_t   status = PASS_SUCCEEDED;
-
-    /*
-     * Process whatever IDBs we haven't seen yet.  This will be all
-     * the IDBs in the file, as we've finished reading it; they'll
-     * all be at the beginning of the output file.
-     */
-    if (!process_new_idbs(cf->provider.wth, pdh, err, err_info)) {
-        *err_framenum = 0;
-        return PASS_WRITE_ERROR;
-    }
-
-    wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
 
     /* Do we have any tap listeners with filters? */
     filtering_tap_listeners = have_filtering_tap_listeners();
 
-    /* Get the union of the flags for all tap listeners. */
-    tap_flags = union_of_tap_listener_flags();
-
     if (do_dissection) {
         bool create_proto_tree;
 
@@ -3945,6 +3959,41 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
         edt = epan_dissect_new(cf->epan, create_proto_tree, visible);
     }
 
+    return edt;
+}
+
+static pass_status_t
+process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
+        int *err, char **err_info,
+        volatile uint32_t *err_framenum,
+        int max_write_packet_count)
+{
+    wtap_rec        rec;
+    int             framenum;
+    bool            got_printing_error;
+    int             write_framenum = 0;
+    frame_data     *fdata;
+    unsigned        tap_flags;
+    epan_dissect_t *edt;
+    pass_status_t   status = PASS_SUCCEEDED;
+
+    /*
+     * Process whatever IDBs we haven't seen yet.  This will be all
+     * the IDBs in the file, as we've finished reading it; they'll
+     * all be at the beginning of the output file.
+     */
+    if (!process_new_idbs(cf->provider.wth, pdh, err, err_info)) {
+        *err_framenum = 0;
+        return PASS_WRITE_ERROR;
+    }
+
+    wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
+
+    /* Get the union of the flags for all tap listeners. */
+    tap_flags = union_of_tap_listener_flags();
+
+    edt = second_pass_edt_new(cf, tap_flags);
+
     /*
      * Force synchronous resolution of IP addresses; in this pass, we
      * can't do it in the background and fix up past dissections.
@@ -4019,6 +4068,345 @@ process_cap_file_second_pass(capture_file *cf, wtap_dumper *pdh,
     return status;
 }
 
+#ifndef _WIN32
+/*
+ * How a second pass worker process did, as written to its status pipe.
+ * It's followed by err_info_len bytes of err_info.
+ */
+typedef struct {
+    int32_t  status;
+    int32_t  err;
+    uint32_t err_info_len;
+} second_pass_worker_status_t;
+
+typedef struct {
+    pid_t pid;
+    int   out_fd;       /* unlinked temporary file the worker prints to */
+    int   status_fd;    /* read end of the worker's status pipe */
+} second_pass_worker_t;
+
+/*
+ * Can the second pass be split across worker processes?
+ *
+ * Each worker prints its own range of frames to a temporary file,
+ * and we copy those to the standard output in order, so the printed
+ * packets must not depend on anything but the first pass state and
+ * the frames before them, and there must be nothing else to do with
+ * the packets.
+ */
+static bool
+can_split_second_pass(capture_file *cf, wtap_dumper *pdh, uint32_t jobs)
+{
+    if (jobs < 2 || cf->count < jobs)
+        return false;
+
+    /* Only printing; a capture file must be written sequentially. */
+    if (pdh != NULL || !print_packet_info || line_buffered)
+        return false;
+
+    /* Taps (statistics, export objects) accumulate state in one process. */
+    if (tap_listeners_require_dissection())
+        return false;
+
+    /*
+     * Whether a packet is displayed depends on the previous displayed
+     * packet (e.g. frame.time_delta_displayed), which a worker can't know
+     * without running the filter on all the earlier frames.
+     */
+    if (cf->dfcode != NULL)
+        return false;
+
+    /* PostScript output has page state. */
+    if (output_action == WRITE_TEXT && print_format != PR_FMT_TEXT)
+        return false;
+
+    /* Asynchronous lookups would be done by every worker separately. */
+    if (gbl_resolv_flags.network_name || gbl_resolv_flags.maxmind_geoip)
+        return false;
+
+    /* The workers have to be able to reopen the file. */
+    if (cf->filename == NULL || strcmp(cf->filename, "-") == 0)
+        return false;
+
+    return true;
+}
+
+static bool
+write_worker_status(int fd, pass_status_t status, int err, const char *err_info)
+{
+    second_pass_worker_status_t worker_status;
+    size_t   len;
+
+    worker_status.status = status;
+    worker_status.err = err;
+    worker_status.err_info_len = err_info ? (uint32_t)strlen(err_info) : 0;
+    if (ws_write(fd, &worker_status, sizeof worker_status) != (ssize_t)sizeof worker_status)
+        return false;
+    len = worker_status.err_info_len;
+    while (len > 0) {
+        ssize_t nwritten = ws_write(fd, err_info, len);
+        if (nwritten <= 0)
+            return false;
+        err_info += nwritten;
+        len -= nwritten;
+    }
+    return true;
+}
+
+/*
+ * Print frames first through last in a forked worker process, and exit.
+ */
+WS_NORETURN static void
+run_second_pass_worker(capture_file *cf, uint32_t first, uint32_t last,
+        int out_fd, int status_fd)
+{
+    wtap_rec        rec;
+    uint32_t        framenum;
+    frame_data     *fdata;
+    unsigned        tap_flags;
+    epan_dissect_t *edt;
+    int             err = 0;
+    char           *err_info = NULL;
+    pass_status_t   status = PASS_SUCCEEDED;
+
+    if (dup2(out_fd, STDOUT_FILENO) == -1 ||
+            !wtap_fdreopen(cf->provider.wth, cf->filename, &err)) {
+        if (err == 0)
+            err = errno;
+        write_worker_status(status_fd, PASS_READ_ERROR, err, NULL);
+        _exit(0);
+    }
+
+    tap_flags = union_of_tap_listener_flags();
+    edt = second_pass_edt_new(cf, tap_flags);
+
+    /*
+     * Bring the relative time stamps and cumulative byte count up to
+     * where the sequential second pass would have them at the first
+     * frame; every frame passes, as there's no display filter.
+     */
+    for (framenum = 1; framenum < first; framenum++) {
+        fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+        if (edt) {
+            frame_data_set_before_dissect(fdata, &cf->elapsed_time,
+                    &cf->provider.ref, cf->provider.prev_dis);
+            if (cf->provider.ref == fdata) {
+                ref_frame = *fdata;
+                cf->provider.ref = &ref_frame;
+            }
+        }
+        frame_data_set_after_dissect(fdata, &cum_bytes);
+        cf->provider.prev_dis = fdata;
+        cf->provider.prev_cap = fdata;
+    }
+
+    if (first > 1 && (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW))
+        json_dumper_skip_value(&jdumper);
+
+    wtap_rec_init(&rec, DEFAULT_INIT_BUFFER_SIZE_2048);
+    set_resolution_synchrony(true);
+
+    for (framenum = first; framenum <= last; framenum++) {
+        if (read_interrupted) {
+            status = PASS_INTERRUPTED;
+            break;
+        }
+        fdata = frame_data_sequence_find(cf->provider.frames, framenum);
+        if (!wtap_seek_read(cf->provider.wth, fdata->file_off, &rec, &err,
+                    &err_info)) {
+            status = PASS_READ_ERROR;
+            break;
+        }
+        if (process_packet_second_pass(cf, edt, fdata, &rec, tap_flags) == PROCESS_PACKET_PRINT_ERROR) {
+            status = PASS_PRINT_ERROR;
+            break;
+        }
+        wtap_rec_reset(&rec);
+    }
+
+    if (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW)
+        json_dumper_flush(&jdumper);
+    if (fflush(stdout) == EOF && status == PASS_SUCCEEDED) {
+        show_print_file_io_error();
+        status = PASS_PRINT_ERROR;
+    }
+
+    write_worker_status(status_fd, status, err, err_info);
+    _exit(0);
+}
+
+/*
+ * Read a worker's status and wait for it to exit.  Returns false if
+ * it died without reporting its status.
+ */
+static bool
+collect_second_pass_worker(second_pass_worker_t *worker,
+        pass_status_t *status, int *err, char **err_info)
+{
+    second_pass_worker_status_t worker_status;
+    bool    reported = false;
+    int     wstatus;
+
+    if (ws_read(worker->status_fd, &worker_status, sizeof worker_status) == (ssize_t)sizeof worker_status) {
+        char   *info = NULL;
+        size_t  len = worker_status.err_info_len;
+
+        reported = true;
+        if (len > 0) {
+            size_t nread = 0;
+
+            info = (char *)g_malloc(len + 1);
+            while (nread < len) {
+                ssize_t n = ws_read(worker->status_fd, info + nread, len - nread);
+                if (n <= 0)
+                    break;
+                nread += n;
+            }
+            info[nread] = '\0';
+        }
+        *status = (pass_status_t)worker_status.status;
+        *err = worker_status.err;
+        *err_info = info;
+    }
+    ws_close(worker->status_fd);
+    worker->status_fd = -1;
+
+    while (waitpid(worker->pid, &wstatus, 0) == -1 && errno == EINTR)
+        ;
+    worker->pid = -1;
+    return reported;
+}
+
+/*
+ * Copy a worker's output to the standard output.
+ */
+static bool
+copy_second_pass_worker_output(second_pass_worker_t *worker, bool *copied)
+{
+    char     buf[65536];
+    ssize_t  nread;
+
+    if (lseek(worker->out_fd, 0, SEEK_SET) == -1)
+        return false;
+    while ((nread = ws_read(worker->out_fd, buf, sizeof buf)) > 0) {
+        if (fwrite(buf, 1, nread, stdout) != (size_t)nread)
+            return false;
+        *copied = true;
+    }
+    return nread == 0;
+}
+
+/*
+ * Do the second pass in several worker processes, each printing a
+ * contiguous range of frames.
+ *
+ * Dissection isn't thread-safe, so the workers are forked processes;
+ * they share the state of the first pass with us copy-on-write, and
+ * each reopens the capture file so they don't share a file offset.
+ */
+static pass_status_t
+process_cap_file_second_pass_split(capture_file *cf, uint32_t jobs,
+        int *err, char **err_info)
+{
+    second_pass_worker_t *workers;
+    uint32_t      i;
+    uint32_t      started = 0;
+    uint32_t      first = 1;
+    bool          copied = false;
+    pass_status_t status = PASS_SUCCEEDED;
+
+    /* Don't let the workers inherit, and print, our buffered output. */
+    if (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW)
+        json_dumper_flush(&jdumper);
+    if (fflush(stdout) == EOF) {
+        show_print_file_io_error();
+        return PASS_PRINT_ERROR;
+    }
+
+    workers = g_new(second_pass_worker_t, jobs);
+    for (i = 0; i < jobs; i++) {
+        uint32_t last = (uint32_t)(((uint64_t)cf->count * (i + 1)) / jobs);
+        char    *tmpname = NULL;
+        GError  *gerr = NULL;
+        int      status_pipe[2];
+
+        workers[i].out_fd = create_tempfile(NULL, &tmpname, "tshark_pass2", NULL, &gerr);
+        if (workers[i].out_fd == -1) {
+            cmdarg_err("Couldn't create a temporary file for the second pass: %s",
+                    gerr->message);
+            g_error_free(gerr);
+            status = PASS_PRINT_ERROR;
+            break;
+        }
+        /* Nobody else needs the name; the file goes away when we close it. */
+        ws_unlink(tmpname);
+        g_free(tmpname);
+
+        if (pipe(status_pipe) == -1) {
+            cmdarg_err("Couldn't create a pipe for the second pass: %s",
+                    g_strerror(errno));
+            ws_close(workers[i].out_fd);
+            status = PASS_PRINT_ERROR;
+            break;
+        }
+
+        workers[i].pid = fork();
+        if (workers[i].pid == -1) {
+            cmdarg_err("Couldn't start a second pass worker: %s",
+                    g_strerror(errno));
+            ws_close(status_pipe[0]);
+            ws_close(status_pipe[1]);
+            ws_close(workers[i].out_fd);
+            status = PASS_PRINT_ERROR;
+            break;
+        }
+        if (workers[i].pid == 0) {
+            ws_close(status_pipe[0]);
+            run_second_pass_worker(cf, first, last, workers[i].out_fd, status_pipe[1]);
+        }
+        ws_close(status_pipe[1]);
+        workers[i].status_fd = status_pipe[0];
+        started++;
+        first = last + 1;
+    }
+
+    /*
+     * Copy the output in frame order, stopping at the first worker
+     * that failed; its output ends at the failure, as it would have
+     * without splitting.
+     */
+    for (i = 0; i < started; i++) {
+        if (status == PASS_SUCCEEDED) {
+            pass_status_t worker_status = PASS_SUCCEEDED;
+
+            if (!collect_second_pass_worker(&workers[i], &worker_status, err, err_info)) {
+                cmdarg_err("A second pass worker exited abnormally.");
+                status = PASS_PRINT_ERROR;
+            } else if (!copy_second_pass_worker_output(&workers[i], &copied)) {
+                show_print_file_io_error();
+                status = PASS_PRINT_ERROR;
+            } else {
+                status = worker_status;
+            }
+        } else {
+            /* Nobody will read what the rest of the workers print. */
+            kill(workers[i].pid, SIGTERM);
+            ws_close(workers[i].status_fd);
+            while (waitpid(workers[i].pid, NULL, 0) == -1 && errno == EINTR)
+                ;
+        }
+        ws_close(workers[i].out_fd);
+    }
+    g_free(workers);
+
+    /* The finale has to follow the last packet the workers printed. */
+    if (copied && (output_action == WRITE_JSON || output_action == WRITE_JSON_RAW))
+        json_dumper_skip_value(&jdumper);
+
+    return status;
+}
+#endif /* _WIN32 */
+
 static pass_status_t
 process_cap_file_single_pass(capture_file *cf, wtap_dumper *pdh,
         int max_packet_count, int64_t max_byte_count,
@@ -4319,9 +4707,15 @@ process_cap_file(capture_file *cf, char *save_file, int out_file_type,
              * at the end.
              */
             elapsed_start = g_get_monotonic_time();
-            second_pass_status = process_cap_file_second_pass(cf, pdh, &err, &err_info,
-                    &err_framenum,
-                    max_write_packet_count);
+#ifndef _WIN32
+            if (can_split_second_pass(cf, pdh, second_pass_jobs))
+                second_pass_status = process_cap_file_second_pass_split(cf,
+                        second_pass_jobs, &err, &err_info);
+            else
+#endif
+                second_pass_status = process_cap_file_second_pass(cf, pdh, &err, &err_info,
+                        &err_framenum,
+                        max_write_packet_count);
             tshark_elapsed.elapsed_second_pass = g_get_monotonic_time() - elapsed_start;
 
             ws_debug("tshark: done with second pass");
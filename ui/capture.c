@@ -449,6 +449,8 @@ capture_input_new_file(capture_session *cap_session, char *new_file)
         /* Attempt to open the capture file and set up to read from it. */
         switch(cf_open((capture_file *)cap_session->cf, capture_opts->save_file, WTAP_TYPE_AUTO, is_tempfile, &err)) {
             case CF_OK:
+                /* Read what dumpcap just wrote from shared memory, if we can. */
+                wtap_set_shm_ring(((capture_file *)cap_session->cf)->provider.wth, cap_session->shm_ring);
                 break;
             case CF_ERROR:
                 /* Don't unlink (delete) the save file - leave it around,
@@ -612,6 +614,18 @@ capture_input_drops(capture_session *cap_session, uint32_t dropped, const char*
 }
 
 
+/* Capture child told us how full the packet queue of an interface is.
+ */
+static void
+capture_input_queue_usage(capture_session *cap_session _U_,
+                          const capture_queue_usage *usage, const char *interface_name)
+{
+    ws_info("Packet queue of %s: %u packets/%u bytes, at most %u packets/%u bytes (buffer %u bytes)",
+            interface_name, usage->packets, usage->bytes,
+            usage->max_packets, usage->max_bytes, usage->size);
+}
+
+
 /* Capture child told us that an error has occurred while starting or
    running the capture.
    The secondary message might be a null string.
@@ -923,8 +937,8 @@ capture_input_init(capture_session *cap_session, capture_file *cf)
 {
     capture_session_init(cap_session, cf,
                          capture_input_new_file, capture_input_new_packets,
-                         capture_input_drops, capture_input_error,
-                         capture_input_cfilter_error,
+                         capture_input_drops, capture_input_queue_usage,
+                         capture_input_error, capture_input_cfilter_error,
                          capture_input_warning, capture_input_toolbar_control,
                          capture_input_closed);
 }
@@ -0,0 +1,140 @@
+/* tap-heurstat.c
+ * Cost of the heuristic dissectors
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/* This module reports, for tshark, how often each heuristic dissector was
+ * tried, how often it accepted a packet, and how long it took. */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <epan/packet.h>
+#include <epan/tap.h>
+#include <epan/stat_tap_ui.h>
+
+#include <wsutil/cmdarg_err.h>
+
+void register_tap_listener_heurstat(void);
+
+static void
+heurstat_add_entry(const char *table_name _U_, heur_dtbl_entry_t *entry, void *user_data)
+{
+	GPtrArray *entries = (GPtrArray *)user_data;
+
+	if (entry->attempts != 0)
+		g_ptr_array_add(entries, entry);
+}
+
+static void
+heurstat_add_table(const char *table_name, struct heur_dissector_list *table _U_, void *user_data)
+{
+	heur_dissector_table_foreach(table_name, heurstat_add_entry, user_data);
+}
+
+/* Most time first, then most attempts. */
+static int
+heurstat_compare(const void *a, const void *b)
+{
+	const heur_dtbl_entry_t *entry_a = *(const heur_dtbl_entry_t **)a;
+	const heur_dtbl_entry_t *entry_b = *(const heur_dtbl_entry_t **)b;
+
+	if (entry_a->time_us != entry_b->time_us)
+		return entry_a->time_us < entry_b->time_us ? 1 : -1;
+	if (entry_a->attempts != entry_b->attempts)
+		return entry_a->attempts < entry_b->attempts ? 1 : -1;
+	return strcmp(entry_a->short_name, entry_b->short_name);
+}
+
+static void
+heurstat_draw(void *tapdata _U_)
+{
+	GPtrArray *entries = g_ptr_array_new();
+
+	dissector_all_heur_tables_foreach_table(heurstat_add_table, entries, NULL);
+	g_ptr_array_sort(entries, heurstat_compare);
+
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Heuristic Dissector Statistics\n");
+	printf("%-24s %-16s %12s %12s %12s\n", "Heuristic", "Table", "Attempts", "Accepts", "Time (ms)");
+	for (unsigned i = 0; i < entries->len; i++) {
+		const heur_dtbl_entry_t *entry = (const heur_dtbl_entry_t *)g_ptr_array_index(entries, i);
+
+		printf("%-24s %-16s %12" PRIu64 " %12" PRIu64 " %12.3f\n",
+			entry->short_name, entry->list_name, entry->attempts,
+			entry->accepts, entry->time_us / 1000.0);
+	}
+	printf("===================================================================\n");
+	g_ptr_array_free(entries, true);
+}
+
+static void
+heurstat_finish(void *tapdata _U_)
+{
+	heur_dissector_set_timing(false);
+}
+
+static bool
+heurstat_init(const char *opt_arg, void *userdata _U_)
+{
+	GString *error_string;
+
+	if (strcmp("heur,stat", opt_arg) != 0) {
+		cmdarg_err("invalid \"-z heur,stat\" argument");
+		return false;
+	}
+
+	/*
+	 * The counters live in the heuristic dissector entries; the tap
+	 * is only there to have them printed at the end.
+	 */
+	heur_dissector_reset_stats();
+	heur_dissector_set_timing(true);
+
+	error_string = register_tap_listener("frame", NULL, NULL, TL_REQUIRES_NOTHING, NULL, NULL, heurstat_draw, heurstat_finish);
+	if (error_string) {
+		heur_dissector_set_timing(false);
+		cmdarg_err("Couldn't register heur,stat tap: %s",
+			error_string->str);
+		g_string_free(error_string, TRUE);
+		return false;
+	}
+
+	return true;
+}
+
+static stat_tap_ui heurstat_ui = {
+	REGISTER_STAT_GROUP_GENERIC,
+	NULL,
+	"heur,stat",
+	heurstat_init,
+	0,
+	NULL
+};
+
+void
+register_tap_listener_heurstat(void)
+{
+	register_stat_tap_ui(&heurstat_ui, NULL);
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
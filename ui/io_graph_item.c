@@ -310,3 +310,102 @@ double get_io_graph_item(const io_graph_item_t *items_, io_graph_item_unit_t val
     }
     return value;
 }
+
+void merge_io_graph_items(io_graph_item_t *merged, const io_graph_item_t *items, size_t count, int hf_index)
+{
+    ftenum_t ftype = hf_index >= 0 ? proto_registrar_get_ftype(hf_index) : FT_NONE;
+
+    reset_io_graph_items(merged, 1, hf_index);
+
+    for (size_t i = 0; i < count; i++) {
+        const io_graph_item_t *item = &items[i];
+        bool first = (merged->fields == 0);
+
+        if (item->frames == 0 && item->fields == 0) {
+            continue;
+        }
+
+        merged->frames += item->frames;
+        merged->bytes += item->bytes;
+
+        /* Frames are tapped in order, so the earliest and latest frames
+         * of the merged interval are the lowest and highest ones seen. */
+        if (item->first_frame_in_invl != 0 &&
+            (merged->first_frame_in_invl == 0 || item->first_frame_in_invl < merged->first_frame_in_invl)) {
+            merged->first_frame_in_invl = item->first_frame_in_invl;
+        }
+        if (item->last_frame_in_invl > merged->last_frame_in_invl) {
+            merged->last_frame_in_invl = item->last_frame_in_invl;
+        }
+
+        if (item->fields == 0) {
+            continue;
+        }
+
+        switch (ftype) {
+        case FT_UINT8:
+        case FT_UINT16:
+        case FT_UINT24:
+        case FT_UINT32:
+        case FT_UINT40:
+        case FT_UINT48:
+        case FT_UINT56:
+        case FT_UINT64:
+            if ((item->uint_max > merged->uint_max) || first) {
+                merged->uint_max = item->uint_max;
+                merged->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((item->uint_min < merged->uint_min) || first) {
+                merged->uint_min = item->uint_min;
+                merged->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            merged->double_tot += item->double_tot;
+            break;
+        case FT_INT8:
+        case FT_INT16:
+        case FT_INT24:
+        case FT_INT32:
+        case FT_INT40:
+        case FT_INT48:
+        case FT_INT56:
+        case FT_INT64:
+            if ((item->int_max > merged->int_max) || first) {
+                merged->int_max = item->int_max;
+                merged->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((item->int_min < merged->int_min) || first) {
+                merged->int_min = item->int_min;
+                merged->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            merged->double_tot += item->double_tot;
+            break;
+        case FT_FLOAT:
+        case FT_DOUBLE:
+            if ((item->double_max > merged->double_max) || first) {
+                merged->double_max = item->double_max;
+                merged->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((item->double_min < merged->double_min) || first) {
+                merged->double_min = item->double_min;
+                merged->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            merged->double_tot += item->double_tot;
+            break;
+        case FT_RELATIVE_TIME:
+            /* LOAD items only fill in time_tot, which adds up the same way. */
+            if ((nstime_cmp(&item->time_max, &merged->time_max) > 0) || first) {
+                merged->time_max = item->time_max;
+                merged->max_frame_in_invl = item->max_frame_in_invl;
+            }
+            if ((nstime_cmp(&item->time_min, &merged->time_min) < 0) || first) {
+                merged->time_min = item->time_min;
+                merged->min_frame_in_invl = item->min_frame_in_invl;
+            }
+            nstime_add(&merged->time_tot, &item->time_tot);
+            break;
+        default:
+            break;
+        }
+        merged->fields += item->fields;
+    }
+}
@@ -207,6 +207,20 @@ GString *check_field_unit(const char *field_name, int *hf_index, io_graph_item_u
  */
 double get_io_graph_item(const io_graph_item_t *items, io_graph_item_unit_t val_units, int idx, int hf_index, const capture_file *cap_file, int interval, int cur_idx, bool asAOT);
 
+/** Merge consecutive items into one item for a coarser interval.
+ *
+ * The items must have been filled in by update_io_graph_item() at an
+ * interval that evenly divides the coarser one, so that each of them falls
+ * entirely within it. Counts and totals are added up, and the minimum,
+ * maximum, first and last frames are taken across all of the items.
+ *
+ * @param merged [out] The merged item. Its previous contents are discarded.
+ * @param items [in] Array containing the items to merge.
+ * @param count [in] The number of items in the array.
+ * @param hf_index [in] Header field index for advanced statistics.
+ */
+void merge_io_graph_items(io_graph_item_t *merged, const io_graph_item_t *items, size_t count, int hf_index);
+
 /** Update the values of an io_graph_item_t.
  *
  * Frame and byte counts are always calculated. If edt is non-NULL advanced
@@ -0,0 +1,329 @@
+/* io_graph_item_test.c
+ * Tests for merging I/O graph items
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <epan/epan.h>
+#include <epan/epan_dissect.h>
+#include <epan/frame_data.h>
+#include <epan/packet_info.h>
+#include <epan/proto.h>
+#include <epan/register.h>
+#include <epan/tvbuff.h>
+#include <wiretap/wtap.h>
+#include <wsutil/filesystem.h>
+#include <wsutil/wslog.h>
+
+#include "ui/io_graph_item.h"
+
+#define TEST_FRAMES         1500
+/* Intervals in μs. LOAD items overflow with intervals over a second. */
+#define TEST_FINE_INTERVAL  10000
+#define TEST_MERGE_FACTOR   10
+#define TEST_COARSE_INTERVAL (TEST_FINE_INTERVAL * TEST_MERGE_FACTOR)
+/* Longer than the frames take on average. */
+#define TEST_DURATION       (TEST_COARSE_INTERVAL * 100)
+
+typedef struct {
+    uint32_t len;
+    nstime_t rel_ts;
+    uint64_t uint_value;
+    nstime_t time_value;
+} test_frame_t;
+
+typedef struct {
+    int hf_index;
+    int item_unit;
+    io_graph_item_t *fine;
+    io_graph_item_t *coarse;
+    int fine_cur_idx;
+    int coarse_cur_idx;
+} test_graph_t;
+
+static epan_t *test_session;
+static test_frame_t test_frames[TEST_FRAMES + 1];
+
+static void
+fill_test_frames(void)
+{
+    GRand *rand = g_rand_new_with_seed(14);
+    uint64_t rel_us = 0;
+
+    for (uint32_t num = 1; num <= TEST_FRAMES; num++) {
+        test_frame_t *frame = &test_frames[num];
+        uint64_t value_us;
+
+        /* Bursts of frames in one interval, and quiet intervals. */
+        if (g_rand_int_range(rand, 0, 8) == 0) {
+            rel_us += g_rand_int_range(rand, 0, 4 * TEST_FINE_INTERVAL);
+        } else {
+            rel_us += g_rand_int_range(rand, 0, TEST_FINE_INTERVAL / 2);
+        }
+        if (rel_us >= TEST_DURATION) {
+            rel_us = TEST_DURATION - 1;
+        }
+        frame->len = g_rand_int_range(rand, 60, 1515);
+        frame->rel_ts.secs = (time_t)(rel_us / 1000000);
+        frame->rel_ts.nsecs = (int)(rel_us % 1000000) * 1000;
+        /* Repeat values, so that ties for the minimum and maximum are
+         * broken the same way. */
+        frame->uint_value = g_rand_int_range(rand, 0, 50) * 1000;
+        /* Response times spanning several intervals. */
+        value_us = g_rand_int_range(rand, 0, 3 * TEST_COARSE_INTERVAL);
+        frame->time_value.secs = (time_t)(value_us / 1000000);
+        frame->time_value.nsecs = (int)(value_us % 1000000) * 1000;
+    }
+    g_rand_free(rand);
+}
+
+static void
+tap_test_frame(test_graph_t *graph, uint32_t num)
+{
+    static const uint8_t bytes[8];
+    const test_frame_t *frame = &test_frames[num];
+    frame_data fd;
+    packet_info pinfo;
+    epan_dissect_t *edt;
+    tvbuff_t *tvb;
+    int64_t idx;
+
+    memset(&fd, 0, sizeof(fd));
+    fd.num = num;
+    fd.pkt_len = frame->len;
+    memset(&pinfo, 0, sizeof(pinfo));
+    pinfo.num = num;
+    pinfo.fd = &fd;
+    pinfo.rel_ts = frame->rel_ts;
+
+    edt = epan_dissect_new(test_session, true, false);
+    tvb = tvb_new_real_data(bytes, sizeof(bytes), sizeof(bytes));
+    if (proto_registrar_get_ftype(graph->hf_index) == FT_RELATIVE_TIME) {
+        proto_tree_add_time(edt->tree, graph->hf_index, tvb, 0, 8, &frame->time_value);
+    } else {
+        proto_tree_add_uint(edt->tree, graph->hf_index, tvb, 0, 4, (uint32_t)frame->uint_value);
+    }
+
+    idx = get_io_graph_index(&pinfo, TEST_FINE_INTERVAL);
+    g_assert_cmpint(idx, >=, 0);
+    g_assert_true(update_io_graph_item(graph->fine, (int)idx, &pinfo, edt, graph->hf_index, graph->item_unit, TEST_FINE_INTERVAL));
+    graph->fine_cur_idx = (int)idx;
+
+    /* The retap at the coarser interval. */
+    idx = get_io_graph_index(&pinfo, TEST_COARSE_INTERVAL);
+    g_assert_cmpint(idx, >=, 0);
+    g_assert_true(update_io_graph_item(graph->coarse, (int)idx, &pinfo, edt, graph->hf_index, graph->item_unit, TEST_COARSE_INTERVAL));
+    graph->coarse_cur_idx = (int)idx;
+
+    epan_dissect_free(edt);
+    tvb_free(tvb);
+}
+
+static void
+tap_test_graph(test_graph_t *graph, const char *field, int item_unit)
+{
+    size_t fine_count = TEST_DURATION / TEST_FINE_INTERVAL + 1;
+    size_t coarse_count = TEST_DURATION / TEST_COARSE_INTERVAL + 1;
+
+    graph->hf_index = proto_registrar_get_id_byname(field);
+    g_assert_cmpint(graph->hf_index, >=, 0);
+    graph->item_unit = item_unit;
+    graph->fine = g_new(io_graph_item_t, fine_count);
+    reset_io_graph_items(graph->fine, fine_count, graph->hf_index);
+    graph->coarse = g_new(io_graph_item_t, coarse_count);
+    reset_io_graph_items(graph->coarse, coarse_count, graph->hf_index);
+
+    for (uint32_t num = 1; num <= TEST_FRAMES; num++) {
+        tap_test_frame(graph, num);
+    }
+    g_assert_cmpint(graph->coarse_cur_idx, ==, graph->fine_cur_idx / TEST_MERGE_FACTOR);
+}
+
+static void
+free_test_graph(test_graph_t *graph)
+{
+    g_free(graph->fine);
+    g_free(graph->coarse);
+}
+
+/*
+ * Merge the fine items of each coarse interval the way IOGraph does, and
+ * check that the merged items give the values the retap gave.
+ */
+static void
+check_merged_items(const test_graph_t *graph, const io_graph_item_unit_t *units, size_t unit_count)
+{
+    for (int idx = 0; idx <= graph->coarse_cur_idx; idx++) {
+        int first_item = idx * TEST_MERGE_FACTOR;
+        int count = MIN(TEST_MERGE_FACTOR, graph->fine_cur_idx + 1 - first_item);
+        const io_graph_item_t *retapped = &graph->coarse[idx];
+        io_graph_item_t merged;
+
+        merge_io_graph_items(&merged, &graph->fine[first_item], count, graph->hf_index);
+
+        g_assert_cmpuint(merged.frames, ==, retapped->frames);
+        g_assert_cmpuint(merged.bytes, ==, retapped->bytes);
+        g_assert_cmpuint(merged.first_frame_in_invl, ==, retapped->first_frame_in_invl);
+        g_assert_cmpuint(merged.last_frame_in_invl, ==, retapped->last_frame_in_invl);
+        if (graph->item_unit != IOG_ITEM_UNIT_CALC_LOAD) {
+            /* A LOAD value counts once in every interval it spans. */
+            g_assert_cmpuint(merged.fields, ==, retapped->fields);
+            g_assert_cmpuint(merged.min_frame_in_invl, ==, retapped->min_frame_in_invl);
+            g_assert_cmpuint(merged.max_frame_in_invl, ==, retapped->max_frame_in_invl);
+        }
+
+        for (size_t i = 0; i < unit_count; i++) {
+            double merged_value = get_io_graph_item(&merged, units[i], 0, graph->hf_index, NULL, TEST_COARSE_INTERVAL, 0, false);
+            double retapped_value = get_io_graph_item(graph->coarse, units[i], idx, graph->hf_index, NULL, TEST_COARSE_INTERVAL, graph->coarse_cur_idx, false);
+
+            /* Sums of doubles may be added up in another order. */
+            g_assert_cmpfloat(fabs(merged_value - retapped_value), <=, 1e-9 * MAX(1.0, fabs(retapped_value)));
+        }
+    }
+}
+
+static void
+test_merge_uint(void)
+{
+    static const io_graph_item_unit_t units[] = {
+        IOG_ITEM_UNIT_PACKETS,
+        IOG_ITEM_UNIT_BYTES,
+        IOG_ITEM_UNIT_CALC_FIELDS,
+        IOG_ITEM_UNIT_CALC_SUM,
+        IOG_ITEM_UNIT_CALC_MIN,
+        IOG_ITEM_UNIT_CALC_MAX,
+        IOG_ITEM_UNIT_CALC_AVERAGE,
+        IOG_ITEM_UNIT_CALC_THROUGHPUT,
+    };
+    test_graph_t graph;
+
+    tap_test_graph(&graph, "frame.len", IOG_ITEM_UNIT_CALC_SUM);
+    check_merged_items(&graph, units, G_N_ELEMENTS(units));
+    free_test_graph(&graph);
+}
+
+static void
+test_merge_time(void)
+{
+    static const io_graph_item_unit_t units[] = {
+        IOG_ITEM_UNIT_CALC_SUM,
+        IOG_ITEM_UNIT_CALC_MIN,
+        IOG_ITEM_UNIT_CALC_MAX,
+        IOG_ITEM_UNIT_CALC_AVERAGE,
+    };
+    test_graph_t graph;
+
+    tap_test_graph(&graph, "frame.time_delta", IOG_ITEM_UNIT_CALC_AVERAGE);
+    check_merged_items(&graph, units, G_N_ELEMENTS(units));
+    free_test_graph(&graph);
+}
+
+static void
+test_merge_load(void)
+{
+    static const io_graph_item_unit_t units[] = {
+        IOG_ITEM_UNIT_PACKETS,
+        IOG_ITEM_UNIT_CALC_LOAD,
+    };
+    test_graph_t graph;
+
+    tap_test_graph(&graph, "frame.time_delta", IOG_ITEM_UNIT_CALC_LOAD);
+    check_merged_items(&graph, units, G_N_ELEMENTS(units));
+    free_test_graph(&graph);
+}
+
+static void
+test_merge_empty(void)
+{
+    io_graph_item_t items[TEST_MERGE_FACTOR];
+    io_graph_item_t merged;
+    int hf_index = proto_registrar_get_id_byname("frame.len");
+
+    /* Nothing in the interval leaves a reset item, whatever was in the
+     * item before. */
+    reset_io_graph_items(items, TEST_MERGE_FACTOR, hf_index);
+    memset(&merged, 0xff, sizeof(merged));
+    merge_io_graph_items(&merged, items, TEST_MERGE_FACTOR, hf_index);
+    g_assert_cmpuint(merged.frames, ==, 0);
+    g_assert_cmpuint(merged.fields, ==, 0);
+    g_assert_cmpuint(merged.first_frame_in_invl, ==, 0);
+    g_assert_cmpuint(merged.last_frame_in_invl, ==, 0);
+    g_assert_cmpfloat(get_io_graph_item(&merged, IOG_ITEM_UNIT_CALC_AVERAGE, 0, hf_index, NULL, TEST_COARSE_INTERVAL, 0, false), ==, 0);
+    g_assert_cmpfloat(get_io_graph_item(&merged, IOG_ITEM_UNIT_CALC_MAX, 0, hf_index, NULL, TEST_COARSE_INTERVAL, 0, false), ==, 0);
+}
+
+int
+main(int argc, char **argv)
+{
+    static const struct packet_provider_funcs funcs = { 0 };
+    static epan_app_data_t app_data;
+    char *configuration_init_error;
+    int ret;
+
+    g_set_prgname("io_graph_item_test");
+
+    ws_log_init(NULL, "Testing Debug Console");
+
+    g_test_init(&argc, &argv, NULL);
+
+    configuration_init_error = configuration_init(argv[0], "wireshark");
+    if (configuration_init_error != NULL) {
+        fprintf(stderr, "io_graph_item_test: Can't get pathname of directory containing the io_graph_item_test program: %s.\n",
+            configuration_init_error);
+        g_free(configuration_init_error);
+    }
+
+    wtap_init(false, NULL, NULL, 0);
+
+    /* The graphs plot fields of the frame dissector. */
+    app_data.env_var_prefix = "WIRESHARK";
+    app_data.register_func = register_all_protocols;
+    app_data.handoff_func = register_all_protocol_handoffs;
+    if (!epan_init(NULL, NULL, false, &app_data)) {
+        fprintf(stderr, "io_graph_item_test: Can't initialize the dissection engine.\n");
+        return 2;
+    }
+
+    test_session = epan_new(NULL, &funcs);
+    /* Make the fields findable in the tree, as the I/O graph does. */
+    proto_tree_prime_with_hfid(NULL, proto_registrar_get_id_byname("frame.len"));
+    proto_tree_prime_with_hfid(NULL, proto_registrar_get_id_byname("frame.time_delta"));
+    fill_test_frames();
+
+    g_test_add_func("/io_graph_item/merge_uint", test_merge_uint);
+    g_test_add_func("/io_graph_item/merge_time", test_merge_time);
+    g_test_add_func("/io_graph_item/merge_load", test_merge_load);
+    g_test_add_func("/io_graph_item/merge_empty", test_merge_empty);
+
+    ret = g_test_run();
+
+    epan_free(test_session);
+    epan_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
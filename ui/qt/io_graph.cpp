@@ -17,6 +17,7 @@
 
 //#include <QMessageBox>
 
+#include <climits>
 #include <new> // std::bad_alloc
 
 // GTK+ set this to 100000 (NUM_IO_ITEMS) before raising it to unlimited
@@ -41,7 +42,12 @@ IOGraph::IOGraph(QCustomPlot* parent, const char* type_unit_name) :
     interval_(0),
     asAOT_(false),
     type_unit_name_(type_unit_name),
-    cur_idx_(-1)
+    cur_idx_(-1),
+    tap_interval_(0),
+    tap_truncated_(false),
+    merge_factor_(1),
+    merged_cur_idx_(-1),
+    merge_dirty_idx_(INT_MAX)
 {
     GString* error_string;
     error_string = register_tap_listener("frame",
@@ -304,14 +310,15 @@ nstime_t IOGraph::startTime() const
 int IOGraph::packetFromTime(double ts) const
 {
     int idx = ts * SCALE_F / interval_;
-    if (idx >= 0 && idx <= cur_idx_) {
+    if (idx >= 0 && idx <= maxInterval()) {
+        const io_graph_item_t* item = &intervalItems()[idx];
         switch (val_units_) {
         case IOG_ITEM_UNIT_CALC_MAX:
-            return items_[idx].max_frame_in_invl;
+            return item->max_frame_in_invl;
         case IOG_ITEM_UNIT_CALC_MIN:
-            return items_[idx].min_frame_in_invl;
+            return item->min_frame_in_invl;
         default:
-            return items_[idx].last_frame_in_invl;
+            return item->last_frame_in_invl;
         }
     }
     return -1;
@@ -323,6 +330,8 @@ void IOGraph::clearAllData()
     if (items_.size()) {
         reset_io_graph_items(&items_[0], items_.size(), hf_index_);
     }
+    merged_cur_idx_ = -1;
+    merge_dirty_idx_ = INT_MAX;
     nstime_set_zero(&start_time_);
     Graph::clearAllData();
 }
@@ -334,6 +343,9 @@ void IOGraph::recalcGraphData(capture_file* cap_file)
     unsigned int mavg_to_remove = 0, mavg_to_add = 0;
     double mavg_cumulated = 0;
 
+    mergeItems();
+    int cur_idx = maxInterval();
+
     if (graph_) {
         graph_->data()->clear();
     }
@@ -341,7 +353,7 @@ void IOGraph::recalcGraphData(capture_file* cap_file)
         bars_->data()->clear();
     }
 
-    if (moving_avg_period_ > 0 && cur_idx_ >= 0) {
+    if (moving_avg_period_ > 0 && cur_idx >= 0) {
         /* "Warm-up phase" - calculate average on some data not displayed;
          * just to make sure average on leftmost and rightmost displayed
          * values is as reliable as possible
@@ -352,7 +364,7 @@ void IOGraph::recalcGraphData(capture_file* cap_file)
         mavg_in_average_count++;
         for (warmup_interval = 1;
             (warmup_interval < moving_avg_period_ / 2) &&
-            (warmup_interval <= (unsigned)cur_idx_);
+            (warmup_interval <= (unsigned)cur_idx);
             warmup_interval += 1) {
 
             mavg_cumulated += getItemValue((int)warmup_interval, cap_file);
@@ -362,7 +374,7 @@ void IOGraph::recalcGraphData(capture_file* cap_file)
     }
 
     double ts_offset = startOffset();
-    for (int i = 0; i <= cur_idx_; i++) {
+    for (int i = 0; i <= cur_idx; i++) {
         double ts = (double)i * interval_ / SCALE_F + ts_offset;
         double val = getItemValue(i, cap_file);
 
@@ -375,7 +387,7 @@ void IOGraph::recalcGraphData(capture_file* cap_file)
                     mavg_cumulated -= getItemValue(mavg_to_remove, cap_file);
                     mavg_to_remove += 1;
                 }
-                if (mavg_to_add <= (unsigned int)cur_idx_) {
+                if (mavg_to_add <= (unsigned int)cur_idx) {
                     mavg_in_average_count++;
                     mavg_cumulated += getItemValue(mavg_to_add, cap_file);
                     mavg_to_add += 1;
@@ -519,7 +531,7 @@ bool IOGraph::hasItemToShow(int idx, double value) const
 
     bool result = false;
 
-    const io_graph_item_t* item = &items_[idx];
+    const io_graph_item_t* item = &intervalItems()[idx];
 
     switch (val_units_) {
     case IOG_ITEM_UNIT_PACKETS:
@@ -556,10 +568,60 @@ bool IOGraph::hasItemToShow(int idx, double value) const
 
 void IOGraph::setInterval(int interval)
 {
+    if (interval == interval_) {
+        return;
+    }
+
     interval_ = interval;
     if (bars_) {
         bars_->setWidth(interval_ / SCALE_F);
     }
+
+    // A coarser interval that is a multiple of the tapped one can be
+    // calculated by adding up the tapped items, e.g. switching from 1 ms
+    // to 1 s merges each run of 1000 items. Anything else, including a
+    // finer interval, needs the packets again.
+    if (tap_interval_ > 0 && interval_ % tap_interval_ == 0 && !tap_truncated_) {
+        merge_factor_ = interval_ / tap_interval_;
+        merged_cur_idx_ = -1;
+        merge_dirty_idx_ = 0;
+        mergeItems();
+        emit requestRecalc();
+    }
+    else {
+        tap_interval_ = interval_;
+        merge_factor_ = 1;
+        setNeedRetap(true);
+    }
+}
+
+void IOGraph::mergeItems()
+{
+    if (merge_factor_ <= 1 || merge_dirty_idx_ == INT_MAX) {
+        return;
+    }
+
+    int first_idx = merge_dirty_idx_ / merge_factor_;
+    int last_idx = cur_idx_ < 0 ? -1 : cur_idx_ / merge_factor_;
+    merge_dirty_idx_ = INT_MAX;
+
+    if ((size_t)(last_idx + 1) > merged_items_.size()) {
+        try {
+            merged_items_.resize(last_idx + 1);
+        }
+        catch (std::bad_alloc&) {
+            ws_warning("Failed memory allocation.");
+            merged_cur_idx_ = -1;
+            return;
+        }
+    }
+
+    for (int idx = first_idx; idx <= last_idx; idx++) {
+        int first_item = idx * merge_factor_;
+        int count = MIN(merge_factor_, cur_idx_ + 1 - first_item);
+        merge_io_graph_items(&merged_items_[idx], &items_[first_item], count, hf_index_);
+    }
+    merged_cur_idx_ = last_idx;
 }
 
 // Get the value at the given interval (idx) for the current value unit.
@@ -567,7 +629,7 @@ double IOGraph::getItemValue(int idx, const capture_file* cap_file) const
 {
     ws_assert(idx < max_io_items_);
 
-    return get_io_graph_item(&items_[0], val_units_, idx, hf_index_, cap_file, interval_, cur_idx_, asAOT_);
+    return get_io_graph_item(intervalItems(), val_units_, idx, hf_index_, cap_file, interval_, maxInterval(), asAOT_);
 }
 
 // "tap_reset" callback for register_tap_listener
@@ -577,6 +639,10 @@ void IOGraph::tapReset(void* iog_ptr)
     if (!iog) return;
 
     //    qDebug() << "=tapReset" << iog->name_;
+    // Tap at the interval being shown; coarser ones are merged from it.
+    iog->tap_interval_ = iog->interval_;
+    iog->tap_truncated_ = false;
+    iog->merge_factor_ = 1;
     iog->clearAllData();
 }
 
@@ -588,12 +654,20 @@ tap_packet_status IOGraph::tapPacket(void* iog_ptr, packet_info* pinfo, epan_dis
         return TAP_PACKET_DONT_REDRAW;
     }
 
-    int64_t tmp_idx = get_io_graph_index(pinfo, iog->interval_);
+    int64_t tmp_idx = get_io_graph_index(pinfo, iog->tap_interval_);
     bool recalc = false;
 
     /* some sanity checks */
     if ((tmp_idx < 0) || (tmp_idx >= max_io_items_)) {
         iog->cur_idx_ = (int)iog->items_.size() - 1;
+        if (tmp_idx >= max_io_items_ && !iog->tap_truncated_) {
+            iog->tap_truncated_ = true;
+            if (iog->merge_factor_ > 1) {
+                // The interval being shown could hold this packet if we
+                // tapped at it instead.
+                iog->setNeedRetap(true);
+            }
+        }
         return TAP_PACKET_DONT_REDRAW;
     }
 
@@ -652,10 +726,13 @@ tap_packet_status IOGraph::tapPacket(void* iog_ptr, packet_info* pinfo, epan_dis
         adv_edt = edt;
     }
 
-    if (!update_io_graph_item(&iog->items_[0], idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->interval_)) {
+    if (!update_io_graph_item(&iog->items_[0], idx, pinfo, adv_edt, iog->hf_index_, iog->val_units_, iog->tap_interval_)) {
         return TAP_PACKET_DONT_REDRAW;
     }
 
+    /* LOAD spreads a value over the preceding items as well. */
+    iog->merge_dirty_idx_ = MIN(iog->merge_dirty_idx_, iog->val_units_ == IOG_ITEM_UNIT_CALC_LOAD ? 0 : idx);
+
     //    qDebug() << "=tapPacket" << iog->name_ << idx << iog->hf_index_ << iog->val_units_ << iog->num_items_;
 
     if (recalc) {
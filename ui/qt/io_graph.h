@@ -183,7 +183,11 @@ public:
 
     /**
      * @brief Sets the time interval for data bucketing.
-     * @param interval The interval in milliseconds.
+     *
+     * If the interval is a multiple of the one the data was tapped at,
+     * the tapped items are merged and only a recalculation is requested.
+     * Otherwise a retap is needed.
+     * @param interval The interval in microseconds.
      */
     void setInterval(int interval);
 
@@ -214,7 +218,7 @@ public:
      * @brief Retrieves the maximum populated interval index.
      * @return The maximum interval index.
      */
-    int maxInterval() const { return cur_idx_; }
+    int maxInterval() const { return merge_factor_ > 1 ? merged_cur_idx_ : cur_idx_; }
 
     /**
      * @brief Clears all cached plotting and tap data.
@@ -358,6 +362,35 @@ private:
 
     /** The highest interval index currently populated with data. */
     int cur_idx_;
+
+    /** The interval items_ were tapped at. interval_ is a multiple of it. */
+    int tap_interval_;
+
+    /** Flag indicating if packets past the last item were dropped while tapping. */
+    bool tap_truncated_;
+
+    /** interval_ / tap_interval_. If greater than one, merged_items_ are shown. */
+    int merge_factor_;
+
+    /** items_ merged into buckets of merge_factor_ items, for interval_. */
+    std::vector<io_graph_item_t> merged_items_;
+
+    /** The highest index populated in merged_items_. */
+    int merged_cur_idx_;
+
+    /** The lowest index of items_ changed since merged_items_ were updated. */
+    int merge_dirty_idx_;
+
+    /**
+     * @brief Updates merged_items_ for the items_ that changed since the last call.
+     */
+    void mergeItems();
+
+    /**
+     * @brief Retrieves the items for the current interval.
+     * @return Either items_ or merged_items_.
+     */
+    const io_graph_item_t* intervalItems() const { return merge_factor_ > 1 ? merged_items_.data() : items_.data(); }
 };
 
 #endif // IO_GRAPH_H
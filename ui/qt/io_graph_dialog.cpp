@@ -1531,7 +1531,6 @@ void IOGraphDialog::loadProfileGraphs(uat_field_t* io_graph_fields)
 void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
 {
     int interval = ui->intervalComboBox->itemData(ui->intervalComboBox->currentIndex()).toInt();
-    bool need_retap = false;
 
     precision_ = ceil(log10(SCALE_F / interval));
     if (precision_ < 0) {
@@ -1549,23 +1548,18 @@ void IOGraphDialog::on_intervalComboBox_currentIndexChanged(int)
         datetime_ticker_->setDateTimeFormat("hh:mm:ss\ndd.MM.yy");
     }
 
+    // Each graph either merges its items into the coarser interval and
+    // requests a recalculation, or requests a retap.
     if (uat_model_ != NULL) {
         for (int row = 0; row < uat_model_->rowCount(); row++) {
             IOGraph *iog = ioGraphs_.value(row, NULL);
             if (iog) {
                 iog->setInterval(interval);
-                if (iog->visible()) {
-                    need_retap = true;
-                } else {
-                    iog->setNeedRetap(true);
-                }
             }
         }
     }
 
-    if (need_retap) {
-        scheduleRetap(true);
-    }
+    updateStatistics();
 }
 
 void IOGraphDialog::modelRowsReset()
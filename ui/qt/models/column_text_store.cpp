@@ -0,0 +1,348 @@
+/* column_text_store.cpp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "column_text_store.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <glib.h>
+
+#include <QByteArrayView>
+#include <QDir>
+#include <QHashFunctions>
+#include <QTemporaryFile>
+#include <QtAlgorithms>
+
+// Longer strings are almost always unique (e.g. Info), so interning them
+// would only make the table bigger.
+static const size_t intern_max_len_ = 255;
+
+// Compact once at least this many chunks of the arena are dead, and the
+// dead space is more than the live space, so that the copying is amortized
+// over the rows that were replaced.
+static const uint64_t compact_min_dead_chunks_ = 2;
+
+// The number of chunks in each spill file.
+static const uint64_t spill_file_chunks_ = 16;
+
+ColumnTextStore::ColumnTextStore(size_t chunk_size) :
+    chunk_size_(chunk_size),
+    row_count_(0),
+    memory_row_limit_(10000),
+    used_bytes_(0),
+    dead_bytes_(0),
+    intern_count_(0),
+    spill_size_(0),
+    spill_file_used_(0),
+    spill_failed_(false)
+{
+}
+
+ColumnTextStore::~ColumnTextStore()
+{
+    clear();
+}
+
+bool ColumnTextStore::contains(uint32_t frame_num) const
+{
+    return frame_num < rows_.size() && rows_[frame_num] != 0;
+}
+
+unsigned ColumnTextStore::columnCount(uint32_t frame_num) const
+{
+    if (!contains(frame_num)) {
+        return 0;
+    }
+
+    uint32_t count;
+    memcpy(&count, resolve(rows_[frame_num]), sizeof count);
+    return count;
+}
+
+QString ColumnTextStore::text(uint32_t frame_num, unsigned column) const
+{
+    if (column >= columnCount(frame_num)) {
+        return QString();
+    }
+
+    const char *record = resolve(rows_[frame_num]);
+    uint64_t str_ref;
+    memcpy(&str_ref, record + sizeof(uint32_t) + column * sizeof str_ref, sizeof str_ref);
+    return QString::fromUtf8(resolve(str_ref));
+}
+
+void ColumnTextStore::insert(uint32_t frame_num, const char * const *texts, unsigned count)
+{
+    // Store the strings first; allocating the record might start a new chunk.
+    std::vector<uint64_t> str_refs(count);
+    for (unsigned column = 0; column < count; column++) {
+        const char *str = texts[column] ? texts[column] : "";
+        str_refs[column] = storeString(str, strlen(str));
+    }
+
+    uint64_t record_ref;
+    size_t refs_size = count * sizeof(uint64_t);
+    char *record = allocate(sizeof(uint32_t) + refs_size, &record_ref);
+    uint32_t count32 = count;
+    memcpy(record, &count32, sizeof count32);
+    if (count > 0) {
+        memcpy(record + sizeof count32, str_refs.data(), refs_size);
+    }
+
+    if (frame_num >= rows_.size()) {
+        rows_.resize(std::max<size_t>(frame_num + 1, rows_.size() * 3 / 2), 0);
+    }
+    uint64_t old_ref = rows_[frame_num];
+    rows_[frame_num] = record_ref;
+    if (old_ref == 0) {
+        row_count_++;
+    } else {
+        releaseRow(old_ref);
+    }
+}
+
+void ColumnTextStore::remove(uint32_t frame_num)
+{
+    if (contains(frame_num)) {
+        uint64_t old_ref = rows_[frame_num];
+        rows_[frame_num] = 0;
+        row_count_--;
+        releaseRow(old_ref);
+    }
+}
+
+void ColumnTextStore::clear()
+{
+    freeChunks(chunks_, spill_files_);
+    chunks_.clear();
+    spill_files_.clear();
+    spill_size_ = 0;
+    spill_file_used_ = 0;
+    spill_failed_ = false;
+
+    std::vector<uint64_t>().swap(rows_);
+    row_count_ = 0;
+    used_bytes_ = 0;
+    dead_bytes_ = 0;
+    std::vector<InternSlot>().swap(intern_);
+    intern_count_ = 0;
+}
+
+uint64_t ColumnTextStore::arenaSize(uint64_t *spilled) const
+{
+    uint64_t total = 0;
+    for (const Chunk &chunk : chunks_) {
+        total += chunk.size;
+    }
+    if (spilled) {
+        *spilled = spill_size_;
+    }
+    return total;
+}
+
+char *ColumnTextStore::allocate(size_t size, uint64_t *ref)
+{
+    if (chunks_.isEmpty() || chunks_.last().size - chunks_.last().used < size) {
+        addChunk(size);
+    }
+
+    Chunk &chunk = chunks_.last();
+    // References are (chunk index + 1, offset) so that 0 is never valid.
+    *ref = (static_cast<uint64_t>(chunks_.count()) << 32) | chunk.used;
+    char *ptr = chunk.data + chunk.used;
+    chunk.used += static_cast<uint32_t>(size);
+    used_bytes_ += size;
+    return ptr;
+}
+
+const char *ColumnTextStore::resolve(const QVector<Chunk> &chunks, uint64_t ref)
+{
+    return chunks.at(static_cast<qsizetype>(ref >> 32) - 1).data + static_cast<uint32_t>(ref);
+}
+
+uint64_t ColumnTextStore::rowSize(uint64_t record_ref) const
+{
+    const char *record = resolve(record_ref);
+    uint32_t count;
+    memcpy(&count, record, sizeof count);
+
+    uint64_t size = sizeof count + count * sizeof(uint64_t);
+    for (unsigned column = 0; column < count; column++) {
+        uint64_t str_ref;
+        memcpy(&str_ref, record + sizeof count + column * sizeof str_ref, sizeof str_ref);
+        // Interned strings may be shared with other rows; they stay until
+        // the next compaction drops the ones no row uses.
+        size_t len = strlen(resolve(str_ref));
+        if (len > intern_max_len_) {
+            size += len + 1;
+        }
+    }
+    return size;
+}
+
+void ColumnTextStore::releaseRow(uint64_t record_ref)
+{
+    dead_bytes_ += rowSize(record_ref);
+    if (dead_bytes_ >= compact_min_dead_chunks_ * chunk_size_ && dead_bytes_ * 2 > used_bytes_) {
+        compact();
+    }
+}
+
+void ColumnTextStore::compact()
+{
+    QVector<Chunk> old_chunks;
+    old_chunks.swap(chunks_);
+    std::vector<uint64_t> old_rows;
+    old_rows.swap(rows_);
+    rows_.resize(old_rows.size(), 0);
+    QVector<QTemporaryFile *> old_spill_files;
+    old_spill_files.swap(spill_files_);
+
+    spill_size_ = 0;
+    spill_file_used_ = 0;
+    spill_failed_ = false;
+    row_count_ = 0;
+    used_bytes_ = 0;
+    dead_bytes_ = 0;
+    std::vector<InternSlot>().swap(intern_);
+    intern_count_ = 0;
+
+    std::vector<const char *> texts;
+    for (size_t frame_num = 0; frame_num < old_rows.size(); frame_num++) {
+        if (old_rows[frame_num] == 0) {
+            continue;
+        }
+        const char *record = resolve(old_chunks, old_rows[frame_num]);
+        uint32_t count;
+        memcpy(&count, record, sizeof count);
+        texts.resize(count);
+        for (unsigned column = 0; column < count; column++) {
+            uint64_t str_ref;
+            memcpy(&str_ref, record + sizeof count + column * sizeof str_ref, sizeof str_ref);
+            texts[column] = resolve(old_chunks, str_ref);
+        }
+        insert(static_cast<uint32_t>(frame_num), texts.data(), count);
+    }
+
+    freeChunks(old_chunks, old_spill_files);
+}
+
+void ColumnTextStore::freeChunks(const QVector<Chunk> &chunks, const QVector<QTemporaryFile *> &files)
+{
+    for (const Chunk &chunk : chunks) {
+        if (chunk.file) {
+            chunk.file->unmap(reinterpret_cast<uchar *>(chunk.data));
+        } else {
+            g_free(chunk.data);
+        }
+    }
+    qDeleteAll(files);
+}
+
+void ColumnTextStore::addChunk(size_t size)
+{
+    Chunk chunk;
+    chunk.size = static_cast<uint32_t>(std::max(size, chunk_size_));
+    chunk.used = 0;
+    chunk.data = nullptr;
+    chunk.file = nullptr;
+
+    if (row_count_ > memory_row_limit_ && !spill_failed_) {
+        chunk.data = mapSpillChunk(chunk.size, &chunk.file);
+        if (!chunk.data) {
+            // Out of disk space or address space; keep going in memory.
+            spill_failed_ = true;
+        }
+    }
+
+    if (!chunk.data) {
+        chunk.data = static_cast<char *>(g_malloc(chunk.size));
+    }
+    chunks_.append(chunk);
+}
+
+char *ColumnTextStore::mapSpillChunk(uint32_t size, QTemporaryFile **file)
+{
+    if (spill_files_.isEmpty() || spill_file_used_ + size > static_cast<uint64_t>(spill_files_.last()->size())) {
+        // Files are never resized once chunks are mapped from them, so
+        // start a new one. An oversized chunk gets a file of its own.
+        QTemporaryFile *spill_file = new QTemporaryFile(QStringLiteral("%1/wireshark_column_text").arg(QDir::tempPath()));
+        uint64_t file_size = std::max<uint64_t>(size, spill_file_chunks_ * chunk_size_);
+        if (!spill_file->open() || !spill_file->resize(static_cast<qint64>(file_size))) {
+            delete spill_file;
+            return nullptr;
+        }
+        spill_files_.append(spill_file);
+        spill_size_ += file_size;
+        spill_file_used_ = 0;
+    }
+
+    uchar *data = spill_files_.last()->map(static_cast<qint64>(spill_file_used_), size);
+    if (!data) {
+        return nullptr;
+    }
+    spill_file_used_ += size;
+    *file = spill_files_.last();
+    return reinterpret_cast<char *>(data);
+}
+
+uint64_t ColumnTextStore::storeString(const char *str, size_t len)
+{
+    uint64_t ref;
+
+    if (len > intern_max_len_) {
+        char *copy = allocate(len + 1, &ref);
+        memcpy(copy, str, len + 1);
+        return ref;
+    }
+
+    if (intern_.empty() || (intern_count_ + 1) * 2 > intern_.size()) {
+        growInternTable();
+    }
+
+    uint32_t hash = static_cast<uint32_t>(qHash(QByteArrayView(str, len)));
+    size_t mask = intern_.size() - 1;
+    size_t idx = hash & mask;
+    while (intern_[idx].ref != 0) {
+        if (intern_[idx].hash == hash) {
+            const char *interned = resolve(intern_[idx].ref);
+            if (memcmp(interned, str, len) == 0 && interned[len] == '\0') {
+                return intern_[idx].ref;
+            }
+        }
+        idx = (idx + 1) & mask;
+    }
+
+    char *copy = allocate(len + 1, &ref);
+    memcpy(copy, str, len + 1);
+    intern_[idx].ref = ref;
+    intern_[idx].hash = hash;
+    intern_count_++;
+    return ref;
+}
+
+void ColumnTextStore::growInternTable()
+{
+    std::vector<InternSlot> old_slots(std::max<size_t>(intern_.size() * 2, 1024), InternSlot{0, 0});
+    old_slots.swap(intern_);
+
+    size_t mask = intern_.size() - 1;
+    for (const InternSlot &slot : old_slots) {
+        if (slot.ref == 0) {
+            continue;
+        }
+        size_t idx = slot.hash & mask;
+        while (intern_[idx].ref != 0) {
+            idx = (idx + 1) & mask;
+        }
+        intern_[idx] = slot;
+    }
+}
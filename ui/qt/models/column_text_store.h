@@ -0,0 +1,246 @@
+/** @file
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef COLUMN_TEXT_STORE_H
+#define COLUMN_TEXT_STORE_H
+
+#include <config.h>
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <QString>
+#include <QVector>
+
+class QTemporaryFile;
+
+/**
+ * @brief Stores the column text of packet list rows, indexed by frame number.
+ *
+ * Column text is kept as NUL terminated UTF-8 in a compact arena of large
+ * chunks, and short strings (protocol names, addresses, ports) are interned
+ * so that each distinct value is stored only once. Unlike a cache, nothing
+ * is ever evicted, so a row only needs to be dissected once for scrolling,
+ * sorting and copying.
+ *
+ * Once more than memoryRowLimit() rows are stored, new chunks are allocated
+ * from memory-mapped temporary files instead of the heap, so the kernel can
+ * write them back to disk instead of keeping them all resident. Each file
+ * holds a fixed number of chunks and is sized once when it's created, as
+ * Windows can't resize a file while part of it is mapped.
+ *
+ * Replacing or removing a row leaves the space it used in the arena dead.
+ * Once dead space makes up most of the arena, the live rows are copied to
+ * a new arena and the old one is freed.
+ */
+class ColumnTextStore
+{
+public:
+    /**
+     * @brief Creates an empty store.
+     * @param chunk_size The size of the chunks the arena is made of.
+     */
+    explicit ColumnTextStore(size_t chunk_size = default_chunk_size_);
+    ~ColumnTextStore();
+
+    ColumnTextStore(const ColumnTextStore &) = delete;
+    ColumnTextStore &operator=(const ColumnTextStore &) = delete;
+
+    /**
+     * @brief Checks if column text is stored for a frame.
+     * @param frame_num The frame number.
+     * @return True if the frame has stored column text, false otherwise.
+     */
+    bool contains(uint32_t frame_num) const;
+
+    /**
+     * @brief Gets the number of columns stored for a frame.
+     * @param frame_num The frame number.
+     * @return The number of columns, or 0 if nothing is stored.
+     */
+    unsigned columnCount(uint32_t frame_num) const;
+
+    /**
+     * @brief Gets the stored text of a column.
+     * @param frame_num The frame number.
+     * @param column The column index.
+     * @return The column text, or a null QString if it isn't stored.
+     */
+    QString text(uint32_t frame_num, unsigned column) const;
+
+    /**
+     * @brief Stores the column text of a frame, replacing any previous text.
+     * @param frame_num The frame number.
+     * @param texts The UTF-8 text of each column. NULL is stored as "".
+     * @param count The number of columns.
+     */
+    void insert(uint32_t frame_num, const char * const *texts, unsigned count);
+
+    /**
+     * @brief Forgets the column text of a frame.
+     * @param frame_num The frame number.
+     */
+    void remove(uint32_t frame_num);
+
+    /**
+     * @brief Forgets all column text and frees the arena.
+     */
+    void clear();
+
+    /**
+     * @brief Gets the number of rows kept in memory before spilling.
+     * @return The row limit.
+     */
+    qsizetype memoryRowLimit() const { return memory_row_limit_; }
+
+    /**
+     * @brief Sets the number of rows kept in memory before spilling.
+     *
+     * Chunks that have already been allocated stay where they are.
+     * @param limit The row limit.
+     */
+    void setMemoryRowLimit(qsizetype limit) { memory_row_limit_ = limit; }
+
+    /**
+     * @brief Gets the size of the arena, in bytes.
+     * @param spilled If non-NULL, set to the number of bytes in the temporary files.
+     * @return The total number of bytes allocated for the arena.
+     */
+    uint64_t arenaSize(uint64_t *spilled = nullptr) const;
+
+    /**
+     * @brief Gets the number of arena bytes used by replaced or removed rows.
+     * @return The number of dead bytes.
+     */
+    uint64_t deadSize() const { return dead_bytes_; }
+
+    /**
+     * @brief Gets the number of temporary files spilled chunks are mapped from.
+     * @return The number of files.
+     */
+    qsizetype spillFileCount() const { return spill_files_.count(); }
+
+private:
+    // Chunks are large enough that a row record or column string (at most
+    // COL_MAX_INFO_LEN bytes) practically always fits. Anything bigger gets
+    // a chunk of its own.
+    static const size_t default_chunk_size_ = 4 * 1024 * 1024;
+
+    /** A region of the arena, either on the heap or mapped from one of spill_files_. */
+    struct Chunk {
+        char *data;
+        uint32_t size;
+        uint32_t used;
+        QTemporaryFile *file; /**< The file the chunk is mapped from, or NULL. */
+    };
+
+    /** An entry in the intern table. ref is 0 if the slot is empty. */
+    struct InternSlot {
+        uint64_t ref;
+        uint32_t hash;
+    };
+
+    size_t chunk_size_; /**< The size of a chunk. */
+    QVector<Chunk> chunks_; /**< The arena. */
+    std::vector<uint64_t> rows_; /**< Row record reference for each frame number, or 0. */
+    qsizetype row_count_; /**< The number of frames with stored text. */
+    qsizetype memory_row_limit_; /**< Rows stored before new chunks are spilled. */
+
+    uint64_t used_bytes_; /**< Bytes allocated from the arena. */
+    uint64_t dead_bytes_; /**< Bytes of used_bytes_ that no row refers to. */
+
+    std::vector<InternSlot> intern_; /**< Open addressing table of interned strings. */
+    size_t intern_count_; /**< The number of interned strings. */
+
+    QVector<QTemporaryFile *> spill_files_; /**< Backing files for spilled chunks. */
+    uint64_t spill_size_; /**< Total size of spill_files_. */
+    uint64_t spill_file_used_; /**< Bytes of the last of spill_files_ that are mapped. */
+    bool spill_failed_; /**< Spilling was tried and didn't work. */
+
+    /**
+     * @brief Allocates space in the arena.
+     * @param size The number of bytes needed.
+     * @param ref Set to the reference to the space.
+     * @return A pointer to the space.
+     */
+    char *allocate(size_t size, uint64_t *ref);
+
+    /**
+     * @brief Resolves a reference to a pointer into the arena.
+     * @param ref A reference returned by allocate().
+     * @return A pointer to the referenced space.
+     */
+    const char *resolve(uint64_t ref) const { return resolve(chunks_, ref); }
+
+    /**
+     * @brief Resolves a reference to a pointer into a set of chunks.
+     * @param chunks The chunks the reference was allocated from.
+     * @param ref A reference returned by allocate().
+     * @return A pointer to the referenced space.
+     */
+    static const char *resolve(const QVector<Chunk> &chunks, uint64_t ref);
+
+    /**
+     * @brief Counts the arena space of a row record that nothing else refers to.
+     *
+     * That's the record itself and its strings that are too long to be interned.
+     * @param record_ref A reference to the row record.
+     * @return The number of bytes.
+     */
+    uint64_t rowSize(uint64_t record_ref) const;
+
+    /**
+     * @brief Marks the space of a row record as dead, and compacts the arena
+     * if it's mostly dead.
+     * @param record_ref A reference to the row record.
+     */
+    void releaseRow(uint64_t record_ref);
+
+    /**
+     * @brief Copies the live rows to a new arena and frees the old one.
+     */
+    void compact();
+
+    /**
+     * @brief Adds a chunk to the arena, spilling it if the row limit has been reached.
+     * @param size The minimum size of the chunk.
+     */
+    void addChunk(size_t size);
+
+    /**
+     * @brief Maps space for a chunk from the last spill file, adding a file if it's full.
+     * @param size The size of the chunk.
+     * @param file Set to the file the chunk is mapped from.
+     * @return The mapped space, or NULL if spilling failed.
+     */
+    char *mapSpillChunk(uint32_t size, QTemporaryFile **file);
+
+    /**
+     * @brief Frees a set of chunks and the files they are mapped from.
+     * @param chunks The chunks.
+     * @param files The spill files.
+     */
+    static void freeChunks(const QVector<Chunk> &chunks, const QVector<QTemporaryFile *> &files);
+
+    /**
+     * @brief Stores a string, reusing an identical interned string if possible.
+     * @param str The string.
+     * @param len The length of the string.
+     * @return A reference to the NUL terminated copy in the arena.
+     */
+    uint64_t storeString(const char *str, size_t len);
+
+    /**
+     * @brief Doubles the size of the intern table.
+     */
+    void growInternTable();
+};
+
+#endif // COLUMN_TEXT_STORE_H
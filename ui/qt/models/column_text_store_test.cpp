@@ -0,0 +1,190 @@
+/* column_text_store_test.cpp
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "column_text_store.h"
+
+#include <algorithm>
+
+#include <glib.h>
+
+#include <QByteArray>
+#include <QString>
+
+// Small chunks so that a few thousand rows fill many of them.
+static const size_t test_chunk_size = 4096;
+
+// Long enough not to be interned.
+static QByteArray long_text(unsigned frame_num, unsigned version)
+{
+    QByteArray text = QStringLiteral("frame %1 version %2 ").arg(frame_num).arg(version).toUtf8();
+    return text.leftJustified(300, 'x');
+}
+
+static void insert_row(ColumnTextStore &store, unsigned frame_num, unsigned version)
+{
+    QByteArray number = QByteArray::number(frame_num);
+    QByteArray info = long_text(frame_num, version);
+    const char *texts[] = { number.constData(), "UDP", info.constData() };
+
+    store.insert(frame_num, texts, 3);
+}
+
+static void check_row(const ColumnTextStore &store, unsigned frame_num, unsigned version)
+{
+    g_assert_true(store.contains(frame_num));
+    g_assert_cmpuint(store.columnCount(frame_num), ==, 3);
+    g_assert_true(store.text(frame_num, 0) == QString::number(frame_num));
+    g_assert_true(store.text(frame_num, 1) == QStringLiteral("UDP"));
+    g_assert_true(store.text(frame_num, 2) == QString::fromUtf8(long_text(frame_num, version)));
+}
+
+static void test_append(void)
+{
+    ColumnTextStore store(test_chunk_size);
+    const char *texts[] = { "1", NULL, "caf\xc3\xa9" };
+
+    g_assert_false(store.contains(0));
+    g_assert_cmpuint(store.columnCount(7), ==, 0);
+    g_assert_true(store.text(7, 0).isNull());
+
+    store.insert(1, texts, 3);
+    store.insert(5, texts, 0);
+    g_assert_true(store.contains(1));
+    g_assert_false(store.contains(2));
+    g_assert_true(store.contains(5));
+    g_assert_cmpuint(store.columnCount(1), ==, 3);
+    g_assert_cmpuint(store.columnCount(5), ==, 0);
+    g_assert_true(store.text(1, 0) == QStringLiteral("1"));
+    g_assert_true(store.text(1, 1).isEmpty());
+    g_assert_false(store.text(1, 1).isNull());
+    g_assert_true(store.text(1, 2) == QString::fromUtf8("caf\xc3\xa9"));
+    g_assert_true(store.text(1, 3).isNull());
+
+    /* Replacing a row leaves its old space dead. */
+    insert_row(store, 1, 0);
+    check_row(store, 1, 0);
+    g_assert_cmpuint(store.deadSize(), >, 0);
+    insert_row(store, 1, 1);
+    check_row(store, 1, 1);
+
+    store.remove(1);
+    g_assert_false(store.contains(1));
+    g_assert_true(store.text(1, 0).isNull());
+    g_assert_true(store.contains(5));
+
+    store.clear();
+    g_assert_false(store.contains(5));
+    g_assert_cmpuint(store.arenaSize(), ==, 0);
+    g_assert_cmpuint(store.deadSize(), ==, 0);
+}
+
+static void test_intern(void)
+{
+    ColumnTextStore store(test_chunk_size);
+    const char *texts[] = { "10.0.0.1", "10.0.0.2", "TCP" };
+
+    /* Short strings are stored once, so the rows only cost their records. */
+    for (unsigned frame_num = 1; frame_num <= 1000; frame_num++) {
+        store.insert(frame_num, texts, 3);
+    }
+    g_assert_cmpuint(store.arenaSize(), <=, 1000 * (sizeof(uint32_t) + 3 * sizeof(uint64_t)) + test_chunk_size);
+    for (unsigned frame_num = 1; frame_num <= 1000; frame_num++) {
+        g_assert_true(store.text(frame_num, 1) == QStringLiteral("10.0.0.2"));
+    }
+}
+
+static void test_compact(void)
+{
+    ColumnTextStore store(test_chunk_size);
+    uint64_t max_arena = 0;
+
+    for (unsigned frame_num = 1; frame_num <= 100; frame_num++) {
+        insert_row(store, frame_num, 0);
+    }
+
+    /* Rewriting the rows over and over leaves the arena at a bounded
+     * size, as the dead space is compacted away. */
+    for (unsigned version = 1; version <= 50; version++) {
+        for (unsigned frame_num = 1; frame_num <= 100; frame_num++) {
+            insert_row(store, frame_num, version);
+        }
+        g_assert_cmpuint(store.deadSize() * 2, <=, store.arenaSize() + 2 * test_chunk_size);
+        max_arena = std::max(max_arena, store.arenaSize());
+    }
+    g_assert_cmpuint(max_arena, <, 50 * 100 * 300);
+    for (unsigned frame_num = 1; frame_num <= 100; frame_num++) {
+        check_row(store, frame_num, 50);
+    }
+
+    /* Removing rows compacts as well. */
+    for (unsigned frame_num = 1; frame_num <= 90; frame_num++) {
+        store.remove(frame_num);
+    }
+    g_assert_cmpuint(store.deadSize(), <, 2 * test_chunk_size);
+    for (unsigned frame_num = 91; frame_num <= 100; frame_num++) {
+        check_row(store, frame_num, 50);
+    }
+}
+
+static void test_spill(void)
+{
+    ColumnTextStore store(test_chunk_size);
+    uint64_t spilled;
+
+    store.setMemoryRowLimit(10);
+    for (unsigned frame_num = 1; frame_num <= 2000; frame_num++) {
+        insert_row(store, frame_num, 0);
+    }
+    store.arenaSize(&spilled);
+    g_assert_cmpuint(spilled, >, 0);
+
+    /* The files are never grown, so new ones are added as they fill up. */
+    g_assert_cmpint(store.spillFileCount(), >, 1);
+    for (unsigned frame_num = 1; frame_num <= 2000; frame_num++) {
+        check_row(store, frame_num, 0);
+    }
+
+    /* A string bigger than a whole file gets a file of its own. */
+    QByteArray huge(test_chunk_size * 32, 'y');
+    const char *texts[] = { huge.constData() };
+    qsizetype files = store.spillFileCount();
+    store.insert(2001, texts, 1);
+    g_assert_cmpint(store.spillFileCount(), >, files);
+    g_assert_true(store.text(2001, 0) == QString::fromUtf8(huge));
+    check_row(store, 2000, 0);
+
+    /* Compacting a spilled arena moves the rows to new files. */
+    for (unsigned version = 1; version <= 3; version++) {
+        for (unsigned frame_num = 1; frame_num <= 2000; frame_num++) {
+            insert_row(store, frame_num, version);
+        }
+    }
+    for (unsigned frame_num = 1; frame_num <= 2000; frame_num++) {
+        check_row(store, frame_num, 3);
+    }
+    g_assert_true(store.text(2001, 0) == QString::fromUtf8(huge));
+    g_assert_cmpuint(store.arenaSize(), <, 4 * 2000 * 300);
+
+    store.clear();
+    store.arenaSize(&spilled);
+    g_assert_cmpuint(spilled, ==, 0);
+    g_assert_cmpint(store.spillFileCount(), ==, 0);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/column_text_store/append", test_append);
+    g_test_add_func("/column_text_store/intern", test_intern);
+    g_test_add_func("/column_text_store/compact", test_compact);
+    g_test_add_func("/column_text_store/spill", test_spill);
+
+    return g_test_run();
+}
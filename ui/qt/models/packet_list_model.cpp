@@ -37,9 +37,12 @@
 #include <QColor>
 #include <QElapsedTimer>
 #include <QFontMetrics>
+#include <QFuture>
 #include <QModelIndex>
 #include <QElapsedTimer>
 #include <QPalette>
+#include <QThread>
+#include <QtConcurrent>
 
 // Print timing information
 //#define DEBUG_PACKET_LIST_MODEL 1
@@ -546,32 +549,6 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
 
     QString col_title = get_column_title(column);
 
-    /* Make sure we're actually going to sort. Note that the header
-     * has no way of knowing that sorting failed, so in these cases
-     * the sort indicator have the value that the user requested
-     * regardless.
-     */
-    if (PacketListRecord::textColumn(column) >= 0 && (unsigned)visible_rows_.count() > prefs.gui_packet_list_cached_rows_max) {
-        /* Column not based on frame data but by column text that requires
-         * dissection, so to sort in a reasonable amount of time the column
-         * text needs to be cached.
-         */
-        /* If the sort is being triggered because the columns were already
-         * sorted and the filter is being cleared (or changed to something
-         * else with more rows than fit in the cache), then the temporary
-         * message will be immediately overwritten with the standard capture
-         * statistics by the packets_bar_update() call after thawing the rows.
-         * It will still blink yellow, and the user will get the message if
-         * they then click on the header file (wondering why it didn't sort.)
-         */
-        if (col_title.isEmpty()) {
-            col_title = tr("Column");
-        }
-        QString temp_msg = tr("%1 can only be sorted with %2 or fewer visible rows; increase cache size in Layout preferences").arg(col_title).arg(prefs.gui_packet_list_cached_rows_max);
-        mainApp->pushStatus(MainApplication::TemporaryStatus, temp_msg);
-        return;
-    }
-
     /* If we are currently in the middle of reading the capture file, don't
      * sort. PacketList::captureFileReadFinished invalidates all the cached
      * column strings and then tries to sort again.
@@ -633,10 +610,14 @@ void PacketListModel::sort(int column, Qt::SortOrder order)
         if (recent.aggregation_view && prefs.aggregation_fields_num > 0) {
             for (QHash<QString, int>::const_iterator it = aggregation_key_row_.constBegin();
                 it != aggregation_key_row_.constEnd(); ++it) {
-                sorted_visible_rows_[it.value()]->frameData()->aggregation_key = g_strdup(it.key().toUtf8());
+                frame_data_set_aggregation_key(sorted_visible_rows_[it.value()]->frameData(), g_strdup(it.key().toUtf8()));
             }
         }
-        std::sort(sorted_visible_rows_.begin(), sorted_visible_rows_.end(), recordLessThan);
+        if (text_sort_column_ < 0) {
+            std::sort(sorted_visible_rows_.begin(), sorted_visible_rows_.end(), recordLessThan);
+        } else {
+            sortTextColumn(sorted_visible_rows_);
+        }
 
         beginResetModel();
         visible_rows_.resize(0);
@@ -767,9 +748,9 @@ bool PacketListModel::updateVisibleAggregationViewRows(PacketListRecord* record)
     if (prefs.aggregation_fields_num == 0) return true;
 
     frame_data* fdata = record->frameData();
-    if (fdata->aggregation_key == nullptr) return false; // Only packets containing the aggregation fields are displayed
+    if (frame_data_aggregation_key(fdata) == nullptr) return false; // Only packets containing the aggregation fields are displayed
 
-    QString key = QString::fromUtf8(fdata->aggregation_key);
+    QString key = QString::fromUtf8(frame_data_aggregation_key(fdata));
     frame_data_aggregation_free(fdata);
     if (!aggregation_key_row_.contains(key)) {
         aggregation_key_row_[key] = record->row() - 1;
@@ -852,6 +833,129 @@ bool PacketListModel::recordLessThan(PacketListRecord *r1, PacketListRecord *r2)
     }
 }
 
+struct PacketListModel::SortKey {
+    QString text;
+    double number;
+    bool number_ok;
+    uint32_t frame_num;
+    PacketListRecord *record;
+};
+
+bool PacketListModel::sortKeyLessThan(const SortKey &k1, const SortKey &k2)
+{
+    // The text column part of recordLessThan, with the numeric value
+    // parsed once per row instead of once per comparison.
+    int cmp_val = k1.text.compare(k2.text);
+    if (cmp_val != 0 && sort_column_is_numeric_) {
+        if (!k1.number_ok && !k2.number_ok) {
+            cmp_val = 0;
+        } else if (!k1.number_ok || (k2.number_ok && k1.number < k2.number)) {
+            cmp_val = -1;
+        } else if (!k2.number_ok || (k1.number > k2.number)) {
+            cmp_val = 1;
+        }
+    }
+
+    if (cmp_val == 0) {
+        // All else being equal, compare frame numbers.
+        cmp_val = (k1.frame_num > k2.frame_num) - (k1.frame_num < k2.frame_num);
+    }
+
+    if (sort_order_ == Qt::AscendingOrder) {
+        return cmp_val < 0;
+    } else {
+        return cmp_val > 0;
+    }
+}
+
+void PacketListModel::sortTextColumn(QVector<PacketListRecord *> &rows)
+{
+    const qsizetype count = rows.count();
+    QVector<SortKey> keys(count);
+
+    // Dissection isn't thread safe, so the column text has to be
+    // extracted here, but each row is dissected at most once, unlike
+    // when comparing records directly. This is the slow part, so it
+    // gets most of the progress bar.
+    for (qsizetype i = 0; i < count; i++) {
+        if (busy_timer_.elapsed() > busy_timeout_) {
+            if (progress_frame_) {
+                progress_frame_->setValue(static_cast<int>(i * 90 / count));
+            }
+            mainApp->processEvents(QEventLoop::ExcludeSocketNotifiers, 1);
+            if (stop_flag_) {
+                throw SortAbort("Sorting aborted");
+            }
+            busy_timer_.restart();
+        }
+        SortKey &key = keys[i];
+        key.record = rows[i];
+        key.frame_num = rows[i]->frameData()->num;
+        key.text = rows[i]->columnString(sort_cap_file_, sort_column_);
+        key.number_ok = false;
+        key.number = sort_column_is_numeric_ ? parseNumericColumn(key.text, &key.number_ok) : 0.0;
+    }
+
+    // Sorting the keys doesn't touch the capture file or the records, so
+    // sort chunks of them on worker threads and then merge the chunks.
+    int threads = QThread::idealThreadCount();
+    constexpr qsizetype min_chunk_size = 16384;
+    if (threads > 1 && count >= 2 * min_chunk_size) {
+        qsizetype chunk_count = std::min<qsizetype>(threads, count / min_chunk_size);
+        QVector<qsizetype> bounds;
+        for (qsizetype c = 0; c <= chunk_count; c++) {
+            bounds << count * c / chunk_count;
+        }
+
+        QList<QFuture<void>> futures;
+        for (qsizetype c = 0; c < chunk_count; c++) {
+            auto first = keys.begin() + bounds[c];
+            auto last = keys.begin() + bounds[c + 1];
+            futures << QtConcurrent::run([first, last]() {
+                std::sort(first, last, sortKeyLessThan);
+            });
+        }
+        for (QFuture<void> &future : futures) {
+            future.waitForFinished();
+        }
+
+        // Merge neighboring chunks pairwise, in parallel, until one is left.
+        while (bounds.count() > 2) {
+            QVector<qsizetype> merged_bounds;
+            futures.clear();
+            qsizetype b;
+            for (b = 0; b + 2 < bounds.count(); b += 2) {
+                auto first = keys.begin() + bounds[b];
+                auto middle = keys.begin() + bounds[b + 1];
+                auto last = keys.begin() + bounds[b + 2];
+                futures << QtConcurrent::run([first, middle, last]() {
+                    std::inplace_merge(first, middle, last, sortKeyLessThan);
+                });
+                merged_bounds << bounds[b];
+            }
+            if (b + 1 < bounds.count()) {
+                // Odd chunk out; it's merged on the next pass.
+                merged_bounds << bounds[b];
+            }
+            merged_bounds << bounds.last();
+            for (QFuture<void> &future : futures) {
+                future.waitForFinished();
+            }
+            bounds = merged_bounds;
+        }
+    } else {
+        std::sort(keys.begin(), keys.end(), sortKeyLessThan);
+    }
+
+    if (progress_frame_) {
+        progress_frame_->setValue(100);
+    }
+
+    for (qsizetype i = 0; i < count; i++) {
+        rows[i] = keys[i].record;
+    }
+}
+
 // Parses a field as a double. Handle values with suffixes ("12ms"), negative
 // values ("-1.23") and fields with multiple occurrences ("1,2"). Marks values
 // that do not contain any numeric value ("Unknown") as invalid.
@@ -366,6 +366,30 @@ private:
      */
     static bool recordLessThan(PacketListRecord *r1, PacketListRecord *r2);
 
+    /** Sort key extracted from a record; see sortTextColumn(). */
+    struct SortKey;
+
+    /**
+     * @brief Compare function used to sort extracted sort keys.
+     *
+     * Gives the same order as recordLessThan, but never dissects, so it
+     * can be used from worker threads.
+     * @param k1 The first key.
+     * @param k2 The second key.
+     * @return True if k1 should appear before k2, false otherwise.
+     */
+    static bool sortKeyLessThan(const SortKey &k1, const SortKey &k2);
+
+    /**
+     * @brief Sorts records by a column whose text requires dissection.
+     *
+     * Extracts the column text of each record once, then sorts the
+     * extracted keys on worker threads.
+     * @param rows The records to sort, sorted in place.
+     * @throws SortAbort if the user stopped the sort.
+     */
+    static void sortTextColumn(QVector<PacketListRecord *> &rows);
+
     /**
      * @brief Parses a string value from a column as a numeric double.
      * @param val The string value to parse.
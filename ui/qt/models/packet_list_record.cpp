@@ -9,6 +9,8 @@
 
 #include "packet_list_record.h"
 
+#include <string.h>
+
 #include <file.h>
 
 #include <epan/epan_dissect.h>
@@ -20,9 +22,9 @@
 
 #include <ui/qt/utils/qt_ui_utils.h>
 
-#include <QStringList>
+#include <QVarLengthArray>
 
-QCache<uint32_t, QStringList> PacketListRecord::col_text_cache_(500);
+ColumnTextStore PacketListRecord::col_text_store_;
 bool PacketListRecord::dissection_paused_ = false;
 QMap<int, int> PacketListRecord::cinfo_column_;
 unsigned PacketListRecord::rows_color_ver_ = 1;
@@ -59,8 +61,8 @@ void PacketListRecord::ensureColorized(capture_file *cap_file)
 
     bool dissect_color = !colorized_ || ( color_ver_ != rows_color_ver_ );
     if (dissect_color) {
-        /* Dissect columns only if it won't evict anything from cache */
-        bool dissect_columns = col_text_cache_.totalCost() < col_text_cache_.maxCost();
+        /* Column text is never evicted, so fill it in while we're here */
+        bool dissect_columns = !col_text_store_.contains(fdata_->num);
         dissect(cap_file, dissect_columns, dissect_color);
     }
 }
@@ -82,16 +84,11 @@ const QString PacketListRecord::columnString(capture_file *cap_file, int column,
     // properly colorized?
     //
     bool dissect_color = ( colorized && !colorized_ ) || ( color_ver_ != rows_color_ver_ );
-    QStringList *col_text = nullptr;
-    if (!dissect_color) {
-        col_text = col_text_cache_.object(fdata_->num);
-    }
-    if (col_text == nullptr || column >= col_text->count() || col_text->at(column).isNull()) {
+    if (dissect_color || (unsigned)column >= col_text_store_.columnCount(fdata_->num)) {
         dissect(cap_file, true, dissect_color);
-        col_text = col_text_cache_.object(fdata_->num);
     }
 
-    return col_text ? col_text->at(column) : QString();
+    return col_text_store_.text(fdata_->num, column);
 }
 
 void PacketListRecord::resetColumns(column_info *cinfo)
@@ -248,28 +245,29 @@ void PacketListRecord::cacheColumnStrings(column_info *cinfo)
         return;
     }
 
-    QStringList *col_text = new QStringList();
+    QVarLengthArray<const char *, 32> col_text(cinfo->num_cols);
 
     lines_ = 1;
     line_count_changed_ = false;
 
     for (unsigned column = 0; column < cinfo->num_cols; ++column) {
-        int col_lines = 1;
+        int col_lines = 0;
 
-        QString col_str;
         int text_col = cinfo_column_.value(column, -1);
         if (text_col < 0) {
             col_fill_in_frame_data(fdata_, cinfo, column, false);
         }
 
-        col_str = QString(get_column_text(cinfo, column));
-        *col_text << col_str;
-        col_lines = static_cast<int>(col_str.count('\n'));
+        const char *col_str = get_column_text(cinfo, column);
+        col_text[column] = col_str;
+        for (const char *nl = col_str ? strchr(col_str, '\n') : NULL; nl; nl = strchr(nl + 1, '\n')) {
+            col_lines++;
+        }
         if (col_lines > lines_) {
             lines_ = col_lines;
             line_count_changed_ = true;
         }
     }
 
-    col_text_cache_.insert(fdata_->num, col_text);
+    col_text_store_.insert(fdata_->num, col_text.constData(), cinfo->num_cols);
 }
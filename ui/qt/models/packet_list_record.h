@@ -17,8 +17,9 @@
 #include <epan/column.h>
 #include <epan/packet.h>
 
+#include "column_text_store.h"
+
 #include <QByteArray>
-#include <QCache>
 #include <QList>
 #include <QVariant>
 
@@ -49,7 +50,7 @@ public:
     void ensureColorized(capture_file *cap_file);
 
     /**
-     * @brief Return the string value for a column. Data is cached if possible.
+     * @brief Return the string value for a column. Data is stored once dissected.
      * @param cap_file The capture file containing the packet.
      * @param column The column index.
      * @param colorized Whether to fetch the colorized string.
@@ -113,24 +114,23 @@ public:
     void invalidateColorized() { colorized_ = false; }
 
     /**
-     * @brief Removes this specific record from the column text cache.
+     * @brief Removes this specific record from the column text store.
      */
-    void invalidateRecord() { col_text_cache_.remove(fdata_->num); }
+    void invalidateRecord() { col_text_store_.remove(fdata_->num); }
 
     /**
-     * @brief Clears the column text cache for all records.
+     * @brief Clears the column text store for all records.
      */
-    static void invalidateAllRecords() { col_text_cache_.clear(); }
+    static void invalidateAllRecords() { col_text_store_.clear(); }
 
     /**
-     * @brief Sets the maximum capacity of the column text cache.
+     * @brief Sets how many rows of column text are kept in memory.
      *
-     * In Qt 6, QCache maxCost is a qsizetype, but the QAbstractItemModel
-     * number of rows is still an int, so we're limited to INT_MAX anyway.
+     * Column text for further rows is spilled to a temporary file.
      *
-     * @param cost The maximum cost (capacity) for the cache.
+     * @param rows The number of rows to keep in memory.
      */
-    static void setMaxCache(int cost) { col_text_cache_.setMaxCost(cost); }
+    static void setMaxCache(int rows) { col_text_store_.setMemoryRowLimit(rows); }
 
     /**
      * @brief Resets the columns configuration.
@@ -180,7 +180,7 @@ public:
     inline uint32_t expertSeverity() const { return expert_severity_; }
 
 private:
-    static QCache<uint32_t, QStringList> col_text_cache_; /**< The column text for some columns */
+    static ColumnTextStore col_text_store_; /**< The column text of dissected records */
     static bool dissection_paused_; /**< Flag indicating if dissection is globally paused. */
 
     frame_data *fdata_; /**< Pointer to the underlying frame data. */
@@ -210,7 +210,7 @@ private:
     void dissect(capture_file *cap_file, bool dissect_columns, bool dissect_color = false);
 
     /**
-     * @brief Populates the cache with column strings based on the dissected packet.
+     * @brief Populates the store with column strings based on the dissected packet.
      * @param cinfo Pointer to the column information structure.
      */
     void cacheColumnStrings(column_info *cinfo);
@@ -44,17 +44,17 @@ tapPacket(void* ptr, packet_info* pinfo, epan_dissect_t* edt, const void* data _
         }
     }
     if (key->len > 0) {
-        if (pinfo->fd->aggregation_key == NULL) {
-            pinfo->fd->aggregation_key = g_strdup(key->str);
+        const char* old_key = frame_data_aggregation_key(pinfo->fd);
+        if (old_key == NULL) {
+            frame_data_set_aggregation_key(pinfo->fd, g_strdup(key->str));
         }
         else {
             size_t len = strlen(key->str) + 1;
-            len += strlen(pinfo->fd->aggregation_key);
+            len += strlen(old_key);
             gchar* new_key = g_malloc(len);
             if (new_key) {
-                snprintf(new_key, len, "%s%s", pinfo->fd->aggregation_key, key->str);
-                g_free(pinfo->fd->aggregation_key);
-                pinfo->fd->aggregation_key = new_key;
+                snprintf(new_key, len, "%s%s", old_key, key->str);
+                frame_data_set_aggregation_key(pinfo->fd, new_key);
             }
         }
     }
@@ -57,18 +57,20 @@
 static void
 modify_time_perform(frame_data *fd, int neg, nstime_t *offset, int settozero)
 {
+    frame_data_cold *cold = frame_data_get_cold(fd);
+
     /* The actual shift */
     if (settozero == SHIFT_SETTOZERO) {
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        nstime_subtract(&(fd->abs_ts), &(cold->shift_offset));
+        nstime_set_zero(&(cold->shift_offset));
     }
 
     if (neg == SHIFT_POS) {
         nstime_add(&(fd->abs_ts), offset);
-        nstime_add(&(fd->shift_offset), offset);
+        nstime_add(&(cold->shift_offset), offset);
     } else if (neg == SHIFT_NEG) {
         nstime_subtract(&(fd->abs_ts), offset);
-        nstime_subtract(&(fd->shift_offset), offset);
+        nstime_subtract(&(cold->shift_offset), offset);
     } else {
         fprintf(stderr, "Modify_time_perform: neg = %d?\n", neg);
     }
@@ -315,7 +317,7 @@ time_shift_settime(capture_file *cf, unsigned packet_num, const char *time_text)
      */
     if ((packetfd = frame_data_sequence_find(cf->provider.frames, packet_num)) == NULL)
         return "No packets found.";
-    nstime_delta(&packet_time, &(packetfd->abs_ts), &(packetfd->shift_offset));
+    nstime_delta(&packet_time, &(packetfd->abs_ts), frame_data_shift_offset(packetfd));
 
     if ((err_str = time_string_to_nstime(time_text, &packet_time, &set_time)) != NULL)
         return err_str;
@@ -375,7 +377,7 @@ time_shift_adjtime(capture_file *cf, unsigned packet1_num, const char *time1_tex
     if ((packet1fd = frame_data_sequence_find(cf->provider.frames, packet1_num)) == NULL)
         return "No frames found.";
     nstime_copy(&ot1, &(packet1fd->abs_ts));
-    nstime_subtract(&ot1, &(packet1fd->shift_offset));
+    nstime_subtract(&ot1, frame_data_shift_offset(packet1fd));
 
     if ((err_str = time_string_to_nstime(time1_text, &ot1, &nt1)) != NULL)
         return err_str;
@@ -387,7 +389,7 @@ time_shift_adjtime(capture_file *cf, unsigned packet1_num, const char *time1_tex
     if ((packet2fd = frame_data_sequence_find(cf->provider.frames, packet2_num)) == NULL)
         return "No frames found.";
     nstime_copy(&ot2, &(packet2fd->abs_ts));
-    nstime_subtract(&ot2, &(packet2fd->shift_offset));
+    nstime_subtract(&ot2, frame_data_shift_offset(packet2fd));
 
     if ((err_str = time_string_to_nstime(time2_text, &ot2, &nt2)) != NULL)
         return err_str;
@@ -407,8 +409,10 @@ time_shift_adjtime(capture_file *cf, unsigned packet1_num, const char *time1_tex
             continue;   /* Shouldn't happen */
 
         /* Set everything back to the original time */
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        if (fd->cold) {
+            nstime_subtract(&(fd->abs_ts), &(fd->cold->shift_offset));
+            nstime_set_zero(&(fd->cold->shift_offset));
+        }
 
         /* Add the difference to each packet */
         calcNT3(&ot1, &(fd->abs_ts), &nt1, &nt3, &dot, &dnt);
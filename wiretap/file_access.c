@@ -2081,7 +2081,7 @@ wtap_dump_can_open(int file_type_subtype)
  * Return whether we know how to write a compressed file of the specified
  * file type.
  */
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_ZSTD) || defined (HAVE_LZ4FRAME_H)
 bool
 wtap_dump_can_compress(int file_type_subtype)
 {
@@ -2573,6 +2573,14 @@ wtap_dump_flush(wtap_dumper *wdh, int *err)
 		}
 		break;
 #endif
+#ifdef HAVE_ZSTD
+	case WS_FILE_ZSTD_COMPRESSED:
+		if (zstdwfile_flush((ZSTDWFILE_T)wdh->fh) == -1) {
+			*err = zstdwfile_geterr((ZSTDWFILE_T)wdh->fh);
+			return false;
+		}
+		break;
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
 	case WS_FILE_LZ4_COMPRESSED:
 		if (lz4wfile_flush((LZ4WFILE_T)wdh->fh) == -1) {
@@ -2714,6 +2722,10 @@ wtap_dump_file_open(const wtap_dumper *wdh, const char *filename)
 	case WS_FILE_GZIP_COMPRESSED:
 		return gzwfile_open(filename);
 #endif /* defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) */
+#ifdef HAVE_ZSTD
+	case WS_FILE_ZSTD_COMPRESSED:
+		return zstdwfile_open(filename);
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
 	case WS_FILE_LZ4_COMPRESSED:
 		return lz4wfile_open(filename);
@@ -2732,6 +2744,10 @@ wtap_dump_file_fdopen(const wtap_dumper *wdh, int fd)
 	case WS_FILE_GZIP_COMPRESSED:
 		return gzwfile_fdopen(fd);
 #endif /* defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) */
+#ifdef HAVE_ZSTD
+	case WS_FILE_ZSTD_COMPRESSED:
+		return zstdwfile_fdopen(fd);
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
 	case WS_FILE_LZ4_COMPRESSED:
 		return lz4wfile_fdopen(fd);
@@ -2760,6 +2776,18 @@ wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize, int *err
 		}
 		break;
 #endif
+#ifdef HAVE_ZSTD
+	case WS_FILE_ZSTD_COMPRESSED:
+		nwritten = zstdwfile_write((ZSTDWFILE_T)wdh->fh, buf, bufsize);
+		/*
+		 * zstdwfile_write() returns 0 on error.
+		 */
+		if (nwritten == 0) {
+			*err = zstdwfile_geterr((ZSTDWFILE_T)wdh->fh);
+			return false;
+		}
+		break;
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
 	case WS_FILE_LZ4_COMPRESSED:
 		nwritten = lz4wfile_write((LZ4WFILE_T)wdh->fh, buf, bufsize);
@@ -2800,6 +2828,10 @@ wtap_dump_file_close(wtap_dumper *wdh)
 	case WS_FILE_GZIP_COMPRESSED:
 		return gzwfile_close((GZWFILE_T)wdh->fh);
 #endif
+#ifdef HAVE_ZSTD
+	case WS_FILE_ZSTD_COMPRESSED:
+		return zstdwfile_close((ZSTDWFILE_T)wdh->fh);
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
 	case WS_FILE_LZ4_COMPRESSED:
 		return lz4wfile_close((LZ4WFILE_T)wdh->fh);
@@ -2812,7 +2844,7 @@ wtap_dump_file_close(wtap_dumper *wdh)
 int64_t
 wtap_dump_file_seek(wtap_dumper *wdh, int64_t offset, int whence, int *err)
 {
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_ZSTD) || defined (HAVE_LZ4FRAME_H)
 	if (wdh->compression_type != WS_FILE_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
@@ -2833,7 +2865,7 @@ int64_t
 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	int64_t rval;
-#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_LZ4FRAME_H)
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_ZSTD) || defined (HAVE_LZ4FRAME_H)
 	/* XXX - The gzip_writer and lz4_writer structs do contain the
 	 * position in the uncompressed data as an int64_t so we could
 	 * return that, but that should be the same as bytes_dumped as
@@ -25,8 +25,14 @@
 #include "wtap_module.h"
 
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
 #include <wsutil/zlib_compat.h>
 #include <wsutil/file_compressed.h>
+#include <wsutil/shm_ring.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
 
 #ifdef HAVE_ZSTD
 #include <zstd.h>
@@ -139,8 +145,36 @@ struct wtap_reader {
     /* fast seeking */
     GPtrArray *fast_seek;
     void *fast_seek_cur;
+
+    /* shared-memory mirror of a file being written */
+    ws_shm_ring *shm_ring;      /* ring to try before reading the file, if any */
+    uint64_t shm_dev;           /* identity of the file, to find it in the ring */
+    uint64_t shm_ino;
+    bool fd_pos_stale;          /* true if raw_pos was advanced without reading fd */
+
+    /*
+     * Memory mapping of an uncompressed regular file. While out.buf
+     * points into the mapping rather than at out_alloc, the output
+     * buffer is a window of the file, with raw_pos just past it.
+     */
+    struct file_mapping *mapping; /* mapping of the file, or NULL */
+    uint8_t *map;               /* start of the mapping, or NULL */
+    int64_t map_size;           /* size of the file when it was mapped */
+    uint8_t *out_alloc;         /* allocated output buffer */
+    bool map_disabled;          /* true if the file may change while we read it */
 };
 
+/*
+ * A memory mapping of a file. Buffers that borrow data from it hold a
+ * reference to it, so it stays mapped until they're done with the data
+ * even if the file is closed or reopened in the meantime.
+ */
+typedef struct file_mapping {
+    int refcount;
+    uint8_t *base;
+    size_t size;
+} file_mapping;
+
 /* Current read offset within a buffer. */
 static unsigned
 offset_in_buffer(struct wtap_reader_buf *buf)
@@ -202,6 +236,26 @@ buf_read(FILE_T state, struct wtap_reader_buf *buf)
         to_read = space_left;
     }
 
+    if (state->shm_ring != NULL) {
+        /* If the writer still has this data in the ring, skip the file. */
+        size_t copied = ws_shm_ring_read(state->shm_ring, state->shm_dev, state->shm_ino,
+                                         (uint64_t)state->raw_pos, read_ptr, to_read);
+        if (copied > 0) {
+            state->raw_pos += copied;
+            state->fd_pos_stale = true;
+            buf->avail += (unsigned)copied;
+            return 0;
+        }
+    }
+    if (state->fd_pos_stale) {
+        if (ws_lseek64(state->fd, state->raw_pos, SEEK_SET) == -1) {
+            state->err = errno;
+            state->err_info = NULL;
+            return -1;
+        }
+        state->fd_pos_stale = false;
+    }
+
     ret = ws_read(state->fd, read_ptr, to_read);
     if (ret < 0) {
         state->err = errno;
@@ -385,9 +439,116 @@ fast_seek_reset(FILE_T state)
     }
 }
 
+static void
+file_mapping_unref(void *data)
+{
+    file_mapping *mapping = (file_mapping *)data;
+
+    if (!g_atomic_int_dec_and_test(&mapping->refcount))
+        return;
+#ifndef _WIN32
+    munmap(mapping->base, mapping->size);
+#endif /* _WIN32 */
+    g_free(mapping);
+}
+
+/*
+ * Map an uncompressed file, so that its data can be used in place
+ * rather than copied into the output buffer. Files that aren't
+ * regular files, or that can't be mapped, are read as usual.
+ *
+ * Accessing a page of a mapping that is past the end of a file that
+ * has been truncated raises SIGBUS, so files that are being written
+ * while we read them (see file_clearerr() and file_set_shm_ring())
+ * aren't mapped.
+ */
+static void
+map_file(FILE_T state)
+{
+#ifndef _WIN32
+    ws_statb64 st;
+    void *map;
+
+    if (state->map != NULL || state->is_compressed || state->map_disabled)
+        return;
+    if (ws_fstat64(state->fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (uint64_t)st.st_size > SIZE_MAX / 4)
+        return;
+
+    /*
+     * The mapping is read-only; data borrowed from it must be copied
+     * with ws_buffer_own() before it is modified in place (e.g., to
+     * byte-swap pseudo-headers), and writing to it without doing so
+     * faults rather than going unnoticed.
+     */
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+               state->fd, 0);
+    if (map == MAP_FAILED)
+        return;
+    state->mapping = g_new(file_mapping, 1);
+    state->mapping->refcount = 1;
+    state->mapping->base = (uint8_t *)map;
+    state->mapping->size = (size_t)st.st_size;
+    state->map = (uint8_t *)map;
+    state->map_size = st.st_size;
+#else
+    (void)state;
+#endif /* _WIN32 */
+}
+
+/*
+ * Drop our reference to the mapping. Anything left in a mapped output
+ * buffer is read from the file again.
+ */
+static void
+unmap_file(FILE_T state)
+{
+    if (state->map == NULL)
+        return;
+    if (state->out.buf != state->out_alloc) {
+        state->raw_pos -= state->out.avail;
+        state->fd_pos_stale = true;
+        state->out.buf = state->out_alloc;
+        buf_reset(&state->out);
+    }
+    file_mapping_unref(state->mapping);
+    state->mapping = NULL;
+    state->map = NULL;
+    state->map_size = 0;
+}
+
+/* Point the output buffer at the mapped data starting at offset. */
+static void
+map_window(FILE_T state, int64_t offset)
+{
+    int64_t avail = state->map_size - offset;
+
+    state->out.buf = state->map + offset;
+    state->out.next = state->out.buf;
+    state->out.avail = avail > MAX_READ_BUF_SIZE ? MAX_READ_BUF_SIZE : (unsigned)avail;
+    state->raw_pos = offset + state->out.avail;
+    state->fd_pos_stale = true;
+}
+
+/* Discard the output data, going back to the allocated buffer. */
+static void
+out_reset(FILE_T state)
+{
+    state->out.buf = state->out_alloc;
+    buf_reset(&state->out);
+}
+
 static bool
 uncompressed_fill_out_buffer(FILE_T state)
 {
+    if (state->map != NULL && state->raw_pos < state->map_size) {
+        map_window(state, state->raw_pos);
+        return true;
+    }
+
+    /* Past the end of the mapping, e.g. a file that is still growing. */
+    if (state->out.buf != state->out_alloc)
+        out_reset(state);
     if (buf_read(state, &state->out) < 0)
         return false;
     return true;
@@ -410,6 +571,111 @@ uncompressed_fill_out_buffer(FILE_T state)
                     (state->in.avail--, *(state->in.next)++)))
 
 
+#if defined (USE_ZLIB_OR_ZLIBNG) || defined (HAVE_ZSTD)
+/*
+ * Compressed files we write end with a table of their independently
+ * compressed frames; see wsutil/file_compressed.h.  If a file has one, we
+ * add fast seek points for all of its frames as soon as we see the first
+ * one, rather than as we read up to them, so that the first random access
+ * to a frame doesn't have to decompress everything before it.
+ *
+ * Read len bytes at offset from the file, without disturbing sequential
+ * reading; return the data, to be freed with g_free(), or NULL on failure.
+ */
+static uint8_t *
+fast_seek_read_table(FILE_T state, int64_t offset, size_t len)
+{
+    uint8_t *buf;
+
+    /* The next buf_read() has to go back to where it was. */
+    state->fd_pos_stale = true;
+    if (ws_lseek64(state->fd, offset, SEEK_SET) == -1)
+        return NULL;
+    buf = (uint8_t *)g_malloc(len);
+    if (ws_read(state->fd, buf, (unsigned)len) != (ssize_t)len) {
+        g_free(buf);
+        return NULL;
+    }
+    return buf;
+}
+
+/*
+ * Check that a frame starts at in, right after one that decompresses to
+ * prev_out bytes, as a table says.  A zstd frame starts with its magic
+ * number; a gzip member starts with its magic number and method, and the
+ * member before it ends with its uncompressed size, modulo 2^32.
+ */
+static bool
+fast_seek_frame_starts_at(FILE_T state, int64_t in, uint32_t prev_out,
+                          compression_t compression)
+{
+    uint8_t *hdr;
+    bool ok = false;
+
+    switch (compression) {
+
+    case GZIP_AFTER_HEADER:
+        hdr = fast_seek_read_table(state, in - 4, 7);
+        ok = hdr != NULL && pletohu32(hdr) == prev_out &&
+             hdr[4] == 0x1f && hdr[5] == 0x8b && hdr[6] == 8;
+        break;
+
+    case ZSTD:
+        hdr = fast_seek_read_table(state, in, 4);
+        ok = hdr != NULL && pletohu32(hdr) == 0xFD2FB528;
+        break;
+
+    default:
+        hdr = NULL;
+        break;
+    }
+    g_free(hdr);
+    return ok;
+}
+
+/*
+ * Add fast seek points for count frames, starting at in_pos in the
+ * file, given the table of their compressed and uncompressed sizes, if
+ * the frames end exactly at end_pos and each of them starts where the
+ * table says.  The first frame already has one.  point_offset is where a
+ * frame's fast seek point is relative to its start.
+ *
+ * If the table doesn't check out, no points are added, and seeking falls
+ * back on the points added while reading the file sequentially.
+ */
+static void
+fast_seek_add_frames(FILE_T state, const uint8_t *sizes, uint32_t count,
+                     unsigned entry_size, int64_t in_pos, int64_t end_pos,
+                     unsigned point_offset, compression_t compression)
+{
+    int64_t in, out;
+
+    in = in_pos;
+    for (uint32_t i = 0; i < count; i++)
+        in += pletohu32(sizes + (size_t)i * entry_size);
+    if (in != end_pos)
+        return;
+
+    in = in_pos;
+    for (uint32_t i = 1; i < count; i++) {
+        in += pletohu32(sizes + (size_t)(i - 1) * entry_size);
+        if (!fast_seek_frame_starts_at(state, in,
+                                       pletohu32(sizes + (size_t)(i - 1) * entry_size + 4),
+                                       compression))
+            return;
+    }
+
+    in = in_pos;
+    out = 0;
+    for (uint32_t i = 0; i < count; i++, sizes += entry_size) {
+        if (i != 0)
+            fast_seek_header(state, in + point_offset, out, compression);
+        in += pletohu32(sizes);
+        out += pletohu32(sizes + 4);
+    }
+}
+#endif /* defined (USE_ZLIB_OR_ZLIBNG) || defined (HAVE_ZSTD) */
+
 /*
  * Gzipped files, using compression from zlib or zlib-ng.
  *
@@ -528,6 +794,54 @@ gz_skipzstr(FILE_T state)
     return 0;
 }
 
+/*
+ * Look for the index of the members at the end of the file, and add fast
+ * seek points for them.  The members we write have a fixed 10-byte header,
+ * and the points are right after it.
+ */
+static void
+zlib_fast_seek_prime(FILE_T state)
+{
+    ws_statb64 statb;
+    uint8_t *tail, *index;
+    uint32_t count;
+    size_t len;
+    int64_t index_pos;
+
+    if (ws_fstat64(state->fd, &statb) == -1 ||
+        statb.st_size - state->start < WS_GZIP_INDEX_HEADER_SIZE + 8 + WS_GZIP_INDEX_TRAILER_SIZE)
+        return;
+
+    /* The member count and magic number, then the fixed trailer. */
+    tail = fast_seek_read_table(state, statb.st_size - 8 - WS_GZIP_INDEX_TRAILER_SIZE,
+                                8 + WS_GZIP_INDEX_TRAILER_SIZE);
+    if (tail == NULL)
+        return;
+    count = pletohu32(tail);
+    if (pletohu32(tail + 4) != WS_GZIP_INDEX_MAGIC || tail[8] != 0x03 || tail[9] != 0 ||
+        pletohu64(tail + 10) != 0 || count > WS_GZIP_INDEX_MAX_MEMBERS) {
+        g_free(tail);
+        return;
+    }
+    g_free(tail);
+
+    len = (size_t)count * 8 + 8;
+    index_pos = statb.st_size - WS_GZIP_INDEX_TRAILER_SIZE - (int64_t)len - WS_GZIP_INDEX_HEADER_SIZE;
+    if (index_pos < state->start)
+        return;
+    index = fast_seek_read_table(state, index_pos, WS_GZIP_INDEX_HEADER_SIZE + len);
+    if (index == NULL)
+        return;
+    if (index[0] == 31 && index[1] == 139 && index[3] == 0x04 &&
+        pletohu16(index + 10) == len + 4 &&
+        index[12] == WS_GZIP_INDEX_SI1 && index[13] == WS_GZIP_INDEX_SI2 &&
+        pletohu16(index + 14) == len) {
+        fast_seek_add_frames(state, index + WS_GZIP_INDEX_HEADER_SIZE, count, 8,
+                             state->start, index_pos, 10, GZIP_AFTER_HEADER);
+    }
+    g_free(index);
+}
+
 static void
 zlib_fast_seek_add(FILE_T file, struct zlib_cur_seek_point *point, int bits, int64_t in_pos, int64_t out_pos)
 {
@@ -849,6 +1163,9 @@ check_for_zlib_compression(FILE_T state)
                     g_free(state->fast_seek_cur);
                     state->fast_seek_cur = cur;
                     fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, GZIP_AFTER_HEADER);
+                    if (state->fast_seek->len == 1 &&
+                        state->raw_pos - state->in.avail == state->start + 10)
+                        zlib_fast_seek_prime(state);
                 }
 #endif /* Z_BLOCK */
                 return 1;
@@ -917,6 +1234,51 @@ zstd_fill_out_buffer(FILE_T state)
     }
     return true;
 }
+
+/*
+ * Look for a seek table at the end of the file, and add fast seek points
+ * for the frames in it.
+ */
+static void
+zstd_fast_seek_prime(FILE_T state)
+{
+    ws_statb64 statb;
+    uint8_t *footer, *table;
+    uint32_t count;
+    unsigned entry_size;
+    size_t len;
+    int64_t table_pos;
+
+    if (ws_fstat64(state->fd, &statb) == -1 ||
+        statb.st_size - state->start < 8 + WS_ZSTD_SEEKABLE_FOOTER_SIZE)
+        return;
+
+    footer = fast_seek_read_table(state, statb.st_size - WS_ZSTD_SEEKABLE_FOOTER_SIZE,
+                                  WS_ZSTD_SEEKABLE_FOOTER_SIZE);
+    if (footer == NULL)
+        return;
+    count = pletohu32(footer);
+    /* Checksums make the entries bigger; the other bits are reserved. */
+    entry_size = (footer[4] & 0x80) ? 12 : 8;
+    if (pletohu32(footer + 5) != WS_ZSTD_SEEKABLE_MAGIC || (footer[4] & 0x7c) != 0 ||
+        (uint64_t)count > (uint64_t)(statb.st_size - state->start) / entry_size) {
+        g_free(footer);
+        return;
+    }
+    g_free(footer);
+
+    len = (size_t)count * entry_size + WS_ZSTD_SEEKABLE_FOOTER_SIZE;
+    table_pos = statb.st_size - (int64_t)len - 8;
+    if (table_pos < state->start)
+        return;
+    table = fast_seek_read_table(state, table_pos, 8 + len);
+    if (table == NULL)
+        return;
+    if (pletohu32(table) == WS_ZSTD_SKIPPABLE_MAGIC && pletohu32(table + 4) == len)
+        fast_seek_add_frames(state, table + 8, count, entry_size,
+                             state->start, table_pos, 0, ZSTD);
+    g_free(table);
+}
 #endif /* HAVE_ZSTD */
 
 /*
@@ -941,6 +1303,9 @@ check_for_zstd_compression(FILE_T state)
         }
 
         fast_seek_header(state, state->raw_pos - state->in.avail, state->pos, ZSTD);
+        if (state->fast_seek != NULL && state->fast_seek->len == 1 &&
+            state->raw_pos - state->in.avail == state->start)
+            zstd_fast_seek_prime(state);
         state->compression = ZSTD;
         state->is_compressed = true;
         return 1;
@@ -950,6 +1315,45 @@ check_for_zstd_compression(FILE_T state)
         return -1;
 #endif /* HAVE_ZSTD */
     }
+
+    /*
+     * Skippable frames, such as a seek table, can come between or after
+     * Zstandard frames; skip them.
+     */
+    if (state->last_compression == ZSTD && state->in.avail >= 4
+        && (state->in.next[0] & 0xf0) == 0x50 && state->in.next[1] == 0x2a
+        && state->in.next[2] == 0x4d && state->in.next[3] == 0x18) {
+        uint64_t skip;
+        unsigned n;
+
+        while (state->in.avail < 8) {
+            if (fill_in_buffer(state) == -1)
+                return -1;
+            if (state->eof && state->in.avail < 8) {
+                state->err = WTAP_ERR_SHORT_READ;
+                state->err_info = NULL;
+                return -1;
+            }
+        }
+        skip = 8 + (uint64_t)pletohu32(state->in.next + 4);
+        while (skip != 0) {
+            if (state->in.avail == 0) {
+                if (fill_in_buffer(state) == -1)
+                    return -1;
+                if (state->in.avail == 0) {
+                    state->err = WTAP_ERR_SHORT_READ;
+                    state->err_info = NULL;
+                    return -1;
+                }
+            }
+            n = (uint64_t)state->in.avail > skip ? (unsigned)skip : state->in.avail;
+            state->in.next += n;
+            state->in.avail -= n;
+            skip -= n;
+        }
+        /* Look for whatever follows. */
+        return 1;
+    }
     return 0;
 }
 
@@ -1354,6 +1758,14 @@ check_for_compression(FILE_T state)
        the input buffer, which also assures space for gzungetc() */
     state->raw = state->pos;
     state->out.next = state->out.buf;
+    state->compression = UNCOMPRESSED;
+    map_file(state);
+    if (state->map != NULL && state->raw_pos - state->in.avail < state->map_size) {
+        /* use the mapped data in place of what we've read */
+        map_window(state, state->raw_pos - state->in.avail);
+        buf_reset(&state->in);
+        return 0;
+    }
     /* not a compressed file -- copy everything we've read into the
        input buffer to the output buffer and fall to raw i/o */
     if (state->in.avail) {
@@ -1363,7 +1775,6 @@ check_for_compression(FILE_T state)
         /* Now discard everything in the input buffer */
         buf_reset(&state->in);
     }
-    state->compression = UNCOMPRESSED;
     return 0;
 }
 
@@ -1465,7 +1876,7 @@ gz_skip(FILE_T state, int64_t len)
 static void
 gz_reset(FILE_T state)
 {
-    buf_reset(&state->out);       /* no output data available */
+    out_reset(state);             /* no output data available */
     state->eof = false;           /* not at end of file */
     state->compression = UNKNOWN; /* look for compression header */
 
@@ -1608,6 +2019,7 @@ file_fdopen(int fd)
     state->out.buf = (unsigned char *)g_try_malloc(want << 1);
     state->out.next = state->out.buf;
     state->out.avail = 0;
+    state->out_alloc = state->out.buf;
     state->size = want;
     if (state->in.buf == NULL || state->out.buf == NULL) {
        goto err;
@@ -1895,7 +2307,8 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
         fast_seek_reset(file);
 
         file->raw_pos = off;
-        buf_reset(&file->out);
+        file->fd_pos_stale = false;
+        out_reset(file);
         file->eof = false;
         file->seek_pending = false;
         file->err = 0;
@@ -2020,14 +2433,19 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
         && (file->fast_seek != NULL))
     {
         /*
-         * Yes.  Just seek there within the file.
+         * Yes.  Just seek there within the file; if it's mapped,
+         * the next read will pick the data up from the mapping.
          */
-        if (ws_lseek64(file->fd, offset - file->out.avail, SEEK_CUR) == -1) {
-            *err = errno;
-            return -1;
-        }
+        if (file->map == NULL) {
+            if (ws_lseek64(file->fd, file->raw_pos + (offset - file->out.avail), SEEK_SET) == -1) {
+                *err = errno;
+                return -1;
+            }
+            file->fd_pos_stale = false;
+        } else
+            file->fd_pos_stale = true;
         file->raw_pos += (offset - file->out.avail);
-        buf_reset(&file->out);
+        out_reset(file);
         file->eof = false;
         file->seek_pending = false;
         file->err = 0;
@@ -2062,6 +2480,7 @@ file_seek(FILE_T file, int64_t offset, int whence, int *err)
         }
         fast_seek_reset(file);
         file->raw_pos = file->start;
+        file->fd_pos_stale = false;
         gz_reset(file);
     }
 
@@ -2212,6 +2631,53 @@ file_read(void *buf, unsigned int len, FILE_T file)
     return (int)got;
 }
 
+bool
+file_read_mapped(FILE_T file, Buffer *buf, unsigned len)
+{
+    const uint8_t *data;
+
+    if (file->map == NULL || len == 0)
+        return false;
+
+    /* process a skip request */
+    if (file->seek_pending) {
+        file->seek_pending = false;
+        if (gz_skip(file, file->skip) == -1)
+            return false;
+    }
+
+    if (file->out.avail == 0 && file->err == 0 &&
+        !(file->eof && file->in.avail == 0)) {
+        if (fill_out_buffer(file) == -1)
+            return false;
+    }
+
+    /*
+     * If the data straddles the end of the window, or we had read it
+     * into the allocated buffer, start a new window at it.
+     */
+    if (file->compression == UNCOMPRESSED &&
+        (file->out.buf == file->out_alloc || file->out.avail < len)) {
+        int64_t offset = file->raw_pos - file->out.avail;
+
+        if (offset + len > file->map_size)
+            return false;
+        map_window(file, offset);
+    }
+    if (file->out.buf == file->out_alloc || file->out.avail < len)
+        return false;
+
+    data = file->out.next;
+    file->out.next += len;
+    file->out.avail -= len;
+    file->pos += len;
+
+    /* The buffer keeps the mapping alive until it's done with the data. */
+    g_atomic_int_inc(&file->mapping->refcount);
+    ws_buffer_borrow(buf, data, len, file_mapping_unref, file->mapping);
+    return true;
+}
+
 /*
  * XXX - this *peeks* at next byte, not a character.
  */
@@ -2396,6 +2862,10 @@ file_clearerr(FILE_T stream)
     stream->err = 0;
     stream->err_info = NULL;
     stream->eof = false;
+
+    /* We're reading a file as it's being written; stop mapping it. */
+    stream->map_disabled = true;
+    unmap_file(stream);
 }
 
 void
@@ -2414,9 +2884,29 @@ file_fdreopen(FILE_T file, const char *path)
     if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
         return false;
     file->fd = fd;
+
+    /* The mapping is of the old file. */
+    if (file->map != NULL) {
+        unmap_file(file);
+        map_file(file);
+    }
     return true;
 }
 
+void
+file_set_shm_ring(FILE_T file, ws_shm_ring *ring)
+{
+    ws_shm_ring_unref(file->shm_ring);
+    file->shm_ring = NULL;
+    if (ring == NULL || !ws_shm_ring_file_id(file->fd, &file->shm_dev, &file->shm_ino))
+        return;
+    file->shm_ring = ws_shm_ring_ref(ring);
+
+    /* The file is being written; don't map it. */
+    file->map_disabled = true;
+    unmap_file(file);
+}
+
 void
 file_close(FILE_T file)
 {
@@ -2433,10 +2923,12 @@ file_close(FILE_T file)
 #ifdef HAVE_LZ4FRAME_H
         LZ4F_freeDecompressionContext(file->lz4_dctx);
 #endif /* HAVE_LZ4FRAME_H */
-        g_free(file->out.buf);
+        unmap_file(file);
+        g_free(file->out_alloc);
         g_free(file->in.buf);
     }
     g_free(file->fast_seek_cur);
+    ws_shm_ring_unref(file->shm_ring);
     file->err = 0;
     file->err_info = NULL;
     g_free(file);
@@ -12,6 +12,7 @@
 #include <wireshark.h>
 #include "wtap.h"
 #include <wsutil/file_util.h>
+#include <wsutil/shm_ring.h>
 
 /**
  * @brief Open a file for reading or writing.
@@ -103,6 +104,27 @@ WS_DLL_PUBLIC bool file_iscompressed(FILE_T stream);
  */
 WS_DLL_PUBLIC int file_read(void *buf, unsigned int count, FILE_T file);
 
+/**
+ * @brief Read bytes from a file into an empty buffer without copying them,
+ * if possible.
+ *
+ * If the file is uncompressed and memory-mapped, and all @p count bytes
+ * are in the mapping, makes @p buf borrow them (see ws_buffer_borrow())
+ * and advances past them. The buffer holds a reference to the mapping,
+ * so the data stays valid until the buffer is refilled, takes ownership
+ * of its data or is freed, even if the file is closed or reopened first.
+ * The data may be modified after ws_buffer_own(); before that, it must
+ * not be.
+ *
+ * @param file File handle.
+ * @param buf Buffer to receive the data.
+ * @param count Number of bytes to read.
+ * @return true if the buffer now has the data, false if it has to be read
+ * with file_read(); the file position is then unchanged, apart from
+ * pending seeks having been done.
+ */
+extern bool file_read_mapped(FILE_T file, Buffer *buf, unsigned int count);
+
 /**
  * @brief Peek the next byte from the file without advancing the position.
  *
@@ -172,6 +194,9 @@ WS_DLL_PUBLIC int file_error(FILE_T fh, char **err_info);
 /**
  * @brief Clear error and end-of-file indicators for a file stream.
  *
+ * This is done to read more of a file that is still being written, so
+ * from then on the file is no longer memory-mapped.
+ *
  * @param stream The file stream to clear.
  */
 extern void file_clearerr(FILE_T stream);
@@ -192,6 +217,18 @@ extern void file_fdclose(FILE_T file);
  */
 extern bool file_fdreopen(FILE_T file, const char *path);
 
+/**
+ * @brief Read recently written data of a file from a shared-memory ring,
+ * falling back to the file for anything the ring doesn't have.
+ *
+ * @param file The file stream.
+ * A file with a ring is being written, so it is no longer memory-mapped.
+ *
+ * @param ring The ring the writer of the file mirrors it into, or NULL to
+ * stop using one. The stream takes a reference to it.
+ */
+extern void file_set_shm_ring(FILE_T file, ws_shm_ring *ring);
+
 /**
  * @brief Close a file stream.
  *
@@ -78,6 +78,8 @@ static try_record_ret_t libpcap_try_record(wtap *wth, pcap_variant_t variant,
 
 static bool libpcap_read(wtap *wth, wtap_rec *rec,
     int *err, char **err_info, int64_t *data_offset);
+static bool libpcap_scan_record(wtap *wth, const uint8_t *data, size_t avail,
+    bool syncing, uint32_t *rec_len, wtap_scan_entry *entry);
 static bool libpcap_seek_read(wtap *wth, int64_t seek_off,
     wtap_rec *rec, int *err, char **err_info);
 static bool libpcap_read_packet(wtap *wth, FILE_T fh,
@@ -718,6 +720,16 @@ wtap_open_return_val libpcap_open(wtap *wth, int *err, char **err_info)
 		wtap_add_generated_idb(wth);
 	}
 
+	/*
+	 * Records of the standard variants can be found without reading
+	 * them; the others have headers we'd have to guess the size of.
+	 * The lengths have to be the ones in the header, too.
+	 */
+	if ((libpcap->variant == PCAP || libpcap->variant == PCAP_NSEC) &&
+	    libpcap->lengths_swapped == NOT_SWAPPED &&
+	    pcap_record_lengths_in_header(wth->file_encap))
+		wth->subtype_scan_record = libpcap_scan_record;
+
 	return WTAP_OPEN_MINE;
 }
 
@@ -1291,6 +1303,61 @@ static bool libpcap_read(wtap *wth, wtap_rec *rec,
 	return libpcap_read_packet(wth, wth->fh, rec, err, err_info);
 }
 
+/*
+ * Check whether a record starts at data, and get its header, without
+ * reading it.
+ */
+static bool
+libpcap_scan_record(wtap *wth, const uint8_t *data, size_t avail,
+    bool syncing, uint32_t *rec_len, wtap_scan_entry *entry)
+{
+	libpcap_t *libpcap = (libpcap_t *)wth->priv;
+	struct pcaprec_hdr hdr;
+
+	if (avail < sizeof hdr)
+		return false;
+	memcpy(&hdr, data, sizeof hdr);
+	if (libpcap->byte_swapped) {
+		hdr.ts_sec = GUINT32_SWAP_LE_BE(hdr.ts_sec);
+		hdr.ts_usec = GUINT32_SWAP_LE_BE(hdr.ts_usec);
+		hdr.incl_len = GUINT32_SWAP_LE_BE(hdr.incl_len);
+		hdr.orig_len = GUINT32_SWAP_LE_BE(hdr.orig_len);
+	}
+
+	/* Leave bad lengths to libpcap_read_packet() to report. */
+	if (hdr.incl_len > wtap_max_snaplen_for_encap(wth->file_encap))
+		return false;
+	if (hdr.incl_len > avail - sizeof hdr)
+		return false;
+
+	if (syncing) {
+		/*
+		 * Packet data can look like a record header; use the same
+		 * checks as libpcap_try_record() to tell them apart.
+		 */
+		if (hdr.ts_usec >= (libpcap->variant == PCAP_NSEC ? 1000000000U : 1000000U))
+			return false;
+		if (hdr.incl_len > hdr.orig_len ||
+		    hdr.orig_len > 128*1024*1024)
+			return false;
+	}
+
+	/* As libpcap_read_packet() sets them, with no pseudo-header. */
+	entry->presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
+	entry->ts.secs = hdr.ts_sec;
+	if (libpcap->variant == PCAP_NSEC)
+		entry->ts.nsecs = hdr.ts_usec;
+	else
+		entry->ts.nsecs = hdr.ts_usec * 1000;
+	entry->tsprec = wth->file_tsprec;
+	entry->pkt_encap = wth->file_encap;
+	entry->len = hdr.orig_len;
+	entry->caplen = hdr.incl_len;
+
+	*rec_len = (uint32_t)sizeof hdr + hdr.incl_len;
+	return true;
+}
+
 static bool
 libpcap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
     int *err, char **err_info)
@@ -1414,7 +1481,7 @@ libpcap_read_packet(wtap *wth, FILE_T fh, wtap_rec *rec,
 	/*
 	 * Read the packet data.
 	 */
-	if (!wtap_read_bytes_buffer(fh, &rec->data, rec->rec_header.packet_header.caplen, err, err_info))
+	if (!wtap_read_bytes_buffer_mapped(fh, &rec->data, rec->rec_header.packet_header.caplen, err, err_info))
 		return false;	/* failed */
 
 	pcap_read_post_process(is_nokia, wth->file_encap, rec,
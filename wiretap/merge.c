@@ -303,21 +303,385 @@ merge_select_frame_type(const int file_type, int in_file_count, merge_in_file_t
 }
 
 /*
- * returns true if first argument is earlier than second
+ * Binary min-heap of the input files that currently have a record
+ * available, ordered by the time stamp of that record.
+ *
+ * With a linear scan, picking the next record is O(N) in the number of
+ * input files, which dominates when merging thousands of files (e.g. a
+ * dumpcap ring buffer); with the heap it's O(log N).
+ */
+typedef struct {
+    merge_in_file_t **files;    /* heap array; files[0] is the earliest */
+    unsigned          count;    /* number of files in the heap */
+    unsigned          primed;   /* number of input files read for the first time */
+    GThreadPool      *pool;     /* read-ahead threads, or NULL */
+} merge_heap_t;
+
+/*
+ * Returns true if the record available from l should be written before
+ * the record available from r.
+ *
+ * This has to give the same order as the linear scan it replaced:
+ * records without a time stamp are treated as earlier than all other
+ * records, with the first such file winning, and for equal time stamps
+ * the *last* file wins.
  */
 static bool
-is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
+merge_heap_before(const merge_in_file_t *l, const merge_in_file_t *r)
 {
-    if (l->secs > r->secs) {  /* left is later */
-        return false;
-    } else if (l->secs < r->secs) { /* left is earlier */
-        return true;
-    } else if (l->nsecs > r->nsecs) { /* tv_sec equal, l.usec later */
-        return false;
+    bool l_has_ts = (l->rec.presence_flags & WTAP_HAS_TS) != 0;
+    bool r_has_ts = (r->rec.presence_flags & WTAP_HAS_TS) != 0;
+
+    if (!l_has_ts || !r_has_ts) {
+        if (l_has_ts != r_has_ts)
+            return !l_has_ts;
+        return l < r;
+    }
+
+    if (l->rec.ts.secs != r->rec.ts.secs)
+        return l->rec.ts.secs < r->rec.ts.secs;
+    if (l->rec.ts.nsecs != r->rec.ts.nsecs)
+        return l->rec.ts.nsecs < r->rec.ts.nsecs;
+
+    return l > r;
+}
+
+static void
+merge_heap_sift_up(merge_heap_t *heap, unsigned pos)
+{
+    merge_in_file_t *in_file = heap->files[pos];
+
+    while (pos > 0) {
+        unsigned parent = (pos - 1) / 2;
+
+        if (!merge_heap_before(in_file, heap->files[parent]))
+            break;
+        heap->files[pos] = heap->files[parent];
+        pos = parent;
+    }
+    heap->files[pos] = in_file;
+}
+
+static void
+merge_heap_sift_down(merge_heap_t *heap, unsigned pos)
+{
+    merge_in_file_t *in_file = heap->files[pos];
+
+    for (;;) {
+        unsigned child = 2 * pos + 1;
+
+        if (child >= heap->count)
+            break;
+        if (child + 1 < heap->count &&
+            merge_heap_before(heap->files[child + 1], heap->files[child]))
+            child++;
+        if (!merge_heap_before(heap->files[child], in_file))
+            break;
+        heap->files[pos] = heap->files[child];
+        pos = child;
+    }
+    heap->files[pos] = in_file;
+}
+
+static void
+merge_heap_push(merge_heap_t *heap, merge_in_file_t *in_file)
+{
+    heap->files[heap->count] = in_file;
+    merge_heap_sift_up(heap, heap->count++);
+}
+
+/* Removes the earliest file from the heap. */
+static void
+merge_heap_pop(merge_heap_t *heap)
+{
+    ws_assert(heap->count > 0);
+
+    heap->count--;
+    if (heap->count > 0) {
+        heap->files[0] = heap->files[heap->count];
+        merge_heap_sift_down(heap, 0);
     }
-    /* either one < two or one == two
-     * either way, return one
+}
+
+/*
+ * Read-ahead of input files.
+ *
+ * Reading a record, especially from a gzip/zstd/lz4 compressed file, can
+ * cost more than everything else the merge loop does with it.  When there
+ * is more than one input file and more than one processor, the records of
+ * each input file are read on a thread pool into a small bounded queue,
+ * and the merge loop just takes them off the front of the queue.
+ *
+ * The merge loop also looks at blocks that the reader attaches to the
+ * wtap (IDBs, NRBs, DSBs, and the SHB interface mapping).  Those are only
+ * accessed with wth_lock held, and each queued record remembers how many
+ * IDBs, NRBs and DSBs had been read along with it, so that the merge loop
+ * sees exactly what it would have seen had it read the file itself, no
+ * matter how far ahead the reader has got.
+ *
+ * Each queue holds up to MERGE_PREFETCH_DEPTH records, fewer when there
+ * are so many input files that all the queues together would hold more
+ * than MERGE_PREFETCH_TOTAL.  Appending files reads them one after the
+ * other, so there's nothing to read ahead in parallel then.
+ */
+#define MERGE_PREFETCH_DEPTH     16
+#define MERGE_PREFETCH_MIN_DEPTH 2
+#define MERGE_PREFETCH_TOTAL     1024
+
+typedef struct {
+    wtap_rec        rec;
+    in_file_state_e state;      /* RECORD_PRESENT, AT_EOF or GOT_ERROR */
+    int             err;
+    char           *err_info;
+    unsigned        idbs;       /* IDBs read so far, including this record's */
+    unsigned        nrbs;       /* NRBs read so far */
+    unsigned        dsbs;       /* DSBs read so far */
+} merge_prefetch_slot_t;
+
+struct merge_prefetch_s {
+    merge_in_file_t *in_file;
+    GMutex           wth_lock;   /* protects in_file->wth */
+    GMutex           lock;       /* protects the fields below */
+    GCond            cond;       /* signalled when a slot is filled */
+    merge_prefetch_slot_t *slots;
+    unsigned         depth;      /* number of slots */
+    unsigned         head;       /* first filled slot */
+    unsigned         count;      /* number of filled slots */
+    bool             scheduled;  /* pushed to, or running in, the thread pool */
+    bool             done;       /* reader got EOF or an error */
+    bool             stop;       /* merge is finishing; stop reading */
+    /* Owned by the merge thread; copied from the last slot consumed. */
+    unsigned         idbs_visible;
+    unsigned         nrbs_visible;
+    unsigned         dsbs_visible;
+};
+
+static void
+merge_prefetch_lock_wth(merge_prefetch_t *prefetch)
+{
+    if (prefetch)
+        g_mutex_lock(&prefetch->wth_lock);
+}
+
+static void
+merge_prefetch_unlock_wth(merge_prefetch_t *prefetch)
+{
+    if (prefetch)
+        g_mutex_unlock(&prefetch->wth_lock);
+}
+
+/* Thread pool function; fills the queue of one input file. */
+static void
+merge_prefetch_worker(void *data, void *user_data _U_)
+{
+    merge_prefetch_t *prefetch = (merge_prefetch_t *)data;
+    wtap *wth = prefetch->in_file->wth;
+    merge_prefetch_slot_t *slot;
+    int64_t data_offset;
+    bool got_record;
+
+    for (;;) {
+        g_mutex_lock(&prefetch->lock);
+        if (prefetch->stop || prefetch->count == prefetch->depth) {
+            prefetch->scheduled = false;
+            g_mutex_unlock(&prefetch->lock);
+            return;
+        }
+        /* The merge thread doesn't touch this slot until count covers it. */
+        slot = &prefetch->slots[(prefetch->head + prefetch->count) % prefetch->depth];
+        g_mutex_unlock(&prefetch->lock);
+
+        wtap_rec_reset(&slot->rec);
+        slot->err = 0;
+        slot->err_info = NULL;
+
+        g_mutex_lock(&prefetch->wth_lock);
+        got_record = wtap_read(wth, &slot->rec, &slot->err, &slot->err_info,
+                               &data_offset);
+        slot->idbs = wth->interface_data->len;
+        slot->nrbs = wth->nrbs ? wth->nrbs->len : 0;
+        slot->dsbs = wth->dsbs ? wth->dsbs->len : 0;
+        g_mutex_unlock(&prefetch->wth_lock);
+
+        if (got_record)
+            slot->state = RECORD_PRESENT;
+        else
+            slot->state = (slot->err != 0) ? GOT_ERROR : AT_EOF;
+
+        g_mutex_lock(&prefetch->lock);
+        prefetch->count++;
+        g_cond_signal(&prefetch->cond);
+        if (!got_record) {
+            prefetch->done = true;
+            prefetch->scheduled = false;
+            g_mutex_unlock(&prefetch->lock);
+            return;
+        }
+        g_mutex_unlock(&prefetch->lock);
+    }
+}
+
+/*
+ * Start reading ahead on all the input files, if that's worth doing.
+ *
+ * Returns the thread pool doing the reading, or NULL if the input files
+ * will be read by the merge thread.
+ */
+static GThreadPool *
+merge_prefetch_start(merge_in_file_t *in_files, const unsigned in_file_count)
+{
+    GThreadPool *pool;
+    unsigned max_threads = g_get_num_processors();
+    unsigned depth;
+    unsigned i, j;
+
+    if (in_file_count < 2 || max_threads < 2)
+        return NULL;
+
+    depth = MERGE_PREFETCH_TOTAL / in_file_count;
+    depth = MIN(MAX(depth, MERGE_PREFETCH_MIN_DEPTH), MERGE_PREFETCH_DEPTH);
+
+    pool = g_thread_pool_new(merge_prefetch_worker, NULL,
+                             (int)MIN(max_threads, in_file_count), false, NULL);
+    if (pool == NULL)
+        return NULL;
+
+    for (i = 0; i < in_file_count; i++) {
+        merge_prefetch_t *prefetch = g_new0(merge_prefetch_t, 1);
+
+        prefetch->in_file = &in_files[i];
+        g_mutex_init(&prefetch->wth_lock);
+        g_mutex_init(&prefetch->lock);
+        g_cond_init(&prefetch->cond);
+        prefetch->depth = depth;
+        prefetch->slots = g_new0(merge_prefetch_slot_t, depth);
+        for (j = 0; j < depth; j++)
+            wtap_rec_init(&prefetch->slots[j].rec, DEFAULT_INIT_BUFFER_SIZE_2048);
+        /* Blocks read when the file was opened are visible from the start. */
+        prefetch->idbs_visible = in_files[i].wth->interface_data->len;
+        prefetch->nrbs_visible = in_files[i].wth->nrbs ? in_files[i].wth->nrbs->len : 0;
+        prefetch->dsbs_visible = in_files[i].wth->dsbs ? in_files[i].wth->dsbs->len : 0;
+        prefetch->scheduled = true;
+        in_files[i].prefetch = prefetch;
+    }
+
+    for (i = 0; i < in_file_count; i++)
+        g_thread_pool_push(pool, in_files[i].prefetch, NULL);
+
+    return pool;
+}
+
+/*
+ * Stop reading ahead, wait for the readers to finish, and discard any
+ * records that were read but not merged.
+ */
+static void
+merge_prefetch_stop(GThreadPool *pool, merge_in_file_t *in_files, const unsigned in_file_count)
+{
+    unsigned i, j;
+
+    if (pool == NULL)
+        return;
+
+    for (i = 0; i < in_file_count; i++) {
+        g_mutex_lock(&in_files[i].prefetch->lock);
+        in_files[i].prefetch->stop = true;
+        g_mutex_unlock(&in_files[i].prefetch->lock);
+    }
+
+    /* Drop queued tasks, and wait for running ones to notice "stop". */
+    g_thread_pool_free(pool, true, true);
+
+    for (i = 0; i < in_file_count; i++) {
+        merge_prefetch_t *prefetch = in_files[i].prefetch;
+
+        for (j = 0; j < prefetch->count; j++)
+            g_free(prefetch->slots[(prefetch->head + j) % prefetch->depth].err_info);
+        for (j = 0; j < prefetch->depth; j++)
+            wtap_rec_cleanup(&prefetch->slots[j].rec);
+        g_free(prefetch->slots);
+        g_cond_clear(&prefetch->cond);
+        g_mutex_clear(&prefetch->lock);
+        g_mutex_clear(&prefetch->wth_lock);
+        g_free(prefetch);
+        in_files[i].prefetch = NULL;
+    }
+}
+
+/* Take the next record of an input file off its read-ahead queue. */
+static bool
+merge_prefetch_next_record(GThreadPool *pool, merge_in_file_t *in_file,
+                           int *err, char **err_info)
+{
+    merge_prefetch_t *prefetch = in_file->prefetch;
+    merge_prefetch_slot_t *slot;
+    wtap_rec tmp_rec;
+
+    g_mutex_lock(&prefetch->lock);
+    while (prefetch->count == 0) {
+        if (prefetch->done) {
+            /* We've already handed back the EOF or error. */
+            g_mutex_unlock(&prefetch->lock);
+            in_file->state = AT_EOF;
+            *err = 0;
+            return false;
+        }
+        if (!prefetch->scheduled) {
+            prefetch->scheduled = true;
+            g_thread_pool_push(pool, prefetch, NULL);
+        }
+        g_cond_wait(&prefetch->cond, &prefetch->lock);
+    }
+    slot = &prefetch->slots[prefetch->head];
+    prefetch->head = (prefetch->head + 1) % prefetch->depth;
+    prefetch->count--;
+
+    /*
+     * Swap rather than copy; the record we hand back to the slot has
+     * already been written (or discarded) by the merge loop.
      */
+    tmp_rec = in_file->rec;
+    in_file->rec = slot->rec;
+    slot->rec = tmp_rec;
+
+    in_file->state = slot->state;
+    *err = slot->err;
+    *err_info = slot->err_info;
+    slot->err_info = NULL;
+    prefetch->idbs_visible = slot->idbs;
+    prefetch->nrbs_visible = slot->nrbs;
+    prefetch->dsbs_visible = slot->dsbs;
+
+    /* Top up the queue once it's half empty. */
+    if (!prefetch->scheduled && !prefetch->done &&
+        prefetch->count <= prefetch->depth / 2) {
+        prefetch->scheduled = true;
+        g_thread_pool_push(pool, prefetch, NULL);
+    }
+    g_mutex_unlock(&prefetch->lock);
+
+    return in_file->state == RECORD_PRESENT;
+}
+
+/*
+ * Read the next record from an input file, updating its state.
+ *
+ * Returns true if a record was read, false on EOF or error.
+ */
+static bool
+merge_read_next_record(GThreadPool *pool, merge_in_file_t *in_file,
+                       int *err, char **err_info)
+{
+    int64_t data_offset;
+
+    if (in_file->prefetch != NULL)
+        return merge_prefetch_next_record(pool, in_file, err, err_info);
+
+    if (!wtap_read(in_file->wth, &in_file->rec, err, err_info, &data_offset)) {
+        in_file->state = (*err != 0) ? GOT_ERROR : AT_EOF;
+        return false;
+    }
+    in_file->state = RECORD_PRESENT;
     return true;
 }
 
@@ -333,6 +697,7 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
+ * @param heap heap of input files with a record available
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
  * @param err wiretap error, if failed
@@ -342,79 +707,58 @@ is_earlier(nstime_t *l, nstime_t *r) /* XXX, move to nstime.c */
  * all files
  */
 static merge_in_file_t *
-merge_read_packet(int in_file_count, merge_in_file_t in_files[],
-                  int *err, char **err_info)
+merge_read_packet(merge_heap_t *heap, unsigned in_file_count,
+                  merge_in_file_t in_files[], int *err, char **err_info)
 {
-    int i;
-    int ei = -1;
-    nstime_t tv = NSTIME_INIT_MAX;
-    wtap_rec *rec;
+    merge_in_file_t *in_file;
 
     /*
      * Make sure we have a record available from each file that's not at
-     * EOF, and search for the record with the earliest time stamp or
-     * with no time stamp (those records are treated as earlier than
-     * all other records).  Yes, this means you won't get a chronological
-     * merge of those records, but you obviously *can't* get that.
+     * EOF.  The first time through, that means reading a record from
+     * every file; after that, only the file whose record we returned
+     * last time needs a new one.
      */
-    for (i = 0; i < in_file_count; i++) {
-        int64_t data_offset;
-
-        if (in_files[i].state == RECORD_NOT_PRESENT) {
-            /*
-             * No packet available, and we haven't seen an error or EOF yet,
-             * so try to read the next packet.
-             */
-            if (!wtap_read(in_files[i].wth, &in_files[i].rec, err, err_info,
-                           &data_offset)) {
-                if (*err != 0) {
-                    in_files[i].state = GOT_ERROR;
-                    return &in_files[i];
-                }
-                in_files[i].state = AT_EOF;
-            } else
-                in_files[i].state = RECORD_PRESENT;
+    while (heap->primed < in_file_count) {
+        in_file = &in_files[heap->primed++];
+        if (merge_read_next_record(heap->pool, in_file, err, err_info)) {
+            merge_heap_push(heap, in_file);
+        } else if (in_file->state == GOT_ERROR) {
+            return in_file;
         }
+    }
 
-        if (in_files[i].state == RECORD_PRESENT) {
-            rec = &in_files[i].rec;
-            if (!(rec->presence_flags & WTAP_HAS_TS)) {
-                /*
-                 * No time stamp.  Pick this record, and stop looking.
-                 */
-                ei = i;
-                break;
-            }
-            if (is_earlier(&rec->ts, &tv)) {
-                /*
-                 * This record's time stamp is earlier than any of the
-                 * records we've seen so far.  Pick it, for now, but
-                 * keep looking.
-                 */
-                tv = rec->ts;
-                ei = i;
-            }
+    if (heap->count > 0 && heap->files[0]->state == RECORD_NOT_PRESENT) {
+        in_file = heap->files[0];
+        if (merge_read_next_record(heap->pool, in_file, err, err_info)) {
+            merge_heap_sift_down(heap, 0);
+        } else {
+            /* EOF or error; either way, no more records from this file. */
+            merge_heap_pop(heap);
+            if (in_file->state == GOT_ERROR)
+                return in_file;
         }
     }
 
-    if (ei == -1) {
+    if (heap->count == 0) {
         /* All the streams are at EOF.  Return an EOF indication. */
         *err = 0;
         return NULL;
     }
 
+    in_file = heap->files[0];
+
     /* We'll need to read another packet from this file. */
-    in_files[ei].state = RECORD_NOT_PRESENT;
+    in_file->state = RECORD_NOT_PRESENT;
 
     /* Count this packet. */
-    in_files[ei].packet_num++;
+    in_file->packet_num++;
 
     /*
      * Return a pointer to the merge_in_file_t of the file from which the
      * packet was read.
      */
     *err = 0;
-    return &in_files[ei];
+    return in_file;
 }
 
 /** Read the next packet, in file sequence order, from the set of files
@@ -429,6 +773,7 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  * On an EOF (meaning all the files are at EOF), set *err to 0 and return
  * NULL.
  *
+ * @param pool read-ahead thread pool, or NULL
  * @param in_file_count number of entries in in_files
  * @param in_files input file array
  * @param err wiretap error, if failed
@@ -438,11 +783,10 @@ merge_read_packet(int in_file_count, merge_in_file_t in_files[],
  * all files
  */
 static merge_in_file_t *
-merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
+merge_append_read_packet(GThreadPool *pool, int in_file_count, merge_in_file_t in_files[],
                          int *err, char **err_info)
 {
     int i;
-    int64_t data_offset;
 
     /*
      * Find the first file not at EOF, and read the next packet from it.
@@ -450,16 +794,13 @@ merge_append_read_packet(int in_file_count, merge_in_file_t in_files[],
     for (i = 0; i < in_file_count; i++) {
         if (in_files[i].state == AT_EOF)
             continue; /* This file is already at EOF */
-        if (wtap_read(in_files[i].wth, &in_files[i].rec, err, err_info,
-                      &data_offset))
+        if (merge_read_next_record(pool, &in_files[i], err, err_info))
             break; /* We have a packet */
         if (*err != 0) {
             /* Read error - quit immediately. */
-            in_files[i].state = GOT_ERROR;
             return &in_files[i];
         }
-        /* EOF - flag this file as being at EOF, and try the next one. */
-        in_files[i].state = AT_EOF;
+        /* EOF - merge_read_next_record() flagged this file as being at EOF, try the next one. */
     }
     if (i == in_file_count) {
         /* All the streams are at EOF.  Return an EOF indication. */
@@ -857,9 +1198,22 @@ process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_
 {
     wtap_block_t                 input_file_idb;
     unsigned                     itf_count, merged_index;
+    unsigned                     idbs_visible;
     unsigned                     i;
 
     for (i = 0; i < in_file_count; i++) {
+        merge_prefetch_t *prefetch = in_files[i].prefetch;
+
+        /*
+         * If the file is being read ahead, only look at the IDBs read
+         * before the record we're about to write, and don't bother
+         * taking the lock if there aren't any new ones.
+         */
+        idbs_visible = prefetch ? prefetch->idbs_visible : UINT_MAX;
+        if (in_files[i].wth->next_interface_data >= idbs_visible)
+            continue;
+
+        merge_prefetch_lock_wth(prefetch);
 
         /*
          * The number below is the global interface number within wth,
@@ -867,7 +1221,8 @@ process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_
          * in map_rec_interface_id().
          */
         itf_count = in_files[i].wth->next_interface_data;
-        while ((input_file_idb = wtap_get_next_interface_description(in_files[i].wth)) != NULL) {
+        while (itf_count < idbs_visible &&
+               (input_file_idb = wtap_get_next_interface_description(in_files[i].wth)) != NULL) {
 
             /* If we were initially in ALL mode and all the interfaces
              * did match, then we set the mode to ANY (merge duplicates).
@@ -902,11 +1257,14 @@ process_new_idbs(wtap_dumper *pdh, merge_in_file_t *in_files, const unsigned in_
                     merged_index = merged_idb_list->interface_data->len - 1;
                     add_idb_index_map(&in_files[i], itf_count, merged_index);
                 } else {
+                    merge_prefetch_unlock_wth(prefetch);
                     return false;
                 }
             }
             itf_count = in_files[i].wth->next_interface_data;
         }
+
+        merge_prefetch_unlock_wth(prefetch);
     }
 
     return true;
@@ -1001,7 +1359,9 @@ map_rec_interface_id(wtap_rec *rec, const merge_in_file_t *in_file)
 
     if (rec->presence_flags & WTAP_HAS_INTERFACE_ID) {
         unsigned section_num = (rec->presence_flags & WTAP_HAS_SECTION_NUMBER) ? rec->section_number : 0;
+        merge_prefetch_lock_wth(in_file->prefetch);
         current_interface_id = wtap_file_get_shb_global_interface_id(in_file->wth, section_num, rec->rec_header.packet_header.interface_id);
+        merge_prefetch_unlock_wth(in_file->prefetch);
     }
 
     if (current_interface_id >= in_file->idb_index_map->len) {
@@ -1043,18 +1403,27 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
 {
     merge_result        status = MERGE_OK;
     merge_in_file_t    *in_file;
+    merge_heap_t        heap = { 0 };
+    GThreadPool        *prefetch_pool;
     int                 count = 0;
     bool                stop_flag = false;
 
+    prefetch_pool = do_append ? NULL : merge_prefetch_start(in_files, in_file_count);
+
+    if (!do_append) {
+        heap.files = g_new(merge_in_file_t *, in_file_count);
+        heap.pool = prefetch_pool;
+    }
+
     for (;;) {
         *err = 0;
 
         if (do_append) {
-            in_file = merge_append_read_packet(in_file_count, in_files, err,
+            in_file = merge_append_read_packet(prefetch_pool, in_file_count, in_files, err,
                                                err_info);
         }
         else {
-            in_file = merge_read_packet(in_file_count, in_files, err,
+            in_file = merge_read_packet(&heap, in_file_count, in_files, err,
                                         err_info);
         }
 
@@ -1137,21 +1506,29 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
          * If any DSBs were read before this record, be sure to pass those now
          * such that wtap_dump can pick it up.
          */
-        if (nrb_combined && in_file->wth->nrbs) {
+        if (nrb_combined && (in_file->prefetch == NULL ||
+                             in_file->nrbs_seen < in_file->prefetch->nrbs_visible)) {
+            merge_prefetch_lock_wth(in_file->prefetch);
             GArray *in_nrb = in_file->wth->nrbs;
-            for (unsigned i = in_file->nrbs_seen; i < in_nrb->len; i++) {
+            unsigned nrbs_visible = in_file->prefetch ? in_file->prefetch->nrbs_visible : UINT_MAX;
+            for (unsigned i = in_file->nrbs_seen; in_nrb && i < in_nrb->len && i < nrbs_visible; i++) {
                 wtap_block_t wblock = g_array_index(in_nrb, wtap_block_t, i);
                 g_array_append_val(nrb_combined, wblock);
                 in_file->nrbs_seen++;
             }
+            merge_prefetch_unlock_wth(in_file->prefetch);
         }
-        if (dsb_combined && in_file->wth->dsbs) {
+        if (dsb_combined && (in_file->prefetch == NULL ||
+                             in_file->dsbs_seen < in_file->prefetch->dsbs_visible)) {
+            merge_prefetch_lock_wth(in_file->prefetch);
             GArray *in_dsb = in_file->wth->dsbs;
-            for (unsigned i = in_file->dsbs_seen; i < in_dsb->len; i++) {
+            unsigned dsbs_visible = in_file->prefetch ? in_file->prefetch->dsbs_visible : UINT_MAX;
+            for (unsigned i = in_file->dsbs_seen; in_dsb && i < in_dsb->len && i < dsbs_visible; i++) {
                 wtap_block_t wblock = g_array_index(in_dsb, wtap_block_t, i);
                 g_array_append_val(dsb_combined, wblock);
                 in_file->dsbs_seen++;
             }
+            merge_prefetch_unlock_wth(in_file->prefetch);
         }
 
         if (!wtap_dump(pdh, &in_file->rec, err, err_info)) {
@@ -1161,6 +1538,14 @@ merge_process_packets(wtap_dumper *pdh, const int file_type,
         wtap_rec_reset(&in_file->rec);
     }
 
+    g_free(heap.files);
+
+    /*
+     * Stop reading ahead. Anything the readers got past the last record
+     * we wrote is now visible, as it would be after reading to EOF.
+     */
+    merge_prefetch_stop(prefetch_pool, in_files, in_file_count);
+
     if (cb)
         cb->callback_func(MERGE_EVENT_DONE, count, in_files, in_file_count, cb->data);
 
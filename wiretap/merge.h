@@ -30,6 +30,9 @@ typedef enum {
 } in_file_state_e;
 
 
+/** Opaque read-ahead state of an input file; private to merge.c. */
+typedef struct merge_prefetch_s merge_prefetch_t;
+
 /**
  * @brief Structure to manage input files during merge.
  *
@@ -45,6 +48,7 @@ typedef struct merge_in_file_s {
     GArray         *idb_index_map;   /**< Maps legacy phdr interface_id to new IDs during merge. */
     unsigned        nrbs_seen;       /**< Count of processed elements from wth->nrbs. */
     unsigned        dsbs_seen;       /**< Count of processed elements from wth->dsbs. */
+    merge_prefetch_t *prefetch;      /**< Read-ahead state, if records are read on a worker thread. */
 } merge_in_file_t;
 
 /**
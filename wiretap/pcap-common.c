@@ -2040,6 +2040,7 @@ pcap_byteswap_linux_sll_pseudoheader(wtap_rec *rec)
 	unsigned packet_size;
 	uint16_t protocol;
 
+	ws_buffer_own(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2071,6 +2072,7 @@ pcap_byteswap_linux_sll2_pseudoheader(wtap_rec *rec)
 	unsigned packet_size;
 	uint16_t protocol;
 
+	ws_buffer_own(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2104,6 +2106,7 @@ pcap_byteswap_linux_usb_pseudoheader(wtap_rec *rec, bool header_len_64_bytes)
 	struct linux_usb_isodesc *pisodesc;
 	int32_t iso_numdesc, i;
 
+	ws_buffer_own(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2201,6 +2204,7 @@ pcap_byteswap_nflog_pseudoheader(wtap_rec *rec)
 	struct nflog_tlv *tlv;
 	unsigned size;
 
+	ws_buffer_own(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2286,6 +2290,7 @@ pcap_byteswap_pflog_pseudoheader(wtap_rec *rec)
 	unsigned packet_size;
 	struct pfloghdr *pflhdr;
 
+	ws_buffer_own(&rec->data);
 	pd = ws_buffer_start_ptr(&rec->data);
 
 	/*
@@ -2733,6 +2738,30 @@ wtap_encap_requires_phdr(int wtap_encap)
 	return false;
 }
 
+bool
+pcap_record_lengths_in_header(int wtap_encap)
+{
+	switch (wtap_encap) {
+
+	/* Encapsulations with a pseudo-header in the packet data. */
+	case WTAP_ENCAP_ATM_PDUS:
+	case WTAP_ENCAP_IRDA:
+	case WTAP_ENCAP_MTP2_WITH_PHDR:
+	case WTAP_ENCAP_LINUX_LAPD:
+	case WTAP_ENCAP_SITA:
+	case WTAP_ENCAP_BLUETOOTH_H4_WITH_PHDR:
+	case WTAP_ENCAP_BLUETOOTH_LINUX_MONITOR:
+	case WTAP_ENCAP_NFC_LLCP:
+	case WTAP_ENCAP_PPP_WITH_PHDR:
+	case WTAP_ENCAP_ERF:
+	case WTAP_ENCAP_I2C_LINUX:
+	/* pcap_fixup_len() may change the length. */
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+		return false;
+	}
+	return true;
+}
+
 unsigned
 pcap_get_phdr_size(int encap, const union wtap_pseudo_header *pseudo_header)
 {
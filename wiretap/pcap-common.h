@@ -64,6 +64,20 @@ extern int pcap_process_pseudo_header(FILE_T fh, bool is_nokia,
 extern void pcap_read_post_process(bool is_nokia, int wtap_encap,
     wtap_rec *rec, bool bytes_swapped, int fcs_len);
 
+/**
+ * @brief Checks whether the lengths of a pcap or pcapng packet record are
+ * the ones in its record header.
+ *
+ * They aren't if a pseudo-header is taken off the front of the packet data,
+ * or if pcap_read_post_process() fixes up the length; in those cases the
+ * data has to be read to know them.
+ *
+ * @param wtap_encap   Wiretap encapsulation type of the packet, in a file
+ *                     that isn't a Nokia-variant pcap file.
+ * @return             @c true if the lengths are the ones in the header.
+ */
+extern bool pcap_record_lengths_in_header(int wtap_encap);
+
 /**
  * @brief Retrieves the size of the pseudo-header for a given encapsulation type and pseudo-header.
  *
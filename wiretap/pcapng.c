@@ -52,6 +52,9 @@ pcapng_seek_read(wtap *wth, int64_t seek_off,
                  wtap_rec *rec, int *err, char **err_info);
 static void
 pcapng_close(wtap *wth);
+static bool
+pcapng_scan_record(wtap *wth, const uint8_t *data, size_t avail,
+                   bool syncing, uint32_t *rec_len, wtap_scan_entry *entry);
 
 static bool
 pcapng_encap_is_ft_specific(int encap);
@@ -2022,6 +2025,62 @@ pcapng_process_packet_block_option(wtapng_block_t *wblock,
     return true;
 }
 
+/*
+ * Convert a packet time stamp, in the units of the packet's interface, to
+ * seconds and nanoseconds.
+ */
+static void
+pcapng_convert_timestamp(const interface_info_t *iface_info, uint32_t ts_high,
+                         uint32_t ts_low, nstime_t *nstime)
+{
+    uint64_t ts;
+
+    /* Combine the two 32-bit pieces of the timestamp into one 64-bit value */
+    ts = (((uint64_t)ts_high) << 32) | ((uint64_t)ts_low);
+
+    /* Convert it to seconds and nanoseconds. */
+    nstime->secs = (time_t)(ts / iface_info->time_units_per_second);
+    /* This can overflow if iface_info->time_units_per_seconds > (2^64 - 1) / 10^9;
+     * log10((2^64 - 1) / 10^9) ~ 10.266 and log2((2^64 - 1) / 10^9) ~ 32.103,
+     * so that's if the power of 10 exponent is greater than 10 or the power of 2
+     * exponent is greater than 32.
+     *
+     * We could test for and use 128 bit integers and platforms and compilers
+     * that have it (C23, and gcc, clang, and ICC on most 64-bit platforms).
+     * For C23, if we include <limits.h> and BITINT_MAXWIDTH is defined to be
+     * at least 128 (or even just 96) we could use unsigned _BitInt(128).
+     * If __SIZEOF_INT128__ is defined we can use unsigned __int128. Some
+     * testing (including with godbolt.org) suggests it's faster to check
+     * overflow and handle our two special cases.
+     */
+    uint64_t ts_frac = ts % iface_info->time_units_per_second;
+    uint64_t ts_ns;
+    if (ckd_mul(&ts_ns, ts_frac, NS_PER_S)) {
+        /* We have 10^N where N > 10 or 2^N where N > 32. */
+        if (!iface_info->tsresol_binary) {
+            /* 10^N where N > 10, so this divides evenly. */
+            ws_assert(iface_info->time_units_per_second > NS_PER_S);
+            nstime->nsecs = (int)(ts_frac / (iface_info->time_units_per_second / NS_PER_S));
+        } else {
+            /* Multiplying a 64 bit integer by a 32 bit integer, then dividing
+             * by 2^N, where N > 32. */
+            uint64_t ts_frac_low = (ts_frac & 0xFFFFFFFF) * NS_PER_S;
+            uint64_t ts_frac_high = (ts_frac >> 32) * NS_PER_S;
+            // Add the carry.
+            ts_frac_high += ts_frac_low >> 32;
+            //ts_frac_low &= 0xFFFFFFFF;
+            ws_assert(iface_info->tsresol_binary > 32);
+            uint8_t high_shift = iface_info->tsresol_binary - 32;
+            nstime->nsecs = (int)(ts_frac_high >> high_shift);
+        }
+    } else {
+        nstime->nsecs = (int)(ts_ns / iface_info->time_units_per_second);
+    }
+
+    /* Add the time stamp offset. */
+    nstime->secs = (time_t)(nstime->secs + iface_info->tsoffset);
+}
+
 static bool
 pcapng_read_packet_block(wtap *wth _U_, FILE_T fh, uint32_t block_type,
                          uint32_t block_content_length,
@@ -2038,7 +2097,6 @@ pcapng_read_packet_block(wtap *wth _U_, FILE_T fh, uint32_t block_type,
     uint32_t flags;
     uint64_t tmp64;
     interface_info_t iface_info;
-    uint64_t ts;
     int pseudo_header_len;
     int fcslen;
     bool enhanced = (block_type == BLOCK_TYPE_EPB);
@@ -2215,54 +2273,12 @@ pcapng_read_packet_block(wtap *wth _U_, FILE_T fh, uint32_t block_type,
         wblock->rec->rec_header.packet_header.len = 0;
     }
 
-    /* Combine the two 32-bit pieces of the timestamp into one 64-bit value */
-    ts = (((uint64_t)packet.ts_high) << 32) | ((uint64_t)packet.ts_low);
-
-    /* Convert it to seconds and nanoseconds. */
-    wblock->rec->ts.secs = (time_t)(ts / iface_info.time_units_per_second);
-    /* This can overflow if iface_info.time_units_per_seconds > (2^64 - 1) / 10^9;
-     * log10((2^64 - 1) / 10^9) ~ 10.266 and log2((2^64 - 1) / 10^9) ~ 32.103,
-     * so that's if the power of 10 exponent is greater than 10 or the power of 2
-     * exponent is greater than 32.
-     *
-     * We could test for and use 128 bit integers and platforms and compilers
-     * that have it (C23, and gcc, clang, and ICC on most 64-bit platforms).
-     * For C23, if we include <limits.h> and BITINT_MAXWIDTH is defined to be
-     * at least 128 (or even just 96) we could use unsigned _BitInt(128).
-     * If __SIZEOF_INT128__ is defined we can use unsigned __int128. Some
-     * testing (including with godbolt.org) suggests it's faster to check
-     * overflow and handle our two special cases.
-     */
-    uint64_t ts_frac = ts % iface_info.time_units_per_second;
-    uint64_t ts_ns;
-    if (ckd_mul(&ts_ns, ts_frac, NS_PER_S)) {
-        /* We have 10^N where N > 10 or 2^N where N > 32. */
-        if (!iface_info.tsresol_binary) {
-            /* 10^N where N > 10, so this divides evenly. */
-            ws_assert(iface_info.time_units_per_second > NS_PER_S);
-            wblock->rec->ts.nsecs = (int)(ts_frac / (iface_info.time_units_per_second / NS_PER_S));
-        } else {
-            /* Multiplying a 64 bit integer by a 32 bit integer, then dividing
-             * by 2^N, where N > 32. */
-            uint64_t ts_frac_low = (ts_frac & 0xFFFFFFFF) * NS_PER_S;
-            uint64_t ts_frac_high = (ts_frac >> 32) * NS_PER_S;
-            // Add the carry.
-            ts_frac_high += ts_frac_low >> 32;
-            //ts_frac_low &= 0xFFFFFFFF;
-            ws_assert(iface_info.tsresol_binary > 32);
-            uint8_t high_shift = iface_info.tsresol_binary - 32;
-            wblock->rec->ts.nsecs = (int)(ts_frac_high >> high_shift);
-        }
-    } else {
-        wblock->rec->ts.nsecs = (int)(ts_ns / iface_info.time_units_per_second);
-    }
-
-    /* Add the time stamp offset. */
-    wblock->rec->ts.secs = (time_t)(wblock->rec->ts.secs + iface_info.tsoffset);
+    pcapng_convert_timestamp(&iface_info, packet.ts_high, packet.ts_low,
+                             &wblock->rec->ts);
 
     /* "(Enhanced) Packet Block" read capture data */
-    if (!wtap_read_bytes_buffer(fh, &wblock->rec->data,
-                                packet.cap_len - pseudo_header_len, err, err_info))
+    if (!wtap_read_bytes_buffer_mapped(fh, &wblock->rec->data,
+                                       packet.cap_len - pseudo_header_len, err, err_info))
         return false;
     block_read += packet.cap_len - pseudo_header_len;
 
@@ -2449,8 +2465,8 @@ pcapng_read_simple_packet_block(wtap *wth _U_, FILE_T fh,
     }
 
     /* "Simple Packet Block" read capture data */
-    if (!wtap_read_bytes_buffer(fh, &wblock->rec->data,
-                                simple_packet.cap_len - pseudo_header_len, err, err_info))
+    if (!wtap_read_bytes_buffer_mapped(fh, &wblock->rec->data,
+                                       simple_packet.cap_len - pseudo_header_len, err, err_info))
         return false;
 
     /* jump over potential padding bytes at end of the packet data */
@@ -3683,6 +3699,7 @@ pcapng_open(wtap *wth, int *err, char **err_info)
     wth->subtype_read = pcapng_read;
     wth->subtype_seek_read = pcapng_seek_read;
     wth->subtype_close = pcapng_close;
+    wth->subtype_scan_record = pcapng_scan_record;
     wth->file_type_subtype = pcapng_file_type_subtype;
 
     /* Always initialize the lists of Decryption Secret Blocks, Name
@@ -3913,6 +3930,119 @@ pcapng_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
     return true;
 }
 
+/*
+ * Check whether a packet block of the current section starts at data, and
+ * get the header pcapng_read() would give its record, without reading it.
+ *
+ * Every other block type can change the state used to read the packets
+ * that follow it, so those are left to pcapng_read(), as are packets with
+ * options, which might carry comments or drop counts, packets with a
+ * pseudo-header, and the obsolete Packet Block, which has a drop count.
+ */
+static bool
+pcapng_scan_record(wtap *wth, const uint8_t *data, size_t avail,
+                   bool syncing, uint32_t *rec_len, wtap_scan_entry *entry)
+{
+    pcapng_t *pcapng = (pcapng_t *)wth->priv;
+    section_info_t *section_info;
+    const interface_info_t *iface_info;
+    pcapng_block_header_t bh;
+    pcapng_enhanced_packet_block_t epb;
+    pcapng_simple_packet_block_t spb;
+    uint32_t trailer;
+
+    section_info = &g_array_index(pcapng->sections, section_info_t,
+                                  pcapng->current_section_number);
+
+    if (avail < MIN_BLOCK_SIZE)
+        return false;
+    memcpy(&bh, data, sizeof bh);
+    if (section_info->byte_swapped) {
+        bh.block_type = GUINT32_SWAP_LE_BE(bh.block_type);
+        bh.block_total_length = GUINT32_SWAP_LE_BE(bh.block_total_length);
+    }
+
+    if (bh.block_total_length < MIN_BLOCK_SIZE ||
+        bh.block_total_length > MAX_BLOCK_SIZE ||
+        bh.block_total_length % 4 != 0 ||
+        bh.block_total_length > avail)
+        return false;
+
+    /* The trailing length has to match; that's what makes this reliable. */
+    memcpy(&trailer, data + bh.block_total_length - sizeof trailer, sizeof trailer);
+    if (section_info->byte_swapped)
+        trailer = GUINT32_SWAP_LE_BE(trailer);
+    if (trailer != bh.block_total_length)
+        return false;
+
+    switch (bh.block_type) {
+
+    case BLOCK_TYPE_EPB:
+        if (bh.block_total_length < MIN_EPB_SIZE)
+            return false;
+        memcpy(&epb, data + sizeof bh, sizeof epb);
+        if (section_info->byte_swapped) {
+            epb.interface_id = GUINT32_SWAP_LE_BE(epb.interface_id);
+            epb.timestamp_high = GUINT32_SWAP_LE_BE(epb.timestamp_high);
+            epb.timestamp_low = GUINT32_SWAP_LE_BE(epb.timestamp_low);
+            epb.captured_len = GUINT32_SWAP_LE_BE(epb.captured_len);
+            epb.packet_len = GUINT32_SWAP_LE_BE(epb.packet_len);
+        }
+        if (epb.interface_id >= section_info->interfaces->len)
+            return false;
+        iface_info = &g_array_index(section_info->interfaces, interface_info_t,
+                                    epb.interface_id);
+        if (epb.captured_len > wtap_max_snaplen_for_encap(iface_info->wtap_encap) ||
+            !pcap_record_lengths_in_header(iface_info->wtap_encap))
+            return false;
+        /* The block must be just the packet data, without options. */
+        if (bh.block_total_length - MIN_EPB_SIZE != WS_ROUNDUP_4(epb.captured_len))
+            return false;
+
+        entry->presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN|WTAP_HAS_INTERFACE_ID;
+        pcapng_convert_timestamp(iface_info, epb.timestamp_high,
+                                 epb.timestamp_low, &entry->ts);
+        entry->len = epb.packet_len;
+        entry->caplen = epb.captured_len;
+        break;
+
+    case BLOCK_TYPE_SPB:
+        if (section_info->interfaces->len == 0 ||
+            bh.block_total_length < MIN_BLOCK_SIZE + sizeof spb)
+            return false;
+        memcpy(&spb, data + sizeof bh, sizeof spb);
+        if (section_info->byte_swapped)
+            spb.packet_len = GUINT32_SWAP_LE_BE(spb.packet_len);
+        iface_info = &g_array_index(section_info->interfaces, interface_info_t, 0);
+        if (!pcap_record_lengths_in_header(iface_info->wtap_encap))
+            return false;
+
+        /* As pcapng_read_simple_packet_block() works them out. */
+        entry->caplen = spb.packet_len;
+        if (entry->caplen > iface_info->snap_len && iface_info->snap_len != 0)
+            entry->caplen = iface_info->snap_len;
+        if (entry->caplen > wtap_max_snaplen_for_encap(iface_info->wtap_encap) ||
+            bh.block_total_length - MIN_BLOCK_SIZE - sizeof spb <
+                WS_ROUNDUP_4(entry->caplen))
+            return false;
+
+        entry->presence_flags = WTAP_HAS_CAP_LEN|WTAP_HAS_INTERFACE_ID;
+        entry->ts.secs = 0;
+        entry->ts.nsecs = 0;
+        entry->len = spb.packet_len;
+        break;
+
+    default:
+        return false;
+    }
+
+    entry->tsprec = iface_info->tsprecision;
+    entry->pkt_encap = iface_info->wtap_encap;
+
+    *rec_len = bh.block_total_length;
+    return true;
+}
+
 /* classic wtap: close capture file */
 static void
 pcapng_close(wtap *wth)
@@ -0,0 +1,225 @@
+/* record_scan.c
+ * Finding the records of a capture file with several threads
+ *
+ * Wiretap Library
+ * Copyright (c) 1998 by Gilbert Ramirez <gram@alumni.rice.edu>
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+#define WS_LOG_DOMAIN LOG_DOMAIN_WIRETAP
+
+#include <glib.h>
+
+#include "wtap_module.h"
+#include "file_wrappers.h"
+
+#include <wsutil/wslog.h>
+
+/*
+ * Number of consecutive records that have to be found, starting at an
+ * offset in the middle of the file, before we believe a record starts
+ * there.
+ */
+#define SCAN_SYNC_RECORDS	8
+
+/*
+ * Smallest range of the file worth handing to a thread, unless the caller
+ * asks for another size.
+ */
+#define SCAN_MIN_RANGE		(4 * 1024 * 1024)
+
+/*
+ * Most threads we'll use, however many processors there are; past this,
+ * reading the file is the bottleneck.
+ */
+#define SCAN_MAX_THREADS	16
+
+typedef struct {
+	wtap		*wth;
+	const uint8_t	*data;		/* The mapped file */
+	uint64_t	size;		/* Size of the mapped file */
+	uint64_t	start;		/* Start of the range */
+	uint64_t	end;		/* End of the range */
+	bool		synced;		/* true if a record was found in the range */
+	uint64_t	sync;		/* Offset of the first record found */
+	uint64_t	next;		/* Offset just past the last record found */
+	bool		stopped;	/* true if the walk ended at a non-record */
+	GArray		*entries;	/* The records found */
+	GThread		*thread;
+} scan_range_t;
+
+/*
+ * Append the records that start at offset and follow it, up to end, to
+ * entries.
+ *
+ * Returns the offset just past the last record; *stopped is set if that
+ * isn't a record we can find.
+ */
+static uint64_t
+scan_walk(wtap *wth, const uint8_t *data, uint64_t size, uint64_t offset,
+    uint64_t end, GArray *entries, bool *stopped)
+{
+	wtap_scan_entry entry;
+	uint32_t rec_len;
+
+	*stopped = false;
+	while (offset < end) {
+		if (offset >= size ||
+		    !wth->subtype_scan_record(wth, data + offset,
+		    (size_t)(size - offset), false, &rec_len, &entry)) {
+			*stopped = true;
+			break;
+		}
+		entry.offset = (int64_t)offset;
+		g_array_append_val(entries, entry);
+		offset += rec_len;
+	}
+	return offset;
+}
+
+/*
+ * Find the first offset in [start, end) at which a chain of records
+ * starts.
+ */
+static bool
+scan_sync(wtap *wth, const uint8_t *data, uint64_t size, uint64_t start,
+    uint64_t end, uint64_t *sync)
+{
+	wtap_scan_entry entry;
+	uint32_t rec_len;
+
+	for (uint64_t candidate = start; candidate < end; candidate++) {
+		uint64_t offset = candidate;
+		int found = 0;
+
+		while (found < SCAN_SYNC_RECORDS && offset < size &&
+		    wth->subtype_scan_record(wth, data + offset,
+		    (size_t)(size - offset), true, &rec_len, &entry)) {
+			offset += rec_len;
+			found++;
+		}
+		/* A shorter chain will do if it ends exactly at the end. */
+		if (found == SCAN_SYNC_RECORDS || (found > 0 && offset == size)) {
+			*sync = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void *
+scan_range_worker(void *arg)
+{
+	scan_range_t *range = (scan_range_t *)arg;
+
+	range->synced = scan_sync(range->wth, range->data, range->size,
+	    range->start, range->end, &range->sync);
+	if (range->synced)
+		range->next = scan_walk(range->wth, range->data, range->size,
+		    range->sync, range->end, range->entries, &range->stopped);
+	return NULL;
+}
+
+bool
+wtap_scan_records(wtap *wth, unsigned num_threads, uint64_t min_range_size,
+    GArray **entries, int64_t *resume_offset)
+{
+	GMappedFile *mapped;
+	const uint8_t *data;
+	uint64_t size, first, offset;
+	unsigned num_ranges;
+	scan_range_t *ranges;
+	GArray *found;
+	bool stopped;
+
+	if (wth->subtype_scan_record == NULL || wth->ispipe ||
+	    file_iscompressed(wth->fh))
+		return false;
+
+	mapped = g_mapped_file_new(wth->pathname, false, NULL);
+	if (mapped == NULL)
+		return false;
+	data = (const uint8_t *)g_mapped_file_get_contents(mapped);
+	size = g_mapped_file_get_length(mapped);
+
+	/* The first record is wherever opening the file left off. */
+	first = (uint64_t)file_tell(wth->fh);
+	if (data == NULL || first > size) {
+		g_mapped_file_unref(mapped);
+		return false;
+	}
+
+	if (min_range_size == 0)
+		min_range_size = SCAN_MIN_RANGE;
+	num_ranges = MIN(MAX(num_threads, 1), SCAN_MAX_THREADS);
+	num_ranges = (unsigned)MIN((uint64_t)num_ranges, (size - first) / min_range_size);
+	if (num_ranges == 0)
+		num_ranges = 1;
+
+	ranges = g_new0(scan_range_t, num_ranges);
+	for (unsigned i = 0; i < num_ranges; i++) {
+		ranges[i].wth = wth;
+		ranges[i].data = data;
+		ranges[i].size = size;
+		ranges[i].start = first + (size - first) * i / num_ranges;
+		ranges[i].end = first + (size - first) * (i + 1) / num_ranges;
+		ranges[i].entries = g_array_new(false, false, sizeof(wtap_scan_entry));
+	}
+
+	/*
+	 * We know where the records of the first range start, so we do
+	 * that one ourselves while the threads guess where the records
+	 * of the others start.
+	 */
+	for (unsigned i = 1; i < num_ranges; i++)
+		ranges[i].thread = g_thread_new("Record scan", scan_range_worker, &ranges[i]);
+
+	found = ranges[0].entries;
+	ranges[0].entries = NULL;
+	offset = scan_walk(wth, data, size, first, ranges[0].end, found, &stopped);
+
+	for (unsigned i = 1; i < num_ranges; i++) {
+		scan_range_t *range = &ranges[i];
+
+		g_thread_join(range->thread);
+		if (stopped || offset >= range->end) {
+			/*
+			 * Either we're done, or a record that started in
+			 * an earlier range covers all of this one.
+			 */
+		} else if (range->synced && range->sync == offset) {
+			g_array_append_vals(found, range->entries->data, range->entries->len);
+			offset = range->next;
+			stopped = range->stopped;
+		} else {
+			/*
+			 * The thread guessed wrong, or found a record our
+			 * walk doesn't reach; redo the range in order.
+			 */
+			ws_debug("rescanning range %u from offset %" PRIu64, i, offset);
+			offset = scan_walk(wth, data, size, offset, range->end, found, &stopped);
+		}
+		g_array_free(range->entries, true);
+	}
+	g_free(ranges);
+	g_mapped_file_unref(mapped);
+
+	*entries = found;
+	*resume_offset = (int64_t)offset;
+	return true;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
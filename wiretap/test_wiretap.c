@@ -0,0 +1,558 @@
+/*
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <wsutil/buffer.h>
+#include <wsutil/file_compressed.h>
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+#include <wsutil/wslog.h>
+
+#include "wtap.h"
+
+#define PROGNAME "test_wiretap"
+
+/*
+ * Fill in the data of a packet of a test capture file, and return true,
+ * or return false if the file has no more packets. Anything else that
+ * has to go before the packet can be written to wdh.
+ */
+typedef bool (*test_packet_func)(uint32_t packet, wtap_dumper *wdh, Buffer *data,
+                                 void *user_data);
+
+/*
+ * Write an Ethernet capture file, compressed or not, to a new temporary
+ * file, and return the path of the file. Packet n has a time stamp of
+ * n seconds.
+ */
+static char *write_test_capture(int file_type_subtype, ws_compression_type compression_type,
+                                test_packet_func packet_func, void *user_data)
+{
+    wtap_dump_params params = WTAP_DUMP_PARAMS_INIT;
+    wtap_dumper *wdh;
+    wtap_rec rec;
+    int err;
+    char *err_info;
+    char *tmpl;
+    char *path;
+    int fd;
+
+    tmpl = g_strdup_printf(PROGNAME "_XXXXXX.%s", wtap_default_file_extension(file_type_subtype));
+    fd = g_file_open_tmp(tmpl, &path, NULL);
+    g_assert_cmpint(fd, !=, -1);
+    ws_close(fd);
+    g_free(tmpl);
+
+    params.encap = WTAP_ENCAP_ETHERNET;
+    params.snaplen = 65535;
+    params.tsprec = WTAP_TSPREC_USEC;
+    wdh = wtap_dump_open(path, file_type_subtype, compression_type,
+                         &params, &err, &err_info);
+    g_assert_nonnull(wdh);
+
+    wtap_rec_init(&rec, 0);
+    for (uint32_t packet = 0; ; packet++) {
+        wtap_rec_reset(&rec);
+        wtap_setup_packet_rec(&rec, WTAP_ENCAP_ETHERNET);
+        if (!packet_func(packet, wdh, &rec.data, user_data))
+            break;
+        rec.presence_flags = WTAP_HAS_TS | WTAP_HAS_CAP_LEN;
+        rec.ts.secs = packet;
+        rec.ts.nsecs = 0;
+        rec.rec_header.packet_header.caplen = (uint32_t)ws_buffer_length(&rec.data);
+        rec.rec_header.packet_header.len = (uint32_t)ws_buffer_length(&rec.data);
+        g_assert_true(wtap_dump(wdh, &rec, &err, &err_info));
+    }
+    wtap_rec_cleanup(&rec);
+    g_assert_true(wtap_dump_close(wdh, NULL, &err, &err_info));
+    return path;
+}
+
+/* Packets of a given length filled with a pattern that depends on the
+   packet number, and compresses somewhat. */
+typedef struct {
+    uint32_t count;
+    unsigned len;
+} test_packets_t;
+
+static uint8_t test_packet_byte(uint32_t packet, unsigned i)
+{
+    return (uint8_t)(packet * 7 + i / 3);
+}
+
+static bool test_packet(uint32_t packet, wtap_dumper *wdh _U_, Buffer *data, void *user_data)
+{
+    const test_packets_t *packets = (const test_packets_t *)user_data;
+
+    if (packet == packets->count)
+        return false;
+    for (unsigned i = 0; i < packets->len; i++) {
+        uint8_t byte = test_packet_byte(packet, i);
+
+        ws_buffer_append(data, &byte, 1);
+    }
+    return true;
+}
+
+static void check_test_packet(const wtap_rec *rec, const test_packets_t *packets,
+                              uint32_t packet)
+{
+    const uint8_t *data = ws_buffer_start_ptr(&rec->data);
+
+    g_assert_cmpint(rec->ts.secs, ==, packet);
+    g_assert_cmpuint(ws_buffer_length(&rec->data), ==, packets->len);
+    for (unsigned i = 0; i < packets->len; i++)
+        g_assert_cmpuint(data[i], ==, test_packet_byte(packet, i));
+}
+
+/* The offset of a packet in an uncompressed pcap file of test packets. */
+static int64_t test_packet_offset(const test_packets_t *packets, uint32_t packet)
+{
+    return 24 + (int64_t)packet * (16 + packets->len);
+}
+
+#define MAPPED_PACKETS      3
+
+static void test_mapped_read(void)
+{
+    const test_packets_t packets = { MAPPED_PACKETS, 64 };
+    wtap *wth;
+    wtap_rec rec, rec2;
+    int64_t offsets[MAPPED_PACKETS];
+    int err;
+    char *err_info;
+    char *path;
+
+    path = write_test_capture(wtap_pcap_file_type_subtype(), WS_FILE_UNCOMPRESSED, test_packet, (void *)&packets);
+    wtap_rec_init(&rec, 0);
+    wtap_rec_init(&rec2, 0);
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    for (uint32_t packet = 0; packet < MAPPED_PACKETS; packet++) {
+        g_assert_true(wtap_read(wth, &rec, &err, &err_info, &offsets[packet]));
+        check_test_packet(&rec, &packets, packet);
+    }
+#ifndef _WIN32
+    /* The data is borrowed from the mapping rather than copied. */
+    g_assert_true(rec.data.borrowed);
+#endif
+
+    /* A buffer that owns its data can change it without that showing
+       up in later reads of the same packet. */
+    ws_buffer_own(&rec.data);
+    ws_buffer_start_ptr(&rec.data)[0] ^= 0xff;
+    g_assert_true(wtap_seek_read(wth, offsets[MAPPED_PACKETS - 1], &rec2, &err, &err_info));
+    check_test_packet(&rec2, &packets, MAPPED_PACKETS - 1);
+
+    /* Borrowed data stays valid when the file is reopened... */
+    g_assert_true(wtap_seek_read(wth, offsets[1], &rec, &err, &err_info));
+    g_assert_true(wtap_fdreopen(wth, path, &err));
+    check_test_packet(&rec, &packets, 1);
+    g_assert_true(wtap_seek_read(wth, offsets[0], &rec2, &err, &err_info));
+    check_test_packet(&rec2, &packets, 0);
+
+    /* ...and when it's closed. */
+    wtap_close(wth);
+    check_test_packet(&rec, &packets, 1);
+    check_test_packet(&rec2, &packets, 0);
+
+    wtap_rec_cleanup(&rec2);
+    wtap_rec_cleanup(&rec);
+    ws_unlink(path);
+    g_free(path);
+}
+
+/* Ranges small enough that a small file is split into as many of them
+   as there are threads. */
+#define SCAN_THREADS        4
+#define SCAN_RANGE_SIZE     (64 * 1024)
+#define SCAN_FILE_SIZE      (SCAN_THREADS * SCAN_RANGE_SIZE + SCAN_RANGE_SIZE / 2)
+#define SCAN_FAKE_REC_LEN   24
+
+/* Packets made of things that look like pcap records, so a scan that
+   starts in the middle of a packet can go wrong, with lengths that make
+   records straddle the boundaries between the ranges the scan splits
+   the file into. */
+static bool scan_pcap_packet(uint32_t packet, wtap_dumper *wdh _U_, Buffer *data,
+                             void *user_data)
+{
+    uint64_t *written = (uint64_t *)user_data;
+    uint32_t len = SCAN_FAKE_REC_LEN * (4 + packet % 60);
+    uint8_t fill[SCAN_FAKE_REC_LEN - 16];
+
+    if (*written >= SCAN_FILE_SIZE)
+        return false;
+    memset(fill, (int)packet, sizeof fill);
+    for (uint32_t fake = 0; fake < len; fake += SCAN_FAKE_REC_LEN) {
+        uint32_t fake_hdr[4] = { packet, fake, sizeof fill, sizeof fill };
+
+        ws_buffer_append(data, (const uint8_t *)fake_hdr, sizeof fake_hdr);
+        ws_buffer_append(data, fill, sizeof fill);
+    }
+    *written += 16 + len;
+    return true;
+}
+
+/* Packets with a second interface added partway through, which a scan
+   can't go past. */
+static bool scan_pcapng_packet(uint32_t packet, wtap_dumper *wdh, Buffer *data,
+                               void *user_data)
+{
+    uint64_t *written = (uint64_t *)user_data;
+    uint32_t len = 61 + packet % 1439;
+    uint8_t fill = (uint8_t)packet;
+
+    if (*written >= SCAN_FILE_SIZE)
+        return false;
+    if (*written < SCAN_FILE_SIZE * 3 / 5 &&
+        *written + 32 + len >= SCAN_FILE_SIZE * 3 / 5) {
+        wtap_block_t idb = wtap_block_create(WTAP_BLOCK_IF_ID_AND_INFO);
+        wtapng_if_descr_mandatory_t *if_mand;
+        int err;
+        char *err_info;
+
+        if_mand = (wtapng_if_descr_mandatory_t *)wtap_block_get_mandatory_data(idb);
+        if_mand->wtap_encap = WTAP_ENCAP_ETHERNET;
+        if_mand->time_units_per_second = 1000000;
+        if_mand->tsprecision = WTAP_TSPREC_USEC;
+        if_mand->snap_len = 65535;
+        g_assert_true(wtap_dump_add_idb(wdh, idb, &err, &err_info));
+        wtap_block_unref(idb);
+    }
+    for (uint32_t i = 0; i < len; i++)
+        ws_buffer_append(data, &fill, 1);
+    *written += 32 + len;
+    return true;
+}
+
+/* What wtap_scan_records() should find for a record that's been read. */
+static wtap_scan_entry read_scan_entry(const wtap_rec *rec, int64_t offset)
+{
+    wtap_scan_entry entry;
+
+    entry.offset = offset;
+    entry.ts = rec->ts;
+    entry.presence_flags = rec->presence_flags;
+    entry.tsprec = rec->tsprec;
+    entry.pkt_encap = rec->rec_header.packet_header.pkt_encap;
+    entry.len = rec->rec_header.packet_header.len;
+    entry.caplen = rec->rec_header.packet_header.caplen;
+    return entry;
+}
+
+static void check_scan_entry(const wtap_scan_entry *scanned, const wtap_scan_entry *read)
+{
+    g_assert_cmpint(scanned->offset, ==, read->offset);
+    g_assert_cmphex(scanned->presence_flags, ==, read->presence_flags);
+    g_assert_cmpint(scanned->ts.secs, ==, read->ts.secs);
+    g_assert_cmpint(scanned->ts.nsecs, ==, read->ts.nsecs);
+    g_assert_cmpint(scanned->tsprec, ==, read->tsprec);
+    g_assert_cmpint(scanned->pkt_encap, ==, read->pkt_encap);
+    g_assert_cmpuint(scanned->len, ==, read->len);
+    g_assert_cmpuint(scanned->caplen, ==, read->caplen);
+}
+
+/* Check that scanning a file, and reading whatever the scan left, finds
+   the same records as reading it sequentially. */
+static void check_scan_records(const char *path, bool complete)
+{
+    GArray *sequential, *scanned;
+    wtap_scan_entry entry;
+    wtap *wth;
+    wtap_rec rec;
+    int64_t offset, resume_offset;
+    int err;
+    char *err_info;
+
+    wtap_rec_init(&rec, 0);
+    sequential = g_array_new(false, false, sizeof(wtap_scan_entry));
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    while (wtap_read(wth, &rec, &err, &err_info, &offset)) {
+        entry = read_scan_entry(&rec, offset);
+        g_array_append_val(sequential, entry);
+        wtap_rec_reset(&rec);
+    }
+    g_assert_cmpint(err, ==, 0);
+    wtap_close(wth);
+    g_assert_cmpuint(sequential->len, >, 0);
+
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    g_assert_true(wtap_scan_records(wth, SCAN_THREADS, SCAN_RANGE_SIZE, &scanned,
+                                    &resume_offset));
+    if (complete)
+        g_assert_cmpuint(scanned->len, ==, sequential->len);
+    else
+        g_assert_cmpuint(scanned->len, <, sequential->len);
+    g_assert_true(wtap_set_read_offset(wth, resume_offset, &err));
+    while (wtap_read(wth, &rec, &err, &err_info, &offset)) {
+        entry = read_scan_entry(&rec, offset);
+        g_array_append_val(scanned, entry);
+        wtap_rec_reset(&rec);
+    }
+    g_assert_cmpint(err, ==, 0);
+
+    g_assert_cmpuint(scanned->len, ==, sequential->len);
+    for (unsigned i = 0; i < scanned->len; i++)
+        check_scan_entry(&g_array_index(scanned, wtap_scan_entry, i),
+                         &g_array_index(sequential, wtap_scan_entry, i));
+
+    /* The records are where the scan says they are. */
+    offset = g_array_index(scanned, wtap_scan_entry, scanned->len / 2).offset;
+    g_assert_true(wtap_seek_read(wth, offset, &rec, &err, &err_info));
+    g_assert_cmpint(rec.ts.secs, ==, scanned->len / 2);
+
+    wtap_close(wth);
+    g_array_free(scanned, true);
+    g_array_free(sequential, true);
+    wtap_rec_cleanup(&rec);
+}
+
+static void test_scan_records_pcap(void)
+{
+    uint64_t written = 24;
+    char *path;
+
+    path = write_test_capture(wtap_pcap_file_type_subtype(), WS_FILE_UNCOMPRESSED,
+                              scan_pcap_packet, &written);
+    check_scan_records(path, true);
+    ws_unlink(path);
+    g_free(path);
+}
+
+static void test_scan_records_pcapng(void)
+{
+    uint64_t written = 0;
+    char *path;
+
+    path = write_test_capture(wtap_pcapng_file_type_subtype(), WS_FILE_UNCOMPRESSED,
+                              scan_pcapng_packet, &written);
+    check_scan_records(path, false);
+    ws_unlink(path);
+    g_free(path);
+}
+
+/* NOTE: You have to run "test_wiretap -m perf" to run the performance tests. */
+static void test_scan_records_perf(void)
+{
+#define SCAN_PERF_PACKETS   (1000 * 1000)
+#define SCAN_PERF_LEN       96
+    const test_packets_t packets = { SCAN_PERF_PACKETS, SCAN_PERF_LEN };
+    unsigned max_threads = g_get_num_processors();
+    GArray *scanned;
+    wtap *wth;
+    wtap_rec rec;
+    int64_t offset, resume_offset, start;
+    double ms;
+    uint32_t count;
+    int err;
+    char *err_info;
+    char *path;
+
+    path = write_test_capture(wtap_pcap_file_type_subtype(), WS_FILE_UNCOMPRESSED,
+                              test_packet, (void *)&packets);
+
+    /* What the packet count takes without a scan: a sequential read. */
+    wtap_rec_init(&rec, 0);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    count = 0;
+    start = g_get_monotonic_time();
+    while (wtap_read(wth, &rec, &err, &err_info, &offset)) {
+        count++;
+        wtap_rec_reset(&rec);
+    }
+    ms = (g_get_monotonic_time() - start) / 1000.0;
+    g_assert_cmpuint(count, ==, SCAN_PERF_PACKETS);
+    g_test_message("sequential read, %u packets: %.3f ms", count, ms);
+    wtap_close(wth);
+    wtap_rec_cleanup(&rec);
+
+    /* Wall clock time, as that's what scales with the threads. */
+    for (unsigned num_threads = 1; ; num_threads = MIN(num_threads * 2, max_threads)) {
+        wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+        g_assert_nonnull(wth);
+        start = g_get_monotonic_time();
+        g_assert_true(wtap_scan_records(wth, num_threads, 0, &scanned, &resume_offset));
+        ms = (g_get_monotonic_time() - start) / 1000.0;
+        g_assert_cmpuint(scanned->len, ==, SCAN_PERF_PACKETS);
+        if (num_threads == max_threads)
+            g_test_minimized_result(ms, "record scan, %u threads, %u packets: %.3f ms",
+                                    num_threads, scanned->len, ms);
+        else
+            g_test_message("record scan, %u threads, %u packets: %.3f ms",
+                           num_threads, scanned->len, ms);
+        g_array_free(scanned, true);
+        wtap_close(wth);
+        if (num_threads == max_threads)
+            break;
+    }
+
+    ws_unlink(path);
+    g_free(path);
+}
+
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) || defined (HAVE_ZSTD)
+/* Enough packets to fill several compressed frames. */
+static const test_packets_t compressed_packets = { 3000, 1500 };
+
+/* Read packets backwards, without reading the file sequentially first,
+   so the reads only have the seek table, if any, to go by; then read
+   it sequentially, if it's intact. */
+static void check_compressed_read(const char *path, bool intact)
+{
+    wtap *wth;
+    wtap_rec rec;
+    int64_t offset;
+    uint32_t packet;
+    int err;
+    char *err_info;
+
+    wtap_rec_init(&rec, 0);
+    wth = wtap_open_offline(path, WTAP_TYPE_AUTO, &err, &err_info, true, NULL);
+    g_assert_nonnull(wth);
+    for (packet = compressed_packets.count; packet-- > 0; ) {
+        if (packet % 97 != 0 && packet != compressed_packets.count - 1)
+            continue;
+        wtap_rec_reset(&rec);
+        g_assert_true(wtap_seek_read(wth, test_packet_offset(&compressed_packets, packet),
+                                     &rec, &err, &err_info));
+        check_test_packet(&rec, &compressed_packets, packet);
+    }
+
+    if (intact) {
+        for (packet = 0; packet < compressed_packets.count; packet++) {
+            wtap_rec_reset(&rec);
+            g_assert_true(wtap_read(wth, &rec, &err, &err_info, &offset));
+            g_assert_cmpint(offset, ==, test_packet_offset(&compressed_packets, packet));
+            check_test_packet(&rec, &compressed_packets, packet);
+        }
+        g_assert_false(wtap_read(wth, &rec, &err, &err_info, &offset));
+        g_assert_cmpint(err, ==, 0);
+    }
+    wtap_close(wth);
+    wtap_rec_cleanup(&rec);
+}
+
+/* Offset of the table of sizes in a compressed file we wrote, and the
+   number of entries in it. */
+static size_t compressed_table(const uint8_t *contents, size_t len,
+                               ws_compression_type compression_type,
+                               uint32_t *count)
+{
+    if (compression_type == WS_FILE_ZSTD_COMPRESSED) {
+        *count = pletohu32(contents + len - WS_ZSTD_SEEKABLE_FOOTER_SIZE);
+        return len - WS_ZSTD_SEEKABLE_FOOTER_SIZE - (size_t)*count * 8;
+    }
+    *count = pletohu32(contents + len - WS_GZIP_INDEX_TRAILER_SIZE - 8);
+    return len - WS_GZIP_INDEX_TRAILER_SIZE - 8 - (size_t)*count * 8;
+}
+
+static void test_compressed_seek(ws_compression_type compression_type)
+{
+    char *contents;
+    uint8_t *entries;
+    size_t len, table;
+    uint32_t count;
+    char *path;
+
+    path = write_test_capture(wtap_pcap_file_type_subtype(), compression_type, test_packet,
+                              (void *)&compressed_packets);
+    check_compressed_read(path, true);
+
+    g_assert_true(g_file_get_contents(path, &contents, &len, NULL));
+    table = compressed_table((uint8_t *)contents, len, compression_type, &count);
+    g_assert_cmpuint(count, >, 2);
+    entries = (uint8_t *)contents + table;
+
+    /* A table whose sizes add up, but which puts the second frame in
+       the wrong place, must not be used. */
+    phtoleu32(entries, pletohu32(entries) - 16);
+    phtoleu32(entries + 8, pletohu32(entries + 8) + 16);
+    g_assert_true(g_file_set_contents(path, contents, len, NULL));
+    check_compressed_read(path, true);
+
+    /* Nor may a truncated one; the packets before it are still there. */
+    phtoleu32(entries, pletohu32(entries) + 16);
+    phtoleu32(entries + 8, pletohu32(entries + 8) - 16);
+    g_assert_true(g_file_set_contents(path, contents, table + 8, NULL));
+    check_compressed_read(path, false);
+
+    g_free(contents);
+    ws_unlink(path);
+    g_free(path);
+}
+#endif
+
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
+static void test_gzip_seek(void)
+{
+    test_compressed_seek(WS_FILE_GZIP_COMPRESSED);
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static void test_zstd_seek(void)
+{
+    test_compressed_seek(WS_FILE_ZSTD_COMPRESSED);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    /* Set the program name. */
+    g_set_prgname(PROGNAME);
+
+    ws_log_init(NULL, "Testing Debug Console");
+
+    g_test_init(&argc, &argv, NULL);
+
+    wtap_init(false, NULL, NULL, 0);
+
+    g_test_add_func("/wtap/mapped_read", test_mapped_read);
+    g_test_add_func("/wtap/scan_records_pcap", test_scan_records_pcap);
+    g_test_add_func("/wtap/scan_records_pcapng", test_scan_records_pcapng);
+#if defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG)
+    g_test_add_func("/wtap/gzip_seek", test_gzip_seek);
+#endif
+#ifdef HAVE_ZSTD
+    g_test_add_func("/wtap/zstd_seek", test_zstd_seek);
+#endif
+    if (g_test_perf()) {
+        g_test_add_func("/wtap/scan_records_perf", test_scan_records_perf);
+    }
+
+    ret = g_test_run();
+
+    wtap_cleanup();
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
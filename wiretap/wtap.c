@@ -217,6 +217,12 @@ wtap_file_get_dpib_lookup_info(wtap *wth)
 	return lookup_info;
 }
 
+unsigned
+wtap_file_get_num_idbs(wtap *wth)
+{
+	return wth->interface_data->len;
+}
+
 wtap_block_t
 wtap_get_next_interface_description(wtap *wth)
 {
@@ -550,6 +556,15 @@ wtap_file_get_nrb(wtap *wth)
 	return g_array_index(wth->nrbs, wtap_block_t, 0);
 }
 
+unsigned
+wtap_file_get_num_nrbs(wtap *wth)
+{
+	if (!wth->nrbs) {
+		return 0;
+	}
+	return wth->nrbs->len;
+}
+
 GArray*
 wtap_file_get_nrb_for_new_file(wtap *wth)
 {
@@ -1656,6 +1671,15 @@ wtap_cleareof(wtap *wth) {
 	}
 }
 
+void
+wtap_set_shm_ring(wtap *wth, ws_shm_ring *ring)
+{
+	if (wth->fh != NULL)
+		file_set_shm_ring(wth->fh, ring);
+	if (wth->random_fh != NULL)
+		file_set_shm_ring(wth->random_fh, ring);
+}
+
 static inline void
 wtapng_process_nrb_ipv4(wtap *wth, wtap_block_t nrb)
 {
@@ -2076,6 +2100,21 @@ wtap_read_bytes_buffer(FILE_T fh, Buffer *buf, unsigned length, int *err,
 	return rv;
 }
 
+/*
+ * Like wtap_read_bytes_buffer(), but if the buffer is empty and the
+ * data is in a memory-mapped file, make the buffer refer to the data
+ * in the mapping rather than copying it.
+ */
+bool
+wtap_read_bytes_buffer_mapped(FILE_T fh, Buffer *buf, unsigned length,
+    int *err, char **err_info)
+{
+	if (length != 0 && ws_buffer_length(buf) == 0 &&
+	    file_read_mapped(fh, buf, length))
+		return true;
+	return wtap_read_bytes_buffer(fh, buf, length, err, err_info);
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (int64_t, in case that's 64 bits.)
@@ -2196,6 +2235,12 @@ wtap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
 	return true;
 }
 
+bool
+wtap_set_read_offset(wtap *wth, int64_t offset, int *err)
+{
+	return file_seek(wth->fh, offset, SEEK_SET, err) != -1;
+}
+
 static bool
 wtap_full_file_read_file(wtap *wth, FILE_T fh, wtap_rec *rec,
     int *err, char **err_info)
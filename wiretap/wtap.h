@@ -2143,6 +2143,21 @@ struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err
 WS_DLL_PUBLIC
 void wtap_cleareof(wtap *wth);
 
+/**
+ * @brief Read a file that is being written from the writer's shared-memory
+ * mirror of it where possible.
+ *
+ * Used when reading a live capture file written by dumpcap, so that the
+ * packets it just wrote don't have to be read back from the file system.
+ * Only uncompressed files are mirrored; anything that isn't in the ring
+ * is read from the file as usual.
+ *
+ * @param wth Wiretap file handle.
+ * @param ring The writer's ring, or NULL to stop using one.
+ */
+WS_DLL_PUBLIC
+void wtap_set_shm_ring(wtap *wth, ws_shm_ring *ring);
+
 /**
  * @brief Callback type for registering new IPv4 hostnames.
  *
@@ -2254,6 +2269,67 @@ WS_DLL_PUBLIC
 bool wtap_seek_read(wtap *wth, int64_t seek_off, wtap_rec *rec,
     int *err, char **err_info);
 
+/**
+ * What wtap_scan_records() finds out about a packet record without reading
+ * it; it's what wtap_read() would put in the record's header.
+ */
+typedef struct {
+    int64_t  offset;            /**< Offset of the record, as wtap_read() returns it */
+    nstime_t ts;                /**< Time stamp, if presence_flags has WTAP_HAS_TS */
+    uint32_t presence_flags;    /**< WTAP_HAS_ flags of the record */
+    int      tsprec;            /**< Time stamp precision */
+    int      pkt_encap;         /**< Link-layer encapsulation of the packet */
+    uint32_t len;               /**< Length of the packet on the network */
+    uint32_t caplen;            /**< Length of the captured data */
+} wtap_scan_entry;
+
+/**
+ * @brief Find the packet records of a file without reading them, using
+ * several threads.
+ *
+ * The file is split into byte ranges, and a thread finds the records
+ * in each; the ranges are then joined, and any range whose records
+ * don't continue from the previous one is scanned again in order. The
+ * offsets are the same ones wtap_read() would return, and the records
+ * can be read with wtap_seek_read().
+ *
+ * Scanning stops at the first record that can't be found that way, such
+ * as a pcapng block other than a packet block, or a packet whose lengths
+ * or time stamp depend on more than its record header; the rest of the
+ * file has to be read with wtap_read() after calling
+ * wtap_set_read_offset() with the offset returned in resume_offset.
+ *
+ * This is only supported for uncompressed regular files of formats that
+ * can find their records, and only before any record has been read.
+ *
+ * @param wth a wtap * returned by a call that opened a file for random-access
+ * reading.
+ * @param num_threads the maximum number of threads to use.
+ * @param min_range_size the smallest range of the file to give a thread,
+ * or 0 for a size that makes a thread worth starting.
+ * @param entries set to a GArray of wtap_scan_entry for the records found,
+ * in the order of the file, which the caller must free.
+ * @param resume_offset set to the offset at which to continue reading with
+ * wtap_read().
+ * @return true on success, false if the file can't be scanned.
+ */
+WS_DLL_PUBLIC
+bool wtap_scan_records(wtap *wth, unsigned num_threads,
+    uint64_t min_range_size, GArray **entries, int64_t *resume_offset);
+
+/**
+ * @brief Set the offset at which wtap_read() reads the next record.
+ *
+ * @param wth a wtap * returned by a call that opened a file for reading.
+ * @param offset the offset of a record, as returned by wtap_read() or
+ * wtap_scan_records().
+ * @param err a positive "errno" value, or a negative number indicating
+ * the type of error, if the seek failed.
+ * @return true on success, false on failure.
+ */
+WS_DLL_PUBLIC
+bool wtap_set_read_offset(wtap *wth, int64_t offset, int *err);
+
 /**
  * @brief Initialize a wtap_rec structure.
  *
@@ -2558,6 +2634,17 @@ wtapng_iface_descriptions_t *wtap_file_get_idb_info(wtap *wth);
 WS_DLL_PUBLIC
 wtapng_dpib_lookup_info_t * wtap_file_get_dpib_lookup_info(wtap *wth);
 
+/**
+ * @brief Gets number of interface descriptions.
+ * @details Returns the number of interface descriptions seen so far,
+ *          including ones already fetched.
+ *
+ * @param wth The wiretap session.
+ * @return The number of existing interface descriptions.
+ */
+WS_DLL_PUBLIC
+unsigned wtap_file_get_num_idbs(wtap *wth);
+
 /**
  * @brief Gets next interface description.
  *
@@ -2616,6 +2703,16 @@ char *wtap_get_debug_if_descr(const wtap_block_t if_descr,
 WS_DLL_PUBLIC
 wtap_block_t wtap_file_get_nrb(wtap *wth);
 
+/**
+ * @brief Gets number of name resolution blocks.
+ * @details Returns the number of existing NRBs.
+ *
+ * @param wth The wiretap session.
+ * @return The number of existing name resolution blocks.
+ */
+WS_DLL_PUBLIC
+unsigned wtap_file_get_num_nrbs(wtap *wth);
+
 /**
  * @brief Gets number of decryption secrets blocks.
  * @details Returns the number of existing DSBs.
@@ -52,6 +52,29 @@ typedef bool (*subtype_read_func)(struct wtap* wtap, wtap_rec* rec,
 typedef bool (*subtype_seek_read_func)(struct wtap* wtap, int64_t seek_off, wtap_rec* rec,
                                        int* err, char** err_info);
 
+/**
+ * @brief Function pointer type for finding a packet record in a mapped file.
+ *
+ * Used by wtap_scan_records() to find where records start without reading
+ * them, possibly from several threads at once; it must only look at state
+ * that was set up when the file was opened.
+ *
+ * @param wtap Wiretap handle.
+ * @param data The data at the candidate offset.
+ * @param avail Number of bytes from data to the end of the file.
+ * @param syncing true if the offset is only a guess, in which case the
+ * record should be checked more strictly.
+ * @param rec_len Set to the length of the record, including its header.
+ * @param entry Set to what reading the record would put in its header,
+ * other than the offset.
+ * @return true if data starts with a complete packet record, false if it
+ * doesn't, or if it starts with a record that has to be read sequentially
+ * or whose header can't be filled in without reading it.
+ */
+typedef bool (*subtype_scan_record_func)(struct wtap* wtap, const uint8_t* data,
+                                         size_t avail, bool syncing, uint32_t* rec_len,
+                                         wtap_scan_entry* entry);
+
 /**
  * Struct holding data of the currently read file.
  */
@@ -80,6 +103,7 @@ struct wtap {
     subtype_seek_read_func      subtype_seek_read;      /**< Function called for random access reads */
     void                        (*subtype_sequential_close)(struct wtap*); /**< Cleanup for sequential read state. */
     void                        (*subtype_close)(struct wtap*);            /**< Cleanup for general file state. */
+    subtype_scan_record_func    subtype_scan_record;    /**< Function called to find records in a mapped file, or NULL */
     int                         file_encap;    /**< Per-file encapsulation type, for those
                                                 * file formats that have
                                                 * per-file encapsulation
@@ -320,6 +344,26 @@ bool
 wtap_read_bytes_buffer(FILE_T fh, Buffer *buf, unsigned length, int *err,
                        char **err_info);
 
+/**
+ * @brief Read bytes into an empty buffer, without copying them if possible.
+ *
+ * Like wtap_read_bytes_buffer(), but if @p buf is empty and the file is
+ * memory-mapped, the buffer is made to refer to the data in the mapping
+ * (see ws_buffer_borrow()). Call ws_buffer_own() before modifying the
+ * data in place.
+ *
+ * @param fh File handle to read from.
+ * @param buf Buffer to receive data.
+ * @param length Number of bytes to read.
+ * @param err Output error code (WTAP_ERR_SHORT_READ on short read or EOF).
+ * @param err_info Optional error info string on failure.
+ * @return true on success; false on short read or error.
+ */
+WS_DLL_PUBLIC
+bool
+wtap_read_bytes_buffer_mapped(FILE_T fh, Buffer *buf, unsigned length,
+                              int *err, char **err_info);
+
 /**
  * @brief Read entire file contents as a single packet (sequential mode).
  *
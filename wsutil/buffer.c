@@ -39,6 +39,38 @@ ws_buffer_init(Buffer* buffer, size_t space)
 	}
 	buffer->start = 0;
 	buffer->first_free = 0;
+	buffer->borrowed = false;
+	buffer->owned_data = NULL;
+	buffer->owned_allocated = 0;
+	buffer->release = NULL;
+	buffer->lender = NULL;
+}
+
+/* Tells the lender of the borrowed memory that we're done with it */
+static void
+buffer_release_borrowed(void (*release)(void *), void *lender)
+{
+	if (release != NULL)
+		release(lender);
+}
+
+/* Switches back to the buffer's own memory block, discarding the contents */
+static void
+buffer_return_borrowed(Buffer* buffer)
+{
+	void (*release)(void *) = buffer->release;
+	void *lender = buffer->lender;
+
+	buffer->data = buffer->owned_data;
+	buffer->allocated = buffer->owned_allocated;
+	buffer->borrowed = false;
+	buffer->owned_data = NULL;
+	buffer->owned_allocated = 0;
+	buffer->release = NULL;
+	buffer->lender = NULL;
+	buffer->start = 0;
+	buffer->first_free = 0;
+	buffer_release_borrowed(release, lender);
 }
 
 /* Frees the memory used by a buffer */
@@ -46,6 +78,8 @@ void
 ws_buffer_free(Buffer* buffer)
 {
 	ws_assert(buffer);
+	if (buffer->borrowed)
+		buffer_return_borrowed(buffer);
 	if (buffer->allocated == DEFAULT_INIT_BUFFER_SIZE_2048) {
 		ws_assert(buffer->data);
 		g_ptr_array_add(small_buffers, buffer->data);
@@ -64,6 +98,9 @@ void
 ws_buffer_assure_space(Buffer* buffer, size_t space)
 {
 	ws_assert(buffer);
+	/* Borrowed memory can't grow (or be written to). */
+	ws_buffer_own(buffer);
+
 	size_t available_at_end = buffer->allocated - buffer->first_free;
 	bool space_at_beginning;
 
@@ -107,6 +144,54 @@ ws_buffer_append(Buffer* buffer, const uint8_t *from, size_t bytes)
 	buffer->first_free += bytes;
 }
 
+void
+ws_buffer_borrow(Buffer* buffer, const uint8_t *data, size_t bytes,
+		 void (*release)(void *lender), void *lender)
+{
+	void (*old_release)(void *) = NULL;
+	void *old_lender = NULL;
+
+	ws_assert(buffer);
+	if (buffer->borrowed) {
+		old_release = buffer->release;
+		old_lender = buffer->lender;
+	} else {
+		buffer->owned_data = buffer->data;
+		buffer->owned_allocated = buffer->allocated;
+		buffer->borrowed = true;
+	}
+	buffer->data = (uint8_t *)data;
+	buffer->allocated = bytes;
+	buffer->start = 0;
+	buffer->first_free = bytes;
+	buffer->release = release;
+	buffer->lender = lender;
+	buffer_release_borrowed(old_release, old_lender);
+}
+
+void
+ws_buffer_own(Buffer* buffer)
+{
+	const uint8_t *borrowed;
+	size_t length;
+	void (*release)(void *);
+	void *lender;
+
+	ws_assert(buffer);
+	if (!buffer->borrowed)
+		return;
+
+	/* Copy the data before letting go of it. */
+	borrowed = buffer->data + buffer->start;
+	length = buffer->first_free - buffer->start;
+	release = buffer->release;
+	lender = buffer->lender;
+	buffer->release = NULL;
+	buffer_return_borrowed(buffer);
+	ws_buffer_append(buffer, borrowed, length);
+	buffer_release_borrowed(release, lender);
+}
+
 void
 ws_buffer_remove_start(Buffer* buffer, size_t bytes)
 {
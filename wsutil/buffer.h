@@ -10,6 +10,7 @@
 #define __W_BUFFER_H__
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include "ws_symbol_export.h"
 
@@ -26,12 +27,21 @@ extern "C" {
  *
  * This structure supports efficient appending and trimming of data,
  * making it suitable for streaming or incremental parsing scenarios.
+ *
+ * A buffer can also borrow memory it doesn't own (see ws_buffer_borrow());
+ * it then goes back to its own memory as soon as it has to grow, and
+ * tells the lender when it's done with the borrowed memory.
  */
 typedef struct Buffer {
     uint8_t *data;       /**< Pointer to the allocated memory block. */
     size_t allocated;    /**< Total size of the allocated buffer. */
     size_t start;        /**< Offset to the first valid byte. */
     size_t first_free;   /**< Offset to the first unused byte (end of valid data). */
+    bool borrowed;       /**< true if data is borrowed rather than allocated. */
+    uint8_t *owned_data; /**< While borrowing, the buffer's own memory block. */
+    size_t owned_allocated; /**< While borrowing, the size of owned_data. */
+    void (*release)(void *lender); /**< While borrowing, called when done with the memory, or NULL. */
+    void *lender;        /**< While borrowing, the argument to pass to release. */
 } Buffer;
 
 /**
@@ -79,6 +89,39 @@ void ws_buffer_assure_space(Buffer* buffer, size_t space);
 WS_DLL_PUBLIC
 void ws_buffer_append(Buffer* buffer, const uint8_t *from, size_t bytes);
 
+/**
+ * @brief Makes the buffer's contents refer to existing memory, without
+ * copying it.
+ *
+ * The buffer keeps its own memory block and switches back to it, copying
+ * the borrowed data, the first time it needs more space. The borrowed
+ * memory must stay valid until the buffer calls @p release, which it does
+ * once, when it borrows other memory, takes ownership of its contents or
+ * is freed. It must not be modified through the buffer; call
+ * ws_buffer_own() first to do that.
+ *
+ * @param buffer Pointer to the Buffer structure.
+ * @param data Pointer to the data to borrow.
+ * @param bytes Number of bytes of data.
+ * @param release Function to call when the buffer is done with the data,
+ * e.g. to drop a reference to what holds it, or NULL.
+ * @param lender Argument to pass to @p release.
+ */
+WS_DLL_PUBLIC
+void ws_buffer_borrow(Buffer* buffer, const uint8_t *data, size_t bytes,
+		      void (*release)(void *lender), void *lender);
+
+/**
+ * @brief Makes sure the buffer's contents are in its own memory.
+ *
+ * If the buffer is borrowing its contents, they are copied into the
+ * buffer's own memory block. Otherwise, this does nothing.
+ *
+ * @param buffer Pointer to the Buffer structure.
+ */
+WS_DLL_PUBLIC
+void ws_buffer_own(Buffer* buffer);
+
 /**
  * @brief Removes bytes from the beginning of the buffer.
  *
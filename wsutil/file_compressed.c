@@ -16,8 +16,13 @@
 #include <errno.h>
 
 #include <wsutil/file_util.h>
+#include <wsutil/pint.h>
 #include <wsutil/zlib_compat.h>
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
 #ifdef HAVE_LZ4FRAME_H
 #include <lz4frame.h>
 #endif /* HAVE_LZ4FRAME_H */
@@ -39,7 +44,7 @@ static const struct compression_type {
     { WS_FILE_GZIP_COMPRESSED, "gz", "gzip compressed", "gzip", true },
 #endif /* USE_ZLIB_OR_ZLIBNG */
 #ifdef HAVE_ZSTD
-    { WS_FILE_ZSTD_COMPRESSED, "zst", "zstd compressed", "zstd", false },
+    { WS_FILE_ZSTD_COMPRESSED, "zst", "zstd compressed", "zstd", true },
 #endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
     { WS_FILE_LZ4_COMPRESSED, "lz4", "lz4 compressed", "lz4", true },
@@ -151,6 +156,7 @@ struct ws_cwstream {
     WFILE_T fh;
     char* io_buffer;
     ws_compression_type ctype;
+    ws_shm_ring* shm_ring;
 };
 
 static WFILE_T
@@ -162,6 +168,10 @@ writecap_file_open(ws_cwstream* pfile, const char *filename)
         case WS_FILE_GZIP_COMPRESSED:
             return gzwfile_open(filename);
 #endif /* defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) */
+#ifdef HAVE_ZSTD
+        case WS_FILE_ZSTD_COMPRESSED:
+            return zstdwfile_open(filename);
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
         case WS_FILE_LZ4_COMPRESSED:
             return lz4wfile_open(filename);
@@ -199,6 +209,10 @@ writecap_file_fdopen(ws_cwstream* pfile, int fd)
         case WS_FILE_GZIP_COMPRESSED:
             return gzwfile_fdopen(fd);
 #endif /* defined (HAVE_ZLIB) || defined (HAVE_ZLIBNG) */
+#ifdef HAVE_ZSTD
+        case WS_FILE_ZSTD_COMPRESSED:
+            return zstdwfile_fdopen(fd);
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
         case WS_FILE_LZ4_COMPRESSED:
             return lz4wfile_fdopen(fd);
@@ -312,6 +326,18 @@ ws_cwstream_open_stdout(ws_compression_type ctype, int *err)
     return pfile;
 }
 
+bool
+ws_cwstream_set_shm_ring(ws_cwstream* pfile, ws_shm_ring* ring)
+{
+    pfile->shm_ring = NULL;
+    if (ring == NULL || pfile->ctype != WS_FILE_UNCOMPRESSED)
+        return false;
+    if (!ws_shm_ring_new_file(ring, fileno((FILE *)pfile->fh)))
+        return false;
+    pfile->shm_ring = ring;
+    return true;
+}
+
 /* Write to file */
 bool
 ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
@@ -332,6 +358,18 @@ ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
             }
             break;
 #endif
+#ifdef HAVE_ZSTD
+        case WS_FILE_ZSTD_COMPRESSED:
+            nwritten = zstdwfile_write(pfile->fh, data, data_length);
+            /*
+             * zstdwfile_write() returns 0 on error.
+             */
+            if (nwritten == 0) {
+                *err = zstdwfile_geterr(pfile->fh);
+                return false;
+            }
+            break;
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
         case WS_FILE_LZ4_COMPRESSED:
             nwritten = lz4wfile_write(pfile->fh, data, data_length);
@@ -354,6 +392,9 @@ ws_cwstream_write(ws_cwstream* pfile, const uint8_t* data, size_t data_length,
                 }
                 return false;
             }
+            if (pfile->shm_ring != NULL) {
+                ws_shm_ring_write(pfile->shm_ring, data, data_length);
+            }
             break;
     }
 
@@ -375,6 +416,16 @@ ws_cwstream_flush(ws_cwstream* pfile, int *err)
             }
             break;
 #endif
+#ifdef HAVE_ZSTD
+        case WS_FILE_ZSTD_COMPRESSED:
+            if (zstdwfile_flush((ZSTDWFILE_T)pfile->fh) == -1) {
+                if (err) {
+                    *err = zstdwfile_geterr((ZSTDWFILE_T)pfile->fh);
+                }
+                return false;
+            }
+            break;
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
         case WS_FILE_LZ4_COMPRESSED:
             if (lz4wfile_flush((LZ4WFILE_T)pfile->fh) == -1) {
@@ -392,6 +443,10 @@ ws_cwstream_flush(ws_cwstream* pfile, int *err)
                 }
                 return false;
             }
+            if (pfile->shm_ring != NULL) {
+                /* The data is in the file now, so readers may use it. */
+                ws_shm_ring_flush(pfile->shm_ring);
+            }
     }
     return true;
 }
@@ -408,6 +463,11 @@ ws_cwstream_close(ws_cwstream* pfile, int *errp)
             err = gzwfile_close(pfile->fh);
             break;
 #endif
+#ifdef HAVE_ZSTD
+        case WS_FILE_ZSTD_COMPRESSED:
+            err = zstdwfile_close(pfile->fh);
+            break;
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
         case WS_FILE_LZ4_COMPRESSED:
             err = lz4wfile_close(pfile->fh);
@@ -437,6 +497,11 @@ ws_cwstream_close_after_error(ws_cwstream* pfile)
             gzwfile_close_after_error(pfile->fh);
             break;
 #endif
+#ifdef HAVE_ZSTD
+        case WS_FILE_ZSTD_COMPRESSED:
+            zstdwfile_close_after_error(pfile->fh);
+            break;
+#endif /* HAVE_ZSTD */
 #ifdef HAVE_LZ4FRAME_H
         case WS_FILE_LZ4_COMPRESSED:
             lz4wfile_close_after_error(pfile->fh);
@@ -459,6 +524,10 @@ ws_cwstream_close_after_error(ws_cwstream* pfile)
 struct gzip_writer {
     int fd;                 /* file descriptor */
     int64_t pos;            /* current position in uncompressed data */
+    int64_t pos_out;        /* current position in compressed data */
+    int64_t member_start;   /* position in compressed data of current member */
+    unsigned member_in;     /* uncompressed data in current member */
+    GArray *members;        /* sizes of finished members, for the index */
     unsigned size;          /* buffer size, zero if not allocated yet */
     unsigned want;          /* requested buffer size, default is GZBUFSIZE */
     unsigned char *in;      /* input buffer */
@@ -511,6 +580,10 @@ gzwfile_fdopen(int fd)
     state->err = Z_OK;              /* clear error */
     state->err_info = NULL;         /* clear additional error information */
     state->pos = 0;                 /* no uncompressed data yet */
+    state->pos_out = 0;
+    state->member_start = 0;
+    state->member_in = 0;
+    state->members = g_array_new(false, false, sizeof(uint32_t));
     state->strm.avail_in = 0;       /* no input data yet */
 
     /* return stream */
@@ -600,6 +673,7 @@ gz_comp(GZWFILE_T state, int flush)
                     state->err = FILE_ERR_SHORT_WRITE;
                     return -1;
                 }
+                state->pos_out += got;
             }
             if (strm->avail_out == 0) {
                 strm->avail_out = state->size;
@@ -628,29 +702,84 @@ gz_comp(GZWFILE_T state, int flush)
     return 0;
 }
 
-/* Write out len bytes from buf.  Return 0, and set state->err, on
-   failure or on an attempt to write 0 bytes (in which case state->err
-   is Z_OK); return the number of bytes written on success. */
-unsigned
-gzwfile_write(GZWFILE_T state, const void *buf, unsigned len)
+/* Finish the current member, so that what's written next starts a new
+   one, and add it to the index.  Return -1, and set state->err, on
+   failure; return 0 on success. */
+static int
+gz_end_member(GZWFILE_T state)
 {
-    unsigned put = len;
-    unsigned n;
-    zlib_streamp strm;
+    uint32_t sizes[2];
 
-    strm = &(state->strm);
+    if (gz_comp(state, Z_FINISH) == -1)
+        return -1;
+    if (state->members != NULL) {
+        if (state->members->len / 2 < WS_GZIP_INDEX_MAX_MEMBERS) {
+            sizes[0] = (uint32_t)(state->pos_out - state->member_start);
+            sizes[1] = state->member_in;
+            g_array_append_vals(state->members, sizes, 2);
+        } else {
+            /* Too many to fit in the extra field; don't write an index. */
+            g_array_free(state->members, true);
+            state->members = NULL;
+        }
+    }
+    state->member_start = state->pos_out;
+    state->member_in = 0;
+    return 0;
+}
 
-    /* check that there's no error */
-    if (state->err != Z_OK)
-        return 0;
+/* Write the index of the members as an empty member at the end of the
+   file.  Return -1, and set state->err, on failure; return 0 on success. */
+static int
+gz_write_index(GZWFILE_T state)
+{
+    unsigned count = state->members->len / 2;
+    size_t len = (size_t)count * 8 + 8;
+    size_t total = WS_GZIP_INDEX_HEADER_SIZE + len + WS_GZIP_INDEX_TRAILER_SIZE;
+    uint8_t *index, *p;
+    ssize_t got;
 
-    /* if len is zero, avoid unnecessary operations */
-    if (len == 0)
-        return 0;
+    index = (uint8_t *)g_malloc0(total);
+    index[0] = 0x1f;                    /* ID1 */
+    index[1] = 0x8b;                    /* ID2 */
+    index[2] = Z_DEFLATED;              /* CM */
+    index[3] = 0x04;                    /* FLG.FEXTRA */
+    index[9] = 0xff;                    /* OS: unknown */
+    phtoleu16(index + 10, (uint16_t)(len + 4));
+    index[12] = WS_GZIP_INDEX_SI1;
+    index[13] = WS_GZIP_INDEX_SI2;
+    phtoleu16(index + 14, (uint16_t)len);
+    p = index + WS_GZIP_INDEX_HEADER_SIZE;
+    for (unsigned i = 0; i < count * 2; i++, p += 4)
+        phtoleu32(p, g_array_index(state->members, uint32_t, i));
+    phtoleu32(p, count);
+    phtoleu32(p + 4, WS_GZIP_INDEX_MAGIC);
+    p += 8;
+    p[0] = 0x03;                        /* empty final fixed-Huffman block */
+
+    got = ws_write(state->fd, index, (unsigned)total);
+    g_free(index);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != total) {
+        state->err = FILE_ERR_SHORT_WRITE;
+        return -1;
+    }
+    state->pos_out += got;
+    return 0;
+}
 
-    /* allocate memory if this is the first time through */
-    if (state->size == 0 && gz_init(state) == -1)
-        return 0;
+/* Write out len bytes from buf, all of which fit in the current member.
+   Return -1, and set state->err, on failure; return 0 on success. */
+static int
+gz_write(GZWFILE_T state, const void *buf, unsigned len)
+{
+    unsigned n;
+    zlib_streamp strm;
+
+    strm = &(state->strm);
 
     /* for small len, copy to input buffer, otherwise compress directly */
     if (len < state->size) {
@@ -673,13 +802,13 @@ DIAG_ON(cast-qual)
             buf = (const char *)buf + n;
             len -= n;
             if (len && gz_comp(state, Z_NO_FLUSH) == -1)
-                return 0;
+                return -1;
         } while (len);
     }
     else {
         /* consume whatever's left in the input buffer */
         if (strm->avail_in != 0 && gz_comp(state, Z_NO_FLUSH) == -1)
-            return 0;
+            return -1;
 
         /* directly compress user buffer to file */
         strm->avail_in = len;
@@ -692,10 +821,50 @@ DIAG_ON(cast-qual)
 #endif /* z_const */
         state->pos += len;
         if (gz_comp(state, Z_NO_FLUSH) == -1)
-            return 0;
+            return -1;
     }
 
     /* input was all buffered or compressed */
+    return 0;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is Z_OK); return the number of bytes written on success. */
+unsigned
+gzwfile_write(GZWFILE_T state, const void *buf, unsigned len)
+{
+    unsigned put = len;
+    unsigned n;
+
+    /* check that there's no error */
+    if (state->err != Z_OK)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* allocate memory if this is the first time through */
+    if (state->size == 0 && gz_init(state) == -1)
+        return 0;
+
+    /* start a new member every WS_COMPRESSED_FRAME_SIZE bytes, so that
+       readers can start decompressing at any of them */
+    do {
+        n = WS_COMPRESSED_FRAME_SIZE - state->member_in;
+        if (n > len)
+            n = len;
+        if (gz_write(state, buf, n) == -1)
+            return 0;
+        state->member_in += n;
+        if (state->member_in == WS_COMPRESSED_FRAME_SIZE &&
+            gz_end_member(state) == -1)
+            return 0;
+        buf = (const char *)buf + n;
+        len -= n;
+    } while (len);
+
     return put;
 }
 
@@ -722,12 +891,19 @@ gzwfile_close(GZWFILE_T state)
 {
     int ret = 0;
 
-    /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1)
+    /* flush, write the index if there's more than one member, free
+       memory, and close file */
+    if ((state->member_in != 0 || state->member_start == 0) &&
+        gz_end_member(state) == -1)
+        ret = state->err;
+    else if (state->members != NULL && state->members->len / 2 > 1 &&
+             gz_write_index(state) == -1)
         ret = state->err;
     (void)ZLIB_PREFIX(deflateEnd)(&(state->strm));
     g_free(state->out);
     g_free(state->in);
+    if (state->members != NULL)
+        g_array_free(state->members, true);
     state->err = Z_OK;
     if (ws_close(state->fd) == -1 && ret == 0)
         ret = errno;
@@ -743,6 +919,8 @@ gzwfile_close_after_error(GZWFILE_T state)
 {
     g_free(state->out);
     g_free(state->in);
+    if (state->members != NULL)
+        g_array_free(state->members, true);
     (void)ws_close(state->fd);
     g_free(state);
 }
@@ -1049,3 +1227,317 @@ lz4wfile_geterr(LZ4WFILE_T state)
     return state->err;
 }
 #endif /* HAVE_LZ4FRAME_H */
+
+#ifdef HAVE_ZSTD
+
+/* XXX - As with lz4, we might want to let the caller pick the level. */
+#define ZSTD_WRITE_LEVEL 3
+
+/* internal zstd file state data structure for writing */
+struct zstd_writer {
+    int fd;                 /* file descriptor */
+    int64_t pos;            /* current position in uncompressed data */
+    int64_t pos_out;        /* current position in compressed data */
+    int64_t frame_start;    /* position in compressed data of current frame */
+    size_t frame_in;        /* uncompressed data in current frame */
+    GArray *frames;         /* sizes of finished frames, for the seek table */
+    size_t size_out;        /* output buffer size, zero if not allocated yet */
+    unsigned char *out;     /* output buffer, containing compressed data */
+    int err;                /* error code */
+    const char *err_info;   /* additional error information string for some errors */
+    ZSTD_CStream *zstd_cstream;
+};
+
+ZSTDWFILE_T
+zstdwfile_open(const char *path)
+{
+    int fd;
+    ZSTDWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = zstdwfile_fdopen(fd);
+    if (state == NULL) {
+        save_errno = errno;
+        ws_close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+ZSTDWFILE_T
+zstdwfile_fdopen(int fd)
+{
+    ZSTDWFILE_T state;
+
+    /* allocate zstd_writer structure to return */
+    state = (ZSTDWFILE_T)g_try_malloc(sizeof *state);
+    if (state == NULL)
+        return NULL;
+    state->fd = fd;
+    state->size_out = 0;            /* no buffer allocated yet */
+
+    /* initialize stream */
+    state->err = 0;                 /* clear error */
+    state->err_info = NULL;         /* clear additional error information */
+    state->pos = 0;                 /* no uncompressed data yet */
+    state->pos_out = 0;
+    state->frame_start = 0;
+    state->frame_in = 0;
+    state->frames = g_array_new(false, false, sizeof(uint32_t));
+
+    /* return stream */
+    return state;
+}
+
+/* Writes len bytes from the output buffer to the file.
+ * Return true on success; returns false and sets state->err on failure.
+ */
+static bool
+zstd_write_out(ZSTDWFILE_T state, const void *buf, size_t len)
+{
+    if (len > 0) {
+        ssize_t got = ws_write(state->fd, buf, (unsigned)len);
+        if (got < 0) {
+            state->err = errno;
+            return false;
+        }
+        if ((size_t)got != len) {
+            state->err = FILE_ERR_SHORT_WRITE;
+            return false;
+        }
+        state->pos_out += got;
+    }
+    return true;
+}
+
+/* Start a new frame.  Return -1, and set state->err and state->err_info,
+   on failure; return 0 on success. */
+static int
+zstd_begin_frame(ZSTDWFILE_T state)
+{
+    size_t ret = ZSTD_initCStream(state->zstd_cstream, ZSTD_WRITE_LEVEL);
+    if (ZSTD_isError(ret)) {
+        state->err = FILE_ERR_CANT_COMPRESS;
+        state->err_info = ZSTD_getErrorName(ret);
+        return -1;
+    }
+    state->frame_start = state->pos_out;
+    state->frame_in = 0;
+    return 0;
+}
+
+/* Initialize state for writing a zstd file.  Mark initialization by setting
+   state->size_out to non-zero.  Return -1, and set state->err and possibly
+   state->err_info, on failure; return 0 on success. */
+static int
+zstd_init(ZSTDWFILE_T state)
+{
+    state->zstd_cstream = ZSTD_createCStream();
+    if (state->zstd_cstream == NULL) {
+        state->err = ENOMEM;
+        return -1;
+    }
+
+    /* big enough to always hold at least one complete block */
+    state->out = (unsigned char *)g_try_malloc(ZSTD_CStreamOutSize());
+    if (state->out == NULL) {
+        ZSTD_freeCStream(state->zstd_cstream);
+        state->err = ENOMEM;
+        return -1;
+    }
+
+    if (zstd_begin_frame(state) == -1) {
+        g_free(state->out);
+        ZSTD_freeCStream(state->zstd_cstream);
+        return -1;
+    }
+
+    /* mark state as initialized */
+    state->size_out = ZSTD_CStreamOutSize();
+    return 0;
+}
+
+/* Finish the current frame and add it to the seek table.  Return -1, and
+   set state->err and possibly state->err_info, on failure; return 0 on
+   success. */
+static int
+zstd_end_frame(ZSTDWFILE_T state)
+{
+    uint32_t sizes[2];
+    size_t remaining;
+
+    do {
+        ZSTD_outBuffer output = { state->out, state->size_out, 0 };
+        remaining = ZSTD_endStream(state->zstd_cstream, &output);
+        if (ZSTD_isError(remaining)) {
+            state->err = FILE_ERR_CANT_COMPRESS;
+            state->err_info = ZSTD_getErrorName(remaining);
+            return -1;
+        }
+        if (!zstd_write_out(state, state->out, output.pos))
+            return -1;
+    } while (remaining != 0);
+
+    sizes[0] = (uint32_t)(state->pos_out - state->frame_start);
+    sizes[1] = (uint32_t)state->frame_in;
+    g_array_append_vals(state->frames, sizes, 2);
+    return zstd_begin_frame(state);
+}
+
+/* Write the seek table as a skippable frame at the end of the file.
+   Return -1, and set state->err, on failure; return 0 on success. */
+static int
+zstd_write_seek_table(ZSTDWFILE_T state)
+{
+    unsigned count = state->frames->len / 2;
+    size_t len = (size_t)count * 8 + WS_ZSTD_SEEKABLE_FOOTER_SIZE;
+    uint8_t *table, *p;
+    bool ok;
+
+    table = (uint8_t *)g_malloc(8 + len);
+    phtoleu32(table, WS_ZSTD_SKIPPABLE_MAGIC);
+    phtoleu32(table + 4, (uint32_t)len);
+    p = table + 8;
+    for (unsigned i = 0; i < count * 2; i++, p += 4)
+        phtoleu32(p, g_array_index(state->frames, uint32_t, i));
+    phtoleu32(p, count);
+    p[4] = 0;                           /* descriptor: no checksums */
+    phtoleu32(p + 5, WS_ZSTD_SEEKABLE_MAGIC);
+
+    ok = zstd_write_out(state, table, 8 + len);
+    g_free(table);
+    return ok ? 0 : -1;
+}
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+size_t
+zstdwfile_write(ZSTDWFILE_T state, const void *buf, size_t len)
+{
+    size_t put = len;
+    size_t to_write;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    /* allocate memory if this is the first time through */
+    if (state->size_out == 0 && zstd_init(state) == -1)
+        return 0;
+
+    /* start a new frame every WS_COMPRESSED_FRAME_SIZE bytes, so that
+       readers can start decompressing at any of them */
+    do {
+        to_write = MIN(len, WS_COMPRESSED_FRAME_SIZE - state->frame_in);
+        ZSTD_inBuffer input = { buf, to_write, 0 };
+        while (input.pos < input.size) {
+            ZSTD_outBuffer output = { state->out, state->size_out, 0 };
+            size_t ret = ZSTD_compressStream(state->zstd_cstream, &output, &input);
+            if (ZSTD_isError(ret)) {
+                state->err = FILE_ERR_CANT_COMPRESS;
+                state->err_info = ZSTD_getErrorName(ret);
+                return 0;
+            }
+            if (!zstd_write_out(state, state->out, output.pos))
+                return 0;
+        }
+        state->pos += to_write;
+        state->frame_in += to_write;
+        if (state->frame_in == WS_COMPRESSED_FRAME_SIZE &&
+            zstd_end_frame(state) == -1)
+            return 0;
+        buf = (const char *)buf + to_write;
+        len -= to_write;
+    } while (len);
+
+    /* input was all compressed */
+    return put;
+}
+
+/* Flush out what we've written so far.  Returns -1, and sets state->err,
+   on failure; returns 0 on success. */
+int
+zstdwfile_flush(ZSTDWFILE_T state)
+{
+    size_t remaining;
+
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    /* If not initialized yet, nothing to flush. */
+    if (state->size_out == 0)
+        return 0;
+
+    do {
+        ZSTD_outBuffer output = { state->out, state->size_out, 0 };
+        remaining = ZSTD_flushStream(state->zstd_cstream, &output);
+        if (ZSTD_isError(remaining)) {
+            state->err = FILE_ERR_CANT_COMPRESS;
+            state->err_info = ZSTD_getErrorName(remaining);
+            return -1;
+        }
+        if (!zstd_write_out(state, state->out, output.pos))
+            return -1;
+    } while (remaining != 0);
+    return 0;
+}
+
+/* Flush out all data written, write the seek table, and close the file.
+   Returns a Wiretap error on failure; returns 0 on success. */
+int
+zstdwfile_close(ZSTDWFILE_T state)
+{
+    int ret = 0;
+
+    /* If not initialized yet, nothing to flush. */
+    if (state->size_out != 0) {
+        if (state->err == 0 && state->frame_in != 0)
+            (void)zstd_end_frame(state);
+        if (state->err == 0)
+            (void)zstd_write_seek_table(state);
+        ret = state->err;
+        g_free(state->out);
+        ZSTD_freeCStream(state->zstd_cstream);
+    }
+    g_array_free(state->frames, true);
+
+    /* Close file */
+    if (ws_close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+/* Immediately close the file after an error has occurred writing or
+   flushing; do nothing other than freeing memory and closing file
+   descriptors. Returns no error. */
+void
+zstdwfile_close_after_error(ZSTDWFILE_T state)
+{
+    /* If not initialized yet, nothing to flush. */
+    if (state->size_out != 0) {
+        g_free(state->out);
+        ZSTD_freeCStream(state->zstd_cstream);
+    }
+    g_array_free(state->frames, true);
+
+    /* Close file */
+    (void)ws_close(state->fd);
+    g_free(state);
+}
+
+int
+zstdwfile_geterr(ZSTDWFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_ZSTD */
@@ -16,6 +16,8 @@
 
 #include <wireshark.h>
 
+#include <wsutil/shm_ring.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -31,6 +33,42 @@ typedef enum {
     WS_FILE_UNKNOWN_COMPRESSION, /**< File appears compressed but the algorithm could not be identified */
 } ws_compression_type;
 
+/*
+ * Compressed files we write are split into independently compressed
+ * frames (zstd) or members (gzip), each holding at most
+ * WS_COMPRESSED_FRAME_SIZE bytes of uncompressed data, and end with a
+ * table of the compressed and uncompressed size of each of them. A reader
+ * that finds the table can start decompressing at any frame, rather than
+ * at the beginning of the file.
+ *
+ * For zstd, the table is the seek table of the "seekable" zstd format,
+ * in a skippable frame at the end of the file:
+ *
+ *   https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+ *
+ * For gzip, the table is in the extra field of an empty member at the end
+ * of the file, so other gzip readers ignore it. The member has only the
+ * fixed header, with FLG.FEXTRA set, and a single extra subfield with the
+ * ID WS_GZIP_INDEX_SI1 WS_GZIP_INDEX_SI2, holding, little-endian, the
+ * compressed and uncompressed size of each preceding member as 32-bit
+ * values, then the number of members and WS_GZIP_INDEX_MAGIC as 32-bit
+ * values. It is followed by an empty deflate block and a zero CRC and
+ * length, so the file ends with WS_GZIP_INDEX_TRAILER_SIZE fixed bytes
+ * after the table.
+ */
+#define WS_COMPRESSED_FRAME_SIZE        (1024 * 1024)
+
+#define WS_ZSTD_SKIPPABLE_MAGIC         0x184D2A5E
+#define WS_ZSTD_SEEKABLE_MAGIC          0x8F92EAB1
+#define WS_ZSTD_SEEKABLE_FOOTER_SIZE    9
+
+#define WS_GZIP_INDEX_SI1               'W'
+#define WS_GZIP_INDEX_SI2               'S'
+#define WS_GZIP_INDEX_MAGIC             0x58444957  /* "WIDX" */
+#define WS_GZIP_INDEX_HEADER_SIZE       16          /* fixed header, XLEN, subfield header */
+#define WS_GZIP_INDEX_TRAILER_SIZE      10          /* empty block, CRC, ISIZE */
+#define WS_GZIP_INDEX_MAX_MEMBERS       ((65535 - 4 - 8) / 8)
+
 /**
  * @brief Converts a compression type name to its corresponding enum value.
  *
@@ -150,6 +188,22 @@ ws_cwstream_fdopen(int fd, ws_compression_type ctype, int *err);
 WS_DLL_PUBLIC ws_cwstream*
 ws_cwstream_open_stdout(ws_compression_type ctype, int *err);
 
+/**
+ * @brief Mirror the data written to an uncompressed stream into a
+ * shared-memory ring, so that a reader in another process can get it
+ * from there instead of reading the file.
+ *
+ * Must be called before anything is written to the stream. The ring
+ * isn't owned by the stream; it must outlive it.
+ *
+ * @param pfile Pointer to the ws_cwstream structure.
+ * @param ring The ring, or NULL to stop mirroring.
+ * @return true if the stream is mirrored, false if ring is NULL or the
+ * stream is compressed.
+ */
+WS_DLL_PUBLIC bool
+ws_cwstream_set_shm_ring(ws_cwstream* pfile, ws_shm_ring* ring);
+
 /* Write to file */
 /**
  * @brief Writes data to a compressed writable stream.
@@ -229,6 +283,18 @@ WS_DLL_PUBLIC void lz4wfile_close_after_error(LZ4WFILE_T state);
 WS_DLL_PUBLIC int lz4wfile_geterr(LZ4WFILE_T state);
 #endif
 
+#ifdef HAVE_ZSTD
+typedef struct zstd_writer *ZSTDWFILE_T;
+
+WS_DLL_PUBLIC ZSTDWFILE_T zstdwfile_open(const char *path);
+WS_DLL_PUBLIC ZSTDWFILE_T zstdwfile_fdopen(int fd);
+WS_DLL_PUBLIC size_t zstdwfile_write(ZSTDWFILE_T state, const void *buf, size_t len);
+WS_DLL_PUBLIC int zstdwfile_flush(ZSTDWFILE_T state);
+WS_DLL_PUBLIC int zstdwfile_close(ZSTDWFILE_T state);
+WS_DLL_PUBLIC void zstdwfile_close_after_error(ZSTDWFILE_T state);
+WS_DLL_PUBLIC int zstdwfile_geterr(ZSTDWFILE_T state);
+#endif /* HAVE_ZSTD */
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -822,6 +822,22 @@ json_dumper_value_uint(json_dumper *dumper, uint64_t value)
     dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
 }
 
+void
+json_dumper_skip_value(json_dumper *dumper)
+{
+    if (!json_dumper_check_previous_error(dumper)) {
+        return;
+    }
+    if (!json_dumper_setting_value_ok(dumper)) {
+        return;
+    }
+    // What prepare_token() does to the state, without printing anything.
+    if (dumper->current_depth > 0) {
+        dumper->state[dumper->current_depth - 1] &= ~JSON_DUMPER_HAS_NAME;
+    }
+    dumper->state[dumper->current_depth] = JSON_DUMPER_TYPE_VALUE;
+}
+
 bool
 json_dumper_finish(json_dumper *dumper)
 {
@@ -840,6 +856,12 @@ json_dumper_finish(json_dumper *dumper)
     return true;
 }
 
+void
+json_dumper_flush(json_dumper *dumper)
+{
+    jd_flush(dumper);
+}
+
 void
 json_dumper_begin_base64(json_dumper *dumper)
 {
@@ -231,6 +231,19 @@ json_dumper_value_int(json_dumper *dumper, int64_t value);
 WS_DLL_PUBLIC void
 json_dumper_value_uint(json_dumper *dumper, uint64_t value);
 
+/**
+ * @brief Accounts for a value without writing anything.
+ *
+ * For when something else writes the value in its place, such as another
+ * dumper with a copy of this one's state: the next value written gets a
+ * separator, and a closing array or object a newline, as if the value
+ * had been written here.
+ *
+ * @param dumper The JSON dumper context.
+ */
+WS_DLL_PUBLIC void
+json_dumper_skip_value(json_dumper *dumper);
+
 /**
  * @brief Begins a base64-encoded data block.
  *
@@ -274,6 +287,18 @@ json_dumper_write_base64(json_dumper *dumper, const unsigned char *data, size_t
 WS_DLL_PUBLIC bool
 json_dumper_finish(json_dumper *dumper);
 
+/**
+ * @brief Writes out any output buffered by the dumper.
+ *
+ * Needed before anything else writes to the output file, e.g. after
+ * the output file has been redirected or before the process forks.
+ * It doesn't flush the output file itself.
+ *
+ * @param dumper The JSON dumper context.
+ */
+WS_DLL_PUBLIC void
+json_dumper_flush(json_dumper *dumper);
+
 #ifdef __cplusplus
 }
 #endif
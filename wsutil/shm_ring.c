@@ -0,0 +1,345 @@
+/* shm_ring.c
+ * Shared-memory mirror of a capture file being written
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define _GNU_SOURCE /* For memfd_create() */
+#include "config.h"
+#include "shm_ring.h"
+
+#include <glib.h>
+
+#include "ws_attributes.h"
+
+#ifdef HAVE_MEMFD_CREATE
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_RING_MAGIC      0x57534d52  /* "WSMR" */
+#define SHM_RING_VERSION    1
+#define SHM_RING_MIN_SIZE   (64 * 1024)
+#define SHM_RING_MAX_SIZE   ((size_t)1 << 30)
+
+/*
+ * The header at the start of the shared memory. The data area follows it;
+ * byte N of the current file is at data[N & (data_size - 1)].
+ *
+ * generation is odd while the writer switches files. write_pos is the
+ * number of bytes of the file written to the ring, and is advanced before
+ * the data is copied, so that a reader that sees the new data also sees
+ * the new write_pos. flush_pos is the number of bytes readers may copy.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t data_size;
+    _Atomic uint64_t generation;
+    _Atomic uint64_t file_dev;
+    _Atomic uint64_t file_ino;
+    _Atomic uint64_t write_pos;
+    _Atomic uint64_t flush_pos;
+} shm_ring_hdr;
+
+#define SHM_RING_HDR_SIZE   4096
+
+struct ws_shm_ring {
+    int refcount;
+    int fd;
+    void *map;
+    size_t map_size;
+    shm_ring_hdr *hdr;
+    uint8_t *data;
+    uint64_t mask;
+};
+
+static ws_shm_ring *
+shm_ring_map(int fd, size_t data_size)
+{
+    ws_shm_ring *ring;
+    size_t map_size = SHM_RING_HDR_SIZE + data_size;
+    void *map;
+
+    map = mmap(NULL, map_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return NULL;
+
+    ring = g_new0(ws_shm_ring, 1);
+    ring->refcount = 1;
+    ring->fd = fd;
+    ring->map = map;
+    ring->map_size = map_size;
+    ring->hdr = (shm_ring_hdr *)map;
+    ring->data = (uint8_t *)map + SHM_RING_HDR_SIZE;
+    ring->mask = data_size - 1;
+    return ring;
+}
+
+ws_shm_ring *
+ws_shm_ring_create(size_t size)
+{
+    ws_shm_ring *ring;
+    size_t data_size = SHM_RING_MIN_SIZE;
+    int fd;
+
+    while (data_size < size && data_size < SHM_RING_MAX_SIZE)
+        data_size <<= 1;
+
+    fd = memfd_create("wireshark-capture", MFD_CLOEXEC);
+    if (fd == -1)
+        return NULL;
+    if (ftruncate(fd, (off_t)(SHM_RING_HDR_SIZE + data_size)) == -1) {
+        close(fd);
+        return NULL;
+    }
+    ring = shm_ring_map(fd, data_size);
+    if (ring == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    /* The memory is zero-filled, so no file is current yet. */
+    ring->hdr->magic = SHM_RING_MAGIC;
+    ring->hdr->version = SHM_RING_VERSION;
+    ring->hdr->data_size = data_size;
+    return ring;
+}
+
+ws_shm_ring *
+ws_shm_ring_open(int fd)
+{
+    ws_shm_ring *ring;
+    shm_ring_hdr hdr;
+    struct stat st;
+
+    if (fstat(fd, &st) == -1 || st.st_size < SHM_RING_HDR_SIZE)
+        return NULL;
+    if (pread(fd, &hdr, sizeof hdr, 0) != (ssize_t)sizeof hdr)
+        return NULL;
+    if (hdr.magic != SHM_RING_MAGIC || hdr.version != SHM_RING_VERSION ||
+        hdr.data_size < SHM_RING_MIN_SIZE || hdr.data_size > SHM_RING_MAX_SIZE ||
+        (hdr.data_size & (hdr.data_size - 1)) != 0 ||
+        (uint64_t)st.st_size < SHM_RING_HDR_SIZE + hdr.data_size)
+        return NULL;
+
+    ring = shm_ring_map(fd, (size_t)hdr.data_size);
+    if (ring == NULL)
+        return NULL;
+    /* The fd may have been inherited without close-on-exec. */
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return ring;
+}
+
+int
+ws_shm_ring_fd(const ws_shm_ring *ring)
+{
+    return ring->fd;
+}
+
+ws_shm_ring *
+ws_shm_ring_ref(ws_shm_ring *ring)
+{
+    g_atomic_int_inc(&ring->refcount);
+    return ring;
+}
+
+void
+ws_shm_ring_unref(ws_shm_ring *ring)
+{
+    if (ring == NULL || !g_atomic_int_dec_and_test(&ring->refcount))
+        return;
+    munmap(ring->map, ring->map_size);
+    close(ring->fd);
+    g_free(ring);
+}
+
+bool
+ws_shm_ring_file_id(int fd, uint64_t *dev, uint64_t *ino)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) == -1)
+        return false;
+    *dev = (uint64_t)st.st_dev;
+    *ino = (uint64_t)st.st_ino;
+    return true;
+}
+
+bool
+ws_shm_ring_new_file(ws_shm_ring *ring, int fd)
+{
+    shm_ring_hdr *hdr = ring->hdr;
+    uint64_t gen = atomic_load_explicit(&hdr->generation, memory_order_relaxed) | 1;
+    uint64_t dev = 0, ino = 0;
+    bool ok;
+
+    ok = ws_shm_ring_file_id(fd, &dev, &ino);
+
+    /* Readers that see an odd generation, or a different one after
+     * copying, discard what they copied. */
+    atomic_store_explicit(&hdr->generation, gen, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&hdr->file_dev, ok ? dev : 0, memory_order_relaxed);
+    atomic_store_explicit(&hdr->file_ino, ok ? ino : 0, memory_order_relaxed);
+    atomic_store_explicit(&hdr->write_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&hdr->flush_pos, 0, memory_order_relaxed);
+    /* A ring that doesn't know its file stays odd, so nothing is found. */
+    if (ok)
+        atomic_store_explicit(&hdr->generation, gen + 1, memory_order_release);
+    return ok;
+}
+
+void
+ws_shm_ring_write(ws_shm_ring *ring, const void *data, size_t len)
+{
+    shm_ring_hdr *hdr = ring->hdr;
+    uint64_t pos = atomic_load_explicit(&hdr->write_pos, memory_order_relaxed);
+    uint64_t size = ring->mask + 1;
+    const uint8_t *src = (const uint8_t *)data;
+    size_t off, first;
+
+    atomic_store_explicit(&hdr->write_pos, pos + len, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    /* Only the last size bytes survive anyway. */
+    if (len > size) {
+        src += len - size;
+        pos += len - size;
+        len = (size_t)size;
+    }
+    off = (size_t)(pos & ring->mask);
+    first = MIN(len, (size_t)size - off);
+    memcpy(ring->data + off, src, first);
+    memcpy(ring->data, src + first, len - first);
+}
+
+void
+ws_shm_ring_flush(ws_shm_ring *ring)
+{
+    shm_ring_hdr *hdr = ring->hdr;
+
+    atomic_store_explicit(&hdr->flush_pos,
+                          atomic_load_explicit(&hdr->write_pos, memory_order_relaxed),
+                          memory_order_release);
+}
+
+size_t
+ws_shm_ring_read(ws_shm_ring *ring, uint64_t dev, uint64_t ino,
+                 uint64_t offset, void *buf, size_t len)
+{
+    shm_ring_hdr *hdr = ring->hdr;
+    uint64_t size = ring->mask + 1;
+    uint64_t gen, flush_pos, write_pos;
+    size_t off, first;
+
+    gen = atomic_load_explicit(&hdr->generation, memory_order_acquire);
+    if (gen & 1)
+        return 0;
+    if (atomic_load_explicit(&hdr->file_dev, memory_order_relaxed) != dev ||
+        atomic_load_explicit(&hdr->file_ino, memory_order_relaxed) != ino)
+        return 0;
+    flush_pos = atomic_load_explicit(&hdr->flush_pos, memory_order_acquire);
+    write_pos = atomic_load_explicit(&hdr->write_pos, memory_order_relaxed);
+    if (offset >= flush_pos || offset + size < write_pos)
+        return 0;
+
+    len = (size_t)MIN((uint64_t)len, flush_pos - offset);
+    off = (size_t)(offset & ring->mask);
+    first = MIN(len, (size_t)size - off);
+    memcpy(buf, ring->data + off, first);
+    memcpy((uint8_t *)buf + first, ring->data, len - first);
+
+    /* If the writer started overwriting what we copied, or switched
+     * files, we have to read it from the file after all. */
+    atomic_thread_fence(memory_order_acquire);
+    write_pos = atomic_load_explicit(&hdr->write_pos, memory_order_relaxed);
+    if (atomic_load_explicit(&hdr->generation, memory_order_relaxed) != gen ||
+        offset + size < write_pos)
+        return 0;
+    return len;
+}
+
+#else /* HAVE_MEMFD_CREATE */
+
+ws_shm_ring *
+ws_shm_ring_create(size_t size _U_)
+{
+    return NULL;
+}
+
+ws_shm_ring *
+ws_shm_ring_open(int fd _U_)
+{
+    return NULL;
+}
+
+int
+ws_shm_ring_fd(const ws_shm_ring *ring _U_)
+{
+    return -1;
+}
+
+ws_shm_ring *
+ws_shm_ring_ref(ws_shm_ring *ring)
+{
+    return ring;
+}
+
+void
+ws_shm_ring_unref(ws_shm_ring *ring _U_)
+{
+}
+
+bool
+ws_shm_ring_new_file(ws_shm_ring *ring _U_, int fd _U_)
+{
+    return false;
+}
+
+void
+ws_shm_ring_write(ws_shm_ring *ring _U_, const void *data _U_, size_t len _U_)
+{
+}
+
+void
+ws_shm_ring_flush(ws_shm_ring *ring _U_)
+{
+}
+
+bool
+ws_shm_ring_file_id(int fd _U_, uint64_t *dev _U_, uint64_t *ino _U_)
+{
+    return false;
+}
+
+size_t
+ws_shm_ring_read(ws_shm_ring *ring _U_, uint64_t dev _U_, uint64_t ino _U_,
+                 uint64_t offset _U_, void *buf _U_, size_t len _U_)
+{
+    return 0;
+}
+
+#endif /* HAVE_MEMFD_CREATE */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,155 @@
+/** @file
+ *
+ * Shared-memory mirror of a capture file being written.
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WS_SHM_RING_H__
+#define __WS_SHM_RING_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @brief Default size of the data area of a ring, in bytes.
+ */
+#define WS_SHM_RING_DEFAULT_SIZE (64 * 1024 * 1024)
+
+/**
+ * @brief A shared-memory ring holding the most recently written bytes of
+ * a capture file.
+ *
+ * The capture child writes every byte it writes to the capture file to the
+ * ring as well, keyed by its offset in the file. A reader of the same file
+ * in another process can then copy recently written data out of the ring
+ * instead of reading it back from the file system. Data that has already
+ * been overwritten in the ring, or that belongs to another file, is simply
+ * not found, and the reader falls back to reading the file.
+ *
+ * There is a single writer and any number of readers. Readers never block
+ * the writer; they validate what they copied afterwards, as with a seqlock.
+ *
+ * Rings are only available where memfd_create() is; elsewhere
+ * ws_shm_ring_create() and ws_shm_ring_open() return NULL.
+ */
+typedef struct ws_shm_ring ws_shm_ring;
+
+/**
+ * @brief Create a new ring backed by an anonymous shared-memory file.
+ *
+ * The file descriptor is close-on-exec; to hand the ring to a child
+ * process, pass it a dup() of it.
+ *
+ * @param size Size of the data area in bytes. Rounded up to a power of two.
+ * @return The new ring, with one reference, or NULL if shared memory isn't
+ * available.
+ */
+WS_DLL_PUBLIC ws_shm_ring *ws_shm_ring_create(size_t size);
+
+/**
+ * @brief Map a ring created by another process.
+ *
+ * @param fd The ring's file descriptor, as returned by ws_shm_ring_fd() in
+ * the creating process. The ring takes ownership of it.
+ * @return The ring, with one reference, or NULL if fd isn't a valid ring.
+ */
+WS_DLL_PUBLIC ws_shm_ring *ws_shm_ring_open(int fd);
+
+/**
+ * @brief Get the file descriptor of a ring.
+ *
+ * @param ring The ring.
+ * @return The file descriptor backing the ring.
+ */
+WS_DLL_PUBLIC int ws_shm_ring_fd(const ws_shm_ring *ring);
+
+/**
+ * @brief Add a reference to a ring.
+ *
+ * @param ring The ring.
+ * @return The ring.
+ */
+WS_DLL_PUBLIC ws_shm_ring *ws_shm_ring_ref(ws_shm_ring *ring);
+
+/**
+ * @brief Drop a reference to a ring. When the last one is dropped, the
+ * ring is unmapped and its file descriptor closed.
+ *
+ * @param ring The ring. May be NULL.
+ */
+WS_DLL_PUBLIC void ws_shm_ring_unref(ws_shm_ring *ring);
+
+/**
+ * @brief Start mirroring a new file.
+ *
+ * Discards the data of the previous file. Subsequent writes start at
+ * offset 0 of the file.
+ *
+ * @param ring The ring.
+ * @param fd A file descriptor for the new file, used to identify it.
+ * @return true on success, false if the file can't be identified.
+ */
+WS_DLL_PUBLIC bool ws_shm_ring_new_file(ws_shm_ring *ring, int fd);
+
+/**
+ * @brief Append data that was written to the current file.
+ *
+ * The data isn't visible to readers until ws_shm_ring_flush() is called.
+ *
+ * @param ring The ring.
+ * @param data The data.
+ * @param len Length of the data.
+ */
+WS_DLL_PUBLIC void ws_shm_ring_write(ws_shm_ring *ring, const void *data, size_t len);
+
+/**
+ * @brief Make everything written so far visible to readers.
+ *
+ * Call this once the data has also been flushed to the file.
+ *
+ * @param ring The ring.
+ */
+WS_DLL_PUBLIC void ws_shm_ring_flush(ws_shm_ring *ring);
+
+/**
+ * @brief Get the identity of a file, for ws_shm_ring_read().
+ *
+ * @param fd A file descriptor for the file.
+ * @param dev Set to the device of the file.
+ * @param ino Set to the inode of the file.
+ * @return true on success, false if the file can't be identified.
+ */
+WS_DLL_PUBLIC bool ws_shm_ring_file_id(int fd, uint64_t *dev, uint64_t *ino);
+
+/**
+ * @brief Copy data of a file out of a ring.
+ *
+ * @param ring The ring.
+ * @param dev Device of the file, from ws_shm_ring_file_id().
+ * @param ino Inode of the file, from ws_shm_ring_file_id().
+ * @param offset Offset in the file of the first byte to copy.
+ * @param buf Buffer to copy the data into.
+ * @param len Maximum number of bytes to copy.
+ * @return The number of bytes copied, or 0 if the ring doesn't hold the
+ * data at offset, in which case it must be read from the file.
+ */
+WS_DLL_PUBLIC size_t ws_shm_ring_read(ws_shm_ring *ring, uint64_t dev, uint64_t ino,
+                                      uint64_t offset, void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WS_SHM_RING_H__ */
@@ -984,6 +984,371 @@ test_sap_lzclzh_decompress_errors(void)
 }
 
 
+#include "buffer.h"
+
+static void
+test_buffer_release(void *lender)
+{
+    (*(int *)lender)++;
+}
+
+static void
+test_buffer_borrow(void)
+{
+    static const uint8_t lent[] = "borrowed data";
+    static const uint8_t other[] = "other data";
+    Buffer buf;
+    int released = 0, other_released = 0;
+
+    ws_buffer_init(&buf, 0);
+
+    /* The buffer refers to the lent memory until it's told to own it. */
+    ws_buffer_borrow(&buf, lent, sizeof lent, test_buffer_release, &released);
+    g_assert_true(ws_buffer_start_ptr(&buf) == lent);
+    g_assert_cmpuint(ws_buffer_length(&buf), ==, sizeof lent);
+    ws_buffer_own(&buf);
+    g_assert_true(ws_buffer_start_ptr(&buf) != lent);
+    g_assert_cmpmem(ws_buffer_start_ptr(&buf), ws_buffer_length(&buf), lent, sizeof lent);
+    g_assert_cmpint(released, ==, 1);
+    ws_buffer_own(&buf);
+    g_assert_cmpint(released, ==, 1);
+
+    /* Borrowing something else releases what was borrowed before. */
+    ws_buffer_clean(&buf);
+    ws_buffer_borrow(&buf, lent, sizeof lent, test_buffer_release, &released);
+    ws_buffer_borrow(&buf, other, sizeof other, test_buffer_release, &other_released);
+    g_assert_cmpint(released, ==, 2);
+    g_assert_cmpint(other_released, ==, 0);
+    g_assert_true(ws_buffer_start_ptr(&buf) == other);
+
+    /* Growing copies the data first. */
+    ws_buffer_append(&buf, lent, sizeof lent);
+    g_assert_cmpint(other_released, ==, 1);
+    g_assert_cmpuint(ws_buffer_length(&buf), ==, sizeof other + sizeof lent);
+    g_assert_cmpmem(ws_buffer_start_ptr(&buf), sizeof other, other, sizeof other);
+
+    /* Freeing a borrowing buffer releases the memory and frees the
+     * buffer's own. */
+    ws_buffer_clean(&buf);
+    ws_buffer_borrow(&buf, lent, sizeof lent, test_buffer_release, &released);
+    ws_buffer_free(&buf);
+    g_assert_cmpint(released, ==, 3);
+
+    /* A lender needn't want to know. */
+    ws_buffer_init(&buf, 0);
+    ws_buffer_borrow(&buf, lent, sizeof lent, NULL, NULL);
+    ws_buffer_own(&buf);
+    g_assert_cmpmem(ws_buffer_start_ptr(&buf), ws_buffer_length(&buf), lent, sizeof lent);
+    ws_buffer_free(&buf);
+}
+
+#include "json_dumper.h"
+
+static void
+test_json_dumper_skip_value(void)
+{
+    json_dumper full = { .output_string = g_string_new(NULL), .flags = JSON_DUMPER_FLAGS_PRETTY_PRINT };
+    json_dumper first = { .output_string = g_string_new(NULL), .flags = JSON_DUMPER_FLAGS_PRETTY_PRINT };
+    json_dumper second, third;
+    GString *split;
+    size_t prefix_len;
+
+    json_dumper_begin_array(&full);
+    json_dumper_begin_object(&full);
+    json_dumper_set_member_name(&full, "a");
+    json_dumper_value_uint(&full, 1);
+    json_dumper_end_object(&full);
+    json_dumper_value_uint(&full, 2);
+    json_dumper_value_string(&full, "three");
+    json_dumper_end_array(&full);
+    g_assert_true(json_dumper_finish(&full));
+
+    /* The same array written by three dumpers, each writing one element
+     * and skipping the ones the others write. */
+    json_dumper_begin_array(&first);
+    json_dumper_begin_object(&first);
+    json_dumper_set_member_name(&first, "a");
+    json_dumper_value_uint(&first, 1);
+    json_dumper_end_object(&first);
+    json_dumper_flush(&first);
+    prefix_len = first.output_string->len;
+
+    second = first;
+    second.output_string = g_string_new(NULL);
+    json_dumper_value_uint(&second, 2);
+    json_dumper_flush(&second);
+
+    third = first;
+    third.output_string = g_string_new(NULL);
+    json_dumper_skip_value(&third);
+    json_dumper_value_string(&third, "three");
+    json_dumper_flush(&third);
+
+    json_dumper_skip_value(&first);
+    json_dumper_skip_value(&first);
+    json_dumper_end_array(&first);
+    g_assert_true(json_dumper_finish(&first));
+
+    split = g_string_new_len(first.output_string->str, prefix_len);
+    g_string_append(split, second.output_string->str);
+    g_string_append(split, third.output_string->str);
+    g_string_append(split, first.output_string->str + prefix_len);
+    g_assert_cmpstr(split->str, ==, full.output_string->str);
+
+    g_string_free(split, true);
+    g_string_free(full.output_string, true);
+    g_string_free(first.output_string, true);
+    g_string_free(second.output_string, true);
+    g_string_free(third.output_string, true);
+}
+
+#ifdef HAVE_MEMFD_CREATE
+#include <unistd.h>
+#include "shm_ring.h"
+
+#define SHM_RING_TEST_SIZE (64 * 1024)
+
+/* The byte at an offset of the test file. Bytes a multiple of the ring
+ * size apart differ, so that stale data in the ring is caught. */
+static uint8_t
+shm_ring_test_byte(uint64_t offset)
+{
+    return (uint8_t)(offset ^ (offset >> 8) ^ ((offset >> 16) * 37));
+}
+
+/* Start a new test file, unlinked, and make it the ring's current file. */
+static int
+shm_ring_test_file(ws_shm_ring *ring, uint64_t *dev, uint64_t *ino)
+{
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp("shm_ring_XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, !=, -1);
+    unlink(path);
+    g_free(path);
+    g_assert_true(ws_shm_ring_new_file(ring, fd));
+    g_assert_true(ws_shm_ring_file_id(fd, dev, ino));
+    return fd;
+}
+
+/* Append len bytes to the test file and the ring, as the capture child
+ * does. */
+static void
+shm_ring_test_write(ws_shm_ring *ring, int fd, uint64_t *offset, size_t len)
+{
+    uint8_t buf[4096];
+
+    while (len > 0) {
+        size_t n = MIN(len, sizeof buf);
+
+        for (size_t i = 0; i < n; i++)
+            buf[i] = shm_ring_test_byte(*offset + i);
+        g_assert_cmpint(write(fd, buf, n), ==, (ssize_t)n);
+        ws_shm_ring_write(ring, buf, n);
+        *offset += n;
+        len -= n;
+    }
+}
+
+/* Check that the ring holds len bytes of the test file at offset. */
+static void
+shm_ring_test_check(ws_shm_ring *ring, uint64_t dev, uint64_t ino,
+                    uint64_t offset, size_t len)
+{
+    uint8_t *buf = (uint8_t *)g_malloc(len);
+
+    g_assert_cmpuint(ws_shm_ring_read(ring, dev, ino, offset, buf, len), ==, len);
+    for (size_t i = 0; i < len; i++)
+        g_assert_cmpuint(buf[i], ==, shm_ring_test_byte(offset + i));
+    g_free(buf);
+}
+
+/* Read the test file up to end the way a reader does, from the ring if
+ * it still holds the data and from the file otherwise, and check it. */
+static void
+shm_ring_test_consume(ws_shm_ring *ring, int fd, uint64_t dev, uint64_t ino,
+                      uint64_t *offset, uint64_t end,
+                      unsigned *ring_reads, unsigned *file_reads)
+{
+    uint8_t buf[1000];
+
+    while (*offset < end) {
+        size_t len = (size_t)MIN(sizeof buf, end - *offset);
+        size_t n;
+
+        n = ws_shm_ring_read(ring, dev, ino, *offset, buf, len);
+        if (n > 0) {
+            (*ring_reads)++;
+        } else {
+            ssize_t got = pread(fd, buf, len, (off_t)*offset);
+
+            g_assert_cmpint(got, >=, 0);
+            if (got == 0) {
+                /* Not written yet. */
+                g_thread_yield();
+                continue;
+            }
+            n = (size_t)got;
+            (*file_reads)++;
+        }
+        for (size_t i = 0; i < n; i++)
+            g_assert_cmpuint(buf[i], ==, shm_ring_test_byte(*offset + i));
+        *offset += n;
+    }
+}
+
+static void
+test_shm_ring_wraparound(void)
+{
+    ws_shm_ring *writer, *reader;
+    uint64_t dev, ino, offset = 0;
+    uint8_t buf[16];
+    int fd;
+
+    writer = ws_shm_ring_create(SHM_RING_TEST_SIZE);
+    g_assert_nonnull(writer);
+    /* Read through a mapping of our own, as another process would. */
+    reader = ws_shm_ring_open(dup(ws_shm_ring_fd(writer)));
+    g_assert_nonnull(reader);
+    fd = shm_ring_test_file(writer, &dev, &ino);
+
+    /* Writes of varying sizes, so that some straddle the end of the
+     * data area. */
+    while (offset < 5 * SHM_RING_TEST_SIZE) {
+        uint64_t start = offset;
+
+        shm_ring_test_write(writer, fd, &offset, 1000 + (size_t)(offset % 777));
+        g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, start, buf, sizeof buf), ==, 0);
+        ws_shm_ring_flush(writer);
+        shm_ring_test_check(reader, dev, ino, start, (size_t)(offset - start));
+    }
+
+    /* The last ring size worth of data is there, wrapped around; anything
+     * older isn't. */
+    shm_ring_test_check(reader, dev, ino, offset - SHM_RING_TEST_SIZE, SHM_RING_TEST_SIZE);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, offset - SHM_RING_TEST_SIZE - 1, buf, 1), ==, 0);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, offset, buf, 1), ==, 0);
+
+    close(fd);
+    ws_shm_ring_unref(reader);
+    ws_shm_ring_unref(writer);
+}
+
+static void
+test_shm_ring_full(void)
+{
+    ws_shm_ring *writer, *reader;
+    uint64_t dev, ino, dev2, ino2, offset = 0;
+    uint8_t buf[100];
+    int fd, fd2;
+
+    writer = ws_shm_ring_create(SHM_RING_TEST_SIZE);
+    g_assert_nonnull(writer);
+    reader = ws_shm_ring_open(dup(ws_shm_ring_fd(writer)));
+    g_assert_nonnull(reader);
+    fd = shm_ring_test_file(writer, &dev, &ino);
+
+    /* A full ring still holds all of the file. */
+    shm_ring_test_write(writer, fd, &offset, SHM_RING_TEST_SIZE);
+    ws_shm_ring_flush(writer);
+    shm_ring_test_check(reader, dev, ino, 0, SHM_RING_TEST_SIZE);
+
+    /* One more byte overwrites the first one. */
+    shm_ring_test_write(writer, fd, &offset, 1);
+    ws_shm_ring_flush(writer);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, 0, buf, 1), ==, 0);
+    shm_ring_test_check(reader, dev, ino, 1, SHM_RING_TEST_SIZE);
+
+    /* Data being overwritten is gone even before the flush, and reads
+     * stop at the flushed data. */
+    shm_ring_test_write(writer, fd, &offset, 10);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, 1, buf, 1), ==, 0);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, SHM_RING_TEST_SIZE - 10, buf, sizeof buf), ==, 11);
+
+    /* Nothing of the previous file is found once the writer switches. */
+    fd2 = shm_ring_test_file(writer, &dev2, &ino2);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev, ino, SHM_RING_TEST_SIZE - 10, buf, 1), ==, 0);
+    g_assert_cmpuint(ws_shm_ring_read(reader, dev2, ino2, 0, buf, 1), ==, 0);
+
+    close(fd2);
+    close(fd);
+    ws_shm_ring_unref(reader);
+    ws_shm_ring_unref(writer);
+}
+
+typedef struct {
+    ws_shm_ring *ring;
+    int fd;
+    uint64_t end;
+} shm_ring_test_producer;
+
+static void *
+shm_ring_test_produce(void *data)
+{
+    shm_ring_test_producer *producer = (shm_ring_test_producer *)data;
+    uint64_t offset = 0;
+
+    while (offset < producer->end) {
+        size_t len = (size_t)MIN(100 + offset % 3000, producer->end - offset);
+
+        shm_ring_test_write(producer->ring, producer->fd, &offset, len);
+        ws_shm_ring_flush(producer->ring);
+    }
+    return NULL;
+}
+
+static void
+test_shm_ring_resync(void)
+{
+    ws_shm_ring *writer, *reader;
+    shm_ring_test_producer producer;
+    GThread *thread;
+    uint64_t dev, ino, offset = 0, read_offset = 0;
+    unsigned ring_reads = 0, file_reads = 0;
+    int fd;
+
+    writer = ws_shm_ring_create(SHM_RING_TEST_SIZE);
+    g_assert_nonnull(writer);
+    reader = ws_shm_ring_open(dup(ws_shm_ring_fd(writer)));
+    g_assert_nonnull(reader);
+
+    /* The writer laps the reader: the start of the file has to come from
+     * the file, and once the reader catches up with what the ring holds,
+     * the rest comes from the ring. */
+    fd = shm_ring_test_file(writer, &dev, &ino);
+    shm_ring_test_write(writer, fd, &offset, 3 * SHM_RING_TEST_SIZE);
+    ws_shm_ring_flush(writer);
+    shm_ring_test_consume(reader, fd, dev, ino, &read_offset, 2 * SHM_RING_TEST_SIZE,
+                          &ring_reads, &file_reads);
+    g_assert_cmpuint(ring_reads, ==, 0);
+    g_assert_cmpuint(file_reads, >, 0);
+    file_reads = 0;
+    shm_ring_test_consume(reader, fd, dev, ino, &read_offset, offset,
+                          &ring_reads, &file_reads);
+    g_assert_cmpuint(ring_reads, >, 0);
+    g_assert_cmpuint(file_reads, ==, 0);
+    close(fd);
+
+    /* The same with the writer running concurrently; whatever the ring
+     * hands out must never be data the writer is overwriting. */
+    producer.ring = writer;
+    producer.fd = shm_ring_test_file(writer, &dev, &ino);
+    producer.end = 64 * SHM_RING_TEST_SIZE;
+    read_offset = 0;
+    thread = g_thread_new("shm_ring_producer", shm_ring_test_produce, &producer);
+    shm_ring_test_consume(reader, producer.fd, dev, ino, &read_offset, producer.end,
+                          &ring_reads, &file_reads);
+    g_thread_join(thread);
+    g_assert_cmpuint(read_offset, ==, producer.end);
+    close(producer.fd);
+
+    ws_shm_ring_unref(reader);
+    ws_shm_ring_unref(writer);
+}
+#endif /* HAVE_MEMFD_CREATE */
+
+
 #include <wsutil/strtoi.h>
 
 static void
@@ -1329,6 +1694,16 @@ int main(int argc, char **argv)
     g_test_add_func("/sap_lzclzh_decompress", test_sap_lzclzh_decompress);
     g_test_add_func("/sap_lzclzh_decompress/errors", test_sap_lzclzh_decompress_errors);
 
+    g_test_add_func("/buffer/borrow", test_buffer_borrow);
+
+    g_test_add_func("/json_dumper/skip_value", test_json_dumper_skip_value);
+
+#ifdef HAVE_MEMFD_CREATE
+    g_test_add_func("/shm_ring/wraparound", test_shm_ring_wraparound);
+    g_test_add_func("/shm_ring/full", test_shm_ring_full);
+    g_test_add_func("/shm_ring/resync", test_shm_ring_resync);
+#endif
+
     ret = g_test_run();
 
     return ret;
@@ -14,6 +14,7 @@
 #define __WMEM_H__
 
 #include "wmem_array.h"
+#include "wmem_btree.h"
 #include "wmem_core.h"
 #include "wmem_list.h"
 #include "wmem_map.h"
@@ -0,0 +1,508 @@
+/* wmem_btree.c
+ * Wireshark Memory Manager B-Tree
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "wmem-int.h"
+#include "wmem_core.h"
+#include "wmem_btree.h"
+#include "wmem_user_cb.h"
+
+/* Most keys (in a leaf) or children (in an inner node) a node holds. */
+#define WMEM_BTREE32_ORDER 32
+
+/*
+ * All the keys and values are in the leaves, which are linked in key order.
+ *
+ * In an inner node, keys[i] is a lower bound of the keys under children[i]
+ * and an upper bound (exclusive) of those under children[i - 1]; keys[0]
+ * isn't used when searching. The keys come first so that a search only
+ * touches the start of the node.
+ */
+typedef struct _wmem_btree32_node_t {
+    uint16_t count;     /* Number of keys in a leaf, of children in an inner node */
+    bool     leaf;
+    uint32_t keys[WMEM_BTREE32_ORDER];
+    void    *ptrs[WMEM_BTREE32_ORDER];      /* Values in a leaf, children in an inner node */
+    struct _wmem_btree32_node_t *prev;      /* Neighbouring leaves */
+    struct _wmem_btree32_node_t *next;
+} wmem_btree32_node_t;
+
+struct _wmem_btree32_t {
+    wmem_allocator_t    *metadata_allocator;
+    wmem_allocator_t    *data_allocator;
+    wmem_btree32_node_t *root;
+    unsigned             count;
+
+    unsigned             metadata_scope_cb_id;
+    unsigned             data_scope_cb_id;
+};
+
+#define CHILD(node, i) ((wmem_btree32_node_t *)(node)->ptrs[i])
+
+/* Index of the first of the n keys that is greater than key. */
+static inline unsigned
+upper_bound(const uint32_t *keys, unsigned n, uint32_t key)
+{
+    unsigned lo = 0, hi = n;
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Index of the first of the n keys that is greater than or equal to key. */
+static inline unsigned
+lower_bound(const uint32_t *keys, unsigned n, uint32_t key)
+{
+    unsigned lo = 0, hi = n;
+
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+
+        if (keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Index of the child of an inner node that key belongs under. */
+static inline unsigned
+child_index(const wmem_btree32_node_t *node, uint32_t key)
+{
+    return upper_bound(node->keys + 1, node->count - 1U, key);
+}
+
+static wmem_btree32_node_t *
+find_leaf(const wmem_btree32_t *tree, uint32_t key)
+{
+    wmem_btree32_node_t *node = tree->root;
+
+    if (node == NULL)
+        return NULL;
+    while (!node->leaf)
+        node = CHILD(node, child_index(node, key));
+    return node;
+}
+
+wmem_btree32_t *
+wmem_btree32_new(wmem_allocator_t *allocator)
+{
+    wmem_btree32_t *tree;
+
+    tree = wmem_new0(allocator, wmem_btree32_t);
+    tree->metadata_allocator = allocator;
+    tree->data_allocator = allocator;
+
+    return tree;
+}
+
+static bool
+wmem_btree32_reset_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event,
+        void *user_data)
+{
+    wmem_btree32_t *tree = (wmem_btree32_t *)user_data;
+
+    tree->root = NULL;
+    tree->count = 0;
+
+    if (event == WMEM_CB_DESTROY_EVENT) {
+        wmem_unregister_callback(tree->metadata_allocator, tree->metadata_scope_cb_id);
+        wmem_free(tree->metadata_allocator, tree);
+    }
+
+    return true;
+}
+
+static bool
+wmem_btree32_destroy_cb(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_,
+        void *user_data)
+{
+    wmem_btree32_t *tree = (wmem_btree32_t *)user_data;
+
+    wmem_unregister_callback(tree->data_allocator, tree->data_scope_cb_id);
+
+    return false;
+}
+
+wmem_btree32_t *
+wmem_btree32_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_scope)
+{
+    wmem_btree32_t *tree;
+
+    tree = wmem_new0(metadata_scope, wmem_btree32_t);
+    tree->metadata_allocator = metadata_scope;
+    tree->data_allocator = data_scope;
+
+    tree->metadata_scope_cb_id = wmem_register_callback(metadata_scope, wmem_btree32_destroy_cb,
+            tree);
+    tree->data_scope_cb_id = wmem_register_callback(data_scope, wmem_btree32_reset_cb,
+            tree);
+
+    return tree;
+}
+
+static void
+free_btree_node(wmem_allocator_t *allocator, wmem_btree32_node_t *node, bool free_values)
+{
+    for (unsigned i = 0; i < node->count; i++) {
+        if (!node->leaf)
+            free_btree_node(allocator, CHILD(node, i), free_values);
+        else if (free_values)
+            wmem_free(allocator, node->ptrs[i]);
+    }
+    wmem_free(allocator, node);
+}
+
+void
+wmem_btree32_destroy(wmem_btree32_t *tree, bool free_values)
+{
+    if (tree->root)
+        free_btree_node(tree->data_allocator, tree->root, free_values);
+    if (tree->metadata_allocator) {
+        wmem_unregister_callback(tree->metadata_allocator, tree->metadata_scope_cb_id);
+    }
+    if (tree->data_allocator) {
+        wmem_unregister_callback(tree->data_allocator, tree->data_scope_cb_id);
+    }
+    wmem_free(tree->metadata_allocator, tree);
+}
+
+bool
+wmem_btree32_is_empty(const wmem_btree32_t *tree)
+{
+    return tree->root == NULL;
+}
+
+unsigned
+wmem_btree32_count(const wmem_btree32_t *tree)
+{
+    return tree->count;
+}
+
+static wmem_btree32_node_t *
+new_btree_node(wmem_allocator_t *allocator, bool leaf)
+{
+    wmem_btree32_node_t *node;
+
+    node = wmem_new(allocator, wmem_btree32_node_t);
+    node->count = 0;
+    node->leaf = leaf;
+    node->prev = NULL;
+    node->next = NULL;
+
+    return node;
+}
+
+static void
+node_insert_at(wmem_btree32_node_t *node, unsigned pos, uint32_t key, void *ptr)
+{
+    unsigned n = node->count - pos;
+
+    memmove(&node->keys[pos + 1], &node->keys[pos], n * sizeof node->keys[0]);
+    memmove(&node->ptrs[pos + 1], &node->ptrs[pos], n * sizeof node->ptrs[0]);
+    node->keys[pos] = key;
+    node->ptrs[pos] = ptr;
+    node->count++;
+}
+
+static void
+node_remove_at(wmem_btree32_node_t *node, unsigned pos)
+{
+    unsigned n = node->count - pos - 1;
+
+    memmove(&node->keys[pos], &node->keys[pos + 1], n * sizeof node->keys[0]);
+    memmove(&node->ptrs[pos], &node->ptrs[pos + 1], n * sizeof node->ptrs[0]);
+    node->count--;
+}
+
+/*
+ * Insert key and ptr at pos in a full node, by moving some of its entries
+ * to a new right sibling. The node is split in the middle, except when
+ * appending to the rightmost node of a level: then the new node gets only
+ * the new entry, so that keys inserted in increasing order fill the nodes
+ * instead of leaving them half empty.
+ */
+static wmem_btree32_node_t *
+node_split_insert(wmem_btree32_t *tree, wmem_btree32_node_t *node, unsigned pos,
+        uint32_t key, void *ptr, bool rightmost)
+{
+    wmem_btree32_node_t *right;
+    unsigned mid;
+
+    mid = (rightmost && pos == node->count) ? node->count : node->count / 2U;
+
+    right = new_btree_node(tree->data_allocator, node->leaf);
+    right->count = node->count - mid;
+    memcpy(right->keys, &node->keys[mid], right->count * sizeof node->keys[0]);
+    memcpy(right->ptrs, &node->ptrs[mid], right->count * sizeof node->ptrs[0]);
+    node->count = mid;
+
+    if (pos < mid)
+        node_insert_at(node, pos, key, ptr);
+    else
+        node_insert_at(right, pos - mid, key, ptr);
+
+    if (node->leaf) {
+        right->prev = node;
+        right->next = node->next;
+        if (node->next)
+            node->next->prev = right;
+        node->next = right;
+    }
+
+    return right;
+}
+
+/*
+ * Insert key under node. If node had to be split, returns its new right
+ * sibling, whose keys[0] is the separator to add to the parent.
+ */
+static wmem_btree32_node_t *
+btree32_insert_node(wmem_btree32_t *tree, wmem_btree32_node_t *node, uint32_t key,
+        void *data, bool rightmost)
+{
+    wmem_btree32_node_t *split;
+    unsigned pos;
+
+    if (node->leaf) {
+        pos = lower_bound(node->keys, node->count, key);
+        if (pos < node->count && node->keys[pos] == key) {
+            node->ptrs[pos] = data;
+            return NULL;
+        }
+        tree->count++;
+    } else {
+        unsigned i = child_index(node, key);
+
+        split = btree32_insert_node(tree, CHILD(node, i), key, data,
+                rightmost && i == node->count - 1U);
+        if (split == NULL)
+            return NULL;
+        pos = i + 1;
+        key = split->keys[0];
+        data = split;
+    }
+
+    if (node->count < WMEM_BTREE32_ORDER) {
+        node_insert_at(node, pos, key, data);
+        return NULL;
+    }
+    return node_split_insert(tree, node, pos, key, data, rightmost);
+}
+
+void
+wmem_btree32_insert(wmem_btree32_t *tree, uint32_t key, void *data)
+{
+    wmem_btree32_node_t *split, *root;
+
+    if (tree->root == NULL) {
+        tree->root = new_btree_node(tree->data_allocator, true);
+    }
+
+    split = btree32_insert_node(tree, tree->root, key, data, true);
+    if (split == NULL)
+        return;
+
+    /* The root was split; grow the tree by a level. */
+    root = new_btree_node(tree->data_allocator, false);
+    root->count = 2;
+    root->keys[0] = tree->root->keys[0];
+    root->ptrs[0] = tree->root;
+    root->keys[1] = split->keys[0];
+    root->ptrs[1] = split;
+    tree->root = root;
+}
+
+void *
+wmem_btree32_lookup(const wmem_btree32_t *tree, uint32_t key)
+{
+    const wmem_btree32_node_t *leaf = find_leaf(tree, key);
+    unsigned pos;
+
+    if (leaf == NULL)
+        return NULL;
+    pos = lower_bound(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && leaf->keys[pos] == key)
+        return leaf->ptrs[pos];
+    return NULL;
+}
+
+bool
+wmem_btree32_contains(const wmem_btree32_t *tree, uint32_t key)
+{
+    const wmem_btree32_node_t *leaf = find_leaf(tree, key);
+    unsigned pos;
+
+    if (leaf == NULL)
+        return false;
+    pos = lower_bound(leaf->keys, leaf->count, key);
+    return pos < leaf->count && leaf->keys[pos] == key;
+}
+
+void *
+wmem_btree32_lookup_le_full(const wmem_btree32_t *tree, uint32_t key, uint32_t *orig_key)
+{
+    const wmem_btree32_node_t *leaf = find_leaf(tree, key);
+    unsigned pos;
+
+    if (leaf == NULL)
+        return NULL;
+    pos = upper_bound(leaf->keys, leaf->count, key);
+    if (pos == 0) {
+        /* Every key in this leaf is greater; the answer ends the one before. */
+        leaf = leaf->prev;
+        if (leaf == NULL)
+            return NULL;
+        pos = leaf->count;
+    }
+    if (orig_key)
+        *orig_key = leaf->keys[pos - 1];
+    return leaf->ptrs[pos - 1];
+}
+
+void *
+wmem_btree32_lookup_le(const wmem_btree32_t *tree, uint32_t key)
+{
+    return wmem_btree32_lookup_le_full(tree, key, NULL);
+}
+
+void *
+wmem_btree32_lookup_ge_full(const wmem_btree32_t *tree, uint32_t key, uint32_t *orig_key)
+{
+    const wmem_btree32_node_t *leaf = find_leaf(tree, key);
+    unsigned pos;
+
+    if (leaf == NULL)
+        return NULL;
+    pos = lower_bound(leaf->keys, leaf->count, key);
+    if (pos == leaf->count) {
+        /* Every key in this leaf is smaller; the answer starts the next one. */
+        leaf = leaf->next;
+        if (leaf == NULL)
+            return NULL;
+        pos = 0;
+    }
+    if (orig_key)
+        *orig_key = leaf->keys[pos];
+    return leaf->ptrs[pos];
+}
+
+void *
+wmem_btree32_lookup_ge(const wmem_btree32_t *tree, uint32_t key)
+{
+    return wmem_btree32_lookup_ge_full(tree, key, NULL);
+}
+
+/*
+ * Remove key from under node, setting *data to its value. Returns true if
+ * node is left empty, in which case it has been freed and has to be
+ * removed from its parent.
+ */
+static bool
+btree32_remove_node(wmem_btree32_t *tree, wmem_btree32_node_t *node, uint32_t key,
+        void **data)
+{
+    unsigned pos;
+
+    if (node->leaf) {
+        pos = lower_bound(node->keys, node->count, key);
+        if (pos == node->count || node->keys[pos] != key)
+            return false;
+        *data = node->ptrs[pos];
+        tree->count--;
+    } else {
+        pos = child_index(node, key);
+        if (!btree32_remove_node(tree, CHILD(node, pos), key, data))
+            return false;
+    }
+
+    node_remove_at(node, pos);
+    if (node->count > 0)
+        return false;
+
+    if (node->leaf) {
+        if (node->prev)
+            node->prev->next = node->next;
+        if (node->next)
+            node->next->prev = node->prev;
+    }
+    wmem_free(tree->data_allocator, node);
+    return true;
+}
+
+void *
+wmem_btree32_remove(wmem_btree32_t *tree, uint32_t key)
+{
+    void *data = NULL;
+
+    if (tree->root == NULL)
+        return NULL;
+
+    if (btree32_remove_node(tree, tree->root, key, &data)) {
+        tree->root = NULL;
+        return data;
+    }
+
+    /* Drop roots that are left with a single child. */
+    while (!tree->root->leaf && tree->root->count == 1) {
+        wmem_btree32_node_t *root = tree->root;
+
+        tree->root = CHILD(root, 0);
+        wmem_free(tree->data_allocator, root);
+    }
+
+    return data;
+}
+
+bool
+wmem_btree32_foreach(const wmem_btree32_t *tree, wmem_foreach_func callback,
+        void *user_data)
+{
+    const wmem_btree32_node_t *leaf = tree->root;
+
+    if (leaf == NULL)
+        return false;
+    while (!leaf->leaf)
+        leaf = CHILD(leaf, 0);
+
+    for (; leaf; leaf = leaf->next) {
+        for (unsigned i = 0; i < leaf->count; i++) {
+            if (callback(GUINT_TO_POINTER(leaf->keys[i]), leaf->ptrs[i], user_data))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -0,0 +1,241 @@
+/** @file
+ * Definitions for the Wireshark Memory Manager B-Tree
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef __WMEM_BTREE_H__
+#define __WMEM_BTREE_H__
+
+#include "wmem_core.h"
+#include "wmem_tree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** @addtogroup wmem
+ *  @{
+ *    @defgroup wmem-btree B-Tree
+ *
+ *    A B+ tree indexed by uint32_t keys. It offers the 32-bit key subset of
+ *    the red/black tree API, but keeps up to 32 keys in each node, in a
+ *    sorted array, so a lookup touches a handful of nodes instead of one
+ *    node per level of a binary tree. The leaves are linked, so the
+ *    "less than or equal" and "greater than or equal" lookups never need
+ *    to climb back up the tree.
+ *
+ *    It is meant for large maps keyed by frame number or sequence number
+ *    that are looked up far more often than they are changed. Keys are
+ *    inserted in increasing order especially cheaply.
+ *
+ *    @{
+ */
+
+struct _wmem_btree32_t;
+
+/**
+ * @typedef wmem_btree32_t
+ * @brief Opaque type representing a B+ tree indexed by uint32_t keys.
+ */
+typedef struct _wmem_btree32_t wmem_btree32_t;
+
+/**
+ * @brief Creates a B-tree with the given allocator scope. When the scope is
+ * emptied, the tree is fully destroyed.
+ *
+ * @param allocator Allocator used for the tree.
+ * @return A pointer to the newly created tree.
+ */
+WS_DLL_PUBLIC
+wmem_btree32_t *
+wmem_btree32_new(wmem_allocator_t *allocator);
+
+/**
+ * @brief Creates a B-tree with two allocator scopes.
+ *
+ * As with wmem_tree_new_autoreset(), the base structure lives in the
+ * metadata scope and the nodes live in the data scope, and the tree is
+ * transparently emptied every time free_all occurs in the data scope.
+ *
+ * @param metadata_scope Allocator for the base structure.
+ * @param data_scope Allocator for the nodes, which resets on free_all.
+ * @return A pointer to the newly created tree.
+ */
+WS_DLL_PUBLIC
+wmem_btree32_t *
+wmem_btree32_new_autoreset(wmem_allocator_t *metadata_scope, wmem_allocator_t *data_scope);
+
+/**
+ * @brief Cleanup memory used by a B-tree.
+ *
+ * Intended for NULL scope allocated trees.
+ *
+ * @param tree The tree to destroy.
+ * @param free_values Whether to free the values stored in the tree.
+ */
+WS_DLL_PUBLIC
+void
+wmem_btree32_destroy(wmem_btree32_t *tree, bool free_values);
+
+/**
+ * @brief Check whether a B-tree is empty.
+ *
+ * @param tree Pointer to the tree to check.
+ * @return True if the tree is empty, false otherwise.
+ */
+WS_DLL_PUBLIC
+bool
+wmem_btree32_is_empty(const wmem_btree32_t *tree);
+
+/**
+ * @brief Get the number of keys in a B-tree.
+ *
+ * @param tree Pointer to the tree.
+ * @return The number of keys in the tree.
+ */
+WS_DLL_PUBLIC
+unsigned
+wmem_btree32_count(const wmem_btree32_t *tree);
+
+/**
+ * @brief Insert a value under a uint32_t key.
+ *
+ * If the key is already in the tree, its value is overwritten.
+ *
+ * @param tree Pointer to the tree where the value will be inserted.
+ * @param key The uint32_t key used to index the value.
+ * @param data Pointer to the data to associate with the key.
+ */
+WS_DLL_PUBLIC
+void
+wmem_btree32_insert(wmem_btree32_t *tree, uint32_t key, void *data);
+
+/**
+ * @brief Check whether a key is in a B-tree.
+ *
+ * @param tree Pointer to the tree to search.
+ * @param key The uint32_t key to look up.
+ * @return True if the key is in the tree, false otherwise.
+ */
+WS_DLL_PUBLIC
+bool
+wmem_btree32_contains(const wmem_btree32_t *tree, uint32_t key);
+
+/**
+ * @brief Look up the value stored under a uint32_t key.
+ *
+ * @param tree Pointer to the tree to search.
+ * @param key The uint32_t key to look up.
+ * @return Pointer to the data associated with the key, or NULL if not found.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_btree32_lookup(const wmem_btree32_t *tree, uint32_t key);
+
+/**
+ * @brief Look up the value with the largest key that is less than or equal
+ * to the search key.
+ *
+ * @param tree Pointer to the tree to search.
+ * @param key The uint32_t key used as the upper bound for the lookup.
+ * @return Pointer to the data associated with the closest matching key, or NULL if none found.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_btree32_lookup_le(const wmem_btree32_t *tree, uint32_t key);
+
+/**
+ * @brief Look up the value with the largest key that is less than or equal
+ * to the search key, and return that key.
+ *
+ * @param tree Pointer to the tree to search.
+ * @param key The uint32_t key used as the upper bound for the lookup.
+ * @param orig_key Pointer to store the key that was found, if any. May be NULL.
+ * @return Pointer to the data associated with the closest matching key, or NULL if none found.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_btree32_lookup_le_full(const wmem_btree32_t *tree, uint32_t key, uint32_t *orig_key);
+
+/**
+ * @brief Look up the value with the smallest key that is greater than or
+ * equal to the search key.
+ *
+ * @param tree Pointer to the tree to search.
+ * @param key The uint32_t key used as the lower bound for the lookup.
+ * @return Pointer to the data associated with the closest matching key, or NULL if none found.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_btree32_lookup_ge(const wmem_btree32_t *tree, uint32_t key);
+
+/**
+ * @brief Look up the value with the smallest key that is greater than or
+ * equal to the search key, and return that key.
+ *
+ * @param tree Pointer to the tree to search.
+ * @param key The uint32_t key used as the lower bound for the lookup.
+ * @param orig_key Pointer to store the key that was found, if any. May be NULL.
+ * @return Pointer to the data associated with the closest matching key, or NULL if none found.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_btree32_lookup_ge_full(const wmem_btree32_t *tree, uint32_t key, uint32_t *orig_key);
+
+/**
+ * @brief Remove a uint32_t key from a B-tree.
+ *
+ * Nodes are freed when they become empty, but aren't merged with their
+ * neighbours, so a tree that shrinks keeps the height it grew to.
+ *
+ * @param tree Pointer to the tree from which the key will be removed.
+ * @param key The uint32_t key to remove.
+ * @return Pointer to the data that was stored at the key, or NULL if no such key exists.
+ */
+WS_DLL_PUBLIC
+void *
+wmem_btree32_remove(wmem_btree32_t *tree, uint32_t key);
+
+/**
+ * @brief Traverse a B-tree in increasing key order.
+ *
+ * The callback gets each key as GUINT_TO_POINTER(key), the way
+ * wmem_tree_foreach() passes 32-bit keys. Traversal stops early if the
+ * callback returns true.
+ *
+ * @param tree Pointer to the tree to traverse.
+ * @param callback Function to call for each key and value.
+ * @param user_data Pointer to user-defined data passed to the callback.
+ * @return True if the traversal was ended prematurely by the callback.
+ */
+WS_DLL_PUBLIC
+bool
+wmem_btree32_foreach(const wmem_btree32_t *tree, wmem_foreach_func callback,
+        void *user_data);
+
+/**   @}
+ *  @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __WMEM_BTREE_H__ */
+
+/*
+ * Editor modelines  -  https://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -1354,6 +1354,230 @@ wmem_test_tree(void)
 }
 
 
+static void
+wmem_test_btree(void)
+{
+    wmem_allocator_t   *allocator, *extra_allocator;
+    wmem_btree32_t     *btree;
+    wmem_tree_t        *tree;
+    uint32_t            i;
+    uint32_t            key, btree_key, tree_key;
+    void               *value;
+
+    allocator       = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+    extra_allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
+
+    btree = wmem_btree32_new(allocator);
+    g_assert_true(btree);
+    g_assert_true(wmem_btree32_is_empty(btree));
+
+    /* test basic operations with increasing keys */
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_btree32_lookup(btree, i) == NULL);
+        if (i > 0) {
+            g_assert_true(wmem_btree32_lookup_le_full(btree, i, &key) == GINT_TO_POINTER(i-1));
+            g_assert_true(key == i - 1);
+        }
+        g_assert_true(wmem_btree32_lookup_ge(btree, i) == NULL);
+        wmem_btree32_insert(btree, i, GINT_TO_POINTER(i));
+        g_assert_true(wmem_btree32_lookup(btree, i) == GINT_TO_POINTER(i));
+        g_assert_true(!wmem_btree32_is_empty(btree));
+    }
+    g_assert_true(wmem_btree32_count(btree) == CONTAINER_ITERS);
+    wmem_btree32_insert(btree, 0, GINT_TO_POINTER(1));
+    g_assert_true(wmem_btree32_lookup(btree, 0) == GINT_TO_POINTER(1));
+    g_assert_true(wmem_btree32_count(btree) == CONTAINER_ITERS);
+
+    for (i=0; i<CONTAINER_ITERS; i+=2) {
+        g_assert_true(wmem_btree32_remove(btree, i) == (i ? GINT_TO_POINTER(i) : GINT_TO_POINTER(1)));
+        g_assert_true(wmem_btree32_remove(btree, i) == NULL);
+    }
+    g_assert_true(wmem_btree32_count(btree) == CONTAINER_ITERS / 2);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_btree32_contains(btree, i) == (i % 2 == 1));
+        if (i > 0) {
+            g_assert_true(wmem_btree32_lookup_le(btree, i) == GINT_TO_POINTER(i - (i % 2 == 0)));
+        }
+        if (i + 1 < CONTAINER_ITERS) {
+            g_assert_true(wmem_btree32_lookup_ge_full(btree, i, &key) == GINT_TO_POINTER(i + (i % 2 == 0)));
+            g_assert_true(key == i + (i % 2 == 0));
+        }
+    }
+    for (i=1; i<CONTAINER_ITERS; i+=2) {
+        wmem_btree32_remove(btree, i);
+    }
+    g_assert_true(wmem_btree32_is_empty(btree));
+    g_assert_true(wmem_btree32_lookup_le(btree, CONTAINER_ITERS) == NULL);
+    wmem_free_all(allocator);
+
+    /* test random operations against the red/black tree */
+    btree = wmem_btree32_new(allocator);
+    tree  = wmem_tree_new(allocator);
+    for (i=0; i<CONTAINER_ITERS * 4; i++) {
+        key = ((uint32_t)g_test_rand_int()) % (CONTAINER_ITERS * 2);
+        if (i >= CONTAINER_ITERS * 2 && g_test_rand_bit()) {
+            g_assert_true(wmem_btree32_remove(btree, key) == wmem_tree_remove32(tree, key));
+        } else {
+            wmem_btree32_insert(btree, key, GINT_TO_POINTER(i));
+            wmem_tree_insert32(tree, key, GINT_TO_POINTER(i));
+        }
+
+        key = ((uint32_t)g_test_rand_int()) % (CONTAINER_ITERS * 2);
+        g_assert_true(wmem_btree32_lookup(btree, key) == wmem_tree_lookup32(tree, key));
+        btree_key = tree_key = 0;
+        value = wmem_btree32_lookup_le_full(btree, key, &btree_key);
+        g_assert_true(value == wmem_tree_lookup32_le_full(tree, key, &tree_key));
+        g_assert_true(value == NULL || btree_key == tree_key);
+        btree_key = tree_key = 0;
+        value = wmem_btree32_lookup_ge_full(btree, key, &btree_key);
+        g_assert_true(value == wmem_tree_lookup32_ge_full(tree, key, &tree_key));
+        g_assert_true(value == NULL || btree_key == tree_key);
+    }
+    g_assert_true(wmem_btree32_count(btree) == wmem_tree_count(tree));
+    wmem_free_all(allocator);
+
+    /* test auto-reset functionality */
+    btree = wmem_btree32_new_autoreset(allocator, extra_allocator);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        wmem_btree32_insert(btree, i, GINT_TO_POINTER(i));
+    }
+    g_assert_true(wmem_btree32_count(btree) == CONTAINER_ITERS);
+    wmem_free_all(extra_allocator);
+    g_assert_true(wmem_btree32_count(btree) == 0);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(wmem_btree32_lookup(btree, i) == NULL);
+        g_assert_true(wmem_btree32_lookup_le(btree, i) == NULL);
+    }
+    wmem_free_all(allocator);
+
+    /* test for-each functionality */
+    btree = wmem_btree32_new(allocator);
+    expected_user_data = GINT_TO_POINTER(g_test_rand_int());
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        do {
+            key = g_test_rand_int();
+        } while (wmem_btree32_contains(btree, key));
+        value_seen[i] = false;
+        wmem_btree32_insert(btree, key, GINT_TO_POINTER(i));
+    }
+
+    cb_called_count    = 0;
+    cb_continue_count  = CONTAINER_ITERS;
+    wmem_btree32_foreach(btree, wmem_test_foreach_cb, expected_user_data);
+    g_assert_true(cb_called_count   == CONTAINER_ITERS);
+    g_assert_true(cb_continue_count == 0);
+
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert_true(value_seen[i]);
+    }
+
+    wmem_destroy_allocator(extra_allocator);
+    wmem_destroy_allocator(allocator);
+}
+
+static void
+wmem_test_btreeperf(void)
+{
+#define BTREE_PERF_KEYS (2 * 1000 * 1000)
+    wmem_allocator_t   *allocator;
+    wmem_btree32_t     *btree;
+    wmem_tree_t        *tree;
+    uint32_t           *rand_keys = g_new(uint32_t, BTREE_PERF_KEYS);
+    uint32_t            i;
+    uintptr_t           sum;
+    double              start_utime, start_stime, end_utime, end_stime, utime_ms, stime_ms;
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+    /* Frame numbers are mostly inserted in increasing order, and looked up
+     * at random. */
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        rand_keys[i] = ((uint32_t)g_test_rand_int()) % (BTREE_PERF_KEYS * 2);
+    }
+
+/* Red/black tree */
+
+    tree = wmem_tree_new(allocator);
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        wmem_tree_insert32(tree, i * 2, GUINT_TO_POINTER(i + 1));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_tree_insert32 %d increasing keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+
+    sum = 0;
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        sum += GPOINTER_TO_UINT(wmem_tree_lookup32_le(tree, rand_keys[i]));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_tree_lookup32_le %d random keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        sum += GPOINTER_TO_UINT(wmem_tree_lookup32_ge(tree, rand_keys[i]));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_tree_lookup32_ge %d random keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+    g_assert_true(sum != 0);
+    wmem_free_all(allocator);
+
+    tree = wmem_tree_new(allocator);
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        wmem_tree_insert32(tree, rand_keys[i], GUINT_TO_POINTER(i + 1));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_tree_insert32 %d random keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+    wmem_free_all(allocator);
+
+/* B-tree */
+
+    btree = wmem_btree32_new(allocator);
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        wmem_btree32_insert(btree, i * 2, GUINT_TO_POINTER(i + 1));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_btree32_insert %d increasing keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+
+    sum = 0;
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        sum += GPOINTER_TO_UINT(wmem_btree32_lookup_le(btree, rand_keys[i]));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_btree32_lookup_le %d random keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        sum += GPOINTER_TO_UINT(wmem_btree32_lookup_ge(btree, rand_keys[i]));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_btree32_lookup_ge %d random keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+    g_assert_true(sum != 0);
+    wmem_free_all(allocator);
+
+    btree = wmem_btree32_new(allocator);
+    RESOURCE_USAGE_START;
+    for (i = 0; i < BTREE_PERF_KEYS; i++) {
+        wmem_btree32_insert(btree, rand_keys[i], GUINT_TO_POINTER(i + 1));
+    }
+    RESOURCE_USAGE_END;
+    g_test_minimized_result(utime_ms + stime_ms,
+        "wmem_btree32_insert %d random keys: u %.3f ms s %.3f ms", BTREE_PERF_KEYS, utime_ms, stime_ms);
+
+    wmem_destroy_allocator(allocator);
+    g_free(rand_keys);
+}
+
 /* to be used as userdata in the callback wmem_test_itree_check_overlap_cb*/
 typedef struct wmem_test_itree_user_data {
     wmem_range_t range;
@@ -1486,8 +1710,13 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/strbuf", wmem_test_strbuf);
     g_test_add_func("/wmem/datastruct/strbuf/validate", wmem_test_strbuf_validate);
     g_test_add_func("/wmem/datastruct/tree",   wmem_test_tree);
+    g_test_add_func("/wmem/datastruct/btree",  wmem_test_btree);
     g_test_add_func("/wmem/datastruct/itree",  wmem_test_itree);
 
+    if (g_test_perf()) {
+        g_test_add_func("/wmem/datastruct/btreeperf", wmem_test_btreeperf);
+    }
+
     ret = g_test_run();
 
     wmem_cleanup();